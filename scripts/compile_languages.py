@@ -0,0 +1,123 @@
+#Compiles data/languages/*.json into binary catalogs loaded by CLocalization
+#usage: compile_languages.py <language.json> <language.catalog>
+#
+#layout (little endian int32):
+#	"TWLC", version, num entries, num buckets, table size, strings size
+#	displacements[num buckets]
+#	slots[table size] (entry index or -1)
+#	entries[num entries] (key offset, 7 version offsets or -1)
+#	strings (zero terminated, utf-8)
+#
+#Keys are placed with hash and displace: the bucket of a key is
+#Hash(key, 0) % num buckets and its slot Hash(key, displacements[bucket]) % table size.
+
+import json, struct, sys
+
+VERSION = 1
+PLURALS = ["value", "zero", "one", "two", "few", "many", "other"]
+
+def Hash(Data, Seed):
+	h = (2166136261 ^ Seed) & 0xffffffff
+	for b in Data:
+		h ^= b
+		h = (h * 16777619) & 0xffffffff
+	return h
+
+def StripTrailingCommas(Text):
+	#json-parser accepts trailing commas, the python one does not
+	Out = []
+	InString = False
+	i = 0
+	while i < len(Text):
+		c = Text[i]
+		if InString:
+			Out.append(c)
+			if c == '\\':
+				Out.append(Text[i+1])
+				i += 1
+			elif c == '"':
+				InString = False
+		elif c == '"':
+			InString = True
+			Out.append(c)
+		elif c == ',':
+			j = i+1
+			while j < len(Text) and Text[j] in ' \t\r\n':
+				j += 1
+			if j >= len(Text) or Text[j] not in '}]':
+				Out.append(c)
+		else:
+			Out.append(c)
+		i += 1
+	return ''.join(Out)
+
+def LoadEntries(Filename):
+	Data = json.loads(StripTrailingCommas(open(Filename, encoding="utf-8").read()))
+	Entries = {}
+	for Item in Data.get("translation", []):
+		Key = Item.get("key")
+		if not Key:
+			continue
+		Versions = Entries.setdefault(Key, [None]*len(PLURALS))
+		if Item.get("value"):
+			Versions[0] = Item["value"]
+		else:
+			for i in range(1, len(PLURALS)):
+				if Item.get(PLURALS[i]):
+					Versions[i] = Item[PLURALS[i]]
+	return Entries
+
+def BuildTable(Keys):
+	TableSize = max(1, len(Keys) + len(Keys)//4)
+	NumBuckets = max(1, len(Keys)//4)
+	Buckets = [[] for i in range(NumBuckets)]
+	for Index, Key in enumerate(Keys):
+		Buckets[Hash(Key, 0) % NumBuckets].append(Index)
+
+	Displacements = [0]*NumBuckets
+	Slots = [-1]*TableSize
+	for Bucket in sorted(range(NumBuckets), key=lambda b: -len(Buckets[b])):
+		if not Buckets[Bucket]:
+			continue
+		Seed = 1
+		while True:
+			Wanted = [Hash(Keys[i], Seed) % TableSize for i in Buckets[Bucket]]
+			if len(set(Wanted)) == len(Wanted) and all(Slots[s] == -1 for s in Wanted):
+				break
+			Seed += 1
+		Displacements[Bucket] = Seed
+		for i, s in zip(Buckets[Bucket], Wanted):
+			Slots[s] = i
+	return Displacements, Slots
+
+def Compile(Input, Output):
+	Entries = LoadEntries(Input)
+	Keys = [k.encode("utf-8") for k in Entries]
+	Displacements, Slots = BuildTable(Keys)
+
+	Strings = bytearray()
+	def AddString(s):
+		Offset = len(Strings)
+		Strings.extend(s + b"\0")
+		return Offset
+
+	EntryData = bytearray()
+	for Key, Versions in zip(Keys, Entries.values()):
+		EntryData += struct.pack("<i", AddString(Key))
+		for v in Versions:
+			EntryData += struct.pack("<i", AddString(v.encode("utf-8")) if v else -1)
+
+	f = open(Output, "wb")
+	f.write(b"TWLC")
+	f.write(struct.pack("<5i", VERSION, len(Keys), len(Displacements), len(Slots), len(Strings)))
+	f.write(struct.pack("<%di" % len(Displacements), *Displacements))
+	f.write(struct.pack("<%di" % len(Slots), *Slots))
+	f.write(EntryData)
+	f.write(Strings)
+	f.close()
+
+if __name__ == "__main__":
+	if len(sys.argv) != 3:
+		print("usage: %s <language.json> <language.catalog>" % sys.argv[0])
+		sys.exit(1)
+	Compile(sys.argv[1], sys.argv[2])
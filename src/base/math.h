@@ -61,6 +61,12 @@ inline int gcd(int a, int b)
 	return a;
 }
 
+// spatial hash of a grid cell, for bucketing positions by their cell
+inline unsigned cell_hash(int x, int y)
+{
+	return ((unsigned)x*73856093u)^((unsigned)y*19349663u);
+}
+
 class fxp
 {
 	int value;
@@ -26,6 +26,14 @@
 	#include <arpa/inet.h>
 
 	#include <dirent.h>
+	#include <sys/mman.h>
+
+	#if defined(CONF_PLATFORM_LINUX)
+		#include <stdint.h>
+		#include <sys/epoll.h>
+		#include <sys/eventfd.h>
+		#include <sys/timerfd.h>
+	#endif
 
 	#if defined(CONF_PLATFORM_MACOSX)
 		#include <Carbon/Carbon.h>
@@ -39,6 +47,7 @@
 	#include <ws2tcpip.h>
 	#include <fcntl.h>
 	#include <direct.h>
+	#include <sys/stat.h>
 	#include <errno.h>
 
 	//for crypto stuff:
@@ -72,10 +81,304 @@ void dbg_logger(DBG_LOGGER logger)
 	loggers[num_loggers++] = logger;
 }
 
+/* async logging: dbg_msg only copies the line into a bounded multi producer queue,
+	a background thread hands the lines to the loggers */
+#if defined(__GNUC__)
+#define LOG_ASYNC_SUPPORTED
+/* the flusher sleeps on a semaphore until a line is queued, without one it polls */
+#if !defined(CONF_PLATFORM_MACOSX)
+#define LOG_WAKEUP_SUPPORTED
+#endif
+#endif
+
+enum
+{
+	LOG_QUEUE_SIZE = 1024, /* power of two */
+	LOG_LINE_SIZE = 1024 - sizeof(unsigned),
+	LOG_NUM_CATEGORIES = 64,
+};
+
+typedef struct
+{
+	volatile unsigned seq;
+	char line[LOG_LINE_SIZE];
+} LOG_SLOT;
+
+typedef struct
+{
+	volatile int state; /* 0 free, 1 taking the name, 2 in use */
+	char sys[32];
+	volatile unsigned window; /* second of the current window */
+	volatile unsigned count; /* lines logged in the window */
+	volatile unsigned suppressed; /* lines dropped in the window */
+} LOG_CATEGORY;
+
+static LOG_SLOT log_queue[LOG_QUEUE_SIZE];
+static volatile unsigned log_head = 0; /* next slot to write */
+static unsigned log_tail = 0; /* next slot to read, only touched by the flusher */
+static volatile int log_async = 0;
+static volatile int log_stop = 0;
+static void *log_thread = 0;
+static unsigned log_rate_limit = 0;
+static LOG_CATEGORY log_categories[LOG_NUM_CATEGORIES];
+static volatile unsigned log_dropped = 0;
+static volatile unsigned log_limited = 0;
+#if defined(LOG_ASYNC_SUPPORTED)
+static __thread int log_on_flusher = 0;
+#endif
+#if defined(LOG_WAKEUP_SUPPORTED)
+static SEMAPHORE log_wakeup;
+static volatile int log_waiting = 0; /* set by the flusher before it sleeps, cleared by whoever wakes it */
+#endif
+
+static void log_write_line(const char *line)
+{
+	int i;
+	for(i = 0; i < num_loggers; i++)
+		loggers[i](line);
+}
+
+static int log_flush_queue()
+{
+	int num = 0;
+#if defined(LOG_ASYNC_SUPPORTED)
+	while(1)
+	{
+		unsigned pos = log_tail;
+		LOG_SLOT *slot = &log_queue[pos&(LOG_QUEUE_SIZE-1)];
+		if(slot->seq != pos+1)
+			break;
+		__sync_synchronize();
+		/* moved on before the loggers run, an assert in one of them drains the rest without this line */
+		log_tail = pos+1;
+		log_write_line(slot->line);
+		__sync_synchronize();
+		slot->seq = pos+LOG_QUEUE_SIZE;
+		num++;
+	}
+#endif
+	return num;
+}
+
+static void log_thread_func(void *user)
+{
+	log_on_flusher = 1;
+	while(!log_stop)
+	{
+		if(log_flush_queue())
+			continue;
+#if defined(LOG_WAKEUP_SUPPORTED)
+		/* announce the sleep before the last look at the queue, a producer that
+			queues after it sees the flag and wakes the flusher */
+		log_waiting = 1;
+		__sync_synchronize();
+		if(log_flush_queue() || log_stop)
+		{
+			/* a producer that cleared the flag in the meantime posts a wakeup, which only costs an extra round */
+			__sync_bool_compare_and_swap(&log_waiting, 1, 0);
+			continue;
+		}
+		semaphore_wait(&log_wakeup);
+#else
+		thread_sleep(2);
+#endif
+	}
+	log_flush_queue();
+}
+
+static void log_wake_flusher()
+{
+#if defined(LOG_WAKEUP_SUPPORTED)
+	__sync_synchronize();
+	if(log_waiting && __sync_bool_compare_and_swap(&log_waiting, 1, 0))
+		semaphore_signal(&log_wakeup);
+#endif
+}
+
+#if defined(LOG_ASYNC_SUPPORTED)
+/* the category of exactly this system, open addressing from its hash. 0 when the table
+	is full or the name too long, those lines are not limited */
+static LOG_CATEGORY *log_find_category(const char *sys)
+{
+	unsigned hash, i;
+	if(str_length(sys) >= (int)sizeof(log_categories[0].sys))
+		return 0;
+
+	hash = str_quickhash(sys);
+	for(i = 0; i < LOG_NUM_CATEGORIES; i++)
+	{
+		LOG_CATEGORY *category = &log_categories[(hash+i)&(LOG_NUM_CATEGORIES-1)];
+		if(category->state == 0 && __sync_bool_compare_and_swap(&category->state, 0, 1))
+		{
+			str_copy(category->sys, sys, sizeof(category->sys));
+			__sync_synchronize();
+			category->state = 2;
+			return category;
+		}
+
+		/* another thread may still be copying the name */
+		while(category->state != 2)
+			;
+		__sync_synchronize();
+		if(str_comp(category->sys, sys) == 0)
+			return category;
+	}
+	return 0;
+}
+#endif
+
+/* returns 0 if the line must be dropped, writes the summary of the last window before the first line of a new one */
+static int log_rate_check(const char *sys)
+{
+#if defined(LOG_ASYNC_SUPPORTED)
+	LOG_CATEGORY *category;
+	unsigned now, window, suppressed;
+
+	if(!log_rate_limit)
+		return 1;
+
+	category = log_find_category(sys);
+	if(!category)
+		return 1;
+	now = (unsigned)time(0);
+	window = category->window;
+	if(window != now && __sync_bool_compare_and_swap(&category->window, window, now))
+	{
+		suppressed = __sync_lock_test_and_set(&category->suppressed, 0);
+		category->count = 0;
+		if(suppressed)
+		{
+			char str[128];
+			str_format(str, sizeof(str), "[%08x][%s]: %u messages suppressed", (int)window, sys, suppressed);
+			dbg_log_line(str);
+		}
+	}
+
+	if(__sync_add_and_fetch(&category->count, 1) > log_rate_limit)
+	{
+		__sync_add_and_fetch(&category->suppressed, 1);
+		__sync_add_and_fetch(&log_limited, 1);
+		return 0;
+	}
+#endif
+	return 1;
+}
+
+void dbg_log_line(const char *line)
+{
+#if defined(LOG_ASYNC_SUPPORTED)
+	unsigned pos;
+	LOG_SLOT *slot;
+
+	/* too long for a slot, better late than truncated */
+	if(log_async && str_length(line) < LOG_LINE_SIZE)
+	{
+		pos = log_head;
+		while(1)
+		{
+			slot = &log_queue[pos&(LOG_QUEUE_SIZE-1)];
+			if(slot->seq == pos)
+			{
+				unsigned prev = __sync_val_compare_and_swap(&log_head, pos, pos+1);
+				if(prev == pos)
+					break;
+				pos = prev;
+			}
+			else if((int)(slot->seq - pos) < 0)
+			{
+				/* the flusher is LOG_QUEUE_SIZE lines behind, never wait for it */
+				__sync_add_and_fetch(&log_dropped, 1);
+				return;
+			}
+			else
+				pos = log_head;
+		}
+
+		str_copy(slot->line, line, sizeof(slot->line));
+		__sync_synchronize();
+		slot->seq = pos+1;
+		log_wake_flusher();
+		return;
+	}
+#endif
+	log_write_line(line);
+}
+
+void dbg_logger_async_start(int rate_limit)
+{
+#if defined(LOG_ASYNC_SUPPORTED)
+	unsigned i;
+	if(log_async)
+		return;
+
+	for(i = 0; i < LOG_QUEUE_SIZE; i++)
+		log_queue[i].seq = i;
+	log_head = 0;
+	log_tail = 0;
+	log_rate_limit = rate_limit > 0 ? rate_limit : 0;
+	log_stop = 0;
+#if defined(LOG_WAKEUP_SUPPORTED)
+	log_waiting = 0;
+	semaphore_init(&log_wakeup);
+#endif
+	log_thread = thread_init(log_thread_func, 0);
+	if(!log_thread)
+	{
+#if defined(LOG_WAKEUP_SUPPORTED)
+		semaphore_destroy(&log_wakeup);
+#endif
+		return;
+	}
+	__sync_synchronize();
+	log_async = 1;
+	atexit(dbg_logger_async_stop);
+#endif
+}
+
+void dbg_logger_async_stop()
+{
+#if defined(LOG_ASYNC_SUPPORTED)
+	if(!log_async)
+		return;
+
+	/* new lines are written directly while the flusher drains the queue */
+	log_async = 0;
+	__sync_synchronize();
+	log_stop = 1;
+#if defined(LOG_WAKEUP_SUPPORTED)
+	__sync_synchronize();
+	semaphore_signal(&log_wakeup);
+#endif
+	thread_wait(log_thread);
+	log_thread = 0;
+#if defined(LOG_WAKEUP_SUPPORTED)
+	semaphore_destroy(&log_wakeup);
+#endif
+#endif
+}
+
+void dbg_logger_async_stats(unsigned *dropped, unsigned *limited)
+{
+	*dropped = log_dropped;
+	*limited = log_limited;
+}
+
 void dbg_assert_imp(const char *filename, int line, int test, const char *msg)
 {
 	if(!test)
 	{
+		/* the process is about to stop, everything logged so far must reach the loggers.
+			the flusher can't wait for itself, it writes the rest of the queue directly */
+#if defined(LOG_ASYNC_SUPPORTED)
+		if(log_on_flusher)
+		{
+			log_async = 0;
+			__sync_synchronize();
+			log_flush_queue();
+		}
+		else
+#endif
+			dbg_logger_async_stop();
 		dbg_msg("assert", "%s(%d): %s", filename, line, msg);
 		dbg_break();
 	}
@@ -91,7 +394,10 @@ void dbg_msg(const char *sys, const char *fmt, ...)
 	va_list args;
 	char str[1024*4];
 	char *msg;
-	int i, len;
+	int len;
+
+	if(log_async && !log_rate_check(sys))
+		return;
 
 	str_format(str, sizeof(str), "[%08x][%s]: ", (int)time(0), sys);
 	len = strlen(str);
@@ -105,8 +411,7 @@ void dbg_msg(const char *sys, const char *fmt, ...)
 #endif
 	va_end(args);
 
-	for(i = 0; i < num_loggers; i++)
-		loggers[i](str);
+	dbg_log_line(str);
 }
 
 static void logger_stdout(const char *line)
@@ -145,11 +450,44 @@ void dbg_logger_file(const char *filename)
 }
 /* */
 
+static void mem_stats_add(int tag, int size, int count)
+{
+#if defined(__GNUC__)
+	__sync_add_and_fetch(&memory_stats.allocated, size);
+	__sync_add_and_fetch(&memory_stats.active_allocations, count);
+	__sync_add_and_fetch(&memory_stats.tag_allocated[tag], size);
+	__sync_add_and_fetch(&memory_stats.tag_active_allocations[tag], count);
+	if(count > 0)
+		__sync_add_and_fetch(&memory_stats.total_allocations, count);
+#else
+	memory_stats.allocated += size;
+	memory_stats.active_allocations += count;
+	memory_stats.tag_allocated[tag] += size;
+	memory_stats.tag_active_allocations[tag] += count;
+	if(count > 0)
+		memory_stats.total_allocations += count;
+#endif
+}
+
+#if defined(__GNUC__)
+typedef volatile int MEMLOCK;
+static void mem_lock(MEMLOCK *lock) { while(__sync_lock_test_and_set(lock, 1)) while(*lock); }
+static void mem_unlock(MEMLOCK *lock) { __sync_lock_release(lock); }
+#else
+typedef int MEMLOCK;
+static void mem_lock(MEMLOCK *lock) {}
+static void mem_unlock(MEMLOCK *lock) {}
+#endif
+
+#if defined(CONF_DEBUG)
+
+/* every block is guarded and listed, mem_check and mem_debug_dump can walk them */
 typedef struct MEMHEADER
 {
 	const char *filename;
 	int line;
 	int size;
+	int tag;
 	struct MEMHEADER *prev;
 	struct MEMHEADER *next;
 } MEMHEADER;
@@ -160,12 +498,12 @@ typedef struct MEMTAIL
 } MEMTAIL;
 
 static struct MEMHEADER *first = 0;
+static MEMLOCK mem_list_lock = 0;
 static const int MEM_GUARD_VAL = 0xbaadc0de;
 
-void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned alignment)
+void *mem_alloc_debug_tag(const char *filename, int line, unsigned size, unsigned alignment, int tag)
 {
 	/* TODO: fix alignment */
-	/* TODO: add debugging */
 	MEMTAIL *tail;
 	MEMHEADER *header = (struct MEMHEADER *)malloc(size+sizeof(MEMHEADER)+sizeof(MEMTAIL));
 	dbg_assert(header != 0, "mem_alloc failure");
@@ -175,18 +513,19 @@ void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned al
 	header->size = size;
 	header->filename = filename;
 	header->line = line;
+	header->tag = tag;
 
-	memory_stats.allocated += header->size;
-	memory_stats.total_allocations++;
-	memory_stats.active_allocations++;
+	mem_stats_add(tag, header->size, 1);
 
 	tail->guard = MEM_GUARD_VAL;
 
+	mem_lock(&mem_list_lock);
 	header->prev = (MEMHEADER *)0;
 	header->next = first;
 	if(first)
 		first->prev = header;
 	first = header;
+	mem_unlock(&mem_list_lock);
 
 	/*dbg_msg("mem", "++ %p", header+1); */
 	return header+1;
@@ -202,15 +541,16 @@ void mem_free(void *p)
 		if(tail->guard != MEM_GUARD_VAL)
 			dbg_msg("mem", "!! %p", p);
 		/* dbg_msg("mem", "-- %p", p); */
-		memory_stats.allocated -= header->size;
-		memory_stats.active_allocations--;
+		mem_stats_add(header->tag, -header->size, -1);
 
+		mem_lock(&mem_list_lock);
 		if(header->prev)
 			header->prev->next = header->next;
 		else
 			first = header->next;
 		if(header->next)
 			header->next->prev = header->prev;
+		mem_unlock(&mem_list_lock);
 
 		free(header);
 	}
@@ -219,57 +559,282 @@ void mem_free(void *p)
 void mem_debug_dump(IOHANDLE file)
 {
 	char buf[1024];
-	MEMHEADER *header = first;
+	MEMHEADER *header;
 	if(!file)
 		file = io_open("memory.txt", IOFLAG_WRITE);
 
 	if(file)
 	{
-		while(header)
+		mem_lock(&mem_list_lock);
+		for(header = first; header; header = header->next)
 		{
 			str_format(buf, sizeof(buf), "%s(%d): %d", header->filename, header->line, header->size);
 			io_write(file, buf, strlen(buf));
 			io_write_newline(file);
-			header = header->next;
 		}
+		mem_unlock(&mem_list_lock);
 
 		io_close(file);
 	}
 }
 
+int mem_check_imp()
+{
+	int result = 1;
+	MEMHEADER *header;
+	mem_lock(&mem_list_lock);
+	for(header = first; header; header = header->next)
+	{
+		MEMTAIL *tail = (MEMTAIL *)(((char*)(header+1))+header->size);
+		if(tail->guard != MEM_GUARD_VAL)
+		{
+			dbg_msg("mem", "Memory check failed at %s(%d): %d", header->filename, header->line, header->size);
+			result = 0;
+			break;
+		}
+	}
+	mem_unlock(&mem_list_lock);
 
-void mem_copy(void *dest, const void *source, unsigned size)
+	return result;
+}
+
+#else
+
+/* blocks are rounded up to power of two size classes. freed blocks go to a per thread
+	cache without any locking, full caches give half of their blocks to a shared depot */
+enum
 {
-	memcpy(dest, source, size);
+	MEM_MIN_CLASS_SHIFT = 5, /* 32 bytes with the header */
+	MEM_NUM_CLASSES = 12, /* up to 64k, which covers the snapshot holders */
+	MEM_CACHE_BYTES = 256*1024, /* per thread and class */
+	MEM_DEPOT_BYTES = 4*1024*1024, /* per class, the rest is given back to the system */
+	MEM_LARGE = -1,
+};
+
+typedef struct MEMHEADER
+{
+	unsigned size;
+	short size_class;
+	short tag;
+	struct MEMHEADER *next; /* free lists */
+} MEMHEADER;
+
+typedef struct
+{
+	MEMHEADER *first;
+	int num;
+} MEMLIST;
+
+typedef struct
+{
+	MEMLOCK lock;
+	MEMLIST blocks;
+} MEMDEPOT;
+
+static MEMDEPOT mem_depots[MEM_NUM_CLASSES];
+
+static unsigned mem_class_size(int size_class) { return 1u<<(size_class+MEM_MIN_CLASS_SHIFT); }
+static int mem_class_max_cached(int size_class) { int n = MEM_CACHE_BYTES/mem_class_size(size_class); return n < 8 ? 8 : n; }
+
+static void mem_list_push(MEMLIST *list, MEMHEADER *header)
+{
+	header->next = list->first;
+	list->first = header;
+	list->num++;
 }
 
-void mem_move(void *dest, const void *source, unsigned size)
+static MEMHEADER *mem_list_pop(MEMLIST *list)
 {
-	memmove(dest, source, size);
+	MEMHEADER *header = list->first;
+	if(header)
+	{
+		list->first = header->next;
+		list->num--;
+	}
+	return header;
 }
 
-void mem_zero(void *block,unsigned size)
+/* moves num blocks from a cache to the depot of their class */
+static void mem_depot_put(int size_class, MEMLIST *cache, int num)
 {
-	memset(block, 0, size);
+	MEMDEPOT *depot = &mem_depots[size_class];
+	int max_blocks = MEM_DEPOT_BYTES/mem_class_size(size_class);
+	MEMLIST release = {0, 0};
+
+	mem_lock(&depot->lock);
+	while(num-- > 0 && cache->first)
+	{
+		if(depot->blocks.num < max_blocks)
+			mem_list_push(&depot->blocks, mem_list_pop(cache));
+		else
+			mem_list_push(&release, mem_list_pop(cache));
+	}
+	mem_unlock(&depot->lock);
+
+	while(release.first)
+		free(mem_list_pop(&release));
 }
 
-int mem_check_imp()
+#if defined(__GNUC__) && defined(CONF_FAMILY_UNIX)
+#define MEM_THREAD_CACHE
+
+static __thread MEMLIST mem_cache[MEM_NUM_CLASSES];
+static __thread int mem_cache_registered = 0;
+static pthread_key_t mem_cache_key;
+static pthread_once_t mem_cache_once = PTHREAD_ONCE_INIT;
+
+/* a thread that ends gives its cached blocks to the depots */
+static void mem_cache_release(void *unused)
+{
+	int i;
+	for(i = 0; i < MEM_NUM_CLASSES; i++)
+		mem_depot_put(i, &mem_cache[i], mem_cache[i].num);
+}
+
+static void mem_cache_create_key() { pthread_key_create(&mem_cache_key, mem_cache_release); }
+
+static MEMLIST *mem_thread_cache(int size_class)
 {
-	MEMHEADER *header = first;
-	while(header)
+	if(!mem_cache_registered)
 	{
-		MEMTAIL *tail = (MEMTAIL *)(((char*)(header+1))+header->size);
-		if(tail->guard != MEM_GUARD_VAL)
+		pthread_once(&mem_cache_once, mem_cache_create_key);
+		pthread_setspecific(mem_cache_key, mem_cache);
+		mem_cache_registered = 1;
+	}
+	return &mem_cache[size_class];
+}
+#endif
+
+void *mem_alloc_debug_tag(const char *filename, int line, unsigned size, unsigned alignment, int tag)
+{
+	MEMHEADER *header = 0;
+	int size_class = 0;
+
+	while(size_class < MEM_NUM_CLASSES && size+sizeof(MEMHEADER) > mem_class_size(size_class))
+		size_class++;
+
+	if(size_class == MEM_NUM_CLASSES)
+	{
+		size_class = MEM_LARGE;
+		header = (MEMHEADER *)malloc(size+sizeof(MEMHEADER));
+	}
+	else
+	{
+#if defined(MEM_THREAD_CACHE)
+		MEMLIST *cache = mem_thread_cache(size_class);
+		if(!cache->first)
 		{
-			dbg_msg("mem", "Memory check failed at %s(%d): %d", header->filename, header->line, header->size);
-			return 0;
+			/* refill half a cache at once to keep the depot lock rare */
+			MEMDEPOT *depot = &mem_depots[size_class];
+			int num = mem_class_max_cached(size_class)/2;
+			mem_lock(&depot->lock);
+			while(num-- > 0 && depot->blocks.first)
+				mem_list_push(cache, mem_list_pop(&depot->blocks));
+			mem_unlock(&depot->lock);
 		}
-		header = header->next;
+		header = mem_list_pop(cache);
+#else
+		MEMDEPOT *depot = &mem_depots[size_class];
+		mem_lock(&depot->lock);
+		header = mem_list_pop(&depot->blocks);
+		mem_unlock(&depot->lock);
+#endif
+		if(!header)
+			header = (MEMHEADER *)malloc(mem_class_size(size_class));
+	}
+
+	dbg_assert(header != 0, "mem_alloc failure");
+	if(!header)
+		return NULL;
+
+	header->size = size;
+	header->size_class = size_class;
+	header->tag = tag;
+	mem_stats_add(tag, size, 1);
+	return header+1;
+}
+
+void mem_free(void *p)
+{
+	MEMHEADER *header;
+	if(!p)
+		return;
+
+	header = (MEMHEADER *)p - 1;
+	mem_stats_add(header->tag, -(int)header->size, -1);
+
+	if(header->size_class == MEM_LARGE)
+	{
+		free(header);
+		return;
+	}
+
+#if defined(MEM_THREAD_CACHE)
+	{
+		MEMLIST *cache = mem_thread_cache(header->size_class);
+		mem_list_push(cache, header);
+		if(cache->num > mem_class_max_cached(header->size_class))
+			mem_depot_put(header->size_class, cache, cache->num/2);
+	}
+#else
+	{
+		MEMLIST list = {0, 0};
+		mem_list_push(&list, header);
+		mem_depot_put(header->size_class, &list, 1);
 	}
+#endif
+}
+
+/* the blocks are not listed in this build, write what the statistics know */
+void mem_debug_dump(IOHANDLE file)
+{
+	static const char *tag_names[NUM_MEMTAGS] = {"other", "snapshot", "entity", "network", "map"};
+	char buf[256];
+	int i;
+	if(!file)
+		file = io_open("memory.txt", IOFLAG_WRITE);
+
+	if(file)
+	{
+		for(i = 0; i < NUM_MEMTAGS; i++)
+		{
+			str_format(buf, sizeof(buf), "%s: %d bytes in %d blocks", tag_names[i], memory_stats.tag_allocated[i], memory_stats.tag_active_allocations[i]);
+			io_write(file, buf, strlen(buf));
+			io_write_newline(file);
+		}
 
+		io_close(file);
+	}
+}
+
+int mem_check_imp()
+{
 	return 1;
 }
 
+#endif
+
+void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned alignment)
+{
+	return mem_alloc_debug_tag(filename, line, size, alignment, MEMTAG_OTHER);
+}
+
+void mem_copy(void *dest, const void *source, unsigned size)
+{
+	memcpy(dest, source, size);
+}
+
+void mem_move(void *dest, const void *source, unsigned size)
+{
+	memmove(dest, source, size);
+}
+
+void mem_zero(void *block,unsigned size)
+{
+	memset(block, 0, size);
+}
+
+
 IOHANDLE io_open(const char *filename, int flags)
 {
 	if(flags == IOFLAG_READ)
@@ -373,6 +938,47 @@ int io_flush(IOHANDLE io)
 	return 0;
 }
 
+const void *io_map(IOHANDLE io, unsigned *size)
+{
+	long int length = io_length(io);
+	*size = 0;
+	if(length <= 0)
+		return 0;
+
+#if defined(CONF_FAMILY_UNIX)
+	{
+		void *data = mmap(0, (size_t)length, PROT_READ, MAP_PRIVATE, fileno((FILE*)io), 0);
+		if(data == MAP_FAILED)
+			return 0;
+		*size = (unsigned)length;
+		return data;
+	}
+#else
+	{
+		void *data = mem_alloc((unsigned)length, 1);
+		if(io_read(io, data, (unsigned)length) != (unsigned)length)
+		{
+			mem_free(data);
+			return 0;
+		}
+		io_seek(io, 0, IOSEEK_START);
+		*size = (unsigned)length;
+		return data;
+	}
+#endif
+}
+
+void io_unmap(const void *data, unsigned size)
+{
+	if(!data)
+		return;
+#if defined(CONF_FAMILY_UNIX)
+	munmap((void *)data, size);
+#else
+	mem_free((void *)data);
+#endif
+}
+
 void *thread_create(void (*threadfunc)(void *), void *u)
 {
 #if defined(CONF_FAMILY_UNIX)
@@ -1448,6 +2054,21 @@ int fs_is_dir(const char *path)
 #endif
 }
 
+int fs_file_time(const char *name, time_t *modified)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	struct _stat sb;
+	if(_stat(name, &sb) == -1)
+		return 1;
+#else
+	struct stat sb;
+	if(stat(name, &sb) == -1)
+		return 1;
+#endif
+	*modified = sb.st_mtime;
+	return 0;
+}
+
 int fs_chdir(const char *path)
 {
 	if(fs_is_dir(path))
@@ -1564,6 +2185,171 @@ int net_socket_read_wait(NETSOCKET sock, int time)
 	return 0;
 }
 
+#if defined(CONF_PLATFORM_LINUX)
+struct WAITER
+{
+	int epoll;
+	int timer;
+	int event;
+};
+
+WAITER *waiter_create()
+{
+	struct epoll_event ev;
+	WAITER *waiter = (WAITER *)malloc(sizeof(WAITER));
+	if(!waiter)
+		return NULL;
+
+	waiter->epoll = epoll_create1(EPOLL_CLOEXEC);
+	/* time_get is the wall clock, the deadlines use the same */
+	waiter->timer = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK|TFD_CLOEXEC);
+	waiter->event = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+	if(waiter->epoll < 0 || waiter->timer < 0 || waiter->event < 0)
+	{
+		waiter_destroy(waiter);
+		return NULL;
+	}
+
+	mem_zero(&ev, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = waiter->timer;
+	epoll_ctl(waiter->epoll, EPOLL_CTL_ADD, waiter->timer, &ev);
+	ev.data.fd = waiter->event;
+	epoll_ctl(waiter->epoll, EPOLL_CTL_ADD, waiter->event, &ev);
+	return waiter;
+}
+
+void waiter_destroy(WAITER *waiter)
+{
+	if(waiter->epoll >= 0)
+		close(waiter->epoll);
+	if(waiter->timer >= 0)
+		close(waiter->timer);
+	if(waiter->event >= 0)
+		close(waiter->event);
+	free(waiter);
+}
+
+int waiter_add_socket(WAITER *waiter, NETSOCKET sock)
+{
+	struct epoll_event ev;
+	mem_zero(&ev, sizeof(ev));
+	ev.events = EPOLLIN;
+	if(sock.ipv4sock >= 0)
+	{
+		ev.data.fd = sock.ipv4sock;
+		if(epoll_ctl(waiter->epoll, EPOLL_CTL_ADD, sock.ipv4sock, &ev) != 0)
+			return -1;
+	}
+	if(sock.ipv6sock >= 0)
+	{
+		ev.data.fd = sock.ipv6sock;
+		if(epoll_ctl(waiter->epoll, EPOLL_CTL_ADD, sock.ipv6sock, &ev) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+void waiter_wake(WAITER *waiter)
+{
+	uint64_t one = 1;
+	if(write(waiter->event, &one, sizeof(one)) < 0)
+		return; /* the counter is set already */
+}
+
+int waiter_wait_until(WAITER *waiter, int64 deadline)
+{
+	struct itimerspec spec;
+	struct epoll_event events[8];
+	uint64_t value;
+	int num, i;
+	int woken = 0;
+
+	mem_zero(&spec, sizeof(spec));
+	if(deadline >= 0)
+	{
+		/* a zero value disarms the timer */
+		if(deadline == 0)
+			deadline = 1;
+		spec.it_value.tv_sec = deadline/time_freq();
+		spec.it_value.tv_nsec = (deadline%time_freq())*(1000000000/time_freq());
+	}
+	timerfd_settime(waiter->timer, TFD_TIMER_ABSTIME, &spec, NULL);
+
+	num = epoll_wait(waiter->epoll, events, sizeof(events)/sizeof(events[0]), -1);
+	for(i = 0; i < num; i++)
+	{
+		if(events[i].data.fd == waiter->timer)
+		{
+			if(read(waiter->timer, &value, sizeof(value)) < 0)
+				continue;
+		}
+		else if(events[i].data.fd == waiter->event)
+		{
+			if(read(waiter->event, &value, sizeof(value)) >= 0)
+				woken = 1;
+		}
+		else
+			woken = 1;
+	}
+	return woken;
+}
+#else
+struct WAITER
+{
+	NETSOCKET sock;
+	int has_sock;
+	volatile int woken;
+};
+
+WAITER *waiter_create()
+{
+	WAITER *waiter = (WAITER *)malloc(sizeof(WAITER));
+	if(waiter)
+		mem_zero(waiter, sizeof(WAITER));
+	return waiter;
+}
+
+void waiter_destroy(WAITER *waiter)
+{
+	free(waiter);
+}
+
+int waiter_add_socket(WAITER *waiter, NETSOCKET sock)
+{
+	if(waiter->has_sock)
+		return -1;
+	waiter->sock = sock;
+	waiter->has_sock = 1;
+	return 0;
+}
+
+void waiter_wake(WAITER *waiter)
+{
+	waiter->woken = 1;
+}
+
+int waiter_wait_until(WAITER *waiter, int64 deadline)
+{
+	while(deadline < 0 || time_get() < deadline)
+	{
+		if(waiter->woken)
+		{
+			waiter->woken = 0;
+			return 1;
+		}
+		if(waiter->has_sock)
+		{
+			if(net_socket_read_wait(waiter->sock, 1))
+				return 1;
+		}
+		else
+			thread_sleep(1);
+	}
+	return 0;
+}
+#endif
+
 int time_timestamp()
 {
 	return time(0);
@@ -95,6 +95,29 @@ void dbg_msg(const char *sys, const char *fmt, ...);
 void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned alignment);
 #define mem_alloc(s,a) mem_alloc_debug(__FILE__, __LINE__, (s), (a))
 
+/*
+	Function: mem_alloc_tagged
+		Same as <mem_alloc>, the block is accounted to one of the MEMTAG_*
+		entries of <mem_stats>.
+
+	Remarks:
+		- Release builds hand out blocks from per thread caches of power
+		of two size classes, only debug builds list and guard the blocks
+		for <mem_check> and <mem_debug_dump>.
+*/
+enum
+{
+	MEMTAG_OTHER=0,
+	MEMTAG_SNAPSHOT,
+	MEMTAG_ENTITY,
+	MEMTAG_NETWORK,
+	MEMTAG_MAP,
+	NUM_MEMTAGS
+};
+
+void *mem_alloc_debug_tag(const char *filename, int line, unsigned size, unsigned alignment, int tag);
+#define mem_alloc_tagged(s,a,t) mem_alloc_debug_tag(__FILE__, __LINE__, (s), (a), (t))
+
 /*
 	Function: mem_free
 		Frees a block allocated through <mem_alloc>.
@@ -322,6 +345,35 @@ int io_close(IOHANDLE io);
 */
 int io_flush(IOHANDLE io);
 
+/*
+	Function: io_map
+		Maps the whole content of a file read-only into memory.
+
+	Parameters:
+		io - Handle to the file, opened with IOFLAG_READ.
+		size - Pointer that receives the size of the mapping in bytes.
+
+	Returns:
+		Returns a pointer to the file content on success and 0 on failure.
+
+	Remarks:
+		- The mapping stays valid after the handle has been closed.
+		- Platforms without mmap support fall back to reading the file
+		into a heap buffer.
+		- Must be released with <io_unmap>.
+*/
+const void *io_map(IOHANDLE io, unsigned *size);
+
+/*
+	Function: io_unmap
+		Releases a mapping created by <io_map>.
+
+	Parameters:
+		data - Pointer returned by <io_map>.
+		size - Size returned by <io_map>.
+*/
+void io_unmap(const void *data, unsigned size);
+
 
 /*
 	Function: io_stdin
@@ -1077,6 +1129,19 @@ int fs_storage_path(const char *appname, char *path, int max);
 */
 int fs_is_dir(const char *path);
 
+/*
+	Function: fs_file_time
+		Gets the modification time of a file
+
+	Parameters:
+		name - The filename.
+		modified - Pointer to a time_t that will receive the modification time.
+
+	Returns:
+		Returns 0 on success, 1 on failure.
+*/
+int fs_file_time(const char *name, time_t *modified);
+
 /*
 	Function: fs_chdir
 		Changes current working directory
@@ -1183,6 +1248,62 @@ int net_would_block();
 
 int net_socket_read_wait(NETSOCKET sock, int time);
 
+/* Group: Waiters */
+typedef struct WAITER WAITER;
+
+/*
+	Function: waiter_create
+		Creates a waiter, a thread can sleep on it until a deadline,
+		incoming data on its sockets or a wake up from another thread.
+
+	Returns:
+		The waiter or NULL on failure.
+
+	Remarks:
+		- Uses epoll and an absolute timerfd on linux. Other platforms
+		poll the sockets and the wake up flag once per millisecond.
+*/
+WAITER *waiter_create();
+
+/*
+	Function: waiter_destroy
+		Frees a waiter.
+*/
+void waiter_destroy(WAITER *waiter);
+
+/*
+	Function: waiter_add_socket
+		Wakes the waiter when data arrives on the socket.
+
+	Returns:
+		0 on success.
+
+	Remarks:
+		- The fallback for other platforms supports one socket.
+*/
+int waiter_add_socket(WAITER *waiter, NETSOCKET sock);
+
+/*
+	Function: waiter_wake
+		Wakes the thread waiting on the waiter, or makes its next wait
+		return at once. Can be called from any thread.
+*/
+void waiter_wake(WAITER *waiter);
+
+/*
+	Function: waiter_wait_until
+		Sleeps until the deadline, incoming data or a wake up.
+
+	Parameters:
+		waiter - Waiter to sleep on.
+		deadline - Absolute time in <time_get> units, negative to wait
+			without a deadline.
+
+	Returns:
+		1 when woken by a socket or <waiter_wake>, 0 at the deadline.
+*/
+int waiter_wait_until(WAITER *waiter, int64 deadline);
+
 void mem_debug_dump(IOHANDLE file);
 
 void swap_endian(void *data, unsigned elem_size, unsigned num);
@@ -1195,11 +1316,42 @@ void dbg_logger_stdout();
 void dbg_logger_debugger();
 void dbg_logger_file(const char *filename);
 
+/*
+	Function: dbg_logger_async_start
+		Hands the lines of dbg_msg to the loggers from a background thread.
+		Lines that do not fit in the queue are dropped instead of waiting.
+
+	Parameters:
+		rate_limit - Lines per second and system before the next ones are
+		dropped, 0 for no limit.
+*/
+void dbg_logger_async_start(int rate_limit);
+
+/*
+	Function: dbg_logger_async_stop
+		Writes the queued lines and logs synchronously again.
+*/
+void dbg_logger_async_stop();
+
+/*
+	Function: dbg_logger_async_stats
+		Lines dropped because the queue was full and because of the rate limit.
+*/
+void dbg_logger_async_stats(unsigned *dropped, unsigned *limited);
+
+/*
+	Function: dbg_log_line
+		Gives an already formatted line to the loggers.
+*/
+void dbg_log_line(const char *line);
+
 typedef struct
 {
 	int allocated;
 	int active_allocations;
 	int total_allocations;
+	int tag_allocated[NUM_MEMTAGS];
+	int tag_active_allocations[NUM_MEMTAGS];
 } MEMSTATS;
 
 const MEMSTATS *mem_stats();
@@ -197,6 +197,7 @@ public:
 	virtual const char *ClientName(int ClientID) = 0;
 	virtual const char *ClientClan(int ClientID) = 0;
 	virtual int ClientCountry(int ClientID) = 0;
+	virtual int ClientGeolocationCountry(int ClientID) = 0; // -1 when unknown
 	virtual bool ClientIngame(int ClientID) = 0;
 	virtual int GetClientInfo(int ClientID, CClientInfo *pInfo) = 0;
 	virtual void GetClientAddr(int ClientID, char *pAddrStr, int Size) = 0;
@@ -301,11 +302,18 @@ public:
 	}
 
 	virtual void SetClientName(int ClientID, char const *pName) = 0;
+	// same as SetClientName for threads other than the game thread, applied on the next tick
+	virtual void RequestClientName(int ClientID, char const *pName) = 0;
 	virtual void SetClientClan(int ClientID, char const *pClan) = 0;
 	virtual void SetClientCountry(int ClientID, int Country) = 0;
 
 	virtual int SnapNewID() = 0;
 	virtual void SnapFreeID(int ID) = 0;
+	// consecutive snap ids for entities that snap many items, Owner is the entity's own id:
+	// if it is freed first the range is reported as leaked and freed with it. returns -1 if the free ids
+	// are too fragmented, the entity has to use single ids or skip the items then
+	virtual int SnapNewIDRange(int Num, int Owner) = 0;
+	virtual void SnapFreeIDRange(int ID, int Num) = 0;
 	virtual void *SnapNewItem(int Type, int ID, int Size) = 0;
 
 	virtual void SnapSetStaticsize(int ItemType, int Size) = 0;
@@ -376,6 +384,9 @@ public:
 	virtual CMapVote* GetMapVote() = 0;
 	virtual int GetMinPlayersForMap(const char* pMapName) = 0;
 	virtual int GetMaxPlayersForMap(const char* pMapName) = 0;
+	virtual bool MapExists(const char* pMapName) = 0;
+	virtual int GetMapRotationSize() = 0;
+	virtual const char* GetMapRotationName(int Index) = 0;
 	
 	virtual int GetTimeShiftUnit() const = 0; //In ms
 /* INFECTION MODIFICATION END *****************************************/
@@ -398,6 +409,8 @@ public:
 	virtual void OnPreSnap() = 0;
 	virtual void OnSnap(int ClientID) = 0;
 	virtual void OnPostSnap() = 0;
+	// write the game metrics that are read when asked for with pMetrics->WriteGauge and WriteCounter
+	virtual void OnCollectMetrics(class CMetrics *pMetrics) = 0;
 
 	virtual void OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID) = 0;
 
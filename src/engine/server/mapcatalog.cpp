@@ -0,0 +1,311 @@
+#include <base/tl/threading.h>
+#include <engine/console.h>
+#include <engine/engine.h>
+#include <engine/storage.h>
+#include <engine/shared/datafile.h>
+
+#include "mapcatalog.h"
+#include "mapconverter.h"
+
+static bool IsSeparator(char c) { return c == ';' || c == ' ' || c == ',' || c == '\t'; }
+
+CMapCatalog::CMapCatalog()
+{
+	m_pStorage = 0;
+	m_pConsole = 0;
+	m_pEngine = 0;
+	m_LastRefresh = 0;
+	m_Scanning = false;
+	m_NumScanned = 0;
+	m_aRotation[0] = 0;
+	m_aRotationNames[0] = 0;
+	m_RotationSize = 0;
+}
+
+CMapCatalog::~CMapCatalog()
+{
+	// the job works on the members
+	while(m_Scanning && m_ScanJob.Status() != CJob::STATE_DONE)
+		thread_sleep(1);
+}
+
+void CMapCatalog::Init(IStorage *pStorage, IConsole *pConsole, IEngine *pEngine)
+{
+	m_pStorage = pStorage;
+	m_pConsole = pConsole;
+	m_pEngine = pEngine;
+}
+
+void CMapCatalog::FormatClientMapDir(char *pBuffer, int BufferSize, const char *pName, unsigned Crc)
+{
+	str_format(pBuffer, BufferSize, "clientmaps/%s_%08x_v%d", pName, Crc, (int)CMapConverter::VERSION);
+}
+
+void CMapCatalog::FormatClientMapPath(char *pBuffer, int BufferSize, const char *pName, unsigned Crc)
+{
+	str_format(pBuffer, BufferSize, "clientmaps/%s_%08x_v%d/tw06-highres.map", pName, Crc, (int)CMapConverter::VERSION);
+}
+
+CMapCatalog::CEntry *CMapCatalog::FindEntry(array<CEntry> *paEntries, const char *pName)
+{
+	for(int i = 0; i < paEntries->size(); i++)
+	{
+		if(str_comp((*paEntries)[i].m_aName, pName) == 0)
+			return &(*paEntries)[i];
+	}
+	return 0;
+}
+
+// runs in the scan job as well, must not print
+bool CMapCatalog::LoadMap(CEntry *pEntry, bool Force) const
+{
+	char aFilename[512];
+	char aFullPath[512];
+	str_format(aFilename, sizeof(aFilename), "maps/%s.map", pEntry->m_aName);
+	IOHANDLE File = m_pStorage->OpenFile(aFilename, IOFLAG_READ, IStorage::TYPE_ALL, aFullPath, sizeof(aFullPath));
+	if(!File)
+		return false;
+	unsigned Size = (unsigned)io_length(File);
+	io_close(File);
+
+	time_t MapTime = 0;
+	fs_file_time(aFullPath, &MapTime);
+
+	if(!Force && MapTime == pEntry->m_MapTime && Size == pEntry->m_Size)
+	{
+		LoadMapInfo(pEntry, false);
+		return true;
+	}
+
+	unsigned Crc = 0;
+	unsigned CrcSize = 0;
+	if(!CDataFileReader::GetCrcSize(m_pStorage, aFilename, IStorage::TYPE_ALL, &Crc, &CrcSize))
+		return false;
+
+	pEntry->m_Crc = Crc;
+	pEntry->m_Size = CrcSize;
+	pEntry->m_MapTime = MapTime;
+	FormatClientMapPath(pEntry->m_aClientMap, sizeof(pEntry->m_aClientMap), pEntry->m_aName, Crc);
+	LoadMapInfo(pEntry, Force);
+	return true;
+}
+
+void CMapCatalog::LoadMapInfo(CEntry *pEntry, bool Force) const
+{
+	char aFilename[512];
+	char aFullPath[512];
+	str_format(aFilename, sizeof(aFilename), "maps/%s.mapinfo", pEntry->m_aName);
+	IOHANDLE File = m_pStorage->OpenFile(aFilename, IOFLAG_READ, IStorage::TYPE_ALL, aFullPath, sizeof(aFullPath));
+	if(!File)
+	{
+		pEntry->m_MinPlayers = 0;
+		pEntry->m_MaxPlayers = 0;
+		pEntry->m_TimeLimit = 0;
+		pEntry->m_InfoTime = 0;
+		return;
+	}
+
+	time_t InfoTime = 0;
+	fs_file_time(aFullPath, &InfoTime);
+	if(!Force && InfoTime && InfoTime == pEntry->m_InfoTime)
+	{
+		io_close(File);
+		return;
+	}
+
+	char aInfo[4096];
+	int Length = io_read(File, aInfo, sizeof(aInfo)-1);
+	io_close(File);
+	aInfo[Length] = 0;
+
+	pEntry->m_MinPlayers = 0;
+	pEntry->m_MaxPlayers = 0;
+	pEntry->m_TimeLimit = 0;
+	pEntry->m_InfoTime = InfoTime;
+
+	char *pLine = aInfo;
+	while(*pLine)
+	{
+		char *pEnd = pLine;
+		while(*pEnd && *pEnd != '\n')
+			pEnd++;
+		bool Last = *pEnd == 0;
+		*pEnd = 0;
+
+		if(str_comp_nocase_num(pLine, "#minplayers ", 12) == 0)
+			pEntry->m_MinPlayers = str_toint(pLine+12);
+		else if(str_comp_nocase_num(pLine, "#maxplayers ", 12) == 0)
+			pEntry->m_MaxPlayers = str_toint(pLine+12);
+		else if(str_comp_nocase_num(pLine, "sv_timelimit ", 13) == 0)
+			pEntry->m_TimeLimit = str_toint(pLine+13);
+
+		if(Last)
+			break;
+		pLine = pEnd+1;
+	}
+}
+
+int CMapCatalog::ListMapsCallback(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	CListData *pData = (CListData *)pUser;
+	int Length = str_length(pName);
+	if(IsDir || Length <= 4 || Length-4 >= MAX_MAP_NAME || str_comp(pName+Length-4, ".map") != 0)
+		return 0;
+
+	char aName[MAX_MAP_NAME];
+	str_copy(aName, pName, Length-4+1);
+
+	// the first storage path containing the map wins, like IStorage::OpenFile
+	CEntry *pEntry = FindEntry(pData->m_paEntries, aName);
+	if(pEntry)
+	{
+		if(!pEntry->m_Seen)
+			pEntry->m_Seen = pData->m_pSelf->LoadMap(pEntry, pData->m_Force);
+		return 0;
+	}
+
+	CEntry Entry;
+	mem_zero(&Entry, sizeof(Entry));
+	str_copy(Entry.m_aName, aName, sizeof(Entry.m_aName));
+	if(pData->m_pSelf->LoadMap(&Entry, true))
+	{
+		Entry.m_Seen = true;
+		pData->m_paEntries->add(Entry);
+	}
+	return 0;
+}
+
+void CMapCatalog::Update(array<CEntry> *paEntries, bool Force) const
+{
+	for(int i = 0; i < paEntries->size(); i++)
+		(*paEntries)[i].m_Seen = false;
+
+	CListData Data = {this, paEntries, Force};
+	m_pStorage->ListDirectory(IStorage::TYPE_ALL, "maps", ListMapsCallback, &Data);
+
+	// maps that were not listed are either gone or were loaded on demand from a sub folder
+	for(int i = 0; i < paEntries->size(); i++)
+	{
+		if(!(*paEntries)[i].m_Seen && !LoadMap(&(*paEntries)[i], Force))
+		{
+			paEntries->remove_index(i);
+			i--;
+		}
+	}
+}
+
+int CMapCatalog::ScanJob(void *pUser)
+{
+	CMapCatalog *pSelf = (CMapCatalog *)pUser;
+	pSelf->Update(&pSelf->m_aScanEntries, false);
+	return 0;
+}
+
+void CMapCatalog::FinishScan()
+{
+	sync_barrier();
+	m_Scanning = false;
+
+	for(int i = 0; i < m_aScanEntries.size(); i++)
+	{
+		CEntry *pOld = FindEntry(&m_aEntries, m_aScanEntries[i].m_aName);
+		if(pOld && pOld->m_Crc != m_aScanEntries[i].m_Crc)
+		{
+			char aBuf[256];
+			str_format(aBuf, sizeof(aBuf), "map '%s' changed, crc is now %08x", m_aScanEntries[i].m_aName, m_aScanEntries[i].m_Crc);
+			m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "mapcatalog", aBuf);
+		}
+	}
+
+	// keep the maps that were loaded on demand while the job ran
+	for(int i = m_NumScanned; i < m_aEntries.size(); i++)
+	{
+		if(!FindEntry(&m_aScanEntries, m_aEntries[i].m_aName))
+			m_aScanEntries.add(m_aEntries[i]);
+	}
+
+	m_aEntries = m_aScanEntries;
+	m_aScanEntries.clear();
+	m_LastRefresh = time_get();
+}
+
+int CMapCatalog::Rescan()
+{
+	// a running scan would overwrite the result
+	while(m_Scanning && m_ScanJob.Status() != CJob::STATE_DONE)
+		thread_sleep(1);
+	if(m_Scanning)
+		FinishScan();
+
+	Update(&m_aEntries, true);
+	m_LastRefresh = time_get();
+
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "%d maps indexed", m_aEntries.size());
+	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "mapcatalog", aBuf);
+	return m_aEntries.size();
+}
+
+void CMapCatalog::Refresh()
+{
+	if(m_Scanning)
+	{
+		if(m_ScanJob.Status() == CJob::STATE_DONE)
+			FinishScan();
+		return;
+	}
+
+	if(time_get() < m_LastRefresh + time_freq()*REFRESH_INTERVAL)
+		return;
+
+	m_aScanEntries = m_aEntries;
+	m_NumScanned = m_aEntries.size();
+	m_Scanning = true;
+	m_pEngine->AddJob(&m_ScanJob, ScanJob, this);
+}
+
+bool CMapCatalog::Get(const char *pName, CEntry *pEntry)
+{
+	CEntry *pFound = FindEntry(&m_aEntries, pName);
+	if(pFound)
+	{
+		*pEntry = *pFound;
+		return true;
+	}
+
+	if(str_length(pName) >= MAX_MAP_NAME)
+		return false;
+
+	CEntry Entry;
+	mem_zero(&Entry, sizeof(Entry));
+	str_copy(Entry.m_aName, pName, sizeof(Entry.m_aName));
+	if(!LoadMap(&Entry, true))
+		return false;
+	m_aEntries.add(Entry);
+	*pEntry = Entry;
+	return true;
+}
+
+int CMapCatalog::RotationSize(const char *pRotation)
+{
+	if(str_comp(pRotation, m_aRotation) == 0)
+		return m_RotationSize;
+
+	str_copy(m_aRotation, pRotation, sizeof(m_aRotation));
+	str_copy(m_aRotationNames, pRotation, sizeof(m_aRotationNames));
+	m_RotationSize = 0;
+
+	char *pName = m_aRotationNames;
+	while(*pName)
+	{
+		while(*pName && IsSeparator(*pName))
+			*pName++ = 0;
+		if(!*pName)
+			break;
+		if(m_RotationSize < MAX_ROTATION_MAPS)
+			m_apRotation[m_RotationSize++] = pName;
+		while(*pName && !IsSeparator(*pName))
+			pName++;
+	}
+	return m_RotationSize;
+}
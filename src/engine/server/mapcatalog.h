@@ -0,0 +1,96 @@
+#ifndef ENGINE_SERVER_MAPCATALOG_H
+#define ENGINE_SERVER_MAPCATALOG_H
+
+#include <base/system.h>
+#include <base/tl/array.h>
+#include <engine/shared/jobs.h>
+
+// in-memory index of the maps available to the server and of sv_maprotation
+// built once at startup, entries are reloaded when their .map or .mapinfo changes on disk.
+// the change detection runs as an engine job on a copy of the entries, which is swapped in once it is done
+class CMapCatalog
+{
+public:
+	enum
+	{
+		MAX_MAP_NAME=64,
+		MAX_ROTATION_MAPS=256,
+		REFRESH_INTERVAL=10, // seconds between two change detections
+	};
+
+	struct CEntry
+	{
+		char m_aName[MAX_MAP_NAME];
+		unsigned m_Crc;
+		unsigned m_Size;
+		int m_MinPlayers;
+		int m_MaxPlayers;
+		int m_TimeLimit;
+		char m_aClientMap[256]; // path of the map generated for the clients
+
+		time_t m_MapTime;
+		time_t m_InfoTime;
+		bool m_Seen;
+	};
+
+private:
+	struct CListData
+	{
+		const CMapCatalog *m_pSelf;
+		array<CEntry> *m_paEntries;
+		bool m_Force;
+	};
+
+	class IStorage *m_pStorage;
+	class IConsole *m_pConsole;
+	class IEngine *m_pEngine;
+
+	array<CEntry> m_aEntries;
+	int64 m_LastRefresh;
+
+	// only touched by the scan job while it runs
+	array<CEntry> m_aScanEntries;
+	CJob m_ScanJob;
+	bool m_Scanning;
+	int m_NumScanned; // entries that were copied for the scan, the ones after them were loaded on demand
+
+	char m_aRotation[1024];
+	char m_aRotationNames[1024];
+	const char *m_apRotation[MAX_ROTATION_MAPS];
+	int m_RotationSize;
+
+	static CEntry *FindEntry(array<CEntry> *paEntries, const char *pName);
+	bool LoadMap(CEntry *pEntry, bool Force) const;
+	void LoadMapInfo(CEntry *pEntry, bool Force) const;
+	void Update(array<CEntry> *paEntries, bool Force) const;
+	void FinishScan();
+
+	static int ListMapsCallback(const char *pName, int IsDir, int StorageType, void *pUser);
+	static int ScanJob(void *pUser);
+
+public:
+	CMapCatalog();
+	~CMapCatalog();
+
+	void Init(class IStorage *pStorage, class IConsole *pConsole, class IEngine *pEngine);
+
+	// re-reads every map right away, returns the number of maps found
+	int Rescan();
+	// starts a job that reloads the entries whose files changed, at most every REFRESH_INTERVAL seconds,
+	// and takes over its result once it is done
+	void Refresh();
+
+	// copies the entry, loads maps outside of the maps folder on demand, returns false if the map does not exist
+	bool Get(const char *pName, CEntry *pEntry);
+	// the entries move when the scan result is taken over, don't keep the pointer
+	int Num() const { return m_aEntries.size(); }
+	const CEntry *GetByIndex(int Index) const { return &m_aEntries[Index]; }
+
+	int RotationSize(const char *pRotation);
+	const char *RotationName(int Index) const { return m_apRotation[Index]; }
+
+	static void FormatClientMapDir(char *pBuffer, int BufferSize, const char *pName, unsigned Crc);
+	static void FormatClientMapPath(char *pBuffer, int BufferSize, const char *pName, unsigned Crc);
+};
+
+#endif
@@ -55,6 +55,12 @@ public:
 		TIMESHIFT_MENUCLASS = 60,
 		TIMESHIFT_MENUCLASS_MASK = NUM_MENUCLASS+1,
 	};
+	
+	enum
+	{
+		// part of the path of the cached client maps, increase it whenever the output changes
+		VERSION = 1,
+	};
 
 protected:
 	IStorage *m_pStorage;
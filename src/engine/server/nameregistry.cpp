@@ -0,0 +1,53 @@
+#include "nameregistry.h"
+
+CNameRegistry::CNameRegistry()
+{
+	Clear();
+}
+
+void CNameRegistry::Clear()
+{
+	for(int i = 0; i < NUM_BUCKETS; i++)
+		m_aBuckets[i] = -1;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		m_aUsed[i] = false;
+}
+
+int CNameRegistry::Find(const char *pName) const
+{
+	unsigned Hash = str_quickhash(pName);
+	for(int i = m_aBuckets[Hash%NUM_BUCKETS]; i != -1; i = m_aNext[i])
+	{
+		if(m_aHash[i] == Hash && str_comp(m_aaNames[i], pName) == 0)
+			return i;
+	}
+	return -1;
+}
+
+void CNameRegistry::Set(int ClientID, const char *pName)
+{
+	Remove(ClientID);
+
+	str_copy(m_aaNames[ClientID], pName, sizeof(m_aaNames[ClientID]));
+	m_aHash[ClientID] = str_quickhash(m_aaNames[ClientID]);
+	int *pBucket = &m_aBuckets[m_aHash[ClientID]%NUM_BUCKETS];
+	m_aNext[ClientID] = *pBucket;
+	*pBucket = ClientID;
+	m_aUsed[ClientID] = true;
+}
+
+void CNameRegistry::Remove(int ClientID)
+{
+	if(!m_aUsed[ClientID])
+		return;
+
+	for(int *pLink = &m_aBuckets[m_aHash[ClientID]%NUM_BUCKETS]; *pLink != -1; pLink = &m_aNext[*pLink])
+	{
+		if(*pLink == ClientID)
+		{
+			*pLink = m_aNext[ClientID];
+			break;
+		}
+	}
+	m_aUsed[ClientID] = false;
+}
@@ -0,0 +1,33 @@
+#ifndef ENGINE_SERVER_NAMEREGISTRY_H
+#define ENGINE_SERVER_NAMEREGISTRY_H
+
+#include <base/system.h>
+#include <engine/shared/protocol.h>
+
+// names in use by the clients, hashed so a collision is found without comparing every client
+// owned by the game thread, the names are stored trimmed like CServer::TrySetClientName sets them
+class CNameRegistry
+{
+	enum
+	{
+		NUM_BUCKETS=128, // power of two above MAX_CLIENTS
+	};
+
+	int m_aBuckets[NUM_BUCKETS]; // first client of the bucket or -1
+	int m_aNext[MAX_CLIENTS];
+	unsigned m_aHash[MAX_CLIENTS];
+	char m_aaNames[MAX_CLIENTS][MAX_NAME_LENGTH];
+	bool m_aUsed[MAX_CLIENTS];
+
+public:
+	CNameRegistry();
+
+	void Clear();
+	// client owning the name or -1
+	int Find(const char *pName) const;
+	// replaces the previous name of the client
+	void Set(int ClientID, const char *pName);
+	void Remove(int ClientID);
+};
+
+#endif
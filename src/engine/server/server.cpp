@@ -5,6 +5,7 @@
 #include <base/math.h>
 #include <base/system.h>
 #include <base/tl/array.h>
+#include <base/tl/threading.h>
 
 #include <engine/config.h>
 #include <engine/console.h>
@@ -22,6 +23,7 @@
 #include <engine/shared/mapchecker.h>
 #include <engine/shared/netban.h>
 #include <engine/shared/network.h>
+#include <engine/shared/network_io.h>
 #include <engine/shared/packer.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/snapshot.h>
@@ -39,10 +41,15 @@
 #include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <zlib.h>
 #include <engine/server/mapconverter.h>
 #include <engine/server/crypt.h>
 
 #include <teeuniverses/components/localization.h>
+
+#ifdef CONF_GEOLOCATION
+	#include <infclasscr/geolocation.h>
+#endif
 /* INFECTION MODIFICATION END *****************************************/
 
 #if defined(CONF_FAMILY_WINDOWS)
@@ -100,6 +107,18 @@ static void StrRtrim(char *pStr)
 	}
 }
 
+// seconds, shared by the per client stats and the metrics
+static const double s_aInputMarginBounds[CServer::NUM_INPUT_MARGIN_BOUNDS] = {-0.1, -0.04, -0.02, -0.01, 0, 0.01, 0.02, 0.04, 0.1, 0.25};
+static const double s_aAckLatencyBounds[CServer::NUM_ACK_LATENCY_BOUNDS] = {0.01, 0.025, 0.05, 0.075, 0.1, 0.15, 0.2, 0.3, 0.5, 1};
+
+static int FindBucket(const double *pBounds, int NumBounds, double Value)
+{
+	int Bucket = 0;
+	while(Bucket < NumBounds && Value > pBounds[Bucket])
+		Bucket++;
+	return Bucket;
+}
+
 CSnapIDPool::CSnapIDPool()
 {
 	Reset();
@@ -110,7 +129,10 @@ void CSnapIDPool::Reset()
 	for(int i = 0; i < MAX_IDS; i++)
 	{
 		m_aIDs[i].m_Next = i+1;
+		m_aIDs[i].m_Prev = i-1;
 		m_aIDs[i].m_State = 0;
+		m_aIDs[i].m_Owner = -1;
+		m_aIDs[i].m_NumOwned = 0;
 	}
 
 	m_aIDs[MAX_IDS-1].m_Next = -1;
@@ -119,8 +141,25 @@ void CSnapIDPool::Reset()
 	m_LastTimed = -1;
 	m_Usage = 0;
 	m_InUsage = 0;
+	m_NumTimed = 0;
+	m_RangeCursor = MAX_IDS;
+
+	m_PeakUsage = 0;
+	m_PeakInUsage = 0;
+	m_PeakTimed = 0;
+	m_NumRanges = 0;
+	m_NumLeaked = 0;
 }
 
+void CSnapIDPool::UnlinkFree(int ID)
+{
+	if(m_aIDs[ID].m_Prev != -1)
+		m_aIDs[m_aIDs[ID].m_Prev].m_Next = m_aIDs[ID].m_Next;
+	else
+		m_FirstFree = m_aIDs[ID].m_Next;
+	if(m_aIDs[ID].m_Next != -1)
+		m_aIDs[m_aIDs[ID].m_Next].m_Prev = m_aIDs[ID].m_Prev;
+}
 
 void CSnapIDPool::RemoveFirstTimeout()
 {
@@ -128,6 +167,9 @@ void CSnapIDPool::RemoveFirstTimeout()
 
 	// add it to the free list
 	m_aIDs[m_FirstTimed].m_Next = m_FirstFree;
+	m_aIDs[m_FirstTimed].m_Prev = -1;
+	if(m_FirstFree != -1)
+		m_aIDs[m_FirstFree].m_Prev = m_FirstTimed;
 	m_aIDs[m_FirstTimed].m_State = 0;
 	m_FirstFree = m_FirstTimed;
 
@@ -137,27 +179,87 @@ void CSnapIDPool::RemoveFirstTimeout()
 		m_LastTimed = -1;
 
 	m_Usage--;
+	m_NumTimed--;
 }
 
-int CSnapIDPool::NewID()
+void CSnapIDPool::ProcessTimeouts()
 {
 	int64 Now = time_get();
-
-	// process timed ids
 	while(m_FirstTimed != -1 && m_aIDs[m_FirstTimed].m_Timeout < Now)
 		RemoveFirstTimeout();
+}
+
+int CSnapIDPool::NewID()
+{
+	// process timed ids
+	ProcessTimeouts();
 
 	int ID = m_FirstFree;
 	dbg_assert(ID != -1, "id error");
 	if(ID == -1)
 		return ID;
-	m_FirstFree = m_aIDs[m_FirstFree].m_Next;
+	UnlinkFree(ID);
 	m_aIDs[ID].m_State = 1;
+	m_aIDs[ID].m_Owner = -1;
 	m_Usage++;
 	m_InUsage++;
+	m_PeakUsage = max(m_PeakUsage, m_Usage);
+	m_PeakInUsage = max(m_PeakInUsage, m_InUsage);
 	return ID;
 }
 
+int CSnapIDPool::NewIDRange(int Num, int Owner)
+{
+	if(Num <= 0)
+		return -1;
+
+	ProcessTimeouts();
+
+	// next fit from the top of the pool, so ranges do not get in the way of the single ids
+	int First = -1;
+	int Run = 0;
+	int End = m_RangeCursor;
+	for(int Checked = 0; Checked < MAX_IDS+Num && First == -1; Checked++)
+	{
+		if(End-Run == 0)
+		{
+			End = MAX_IDS;
+			Run = 0;
+		}
+		if(m_aIDs[End-Run-1].m_State == 0)
+		{
+			Run++;
+			if(Run == Num)
+				First = End-Run;
+		}
+		else
+		{
+			End = End-Run-1;
+			Run = 0;
+		}
+	}
+	// fragmented, the caller falls back to single ids or does without
+	if(First == -1)
+		return -1;
+
+	for(int i = First; i < First+Num; i++)
+	{
+		UnlinkFree(i);
+		m_aIDs[i].m_State = 1;
+		m_aIDs[i].m_Owner = Owner;
+	}
+	if(Owner >= 0)
+		m_aIDs[Owner].m_NumOwned += Num;
+
+	m_RangeCursor = First;
+	m_Usage += Num;
+	m_InUsage += Num;
+	m_NumRanges++;
+	m_PeakUsage = max(m_PeakUsage, m_Usage);
+	m_PeakInUsage = max(m_PeakInUsage, m_InUsage);
+	return First;
+}
+
 void CSnapIDPool::TimeoutIDs()
 {
 	// process timed ids
@@ -165,13 +267,36 @@ void CSnapIDPool::TimeoutIDs()
 		RemoveFirstTimeout();
 }
 
+void CSnapIDPool::FreeLeaked(int Owner)
+{
+	int NumLeaked = 0;
+	for(int i = 0; i < MAX_IDS && m_aIDs[Owner].m_NumOwned; i++)
+	{
+		if(m_aIDs[i].m_State == 1 && m_aIDs[i].m_Owner == Owner)
+		{
+			FreeID(i);
+			NumLeaked++;
+		}
+	}
+	m_NumLeaked += NumLeaked;
+	dbg_msg("snapid", "id %d was freed before %d of its ids, freeing them too", Owner, NumLeaked);
+}
+
 void CSnapIDPool::FreeID(int ID)
 {
 	if(ID < 0)
 		return;
 	dbg_assert(m_aIDs[ID].m_State == 1, "id is not alloced");
 
+	if(m_aIDs[ID].m_Owner >= 0)
+	{
+		m_aIDs[m_aIDs[ID].m_Owner].m_NumOwned--;
+		m_aIDs[ID].m_Owner = -1;
+	}
+
 	m_InUsage--;
+	m_NumTimed++;
+	m_PeakTimed = max(m_PeakTimed, m_NumTimed);
 	m_aIDs[ID].m_State = 2;
 	m_aIDs[ID].m_Timeout = time_get()+time_freq()*5;
 	m_aIDs[ID].m_Next = -1;
@@ -186,17 +311,17 @@ void CSnapIDPool::FreeID(int ID)
 		m_FirstTimed = ID;
 		m_LastTimed = ID;
 	}
+
+	if(m_aIDs[ID].m_NumOwned)
+		FreeLeaked(ID);
 }
 
-int CSnapIDPool::GetIDCount()
+void CSnapIDPool::FreeIDRange(int ID, int Num)
 {
-	int Count = 0;
-	for(int i = 0; i < MAX_IDS; i++)
-	{
-		if (m_aIDs[i].m_State == 1)
-			Count++;
-	}
-	return Count;
+	if(ID < 0)
+		return;
+	for(int i = ID; i < ID+Num; i++)
+		FreeID(i);
 }
 
 void CServerBan::InitServerBan(IConsole *pConsole, IStorage *pStorage, CServer* pServer)
@@ -331,12 +456,15 @@ void CServer::CClient::Reset(bool ResetScore)
 	m_Snapshots.PurgeAll();
 	m_LastAckedSnapshot = -1;
 	m_LastInputTick = -1;
+	m_SnapshotBytes = 0;
 	m_Quitting = false;
 	m_SnapRate = CClient::SNAPRATE_INIT;
 	m_NextMapChunk = 0;
 	
 	if(ResetScore)
 	{
+		mem_zero(&m_InputStats, sizeof(m_InputStats));
+
 		m_NbRound = 0;
 		
 		m_AntiPing = 0;
@@ -368,8 +496,16 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 	m_CurrentGameTick = 0;
 	m_RunServer = 1;
 
-	m_pCurrentMapData = 0;
 	m_CurrentMapSize = 0;
+	m_pCurrentMapFrames = 0;
+	m_pCurrentMapFrameSizes = 0;
+	m_NumMapChunks = 0;
+
+	m_pWaiter = 0;
+	m_Hibernating = false;
+
+	m_NameRequestLock = lock_create();
+	m_NumNameRequests = 0;
 
 	m_MapReload = 0;
 
@@ -379,12 +515,22 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 	m_ServerInfoFirstRequest = 0;
 	m_ServerInfoNumRequests = 0;
 	m_ServerInfoHighLoad = false;
+
+	InitMetrics();
+	
+#ifdef CONF_GEOLOCATION
+	m_pGeolocation = new Geolocation("GeoLite2-Country.mmdb");
+#endif
 	
 	Init();
 }
 
 CServer::~CServer()
 {
+	lock_destroy(m_NameRequestLock);
+#ifdef CONF_GEOLOCATION
+	delete m_pGeolocation;
+#endif
 }
 
 int CServer::TrySetClientName(int ClientID, const char *pName)
@@ -404,30 +550,40 @@ int CServer::TrySetClientName(int ClientID, const char *pName)
 	if(aTrimmedName[0] == '/')
 		return -1;
 
-	pName = aTrimmedName;
+	// the name is stored cut to MAX_NAME_LENGTH, the collision check must see the same
+	str_copy(aTrimmedName2, aTrimmedName, MAX_NAME_LENGTH);
+	StrRtrim(aTrimmedName2);
+	pName = aTrimmedName2;
 
 	// make sure that two clients doesn't have the same name
-	for(int i = 0; i < MAX_CLIENTS; i++)
-	{
-		if(i != ClientID && m_aClients[i].m_State >= CClient::STATE_READY)
-		{
-			str_copy(aTrimmedName2, ClientName(i), sizeof(aTrimmedName2));
-			StrRtrim(aTrimmedName2);
-			
-			if(str_comp(pName, aTrimmedName2) == 0)
-				return -1;
-		}
-	}
+	int Owner = m_NameRegistry.Find(pName);
+	if(Owner != -1 && Owner != ClientID)
+		return -1;
 
 	// check if new and old name are the same
-	if(m_aClients[ClientID].m_aName[0] && str_comp(m_aClients[ClientID].m_aName, pName) == 0)
+	if(Owner == ClientID)
 		return 0;
 	
 	// set the client name
 	str_copy(m_aClients[ClientID].m_aName, pName, MAX_NAME_LENGTH);
+	m_NameRegistry.Set(ClientID, m_aClients[ClientID].m_aName);
 	return 0;
 }
 
+void CServer::ClearClientName(int ClientID)
+{
+	m_aClients[ClientID].m_aName[0] = 0;
+	m_NameRegistry.Remove(ClientID);
+
+	lock_wait(m_NameRequestLock);
+	if(m_aClients[ClientID].m_aRequestedName[0])
+	{
+		m_aClients[ClientID].m_aRequestedName[0] = 0;
+		atomic_dec(&m_NumNameRequests);
+	}
+	lock_unlock(m_NameRequestLock);
+}
+
 void CServer::SetClientName(int ClientID, const char *pName)
 {
 	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY)
@@ -459,6 +615,37 @@ void CServer::SetClientName(int ClientID, const char *pName)
 	}
 }
 
+void CServer::RequestClientName(int ClientID, const char *pName)
+{
+	if(ClientID < 0 || ClientID >= MAX_CLIENTS || !pName || !pName[0])
+		return;
+
+	lock_wait(m_NameRequestLock);
+	if(!m_aClients[ClientID].m_aRequestedName[0])
+		atomic_inc(&m_NumNameRequests);
+	str_copy(m_aClients[ClientID].m_aRequestedName, pName, sizeof(m_aClients[ClientID].m_aRequestedName));
+	lock_unlock(m_NameRequestLock);
+}
+
+void CServer::ApplyRequestedNames()
+{
+	char aName[MAX_NAME_LENGTH];
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		lock_wait(m_NameRequestLock);
+		str_copy(aName, m_aClients[i].m_aRequestedName, sizeof(aName));
+		if(aName[0])
+		{
+			m_aClients[i].m_aRequestedName[0] = 0;
+			atomic_dec(&m_NumNameRequests);
+		}
+		lock_unlock(m_NameRequestLock);
+
+		if(aName[0])
+			SetClientName(i, aName);
+	}
+}
+
 void CServer::SetClientClan(int ClientID, const char *pClan)
 {
 	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY || !pClan)
@@ -517,6 +704,7 @@ int CServer::Init()
 	{
 		m_aClients[i].m_State = CClient::STATE_EMPTY;
 		m_aClients[i].m_aName[0] = 0;
+		m_aClients[i].m_aRequestedName[0] = 0;
 		m_aClients[i].m_aClan[0] = 0;
 		m_aClients[i].m_CustClt = 0;
 		m_aClients[i].m_Solar = 0;
@@ -809,6 +997,17 @@ std::string CServer::GetClientIP(int ClientID)
 }
 
 
+int CServer::ClientGeolocationCountry(int ClientID)
+{
+#ifdef CONF_GEOLOCATION
+	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State == CClient::STATE_EMPTY)
+		return -1;
+	return m_pGeolocation->get_result(ClientID, m_NetServer.ClientAddr(ClientID));
+#else
+	return -1;
+#endif
+}
+
 const char *CServer::ClientName(int ClientID)
 {
 	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State == CServer::CClient::STATE_EMPTY)
@@ -944,6 +1143,7 @@ void CServer::DoSnapshot()
 			int Crc;
 			static CSnapshot EmptySnap;
 			CSnapshot *pDeltashot = &EmptySnap;
+			const CSnapshotIndex *pDeltashotIndex = 0;
 			int DeltashotSize;
 			int DeltaTick = -1;
 			int DeltaSize;
@@ -967,7 +1167,7 @@ void CServer::DoSnapshot()
 			EmptySnap.Clear();
 
 			{
-				DeltashotSize = m_aClients[i].m_Snapshots.Get(m_aClients[i].m_LastAckedSnapshot, 0, &pDeltashot, 0);
+				DeltashotSize = m_aClients[i].m_Snapshots.Get(m_aClients[i].m_LastAckedSnapshot, 0, &pDeltashot, 0, &pDeltashotIndex);
 				if(DeltashotSize >= 0)
 					DeltaTick = m_aClients[i].m_LastAckedSnapshot;
 				else
@@ -978,8 +1178,8 @@ void CServer::DoSnapshot()
 				}
 			}
 
-			// create delta
-			DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
+			// create delta, the index of the new snapshot was built when storing it
+			DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pDeltashotIndex, pData, m_aClients[i].m_Snapshots.m_pLast->m_pIndex, aDeltaData);
 
 			if(DeltaSize)
 			{
@@ -990,6 +1190,8 @@ void CServer::DoSnapshot()
 
 				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData);
 				NumPackets = (SnapshotSize+MaxSize-1)/MaxSize;
+				m_aClients[i].m_SnapshotBytes = SnapshotSize;
+				m_Metrics.Add(m_SnapshotBytesMetric, SnapshotSize);
 
 				for(int n = 0, Left = SnapshotSize; Left; n++)
 				{
@@ -1026,6 +1228,7 @@ void CServer::DoSnapshot()
 				Msg.AddInt(m_CurrentGameTick);
 				Msg.AddInt(m_CurrentGameTick-DeltaTick);
 				SendMsgEx(&Msg, MSGFLAG_FLUSH, i, true);
+				m_aClients[i].m_SnapshotBytes = 0;
 			}
 		}
 	}
@@ -1070,7 +1273,7 @@ int CServer::NewClientCallback(int ClientID, void *pUser)
 {
 	CServer *pThis = (CServer *)pUser;
 	pThis->m_aClients[ClientID].m_State = CClient::STATE_AUTH;
-	pThis->m_aClients[ClientID].m_aName[0] = 0;
+	pThis->ClearClientName(ClientID);
 	pThis->m_aClients[ClientID].m_aClan[0] = 0;
 	pThis->m_aClients[ClientID].m_Country = -1;
 	pThis->m_aClients[ClientID].m_Authed = AUTHED_NO;
@@ -1085,6 +1288,11 @@ int CServer::NewClientCallback(int ClientID, void *pUser)
 	pThis->m_aClients[ClientID].m_Solar = 0;
 	pThis->m_aClients[ClientID].Reset();
 	
+#ifdef CONF_GEOLOCATION
+	// resolve the country while the client downloads the map
+	pThis->m_pGeolocation->request(ClientID, pThis->m_NetServer.ClientAddr(ClientID));
+#endif
+	
 	//Getback session about the client
 	IServer::CClientSession* pSession = pThis->m_NetSession.GetData(pThis->m_NetServer.ClientAddr(ClientID));
 	if(pSession)
@@ -1131,7 +1339,7 @@ int CServer::DelClientCallback(int ClientID, int Type, const char *pReason, void
 		pThis->GameServer()->OnClientDrop(ClientID, Type, pReason);
 
 	pThis->m_aClients[ClientID].m_State = CClient::STATE_EMPTY;
-	pThis->m_aClients[ClientID].m_aName[0] = 0;
+	pThis->ClearClientName(ClientID);
 	pThis->m_aClients[ClientID].m_aClan[0] = 0;
 	pThis->m_aClients[ClientID].m_Country = -1;
 	pThis->m_aClients[ClientID].m_Authed = AUTHED_NO;
@@ -1160,40 +1368,109 @@ void CServer::SendMap(int ClientID)
 	Msg.AddInt(m_CurrentMapSize);
 	SendMsgEx(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, ClientID, true);
 
-	m_aClients[ClientID].m_NextMapChunk = 0;
+	CClient *pClient = &m_aClients[ClientID];
+	pClient->m_NextMapChunk = 0;
+	pClient->m_MapChunksSent = 0;
+	pClient->m_MapWindow = clamp(g_Config.m_InfMapWindow, (int)MAP_WINDOW_MIN, (int)MAP_WINDOW_MAX);
+	pClient->m_MapWindowGrowth = 0;
+	pClient->m_MapSlowStart = true;
+	pClient->m_MapResends = m_NetServer.ClientResends(ClientID);
+	pClient->m_MapRtt = 0;
+	pClient->m_MapMinRtt = 0;
+	pClient->m_MapWindowCut = 0;
 }
 
 void CServer::SendMapData(int ClientID, int Chunk)
 {
- 	unsigned int ChunkSize = 1024-128;
- 	unsigned int Offset = Chunk * ChunkSize;
- 	int Last = 0;
- 
- 	// drop faulty map data requests
- 	if(Chunk < 0 || Offset > m_CurrentMapSize)
- 		return;
- 
- 	if(Offset+ChunkSize >= m_CurrentMapSize)
- 	{
- 		ChunkSize = m_CurrentMapSize-Offset;
- 		Last = 1;
- 	}
- 
- 	CMsgPacker Msg(NETMSG_MAP_DATA);
- 	Msg.AddInt(Last);
- 	Msg.AddInt(m_CurrentMapCrc);
- 	Msg.AddInt(Chunk);
- 	Msg.AddInt(ChunkSize);
- 	Msg.AddRaw(&m_pCurrentMapData[Offset], ChunkSize);
- 	SendMsgEx(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, ClientID, true);
- 
- 	if(g_Config.m_Debug)
- 	{
- 		char aBuf[256];
- 		str_format(aBuf, sizeof(aBuf), "sending chunk %d with size %d", Chunk, ChunkSize);
- 		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
- 	}
- }
+	// drop faulty map data requests
+	if(Chunk < 0 || Chunk >= m_NumMapChunks)
+		return;
+
+	// the chunks are packed at map load, see PackMapChunks
+	CNetChunk Packet;
+	mem_zero(&Packet, sizeof(CNetChunk));
+	Packet.m_ClientID = ClientID;
+	Packet.m_pData = &m_pCurrentMapFrames[Chunk*MAP_FRAME_SIZE];
+	Packet.m_DataSize = m_pCurrentMapFrameSizes[Chunk];
+	Packet.m_Flags = NETSENDFLAG_VITAL|NETSENDFLAG_FLUSH;
+
+	m_DemoRecorder.RecordMessage(Packet.m_pData, Packet.m_DataSize);
+	m_NetServer.Send(&Packet);
+
+	if(g_Config.m_Debug)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "sending chunk %d with size %d", Chunk, Packet.m_DataSize);
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
+	}
+}
+
+void CServer::PackMapChunks(const unsigned char *pData)
+{
+	if(m_pCurrentMapFrames)
+		mem_free(m_pCurrentMapFrames);
+	if(m_pCurrentMapFrameSizes)
+		mem_free(m_pCurrentMapFrameSizes);
+
+	m_NumMapChunks = max(1, (int)((m_CurrentMapSize+MAP_CHUNK_SIZE-1)/MAP_CHUNK_SIZE));
+	m_pCurrentMapFrames = (unsigned char *)mem_alloc_tagged(m_NumMapChunks*MAP_FRAME_SIZE, 1, MEMTAG_NETWORK);
+	m_pCurrentMapFrameSizes = (int *)mem_alloc_tagged(m_NumMapChunks*sizeof(int), 1, MEMTAG_NETWORK);
+
+	for(int Chunk = 0; Chunk < m_NumMapChunks; Chunk++)
+	{
+		unsigned Offset = Chunk*MAP_CHUNK_SIZE;
+		int ChunkSize = min((unsigned)MAP_CHUNK_SIZE, m_CurrentMapSize-Offset);
+
+		CMsgPacker Msg(NETMSG_MAP_DATA);
+		Msg.AddInt(Chunk == m_NumMapChunks-1);
+		Msg.AddInt(m_CurrentMapCrc);
+		Msg.AddInt(Chunk);
+		Msg.AddInt(ChunkSize);
+		Msg.AddRaw(&pData[Offset], ChunkSize);
+
+		// store the system flag in the message id, like SendMsgEx does
+		unsigned char *pFrame = &m_pCurrentMapFrames[Chunk*MAP_FRAME_SIZE];
+		mem_copy(pFrame, Msg.Data(), Msg.Size());
+		pFrame[0] = (pFrame[0]<<1)|1;
+		m_pCurrentMapFrameSizes[Chunk] = Msg.Size();
+	}
+}
+
+void CServer::UpdateMapWindow(int ClientID, int Chunk)
+{
+	CClient *pClient = &m_aClients[ClientID];
+	int64 Now = time_get();
+
+	// the request for a chunk acknowledges the previous one
+	if(Chunk > 0)
+	{
+		int64 Rtt = Now - pClient->m_aMapChunkSendTime[(Chunk-1)%MAP_SEND_TIMES];
+		if(!pClient->m_MapMinRtt || Rtt < pClient->m_MapMinRtt)
+			pClient->m_MapMinRtt = Rtt;
+		pClient->m_MapRtt = pClient->m_MapRtt ? (pClient->m_MapRtt*7 + Rtt)/8 : Rtt;
+	}
+
+	// resent chunks or a queue building up on the path mean the window is too large
+	unsigned Resends = m_NetServer.ClientResends(ClientID);
+	bool Congested = Resends != pClient->m_MapResends || pClient->m_MapRtt > pClient->m_MapMinRtt*2 + time_freq()/50;
+	pClient->m_MapResends = Resends;
+
+	if(Congested)
+	{
+		// back off at most once per round trip
+		if(Now > pClient->m_MapWindowCut + pClient->m_MapRtt)
+		{
+			pClient->m_MapWindow = max(pClient->m_MapWindow/2, (int)MAP_WINDOW_MIN);
+			pClient->m_MapSlowStart = false;
+			pClient->m_MapWindowCut = Now;
+		}
+	}
+	else if(pClient->m_MapSlowStart || ++pClient->m_MapWindowGrowth >= pClient->m_MapWindow)
+	{
+		pClient->m_MapWindow = min(pClient->m_MapWindow+1, (int)MAP_WINDOW_MAX);
+		pClient->m_MapWindowGrowth = 0;
+	}
+}
 
 void CServer::SendConnectionReady(int ClientID)
 {
@@ -1345,22 +1622,25 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 			if((pPacket->m_Flags&NET_CHUNKFLAG_VITAL) == 0 || m_aClients[ClientID].m_State < CClient::STATE_CONNECTING)
 				return;
 
+			CClient *pClient = &m_aClients[ClientID];
 			int Chunk = Unpacker.GetInt();
-			if(Chunk != m_aClients[ClientID].m_NextMapChunk || !g_Config.m_InfFastDownload)
+			if(Chunk != pClient->m_NextMapChunk || !g_Config.m_InfFastDownload)
 			{
 				SendMapData(ClientID, Chunk);
 				return;
 			}
 
-			if(Chunk == 0)
+			UpdateMapWindow(ClientID, Chunk);
+			pClient->m_NextMapChunk++;
+
+			// keep the window full
+			int64 Now = time_get();
+			int End = min(Chunk + pClient->m_MapWindow, m_NumMapChunks);
+			for(; pClient->m_MapChunksSent < End; pClient->m_MapChunksSent++)
 			{
-				for(int i = 0; i < g_Config.m_InfMapWindow; i++)
-				{
-					SendMapData(ClientID, i);
-				}
+				pClient->m_aMapChunkSendTime[pClient->m_MapChunksSent%MAP_SEND_TIMES] = Now;
+				SendMapData(ClientID, pClient->m_MapChunksSent);
 			}
-			SendMapData(ClientID, g_Config.m_InfMapWindow + m_aClients[ClientID].m_NextMapChunk);
-			m_aClients[ClientID].m_NextMapChunk++;
 		}
 		else if(Msg == NETMSG_READY)
 		{
@@ -1397,8 +1677,10 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 		else if(Msg == NETMSG_INPUT)
 		{
 			CClient::CInput *pInput;
+			CClient::CInputStats *pStats = &m_aClients[ClientID].m_InputStats;
 			int64 TagTime;
 
+			int PrevAckedSnapshot = m_aClients[ClientID].m_LastAckedSnapshot;
 			m_aClients[ClientID].m_LastAckedSnapshot = Unpacker.GetInt();
 			int IntendedTick = Unpacker.GetInt();
 			int Size = Unpacker.GetInt();
@@ -1411,26 +1693,60 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				m_aClients[ClientID].m_SnapRate = CClient::SNAPRATE_FULL;
 
 			if(m_aClients[ClientID].m_Snapshots.Get(m_aClients[ClientID].m_LastAckedSnapshot, &TagTime, 0, 0) >= 0)
-				m_aClients[ClientID].m_Latency = (int)(((time_get()-TagTime)*1000)/time_freq());
+			{
+				int64 AckTime = time_get()-TagTime;
+				m_aClients[ClientID].m_Latency = (int)((AckTime*1000)/time_freq());
+
+				// the same ack is repeated with every input until the next snapshot arrives
+				if(m_aClients[ClientID].m_LastAckedSnapshot != PrevAckedSnapshot)
+				{
+					double Seconds = AckTime/(double)time_freq();
+					pStats->m_aAckCounts[FindBucket(s_aAckLatencyBounds, NUM_ACK_LATENCY_BOUNDS, Seconds)]++;
+					pStats->m_AckSum += Seconds;
+					pStats->m_NumAcks++;
+					pStats->m_LastAckLatency = Seconds;
+					m_Metrics.Observe(m_AckLatencyMetric, Seconds);
+				}
+			}
+
+			CountInputEvent(ClientID, INPUT_RECEIVED);
 
 			// add message to report the input timing
 			// skip packets that are old
 			if(IntendedTick > m_aClients[ClientID].m_LastInputTick)
 			{
-				int TimeLeft = ((TickStartTime(IntendedTick)-time_get())*1000) / time_freq();
+				int64 Margin = TickStartTime(IntendedTick)-time_get();
+				int TimeLeft = (Margin*1000) / time_freq();
 
 				CMsgPacker Msg(NETMSG_INPUTTIMING);
 				Msg.AddInt(IntendedTick);
 				Msg.AddInt(TimeLeft);
 				SendMsgEx(&Msg, 0, ClientID, true);
+
+				double Seconds = Margin/(double)time_freq();
+				pStats->m_aMarginCounts[FindBucket(s_aInputMarginBounds, NUM_INPUT_MARGIN_BOUNDS, Seconds)]++;
+				pStats->m_MarginSum += Seconds;
+				m_Metrics.Observe(m_InputMarginMetric, Seconds);
 			}
+			else
+				CountInputEvent(ClientID, INPUT_DUPLICATE);
 
 			m_aClients[ClientID].m_LastInputTick = IntendedTick;
 
 			pInput = &m_aClients[ClientID].m_aInputs[m_aClients[ClientID].m_CurrentInput];
 
 			if(IntendedTick <= Tick())
+			{
 				IntendedTick = Tick()+1;
+				CountInputEvent(ClientID, INPUT_CLAMPED);
+			}
+
+			// the tick loop applies the input with the lowest ring index for a tick, which is
+			// the older one unless the ring wrapped between the two
+			if(pInput->m_GameTick > Tick())
+				CountInputEvent(ClientID, INPUT_OVERWRITTEN);
+			if(m_aClients[ClientID].m_aInputs[(m_aClients[ClientID].m_CurrentInput+199)%200].m_GameTick == IntendedTick)
+				CountInputEvent(ClientID, INPUT_SHADOWED);
 
 			pInput->m_GameTick = IntendedTick;
 
@@ -1906,6 +2222,7 @@ void CServer::PumpNetwork()
 	m_NetSession.Update();
 	m_NetAccusation.Update();
 	m_Econ.Update();
+	m_MetricsHttp.Update();
 }
 
 char *CServer::GetMapName()
@@ -1922,6 +2239,8 @@ char *CServer::GetMapName()
 
 int CServer::LoadMap(const char *pMapName)
 {
+	int64 LoadStart = time_get();
+
 	//DATAFILE *df;
 	char aBuf[512];
 	str_format(aBuf, sizeof(aBuf), "maps/%s.map", pMapName);
@@ -1945,13 +2264,14 @@ int CServer::LoadMap(const char *pMapName)
 	//We need to convert the map to something that the client can use
 	//First, try to find if the client map is already generated
 	{
-		CDataFileReader dfServerMap;
-		dfServerMap.Open(Storage(), aBuf, IStorage::TYPE_ALL);
-		unsigned ServerMapCrc = dfServerMap.Crc();
-		dfServerMap.Close();
+		unsigned ServerMapCrc = m_pMap->Crc();
 		
 		char aClientMapName[256];
-		str_format(aClientMapName, sizeof(aClientMapName), "clientmaps/%s_%08x/tw06-highres.map", pMapName, ServerMapCrc);
+		CMapCatalog::CEntry Entry;
+		if(m_MapCatalog.Get(pMapName, &Entry) && Entry.m_Crc == ServerMapCrc)
+			str_copy(aClientMapName, Entry.m_aClientMap, sizeof(aClientMapName));
+		else
+			CMapCatalog::FormatClientMapPath(aClientMapName, sizeof(aClientMapName), pMapName, ServerMapCrc);
 		
 		CMapConverter MapConverter(Storage(), m_pMap, Console());
 		if(!MapConverter.Load())
@@ -1959,40 +2279,55 @@ int CServer::LoadMap(const char *pMapName)
 		
 		m_TimeShiftUnit = MapConverter.GetTimeShiftUnit();
 		
+		// the instances on this machine share the converted maps, a map at the final path is
+		// complete because every conversion is written to a file of its own and renamed
 		CDataFileReader dfClientMap;
-		//The map must be converted
-		
-		char aClientMapDir[256];
-		str_format(aClientMapDir, sizeof(aClientMapDir), "clientmaps/%s_%08x", pMapName, ServerMapCrc);
-			
-		char aFullPath[512];
-		Storage()->GetCompletePath(IStorage::TYPE_SAVE, aClientMapDir, aFullPath, sizeof(aFullPath));
-		if(fs_makedir(aFullPath) != 0)
+		if(dfClientMap.Open(Storage(), aClientMapName, IStorage::TYPE_SAVE))
 		{
-			dbg_msg("infclass", "Can't create the directory '%s'", aClientMapDir);
+			dfClientMap.Close();
+			Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", "using the client map converted before");
 		}
+		else
+		{
+			char aClientMapDir[256];
+			CMapCatalog::FormatClientMapDir(aClientMapDir, sizeof(aClientMapDir), pMapName, ServerMapCrc);
 				
-		if(!MapConverter.CreateMap(aClientMapName))
-			return 0;
+			char aFullPath[512];
+			Storage()->GetCompletePath(IStorage::TYPE_SAVE, aClientMapDir, aFullPath, sizeof(aFullPath));
+			if(fs_makedir(aFullPath) != 0)
+			{
+				dbg_msg("infclass", "Can't create the directory '%s'", aClientMapDir);
+			}
 			
-		CDataFileReader dfGeneratedMap;
-		dfGeneratedMap.Open(Storage(), aClientMapName, IStorage::TYPE_ALL);
-		m_CurrentMapCrc = dfGeneratedMap.Crc();
-		dfGeneratedMap.Close();
-		
+			// the port tells the instances apart
+			char aTmpClientMapName[256];
+			str_format(aTmpClientMapName, sizeof(aTmpClientMapName), "%s.%d.tmp", aClientMapName, g_Config.m_SvPort);
+			if(!MapConverter.CreateMap(aTmpClientMapName))
+				return 0;
+			if(!Storage()->RenameFile(aTmpClientMapName, aClientMapName, IStorage::TYPE_SAVE))
+			{
+				dbg_msg("infclass", "Can't rename '%s' to '%s'", aTmpClientMapName, aClientMapName);
+				Storage()->RemoveFile(aTmpClientMapName, IStorage::TYPE_SAVE);
+				return 0;
+			}
+		}
+			
+		//Download the generated map in memory to send it to clients
+		IOHANDLE File = Storage()->OpenFile(aClientMapName, IOFLAG_READ, IStorage::TYPE_ALL);
+		if(!File)
+			return 0;
+		m_CurrentMapSize = (int)io_length(File);
+		unsigned char *pMapData = (unsigned char *)mem_alloc_tagged(m_CurrentMapSize, 1, MEMTAG_MAP);
+		io_read(File, pMapData, m_CurrentMapSize);
+		io_close(File);
+		m_CurrentMapCrc = crc32(0, pMapData, m_CurrentMapSize); // ignore_convention
+		PackMapChunks(pMapData);
+		mem_free(pMapData);
 	
 		char aBufMsg[128];
 		str_format(aBufMsg, sizeof(aBufMsg), "map crc is %08x, generated map crc is %08x", ServerMapCrc, m_CurrentMapCrc);
 		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBufMsg);
 		
-		//Download the generated map in memory to send it to clients
-		IOHANDLE File = Storage()->OpenFile(aClientMapName, IOFLAG_READ, IStorage::TYPE_ALL);
-		m_CurrentMapSize = (int)io_length(File);
-		if(m_pCurrentMapData)
-			mem_free(m_pCurrentMapData);
-		m_pCurrentMapData = (unsigned char *)mem_alloc(m_CurrentMapSize, 1);
-		io_read(File, m_pCurrentMapData, m_CurrentMapSize);
-		io_close(File);
 		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", "maps/infc_x_current.map loaded in memory");
 	}
 
@@ -2006,96 +2341,40 @@ int CServer::LoadMap(const char *pMapName)
 	ResetMapVotes();
 
 /* INFECTION MODIFICATION END *****************************************/
+
+	m_Metrics.Set(m_MapLoadMetric, (time_get()-LoadStart)/(double)time_freq());
 	
 	return 1;
 }
 
 int CServer::GetMinPlayersForMap(const char* pMapName)
 {
-	int MinPlayers = 0;
-	char MapInfoFilename[256];
-	str_format(MapInfoFilename, sizeof(MapInfoFilename), "maps/%s.mapinfo", pMapName);
-	IOHANDLE File = Storage()->OpenFile(MapInfoFilename, IOFLAG_READ, IStorage::TYPE_ALL);
-
-	if(!File)
-		return 0;
-
-	char MapInfoLine[512];
-	bool isEndOfFile = false;
-	while(!isEndOfFile)
-	{
-		isEndOfFile = true;
-		
-		//Load one line
-		int MapInfoLineLength = 0;
-		char c;
-		while(io_read(File, &c, 1))
-		{
-			isEndOfFile = false;
-			
-			if(c == '\n') break;
-			else
-			{
-				MapInfoLine[MapInfoLineLength] = c;
-				MapInfoLineLength++;
-			}
-		}
-		
-		MapInfoLine[MapInfoLineLength] = 0;
-		
-		//Get the key
-		if(str_comp_nocase_num(MapInfoLine, "#minplayers ", 12) == 0)
-		{
-			MinPlayers = str_toint(MapInfoLine+12);
-		}
-	}
-	io_close(File);
-
-	return MinPlayers;
+	CMapCatalog::CEntry Entry;
+	return m_MapCatalog.Get(pMapName, &Entry) ? Entry.m_MinPlayers : 0;
 }
 
 int CServer::GetMaxPlayersForMap(const char* pMapName)
 {
-	int MaxPlayers = 0;
-	char MapInfoFilename[256];
-	str_format(MapInfoFilename, sizeof(MapInfoFilename), "maps/%s.mapinfo", pMapName);
-	IOHANDLE File = Storage()->OpenFile(MapInfoFilename, IOFLAG_READ, IStorage::TYPE_ALL);
+	CMapCatalog::CEntry Entry;
+	return m_MapCatalog.Get(pMapName, &Entry) ? Entry.m_MaxPlayers : 0;
+}
 
-	if(!File)
-		return 0;
+bool CServer::MapExists(const char* pMapName)
+{
+	CMapCatalog::CEntry Entry;
+	return m_MapCatalog.Get(pMapName, &Entry);
+}
 
-	char MapInfoLine[512];
-	bool isEndOfFile = false;
-	while(!isEndOfFile)
-	{
-		isEndOfFile = true;
-		
-		//Load one line
-		int MapInfoLineLength = 0;
-		char c;
-		while(io_read(File, &c, 1))
-		{
-			isEndOfFile = false;
-			
-			if(c == '\n') break;
-			else
-			{
-				MapInfoLine[MapInfoLineLength] = c;
-				MapInfoLineLength++;
-			}
-		}
-		
-		MapInfoLine[MapInfoLineLength] = 0;
-		
-		//Get the key
-		if(str_comp_nocase_num(MapInfoLine, "#maxplayers ", 12) == 0)
-		{
-			MaxPlayers = str_toint(MapInfoLine+12);
-		}
-	}
-	io_close(File);
+int CServer::GetMapRotationSize()
+{
+	return m_MapCatalog.RotationSize(g_Config.m_SvMaprotation);
+}
 
-	return MaxPlayers;
+const char* CServer::GetMapRotationName(int Index)
+{
+	if(Index < 0 || Index >= GetMapRotationSize())
+		return "";
+	return m_MapCatalog.RotationName(Index);
 }
 
 void CServer::InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, IConsole *pConsole)
@@ -2103,69 +2382,16 @@ void CServer::InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterS
 	m_Register.Init(pNetServer, pMasterServer, pConsole);
 }
 
-static bool IsSeparator(char c) { return c == ';' || c == ' ' || c == ',' || c == '\t'; }
-
 int CServer::Run()
 {
 	//
 	m_PrintCBIndex = Console()->RegisterPrintCallback(g_Config.m_ConsoleOutputLevel, SendRconLineAuthed, this);
 
+	m_MapCatalog.Rescan();
+
 	//Choose a random map from the rotation
-	if(!str_length(g_Config.m_SvMap) && str_length(g_Config.m_SvMaprotation))
-	{
-		int nbMaps = 0;
-		{
-			const char *pNextMap = g_Config.m_SvMaprotation;
-			
-			//Skip initial separator
-			while(*pNextMap && IsSeparator(*pNextMap))
-				pNextMap++;
-				
-			while(*pNextMap)
-			{
-				while(*pNextMap && !IsSeparator(*pNextMap))
-					pNextMap++;
-				while(*pNextMap && IsSeparator(*pNextMap))
-					pNextMap++;
-			
-				nbMaps++;
-			}
-		}
-		
-		int MapPos = random_int(0, nbMaps-1);
-		char aBuf[512] = {0};
-		
-		{
-			int MapPosIter = 0;
-			const char *pNextMap = g_Config.m_SvMaprotation;
-			
-			//Skip initial separator
-			while(*pNextMap && IsSeparator(*pNextMap))
-				pNextMap++;
-				
-			while(*pNextMap)
-			{
-				if(MapPosIter == MapPos)
-				{
-					int MapNameLength = 0;
-					while(pNextMap[MapNameLength] && !IsSeparator(pNextMap[MapNameLength]))
-						MapNameLength++;
-					mem_copy(aBuf, pNextMap, MapNameLength);	
-					aBuf[MapNameLength] = 0;
-					break;
-				}
-				
-				while(*pNextMap && !IsSeparator(*pNextMap))
-					pNextMap++;
-				while(*pNextMap && IsSeparator(*pNextMap))
-					pNextMap++;
-			
-				MapPosIter++;
-			}
-		}
-		
-		str_copy(g_Config.m_SvMap, aBuf, sizeof(g_Config.m_SvMap));
-	}
+	if(!str_length(g_Config.m_SvMap) && GetMapRotationSize())
+		str_copy(g_Config.m_SvMap, GetMapRotationName(random_int(0, GetMapRotationSize()-1)), sizeof(g_Config.m_SvMap));
 
 	// load map
 	if(!LoadMap(g_Config.m_SvMap))
@@ -2189,7 +2415,7 @@ int CServer::Run()
 		BindAddr.port = g_Config.m_SvPort;
 	}
 
-	if(!m_NetServer.Open(BindAddr, &m_ServerBan, g_Config.m_SvMaxClients, g_Config.m_SvMaxClientsPerIP, 0))
+	if(!m_NetServer.Open(BindAddr, &m_ServerBan, g_Config.m_SvMaxClients, g_Config.m_SvMaxClientsPerIP, g_Config.m_SvNetThread ? NETFLAG_IOTHREAD : 0))
 	{
 		dbg_msg("server", "couldn't open socket. port %d might already be in use", g_Config.m_SvPort);
 		return -1;
@@ -2207,8 +2433,30 @@ int CServer::Run()
 
 	m_NetServer.SetCallbacks(NewClientCallback, ClientRejoinCallback, DelClientCallback, this);
 
+	m_pWaiter = waiter_create();
+	if(m_pWaiter)
+		m_NetServer.SetWaiter(m_pWaiter);
+	else
+		dbg_msg("server", "failed to create the tick waiter, polling the socket");
+
 	m_Econ.Init(Console(), &m_ServerBan);
 
+	if(g_Config.m_SvMetricsPort)
+	{
+		NETADDR BindAddr;
+		if(!g_Config.m_SvMetricsBindaddr[0] || net_host_lookup(g_Config.m_SvMetricsBindaddr, &BindAddr, NETTYPE_ALL) != 0)
+			mem_zero(&BindAddr, sizeof(BindAddr));
+		BindAddr.type = NETTYPE_ALL;
+		BindAddr.port = g_Config.m_SvMetricsPort;
+
+		char aBuf[128];
+		if(m_MetricsHttp.Open(BindAddr, WriteMetrics, this))
+			str_format(aBuf, sizeof(aBuf), "bound to %s:%d", g_Config.m_SvMetricsBindaddr, g_Config.m_SvMetricsPort);
+		else
+			str_format(aBuf, sizeof(aBuf), "couldn't open port %d", g_Config.m_SvMetricsPort);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "metrics", aBuf);
+	}
+
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "server name is '%s'", g_Config.m_SvName);
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
@@ -2244,9 +2492,13 @@ int CServer::Run()
 #endif
 			if(NonActive)
 				PumpNetwork();
+			m_Metrics.Add(m_WakeupsMetric, 1);
+			UpdateHibernation();
 			int64 t = time_get();
 			int NewTicks = 0;
 
+			m_MapCatalog.Refresh();
+
 			// load new map TODO: don't poll this
 			if(str_comp(g_Config.m_SvMap, m_aCurrentMap) != 0 || m_MapReload)
 			{
@@ -2285,32 +2537,22 @@ int CServer::Run()
 				}
 			}
 
-			while(t > TickStartTime(m_CurrentGameTick+1))
+			while(!m_Hibernating && t > TickStartTime(m_CurrentGameTick+1))
 			{
+				int64 TickStart = time_get();
 				m_CurrentGameTick++;
 				NewTicks++;
+				m_Metrics.Observe(m_TickLatenessMetric, (TickStart-TickStartTime(m_CurrentGameTick))/(double)time_freq());
 
-				//Check for name collision. We add this because the login is in a different thread and can't check it himself.
 				for(int i=MAX_CLIENTS-1; i>=0; i--)
 				{
 					if(m_aClients[i].m_State >= CClient::STATE_READY && m_aClients[i].m_Session.m_MuteTick > 0)
 						m_aClients[i].m_Session.m_MuteTick--;
-					
-					if(m_aClients[i].m_State >= CClient::STATE_READY)
-					{
-						if(TrySetClientName(i, m_aClients[i].m_aName))
-						{
-							// auto rename
-							for(int j = 1;; j++)
-							{
-								char aNameTry[MAX_NAME_LENGTH];
-								str_format(aNameTry, sizeof(aNameTry), "(%d)%s", j, m_aClients[i].m_aName);
-								if(TrySetClientName(i, aNameTry) == 0)
-									break;
-							}
-						}
-					}
 				}
+
+				// names set from other threads, the collisions are checked when a name is set
+				if(m_NumNameRequests)
+					ApplyRequestedNames();
 				
 				for(int i=0; i<MAX_CLIENTS; i++)
 				{
@@ -2349,7 +2591,8 @@ int CServer::Run()
 				}
 
 				GameServer()->OnTick();
-				
+
+				m_Metrics.Observe(m_TickDurationMetric, (time_get()-TickStart)/(double)time_freq());
 			}
 
 			// snap game
@@ -2368,9 +2611,18 @@ int CServer::Run()
 				PumpNetwork();
 
 			NonActive = true;
+			m_NetServer.FlushIOThread();
 
-			// wait for incomming data
-			net_socket_read_wait(m_NetServer.Socket(), 5);
+			// wait for incomming data or the next tick, the snapshots are taken on ticks
+			if(m_pWaiter)
+			{
+				int64 Deadline = TickStartTime(m_CurrentGameTick+1);
+				if(m_Hibernating)
+					Deadline = time_get() + time_freq()*HIBERNATION_WAKE_INTERVAL;
+				waiter_wait_until(m_pWaiter, Deadline);
+			}
+			else
+				net_socket_read_wait(m_NetServer.Socket(), 5);
 
 #if defined(MEASURE_TICKS)
 			MeasureTicks.End();
@@ -2391,12 +2643,21 @@ int CServer::Run()
 
 		m_Econ.Shutdown();
 	}
+	m_MetricsHttp.Shutdown();
+	m_NetServer.Close();
+	if(m_pWaiter)
+	{
+		waiter_destroy(m_pWaiter);
+		m_pWaiter = 0;
+	}
 
 	GameServer()->OnShutdown();
 	m_pMap->Unload();
 
-	if(m_pCurrentMapData)
-		mem_free(m_pCurrentMapData);
+	if(m_pCurrentMapFrames)
+		mem_free(m_pCurrentMapFrames);
+	if(m_pCurrentMapFrameSizes)
+		mem_free(m_pCurrentMapFrameSizes);
 		
 	return 0;
 }
@@ -2601,6 +2862,116 @@ bool CServer::ConMapReload(IConsole::IResult *pResult, void *pUser)
 	return true;
 }
 
+bool CServer::ConRescanMaps(IConsole::IResult *pResult, void *pUser)
+{
+	((CServer *)pUser)->m_MapCatalog.Rescan();
+	
+	return true;
+}
+
+bool CServer::ConListMaps(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pSelf = (CServer *)pUser;
+	for(int i = 0; i < pSelf->m_MapCatalog.Num(); i++)
+	{
+		const CMapCatalog::CEntry *pEntry = pSelf->m_MapCatalog.GetByIndex(i);
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "%s crc=%08x size=%u minplayers=%d maxplayers=%d timelimit=%d",
+			pEntry->m_aName, pEntry->m_Crc, pEntry->m_Size, pEntry->m_MinPlayers, pEntry->m_MaxPlayers, pEntry->m_TimeLimit);
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "mapcatalog", aBuf);
+	}
+	
+	return true;
+}
+
+bool CServer::ConSnapIDStats(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pSelf = (CServer *)pUser;
+	const CSnapIDPool *pPool = &pSelf->m_IDPool;
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "ids: %d/%d used, %d alloced, %d timed",
+		pPool->GetUsage(), pPool->GetMaxIDs(), pPool->GetIDCount(), pPool->GetNumTimed());
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "snapid", aBuf);
+	str_format(aBuf, sizeof(aBuf), "peak: %d used, %d alloced, %d timed",
+		pPool->GetPeakUsage(), pPool->GetPeakInUsage(), pPool->GetPeakTimed());
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "snapid", aBuf);
+	str_format(aBuf, sizeof(aBuf), "ranges: %d, leaked ids: %d", pPool->GetNumRanges(), pPool->GetNumLeaked());
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "snapid", aBuf);
+
+	return true;
+}
+
+void CServer::PrintMetricsLine(const char *pLine, void *pUser)
+{
+	CServer *pSelf = (CServer *)pUser;
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "metrics", pLine);
+}
+
+bool CServer::ConMetrics(IConsole::IResult *pResult, void *pUser)
+{
+	WriteMetrics(PrintMetricsLine, pUser, pUser);
+	return true;
+}
+
+bool CServer::ConInputStats(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pSelf = (CServer *)pUser;
+	char aBuf[256];
+
+	// a summary line per client, or the histograms of one client
+	if(pResult->NumArguments() == 0)
+	{
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			if(pSelf->m_aClients[i].m_State != CClient::STATE_INGAME)
+				continue;
+			const CClient::CInputStats *pStats = &pSelf->m_aClients[i].m_InputStats;
+			int64 NumTimed = pStats->m_aNumEvents[INPUT_RECEIVED]-pStats->m_aNumEvents[INPUT_DUPLICATE];
+			str_format(aBuf, sizeof(aBuf), "id=%d inputs=%lld clamped=%lld duplicate=%lld shadowed=%lld overwritten=%lld margin=%.1fms ack=%.1fms",
+				i, (long long)pStats->m_aNumEvents[INPUT_RECEIVED], (long long)pStats->m_aNumEvents[INPUT_CLAMPED],
+				(long long)pStats->m_aNumEvents[INPUT_DUPLICATE], (long long)pStats->m_aNumEvents[INPUT_SHADOWED],
+				(long long)pStats->m_aNumEvents[INPUT_OVERWRITTEN],
+				NumTimed > 0 ? pStats->m_MarginSum*1000/NumTimed : 0.0,
+				pStats->m_NumAcks ? pStats->m_AckSum*1000/pStats->m_NumAcks : 0.0);
+			pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input", aBuf);
+		}
+		return true;
+	}
+
+	int ClientID = pResult->GetInteger(0);
+	if(ClientID < 0 || ClientID >= MAX_CLIENTS || pSelf->m_aClients[ClientID].m_State == CClient::STATE_EMPTY)
+	{
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input", "invalid client id");
+		return true;
+	}
+
+	const CClient::CInputStats *pStats = &pSelf->m_aClients[ClientID].m_InputStats;
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input", "time left until the intended tick:");
+	for(int i = 0; i <= NUM_INPUT_MARGIN_BOUNDS; i++)
+	{
+		if(i < NUM_INPUT_MARGIN_BOUNDS)
+			str_format(aBuf, sizeof(aBuf), "  <= %gms: %lld", s_aInputMarginBounds[i]*1000, (long long)pStats->m_aMarginCounts[i]);
+		else
+			str_format(aBuf, sizeof(aBuf), "  more: %lld", (long long)pStats->m_aMarginCounts[i]);
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input", aBuf);
+	}
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input", "snapshot ack latency:");
+	for(int i = 0; i <= NUM_ACK_LATENCY_BOUNDS; i++)
+	{
+		if(i < NUM_ACK_LATENCY_BOUNDS)
+			str_format(aBuf, sizeof(aBuf), "  <= %gms: %lld", s_aAckLatencyBounds[i]*1000, (long long)pStats->m_aAckCounts[i]);
+		else
+			str_format(aBuf, sizeof(aBuf), "  more: %lld", (long long)pStats->m_aAckCounts[i]);
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input", aBuf);
+	}
+	str_format(aBuf, sizeof(aBuf), "inputs=%lld clamped=%lld duplicate=%lld shadowed=%lld overwritten=%lld",
+		(long long)pStats->m_aNumEvents[INPUT_RECEIVED], (long long)pStats->m_aNumEvents[INPUT_CLAMPED],
+		(long long)pStats->m_aNumEvents[INPUT_DUPLICATE], (long long)pStats->m_aNumEvents[INPUT_SHADOWED],
+		(long long)pStats->m_aNumEvents[INPUT_OVERWRITTEN]);
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input", aBuf);
+	return true;
+}
+
 bool CServer::ConLogout(IConsole::IResult *pResult, void *pUser)
 {
 	CServer *pServer = (CServer *)pUser;
@@ -2693,6 +3064,8 @@ void CServer::RegisterCommands()
 	m_pMap = Kernel()->RequestInterface<IEngineMap>();
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
 
+	m_MapCatalog.Init(m_pStorage, m_pConsole, Kernel()->RequestInterface<IEngine>());
+
 	// register console commands
 	Console()->Register("kick", "s<username or uid> ?r<reason>", CFGFLAG_SERVER, ConKick, this, "Kick player with specified id for any reason");
 	Console()->Register("option_status", "", CFGFLAG_SERVER, ConOptionStatus, this, "List player options");
@@ -2703,6 +3076,11 @@ void CServer::RegisterCommands()
 	Console()->Register("stoprecord", "", CFGFLAG_SERVER, ConStopRecord, this, "Stop recording");
 
 	Console()->Register("reload", "", CFGFLAG_SERVER, ConMapReload, this, "Reload the map");
+	Console()->Register("rescan_maps", "", CFGFLAG_SERVER, ConRescanMaps, this, "Rebuild the map catalog from the maps folder");
+	Console()->Register("list_maps", "", CFGFLAG_SERVER, ConListMaps, this, "List the maps of the map catalog");
+	Console()->Register("snap_id_stats", "", CFGFLAG_SERVER, ConSnapIDStats, this, "Show snap id usage, peaks and leaks");
+	Console()->Register("metrics", "", CFGFLAG_SERVER, ConMetrics, this, "Print the metrics in the prometheus text format");
+	Console()->Register("input_stats", "?i<clientid>", CFGFLAG_SERVER, ConInputStats, this, "Show how late the inputs arrive, and the snapshot ack latency");
 
 	Console()->Chain("sv_name", ConchainSpecialInfoupdate, this);
 	Console()->Chain("password", ConchainSpecialInfoupdate, this);
@@ -2723,6 +3101,136 @@ void CServer::RegisterCommands()
 }
 
 
+void CServer::InitMetrics()
+{
+	static const double s_aTickBounds[] = {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.015, 0.02, 0.04, 0.1, 0.25};
+	m_TickDurationMetric = m_Metrics.Histogram("teeworlds_tick_duration_seconds", "Time spent in one game tick", s_aTickBounds, sizeof(s_aTickBounds)/sizeof(s_aTickBounds[0]));
+	static const double s_aLatenessBounds[] = {0.0001, 0.00025, 0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05};
+	m_TickLatenessMetric = m_Metrics.Histogram("teeworlds_tick_lateness_seconds", "Delay between the planned and the actual start of a tick", s_aLatenessBounds, sizeof(s_aLatenessBounds)/sizeof(s_aLatenessBounds[0]));
+	m_WakeupsMetric = m_Metrics.Counter("teeworlds_main_loop_wakeups_total", "Iterations of the main loop");
+	m_SnapshotBytesMetric = m_Metrics.Counter("teeworlds_snapshot_bytes_total", "Compressed snapshot bytes sent to all clients");
+	m_MapLoadMetric = m_Metrics.Gauge("teeworlds_map_load_seconds", "Time spent loading and converting the current map");
+	m_InputMarginMetric = m_Metrics.Histogram("teeworlds_input_margin_seconds", "Time left until the intended tick when an input arrives, negative if late", s_aInputMarginBounds, NUM_INPUT_MARGIN_BOUNDS);
+	m_AckLatencyMetric = m_Metrics.Histogram("teeworlds_snapshot_ack_latency_seconds", "Time from sending a snapshot to its first ack", s_aAckLatencyBounds, NUM_ACK_LATENCY_BOUNDS);
+
+	static const char *s_apInputEvents[NUM_INPUT_EVENTS] = {"received", "clamped", "duplicate", "shadowed", "overwritten"};
+	for(int i = 0; i < NUM_INPUT_EVENTS; i++)
+	{
+		char aLabels[32];
+		str_format(aLabels, sizeof(aLabels), "event=\"%s\"", s_apInputEvents[i]);
+		m_aInputEventMetrics[i] = m_Metrics.Counter("teeworlds_inputs_total", "Inputs received and what happened to them", aLabels);
+	}
+}
+
+void CServer::CountInputEvent(int ClientID, int Event)
+{
+	m_aClients[ClientID].m_InputStats.m_aNumEvents[Event]++;
+	m_Metrics.Add(m_aInputEventMetrics[Event], 1);
+}
+
+void CServer::UpdateHibernation()
+{
+	bool Empty = true;
+	for(int i = 0; i < MAX_CLIENTS && Empty; i++)
+		Empty = m_aClients[i].m_State == CClient::STATE_EMPTY;
+
+	if(!m_Hibernating && Empty && g_Config.m_SvHibernation && m_pWaiter)
+	{
+		m_Hibernating = true;
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", "no clients, hibernating");
+	}
+	else if(m_Hibernating && (!Empty || !g_Config.m_SvHibernation))
+	{
+		// continue with the next tick as if there was no pause
+		m_Hibernating = false;
+		m_GameStartTime = time_get() - (time_freq()*m_CurrentGameTick)/SERVER_TICK_SPEED;
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", "leaving hibernation");
+	}
+}
+
+void CServer::WriteMetrics(CMetrics::FWriteLine pfnWriteLine, void *pLineUser, void *pUser)
+{
+	CServer *pSelf = (CServer *)pUser;
+	CMetrics *pMetrics = &pSelf->m_Metrics;
+	char aLabels[32];
+
+	pMetrics->BeginWrite(pfnWriteLine, pLineUser);
+
+	int NumClients = 0;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(pSelf->m_aClients[i].m_State != CClient::STATE_EMPTY)
+			NumClients++;
+	}
+	pMetrics->WriteGauge("teeworlds_clients", "Connected clients", "", NumClients);
+	pMetrics->WriteGauge("teeworlds_hibernating", "Whether the empty server skips its ticks", "", pSelf->m_Hibernating ? 1 : 0);
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(pSelf->m_aClients[i].m_State != CClient::STATE_INGAME)
+			continue;
+		str_format(aLabels, sizeof(aLabels), "client=\"%d\"", i);
+		pMetrics->WriteGauge("teeworlds_client_snapshot_bytes", "Compressed size of the last snapshot sent to a client", aLabels, pSelf->m_aClients[i].m_SnapshotBytes);
+	}
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(pSelf->m_aClients[i].m_State != CClient::STATE_INGAME)
+			continue;
+		str_format(aLabels, sizeof(aLabels), "client=\"%d\"", i);
+		pMetrics->WriteCounter("teeworlds_client_inputs_clamped_total", "Inputs of a client that arrived after their tick", aLabels, pSelf->m_aClients[i].m_InputStats.m_aNumEvents[INPUT_CLAMPED]);
+	}
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(pSelf->m_aClients[i].m_State != CClient::STATE_INGAME)
+			continue;
+		str_format(aLabels, sizeof(aLabels), "client=\"%d\"", i);
+		pMetrics->WriteGauge("teeworlds_client_snapshot_ack_latency_seconds", "Time from sending the last acked snapshot of a client to its first ack", aLabels, pSelf->m_aClients[i].m_InputStats.m_LastAckLatency);
+	}
+
+	NETSTATS NetStats;
+	net_stats(&NetStats);
+	pMetrics->WriteCounter("teeworlds_packets_received_total", "UDP packets received", "", (unsigned)NetStats.recv_packets);
+	pMetrics->WriteCounter("teeworlds_packets_sent_total", "UDP packets sent", "", (unsigned)NetStats.sent_packets);
+	pMetrics->WriteCounter("teeworlds_received_bytes_total", "UDP bytes received", "", (unsigned)NetStats.recv_bytes);
+	pMetrics->WriteCounter("teeworlds_sent_bytes_total", "UDP bytes sent", "", (unsigned)NetStats.sent_bytes);
+	if(CNetIOThread *pIOThread = pSelf->m_NetServer.IOThread())
+	{
+		pMetrics->WriteGauge("teeworlds_net_thread_recv_queue", "Unpacked packets waiting for the game thread", "", pIOThread->RecvQueueSize());
+		pMetrics->WriteGauge("teeworlds_net_thread_send_queue", "Datagrams waiting for the network thread", "", pIOThread->SendQueueSize());
+		pMetrics->WriteCounter("teeworlds_net_thread_recv_stalls_total", "Times the network thread found the receive queue full", "", pIOThread->NumRecvStalled());
+		pMetrics->WriteCounter("teeworlds_net_thread_send_bypassed_total", "Datagrams sent without the network thread", "", pIOThread->NumSendBypassed());
+	}
+
+	const MEMSTATS *pMemStats = mem_stats();
+	pMetrics->WriteGauge("teeworlds_memory_allocated_bytes", "Bytes allocated with mem_alloc", "", pMemStats->allocated);
+	pMetrics->WriteGauge("teeworlds_memory_active_allocations", "Live allocations made with mem_alloc", "", pMemStats->active_allocations);
+	pMetrics->WriteCounter("teeworlds_memory_allocations_total", "Allocations made with mem_alloc", "", (unsigned)pMemStats->total_allocations);
+	static const char *s_apMemTags[NUM_MEMTAGS] = {"other", "snapshot", "entity", "network", "map"};
+	for(int i = 0; i < NUM_MEMTAGS; i++)
+	{
+		str_format(aLabels, sizeof(aLabels), "tag=\"%s\"", s_apMemTags[i]);
+		pMetrics->WriteGauge("teeworlds_memory_tag_allocated_bytes", "Bytes allocated with mem_alloc per tag", aLabels, pMemStats->tag_allocated[i]);
+	}
+	for(int i = 0; i < NUM_MEMTAGS; i++)
+	{
+		str_format(aLabels, sizeof(aLabels), "tag=\"%s\"", s_apMemTags[i]);
+		pMetrics->WriteGauge("teeworlds_memory_tag_active_allocations", "Live allocations made with mem_alloc per tag", aLabels, pMemStats->tag_active_allocations[i]);
+	}
+
+	unsigned LogDropped, LogLimited;
+	dbg_logger_async_stats(&LogDropped, &LogLimited);
+	pMetrics->WriteCounter("teeworlds_log_dropped_total", "Log lines dropped because the log queue was full", "", LogDropped);
+	pMetrics->WriteCounter("teeworlds_log_rate_limited_total", "Log lines dropped by log_rate_limit", "", LogLimited);
+
+	pMetrics->WriteGauge("teeworlds_snap_ids_used", "Snap ids alloced or waiting to be released", "", pSelf->m_IDPool.GetUsage());
+	pMetrics->WriteGauge("teeworlds_snap_ids_max", "Size of the snap id pool", "", pSelf->m_IDPool.GetMaxIDs());
+
+	if(pSelf->m_pGameServer)
+		pSelf->GameServer()->OnCollectMetrics(pMetrics);
+
+	pMetrics->EndWrite();
+}
+
 int CServer::SnapNewID()
 {
 	return m_IDPool.NewID();
@@ -2733,6 +3241,16 @@ void CServer::SnapFreeID(int ID)
 	m_IDPool.FreeID(ID);
 }
 
+int CServer::SnapNewIDRange(int Num, int Owner)
+{
+	return m_IDPool.NewIDRange(Num, Owner);
+}
+
+void CServer::SnapFreeIDRange(int ID, int Num)
+{
+	m_IDPool.FreeIDRange(ID, Num);
+}
+
 
 void *CServer::SnapNewItem(int Type, int ID, int Size)
 {
@@ -4,8 +4,11 @@
 #define ENGINE_SERVER_SERVER_H
 
 #include <engine/server.h>
+#include <engine/server/mapcatalog.h>
+#include <engine/server/nameregistry.h>
 #include <engine/server/netsession.h>
 #include <engine/server/roundstatistics.h>
+#include <engine/shared/metrics.h>
 #include <game/server/classes.h>
 #include <game/voting.h>
 
@@ -20,7 +23,10 @@ class CSnapIDPool
 	{
 	public:
 		short m_Next;
+		short m_Prev; // free list only
 		short m_State; // 0 = free, 1 = alloced, 2 = timed
+		short m_Owner; // id whose release also ends this one, -1 if none
+		short m_NumOwned;
 		int m_Timeout;
 	};
 
@@ -31,6 +37,18 @@ class CSnapIDPool
 	int m_LastTimed;
 	int m_Usage;
 	int m_InUsage;
+	int m_NumTimed;
+	int m_RangeCursor; // ranges are searched downwards from here, single ids come from the bottom
+
+	int m_PeakUsage;
+	int m_PeakInUsage;
+	int m_PeakTimed;
+	int m_NumRanges;
+	int m_NumLeaked;
+
+	void UnlinkFree(int ID);
+	void ProcessTimeouts();
+	void FreeLeaked(int Owner);
 
 public:
 
@@ -39,10 +57,21 @@ public:
 	void Reset();
 	void RemoveFirstTimeout();
 	int NewID();
+	// Num consecutive ids, freed together with Owner if they are still alloced then, -1 if there is no such run
+	int NewIDRange(int Num, int Owner);
 	void TimeoutIDs();
 	void FreeID(int ID);
-	int GetIDCount();
-	int GetMaxIDs() { return MAX_IDS; }
+	void FreeIDRange(int ID, int Num);
+	int GetIDCount() const { return m_InUsage; }
+	int GetMaxIDs() const { return MAX_IDS; }
+
+	int GetUsage() const { return m_Usage; }
+	int GetNumTimed() const { return m_NumTimed; }
+	int GetPeakUsage() const { return m_PeakUsage; }
+	int GetPeakInUsage() const { return m_PeakInUsage; }
+	int GetPeakTimed() const { return m_PeakTimed; }
+	int GetNumRanges() const { return m_NumRanges; }
+	int GetNumLeaked() const { return m_NumLeaked; }
 };
 
 
@@ -80,6 +109,24 @@ public:
 	enum
 	{
 		MAX_RCONCMD_SEND=16,
+
+		MAP_CHUNK_SIZE=1024-128,
+		MAP_FRAME_SIZE=1024, // room for a packed NETMSG_MAP_DATA message with a full chunk
+		MAP_WINDOW_MIN=1, // inf_map_window has the same range
+		MAP_WINDOW_MAX=24, // keeps the chunks in flight well below the resend buffer of the connection
+		MAP_SEND_TIMES=32,
+
+		HIBERNATION_WAKE_INTERVAL=1, // seconds
+
+		NUM_INPUT_MARGIN_BOUNDS=10,
+		NUM_ACK_LATENCY_BOUNDS=10,
+
+		INPUT_RECEIVED=0,
+		INPUT_CLAMPED, // intended for a tick that was already simulated, moved to the next one
+		INPUT_DUPLICATE, // not newer than the input before, no timing is sent back
+		INPUT_SHADOWED, // same tick as the input before, only the one at the lower ring index is applied
+		INPUT_OVERWRITTEN, // replaced in the ring before its tick came
+		NUM_INPUT_EVENTS,
 	};
 
 	class CClient
@@ -106,6 +153,19 @@ public:
 			int m_GameTick; // the tick that was chosen for the input
 		};
 
+		// how the inputs of the client arrive, for the whole connection
+		class CInputStats
+		{
+		public:
+			int64 m_aMarginCounts[NUM_INPUT_MARGIN_BOUNDS+1]; // time left until the intended tick, the last one is +Inf
+			double m_MarginSum;
+			int64 m_aAckCounts[NUM_ACK_LATENCY_BOUNDS+1]; // from sending a snapshot to its first ack
+			double m_AckSum;
+			int64 m_NumAcks;
+			double m_LastAckLatency; // of the last acked snapshot, taken on its first ack like the histogram
+			int64 m_aNumEvents[NUM_INPUT_EVENTS];
+		};
+
 		// connection state info
 		int m_State;
 		int m_Latency;
@@ -114,19 +174,33 @@ public:
 
 		int m_LastAckedSnapshot;
 		int m_LastInputTick;
+		int m_SnapshotBytes; // compressed size of the last snapshot sent
 		CSnapshotStorage m_Snapshots;
 
 		CInput m_LatestInput;
 		CInput m_aInputs[200]; // TODO: handle input better
 		int m_CurrentInput;
+		CInputStats m_InputStats;
 
 		char m_aName[MAX_NAME_LENGTH];
+		char m_aRequestedName[MAX_NAME_LENGTH]; // from RequestClientName, empty if none
 		char m_aClan[MAX_CLAN_LENGTH];
 		int m_Country;
 		int m_Authed;
 		int m_AuthTries;
 		int m_NextMapChunk;
 
+		// map download window, adapted to the round trip of the chunks and to resends
+		int m_MapChunksSent;
+		int m_MapWindow;
+		int m_MapWindowGrowth;
+		bool m_MapSlowStart;
+		unsigned m_MapResends;
+		int64 m_MapRtt;
+		int64 m_MapMinRtt;
+		int64 m_MapWindowCut;
+		int64 m_aMapChunkSendTime[MAP_SEND_TIMES];
+
 		const IConsole::CCommandInfo *m_pRconCmdToSend;
 		
 		void Reset(bool ResetScore=true);
@@ -163,6 +237,26 @@ public:
 	CEcon m_Econ;
 	CServerBan m_ServerBan;
 
+	CNameRegistry m_NameRegistry;
+	LOCK m_NameRequestLock;
+	volatile unsigned m_NumNameRequests; // changed with the atomic helpers under the lock, read without it
+
+	CMetrics m_Metrics;
+	CMetricsHttp m_MetricsHttp;
+	int m_TickDurationMetric;
+	int m_TickLatenessMetric;
+	int m_WakeupsMetric;
+	int m_SnapshotBytesMetric;
+	int m_MapLoadMetric;
+	int m_InputMarginMetric;
+	int m_AckLatencyMetric;
+	int m_aInputEventMetrics[NUM_INPUT_EVENTS];
+
+	// the main loop sleeps on it until the next tick or incoming data
+	WAITER *m_pWaiter;
+	// no ticks while the server is empty, the game time continues where it stopped
+	bool m_Hibernating;
+
 	IEngineMap *m_pMap;
 
 	int64 m_GameStartTime;
@@ -179,8 +273,12 @@ public:
 	char m_aCurrentMap[64];
 	
 	unsigned m_CurrentMapCrc;
-	unsigned char *m_pCurrentMapData;
 	unsigned int m_CurrentMapSize;
+	unsigned char *m_pCurrentMapFrames; // every chunk packed once as a ready to send message, MAP_FRAME_SIZE bytes apart
+	int *m_pCurrentMapFrameSizes;
+	int m_NumMapChunks;
+
+	CMapCatalog m_MapCatalog;
 
 	bool m_ServerInfoHighLoad;
 	int64 m_ServerInfoFirstRequest;
@@ -190,12 +288,19 @@ public:
 	CRegister m_Register;
 	CMapChecker m_MapChecker;
 
+#ifdef CONF_GEOLOCATION
+	class Geolocation *m_pGeolocation;
+#endif
+
 	CServer();
 	virtual ~CServer();
 
 	int TrySetClientName(int ClientID, const char *pName);
+	void ClearClientName(int ClientID);
+	void ApplyRequestedNames();
 
 	virtual void SetClientName(int ClientID, const char *pName);
+	virtual void RequestClientName(int ClientID, const char *pName);
 	virtual void SetClientClan(int ClientID, char const *pClan);
 	virtual void SetClientCountry(int ClientID, int Country);
 
@@ -218,6 +323,7 @@ public:
 	const char *ClientName(int ClientID);
 	const char *ClientClan(int ClientID);
 	int ClientCountry(int ClientID);
+	int ClientGeolocationCountry(int ClientID);
 	bool ClientIngame(int ClientID);
 	int MaxClients() const;
 
@@ -232,6 +338,8 @@ public:
 
 	void SendMap(int ClientID);
 	void SendMapData(int ClientID, int Chunk);
+	void PackMapChunks(const unsigned char *pData);
+	void UpdateMapWindow(int ClientID, int Chunk);
 	
 	void SendConnectionReady(int ClientID);
 	void SendRconLine(int ClientID, const char *pLine);
@@ -261,6 +369,17 @@ public:
 	static bool ConRecord(IConsole::IResult *pResult, void *pUser);
 	static bool ConStopRecord(IConsole::IResult *pResult, void *pUser);
 	static bool ConMapReload(IConsole::IResult *pResult, void *pUser);
+	static bool ConRescanMaps(IConsole::IResult *pResult, void *pUser);
+	static bool ConListMaps(IConsole::IResult *pResult, void *pUser);
+	static bool ConSnapIDStats(IConsole::IResult *pResult, void *pUser);
+	static bool ConMetrics(IConsole::IResult *pResult, void *pUser);
+	static bool ConInputStats(IConsole::IResult *pResult, void *pUser);
+
+	void InitMetrics();
+	void CountInputEvent(int ClientID, int Event);
+	void UpdateHibernation();
+	static void WriteMetrics(CMetrics::FWriteLine pfnWriteLine, void *pLineUser, void *pUser);
+	static void PrintMetricsLine(const char *pLine, void *pUser);
 	static bool ConLogout(IConsole::IResult *pResult, void *pUser);
 	static bool ConchainSpecialInfoupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static bool ConchainMaxclientsperipUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
@@ -276,6 +395,8 @@ public:
 
 	virtual int SnapNewID();
 	virtual void SnapFreeID(int ID);
+	virtual int SnapNewIDRange(int Num, int Owner);
+	virtual void SnapFreeIDRange(int ID, int Num);
 	virtual void *SnapNewItem(int Type, int ID, int Size);
 	void SnapSetStaticsize(int ItemType, int Size);
 	
@@ -357,6 +478,9 @@ public:
 	virtual IServer::CMapVote* GetMapVote();
 	virtual int GetMinPlayersForMap(const char* pMapName);
 	virtual int GetMaxPlayersForMap(const char* pMapName);
+	virtual bool MapExists(const char* pMapName);
+	virtual int GetMapRotationSize();
+	virtual const char* GetMapRotationName(int Index);
 	virtual int GetTimeShiftUnit() const { return m_TimeShiftUnit; } //In ms
 /* INFECTION MODIFICATION END *****************************************/
 
@@ -5,31 +5,34 @@
 #include "compression.h"
 
 // Format: ESDDDDDD EDDDDDDD EDD... Extended, Data, Sign
-unsigned char *CVariableInt::Pack(unsigned char *pDst, int i)
+static inline unsigned char *PackInt(unsigned char *pDst, int i)
 {
-	*pDst = (i>>25)&0x40; // set sign bit if i<0
-	i = i^(i>>31); // if(i<0) i = ~i
+	unsigned Sign = (i>>25)&0x40; // set sign bit if i<0
+	unsigned Value = i^(i>>31); // if(i<0) i = ~i
 
-	*pDst |= i&0x3F; // pack 6bit into dst
-	i >>= 6; // discard 6 bits
-	if(i)
+	// most of the ints in snapshot deltas and messages fit into the first byte
+	if(Value < 0x40)
 	{
-		*pDst |= 0x80; // set extend bit
-		while(1)
-		{
-			pDst++;
-			*pDst = i&(0x7F); // pack 7bit
-			i >>= 7; // discard 7 bits
-			*pDst |= (i!=0)<<7; // set extend bit (may branch)
-			if(!i)
-				break;
-		}
+		*pDst = Sign|Value;
+		return pDst+1;
 	}
 
-	pDst++;
+	*pDst++ = 0x80|Sign|(Value&0x3F); // pack 6bit with the extend bit
+	Value >>= 6;
+	while(Value >= 0x80)
+	{
+		*pDst++ = 0x80|(Value&0x7F); // pack 7bit with the extend bit
+		Value >>= 7;
+	}
+	*pDst++ = Value;
 	return pDst;
 }
 
+unsigned char *CVariableInt::Pack(unsigned char *pDst, int i)
+{
+	return PackInt(pDst, i);
+}
+
 const unsigned char *CVariableInt::Unpack(const unsigned char *pSrc, int *pInOut)
 {
 	int Sign = (*pSrc>>6)&1;
@@ -80,7 +83,7 @@ long CVariableInt::Compress(const void *pSrc_, int Size, void *pDst_)
 	Size /= 4;
 	while(Size)
 	{
-		pDst = CVariableInt::Pack(pDst, *pSrc);
+		pDst = PackInt(pDst, *pSrc);
 		Size--;
 		pSrc++;
 	}
@@ -9,6 +9,8 @@
 
 MACRO_CONFIG_STR(Password, password, 32, "", CFGFLAG_SERVER, "Password to the server")
 MACRO_CONFIG_STR(Logfile, logfile, 128, "", CFGFLAG_SERVER, "Filename to log all output to")
+MACRO_CONFIG_INT(LogAsync, log_async, 1, 0, 1, CFGFLAG_SERVER, "Write the log from a background thread so slow terminals or disks never stall a tick")
+MACRO_CONFIG_INT(LogRateLimit, log_rate_limit, 500, 0, 100000, CFGFLAG_SERVER, "Lines per second of one system before the async log drops them, 0 for no limit")
 MACRO_CONFIG_INT(ConsoleOutputLevel, console_output_level, 0, 0, 2, CFGFLAG_SERVER, "Adjusts the amount of information in the console")
 
 MACRO_CONFIG_STR(SvName, sv_name, 128, "infclassCR 服务器", CFGFLAG_SERVER, "Server name")
@@ -31,6 +33,8 @@ MACRO_CONFIG_INT(SvAutoDemoRecord, sv_auto_demo_record, 0, 0, 1, CFGFLAG_SERVER,
 MACRO_CONFIG_INT(SvAutoDemoAddMapName, sv_auto_demo_add_map_name, 0, 0, 1, CFGFLAG_SERVER, "Add map name to auto demo file when no max demo number limit")
 MACRO_CONFIG_INT(SvAutoDemoMinPlayers, sv_auto_demo_min_players, 4, 2, 16, CFGFLAG_SERVER, "Min active players for automatically record demos")
 MACRO_CONFIG_INT(SvAutoDemoMax, sv_auto_demo_max, 10, 0, 1000, CFGFLAG_SERVER, "Maximum number of automatically recorded demos (0 = no limit)")
+MACRO_CONFIG_INT(SvNetThread, sv_net_thread, 1, 0, 1, CFGFLAG_SERVER, "Receive, unpack and send the game packets on a network thread, 0 keeps everything on the main thread")
+MACRO_CONFIG_INT(SvHibernation, sv_hibernation, 1, 0, 1, CFGFLAG_SERVER, "Stop ticking and wake up once per second while no clients are connected")
 MACRO_CONFIG_INT(SvServerInfoPerSecond, sv_server_info_per_second, 10, 1, 1000, CFGFLAG_SERVER, "Maximum number of complete server info responses that are sent out per second")
 
 MACRO_CONFIG_STR(EcBindaddr, ec_bindaddr, 128, "localhost", CFGFLAG_ECON, "Address to bind the external console to. Anything but 'localhost' is dangerous")
@@ -40,6 +44,9 @@ MACRO_CONFIG_INT(EcBantime, ec_bantime, 0, 0, 1440, CFGFLAG_ECON, "The time a cl
 MACRO_CONFIG_INT(EcAuthTimeout, ec_auth_timeout, 30, 1, 120, CFGFLAG_ECON, "Time in seconds before the the econ authentification times out")
 MACRO_CONFIG_INT(EcOutputLevel, ec_output_level, 1, 0, 2, CFGFLAG_ECON, "Adjusts the amount of information in the external console")
 
+MACRO_CONFIG_STR(SvMetricsBindaddr, sv_metrics_bindaddr, 128, "localhost", CFGFLAG_SERVER, "Address to bind the metrics endpoint to")
+MACRO_CONFIG_INT(SvMetricsPort, sv_metrics_port, 0, 0, 0, CFGFLAG_SERVER, "Port of the prometheus metrics endpoint, 0 to disable it")
+
 MACRO_CONFIG_INT(Debug, debug, 0, 0, 1, CFGFLAG_SERVER, "Debug mode")
 MACRO_CONFIG_INT(DbgStress, dbg_stress, 0, 0, 0, CFGFLAG_SERVER, "Stress systems")
 MACRO_CONFIG_INT(DbgStressNetwork, dbg_stress_network, 0, 0, 0, CFGFLAG_SERVER, "Stress network")
@@ -2,6 +2,7 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/math.h>
 #include <base/system.h>
+#include <base/tl/threading.h>
 #include <engine/storage.h>
 #include "datafile.h"
 #include <zlib.h>
@@ -55,60 +56,161 @@ struct CDatafileInfo
 	char *m_pDataStart;
 };
 
-struct CDatafile
+// read-only view of a file, shared by all readers that have the same version of the file open.
+// a file that is replaced gets a new mapping, readers of the old one keep theirs. writing a file
+// in place while it is mapped is not supported, a reader of a truncated file faults on access
+struct CDatafileMapping
 {
-	IOHANDLE m_File;
+	char m_aPath[512];
+	unsigned m_FileSize;
+	time_t m_Modified;
+	const unsigned char *m_pFileData;
 	unsigned m_Crc;
-	CDatafileInfo m_Info;
-	CDatafileHeader m_Header;
-	int m_DataStartOffset;
-	char **m_ppDataPtrs;
-	char *m_pData;
+	int m_RefCount;
+	CDatafileMapping *m_pNext;
 };
 
-bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int StorageType)
-{
-	dbg_msg("datafile", "loading. filename='%s'", pFilename);
+// the maps are opened and checked from jobs as well
+static lock s_MappingLock;
+static CDatafileMapping *s_pFirstMapping = 0;
 
-	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType);
+// opens the file and gets what identifies its version, the mapping lock must not be held
+static IOHANDLE OpenVersion(IStorage *pStorage, const char *pFilename, int StorageType, char *pPath, int PathSize, unsigned *pFileSize, time_t *pModified)
+{
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, pPath, PathSize);
 	if(!File)
+		return 0;
+	long int Length = io_length(File);
+	*pFileSize = Length > 0 ? (unsigned)Length : 0;
+	if(fs_file_time(pPath, pModified) != 0)
+		*pModified = 0;
+	return File;
+}
+
+// the mapping lock has to be held
+static CDatafileMapping *FindMapping(const char *pPath, unsigned FileSize, time_t Modified)
+{
+	for(CDatafileMapping *pMapping = s_pFirstMapping; pMapping; pMapping = pMapping->m_pNext)
 	{
-		dbg_msg("datafile", "could not open '%s'", pFilename);
-		return false;
+		if(pMapping->m_FileSize == FileSize && pMapping->m_Modified == Modified && str_comp(pMapping->m_aPath, pPath) == 0)
+			return pMapping;
 	}
+	return 0;
+}
 
+static CDatafileMapping *AcquireMapping(IStorage *pStorage, const char *pFilename, int StorageType)
+{
+	char aPath[512];
+	unsigned FileSize;
+	time_t Modified;
+	IOHANDLE File = OpenVersion(pStorage, pFilename, StorageType, aPath, sizeof(aPath), &FileSize, &Modified);
+	if(!File)
+		return 0;
 
-	// take the CRC of the file and store it
-	unsigned Crc = 0;
 	{
-		enum
+		scope_lock Lock(&s_MappingLock);
+		CDatafileMapping *pMapping = FindMapping(aPath, FileSize, Modified);
+		if(pMapping)
 		{
-			BUFFER_SIZE = 64*1024
-		};
+			pMapping->m_RefCount++;
+			io_close(File);
+			return pMapping;
+		}
+	}
+
+	// map and checksum without the lock, another reader may map the same file meanwhile
+	unsigned MappedSize = 0;
+	const void *pFileData = io_map(File, &MappedSize);
+	io_close(File);
+	if(!pFileData)
+		return 0;
+	if(MappedSize != FileSize)
+	{
+		// changed between the open and the map
+		io_unmap(pFileData, MappedSize);
+		return 0;
+	}
 
-		unsigned char aBuffer[BUFFER_SIZE];
+	CDatafileMapping *pNew = (CDatafileMapping *)mem_alloc_tagged(sizeof(CDatafileMapping), 1, MEMTAG_MAP);
+	str_copy(pNew->m_aPath, aPath, sizeof(pNew->m_aPath));
+	pNew->m_FileSize = FileSize;
+	pNew->m_Modified = Modified;
+	pNew->m_pFileData = (const unsigned char *)pFileData;
+	pNew->m_Crc = crc32(0, pNew->m_pFileData, FileSize); // ignore_convention
+	pNew->m_RefCount = 1;
+
+	scope_lock Lock(&s_MappingLock);
+	CDatafileMapping *pMapping = FindMapping(aPath, FileSize, Modified);
+	if(pMapping)
+	{
+		pMapping->m_RefCount++;
+		io_unmap(pNew->m_pFileData, pNew->m_FileSize);
+		mem_free(pNew);
+		return pMapping;
+	}
+	pNew->m_pNext = s_pFirstMapping;
+	s_pFirstMapping = pNew;
+	return pNew;
+}
+
+static void ReleaseMapping(CDatafileMapping *pMapping)
+{
+	{
+		scope_lock Lock(&s_MappingLock);
+		if(--pMapping->m_RefCount > 0)
+			return;
 
-		while(1)
+		for(CDatafileMapping **ppMapping = &s_pFirstMapping; *ppMapping; ppMapping = &(*ppMapping)->m_pNext)
 		{
-			unsigned Bytes = io_read(File, aBuffer, BUFFER_SIZE);
-			if(Bytes <= 0)
+			if(*ppMapping == pMapping)
+			{
+				*ppMapping = pMapping->m_pNext;
 				break;
-			Crc = crc32(Crc, aBuffer, Bytes); // ignore_convention
+			}
 		}
-
-		io_seek(File, 0, IOSEEK_START);
 	}
 
+	io_unmap(pMapping->m_pFileData, pMapping->m_FileSize);
+	mem_free(pMapping);
+}
+
+struct CDatafile
+{
+	CDatafileMapping *m_pMapping;
+	CDatafileInfo m_Info;
+	CDatafileHeader m_Header;
+	int m_DataStartOffset;
+	char **m_ppDataPtrs;
+	char *m_pData;
+};
+
+bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int StorageType)
+{
+	dbg_msg("datafile", "loading. filename='%s'", pFilename);
+
+	CDatafileMapping *pMapping = AcquireMapping(pStorage, pFilename, StorageType);
+	if(!pMapping)
+	{
+		dbg_msg("datafile", "could not open '%s'", pFilename);
+		return false;
+	}
 
 	// TODO: change this header
 	CDatafileHeader Header;
-	io_read(File, &Header, sizeof(Header));
+	if(pMapping->m_FileSize < sizeof(Header))
+	{
+		dbg_msg("datafile", "file too small. size=%d", pMapping->m_FileSize);
+		ReleaseMapping(pMapping);
+		return false;
+	}
+	mem_copy(&Header, pMapping->m_pFileData, sizeof(Header));
 	if(Header.m_aID[0] != 'A' || Header.m_aID[1] != 'T' || Header.m_aID[2] != 'A' || Header.m_aID[3] != 'D')
 	{
 		if(Header.m_aID[0] != 'D' || Header.m_aID[1] != 'A' || Header.m_aID[2] != 'T' || Header.m_aID[3] != 'A')
 		{
 			dbg_msg("datafile", "wrong signature. %x %x %x %x", Header.m_aID[0], Header.m_aID[1], Header.m_aID[2], Header.m_aID[3]);
-			return 0;
+			ReleaseMapping(pMapping);
+			return false;
 		}
 	}
 
@@ -118,10 +220,11 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	if(Header.m_Version != 3 && Header.m_Version != 4)
 	{
 		dbg_msg("datafile", "wrong version. version=%x", Header.m_Version);
-		return 0;
+		ReleaseMapping(pMapping);
+		return false;
 	}
 
-	// read in the rest except the data
+	// copy the rest except the data
 	unsigned Size = 0;
 	Size += Header.m_NumItemTypes*sizeof(CDatafileItemType);
 	Size += (Header.m_NumItems+Header.m_NumRawData)*sizeof(int);
@@ -129,31 +232,29 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 		Size += Header.m_NumRawData*sizeof(int); // v4 has uncompressed data sizes aswell
 	Size += Header.m_ItemSize;
 
+	if(pMapping->m_FileSize - sizeof(CDatafileHeader) < Size)
+	{
+		dbg_msg("datafile", "couldn't load the whole thing, wanted=%d got=%d", Size, (int)(pMapping->m_FileSize - sizeof(CDatafileHeader)));
+		ReleaseMapping(pMapping);
+		return false;
+	}
+
 	unsigned AllocSize = Size;
 	AllocSize += sizeof(CDatafile); // add space for info structure
 	AllocSize += Header.m_NumRawData*sizeof(void*); // add space for data pointers
 
-	CDatafile *pTmpDataFile = (CDatafile*)mem_alloc(AllocSize, 1);
+	CDatafile *pTmpDataFile = (CDatafile*)mem_alloc_tagged(AllocSize, 1, MEMTAG_MAP);
 	pTmpDataFile->m_Header = Header;
 	pTmpDataFile->m_DataStartOffset = sizeof(CDatafileHeader) + Size;
 	pTmpDataFile->m_ppDataPtrs = (char**)(pTmpDataFile+1);
 	pTmpDataFile->m_pData = (char *)(pTmpDataFile+1)+Header.m_NumRawData*sizeof(char *);
-	pTmpDataFile->m_File = File;
-	pTmpDataFile->m_Crc = Crc;
+	pTmpDataFile->m_pMapping = pMapping;
 
 	// clear the data pointers
 	mem_zero(pTmpDataFile->m_ppDataPtrs, Header.m_NumRawData*sizeof(void*));
 
-	// read types, offsets, sizes and item data
-	unsigned ReadSize = io_read(File, pTmpDataFile->m_pData, Size);
-	if(ReadSize != Size)
-	{
-		io_close(pTmpDataFile->m_File);
-		mem_free(pTmpDataFile);
-		pTmpDataFile = 0;
-		dbg_msg("datafile", "couldn't load the whole thing, wanted=%d got=%d", Size, ReadSize);
-		return false;
-	}
+	// copy types, offsets, sizes and item data
+	mem_copy(pTmpDataFile->m_pData, pMapping->m_pFileData+sizeof(CDatafileHeader), Size);
 
 	Close();
 	m_pDataFile = pTmpDataFile;
@@ -162,10 +263,10 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	swap_endian(m_pDataFile->m_pData, sizeof(int), min(static_cast<unsigned>(Header.m_Swaplen), Size) / sizeof(int));
 #endif
 
-	//if(DEBUG)
+	if(DEBUG)
 	{
 		dbg_msg("datafile", "allocsize=%d", AllocSize);
-		dbg_msg("datafile", "readsize=%d", ReadSize);
+		dbg_msg("datafile", "readsize=%d", Size);
 		dbg_msg("datafile", "swaplen=%d", Header.m_Swaplen);
 		dbg_msg("datafile", "item_size=%d", m_pDataFile->m_Header.m_ItemSize);
 	}
@@ -183,51 +284,31 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 
 	dbg_msg("datafile", "loading done. datafile='%s'", pFilename);
 
-	if(DEBUG)
-	{
-		/*
-		for(int i = 0; i < m_pDataFile->data.num_raw_data; i++)
-		{
-			void *p = datafile_get_data(df, i);
-			dbg_msg("datafile", "%d %d", (int)((char*)p - (char*)(&m_pDataFile->data)), size);
-		}
-
-		for(int i = 0; i < datafile_num_items(df); i++)
-		{
-			int type, id;
-			void *data = datafile_get_item(df, i, &type, &id);
-			dbg_msg("map", "\t%d: type=%x id=%x p=%p offset=%d", i, type, id, data, m_pDataFile->info.item_offsets[i]);
-			int *idata = (int*)data;
-			for(int k = 0; k < 3; k++)
-				dbg_msg("datafile", "\t\t%d=%d (%x)", k, idata[k], idata[k]);
-		}
-
-		for(int i = 0; i < m_pDataFile->data.num_m_aItemTypes; i++)
-		{
-			dbg_msg("map", "\t%d: type=%x start=%d num=%d", i,
-				m_pDataFile->info.m_aItemTypes[i].type,
-				m_pDataFile->info.m_aItemTypes[i].start,
-				m_pDataFile->info.m_aItemTypes[i].num);
-			for(int k = 0; k < m_pDataFile->info.m_aItemTypes[i].num; k++)
-			{
-				int type, id;
-				datafile_get_item(df, m_pDataFile->info.m_aItemTypes[i].start+k, &type, &id);
-				if(type != m_pDataFile->info.m_aItemTypes[i].type)
-					dbg_msg("map", "\tERROR");
-			}
-		}
-		*/
-	}
-
 	return true;
 }
 
 bool CDataFileReader::GetCrcSize(class IStorage *pStorage, const char *pFilename, int StorageType, unsigned *pCrc, unsigned *pSize)
 {
-	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType);
+	char aPath[512];
+	unsigned FileSize;
+	time_t Modified;
+	IOHANDLE File = OpenVersion(pStorage, pFilename, StorageType, aPath, sizeof(aPath), &FileSize, &Modified);
 	if(!File)
 		return false;
 
+	// reuse the checksum of an opened file, as long as it is still the same version
+	{
+		scope_lock Lock(&s_MappingLock);
+		CDatafileMapping *pMapping = FindMapping(aPath, FileSize, Modified);
+		if(pMapping)
+		{
+			*pCrc = pMapping->m_Crc;
+			*pSize = pMapping->m_FileSize;
+			io_close(File);
+			return true;
+		}
+	}
+
 	// get crc and size
 	unsigned Crc = 0;
 	unsigned Size = 0;
@@ -264,6 +345,38 @@ int CDataFileReader::GetDataSize(int Index)
 	return m_pDataFile->m_Info.m_pDataOffsets[Index+1]-m_pDataFile->m_Info.m_pDataOffsets[Index];
 }
 
+// returns the size of the data once it is loaded
+int CDataFileReader::GetUncompressedDataSize(int Index)
+{
+	if(m_pDataFile->m_Header.m_Version == 4)
+		return m_pDataFile->m_Info.m_pDataSizes[Index];
+	return GetDataSize(Index);
+}
+
+// copies or decompresses the data from the mapping into a buffer of GetUncompressedDataSize bytes
+int CDataFileReader::ReadData(int Index, char *pDest)
+{
+	int DataSize = GetDataSize(Index);
+	unsigned Offset = m_pDataFile->m_DataStartOffset+m_pDataFile->m_Info.m_pDataOffsets[Index];
+	if(DataSize < 0 || Offset > m_pDataFile->m_pMapping->m_FileSize || (unsigned)DataSize > m_pDataFile->m_pMapping->m_FileSize-Offset)
+	{
+		dbg_msg("datafile", "data index=%d out of bounds", Index);
+		return 0;
+	}
+	const unsigned char *pSrc = m_pDataFile->m_pMapping->m_pFileData+Offset;
+
+	if(m_pDataFile->m_Header.m_Version == 4)
+	{
+		// v4 has compressed data, TODO: check for errors
+		unsigned long s = m_pDataFile->m_Info.m_pDataSizes[Index];
+		uncompress((Bytef*)pDest, &s, (const Bytef*)pSrc, DataSize); // ignore_convention
+		return (int)s;
+	}
+
+	mem_copy(pDest, pSrc, DataSize);
+	return DataSize;
+}
+
 void *CDataFileReader::GetDataImpl(int Index, int Swap)
 {
 	if(!m_pDataFile) { return 0; }
@@ -271,52 +384,106 @@ void *CDataFileReader::GetDataImpl(int Index, int Swap)
 	// load it if needed
 	if(!m_pDataFile->m_ppDataPtrs[Index])
 	{
-		// fetch the data size
-		int DataSize = GetDataSize(Index);
+		if(DEBUG)
+			dbg_msg("datafile", "loading data index=%d size=%d uncompressed=%d", Index, GetDataSize(Index), GetUncompressedDataSize(Index));
+
+		m_pDataFile->m_ppDataPtrs[Index] = (char *)mem_alloc_tagged(GetUncompressedDataSize(Index), 1, MEMTAG_MAP);
 #if defined(CONF_ARCH_ENDIAN_BIG)
-		int SwapSize = DataSize;
+		int SwapSize = ReadData(Index, m_pDataFile->m_ppDataPtrs[Index]);
+		if(Swap && SwapSize)
+			swap_endian(m_pDataFile->m_ppDataPtrs[Index], sizeof(int), SwapSize/sizeof(int));
+#else
+		ReadData(Index, m_pDataFile->m_ppDataPtrs[Index]);
 #endif
+	}
 
-		if(m_pDataFile->m_Header.m_Version == 4)
-		{
-			// v4 has compressed data
-			void *pTemp = (char *)mem_alloc(DataSize, 1);
-			unsigned long UncompressedSize = m_pDataFile->m_Info.m_pDataSizes[Index];
-			unsigned long s;
+	return m_pDataFile->m_ppDataPtrs[Index];
+}
 
-			dbg_msg("datafile", "loading data index=%d size=%d uncompressed=%d", Index, DataSize, UncompressedSize);
-			m_pDataFile->m_ppDataPtrs[Index] = (char *)mem_alloc(UncompressedSize, 1);
+struct CDatafileLoadJob
+{
+	CDataFileReader *m_pReader;
+	int m_First;
+	int m_Step;
+};
 
-			// read the compressed data
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset+m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, pTemp, DataSize);
+void CDataFileReader::LoadDataThread(void *pUser)
+{
+	CDatafileLoadJob *pJob = (CDatafileLoadJob *)pUser;
+	CDataFileReader *pReader = pJob->m_pReader;
+	CDatafile *pDataFile = pReader->m_pDataFile;
 
-			// decompress the data, TODO: check for errors
-			s = UncompressedSize;
-			uncompress((Bytef*)m_pDataFile->m_ppDataPtrs[Index], &s, (Bytef*)pTemp, DataSize); // ignore_convention
-#if defined(CONF_ARCH_ENDIAN_BIG)
-			SwapSize = s;
-#endif
+	for(int i = pJob->m_First; i < pDataFile->m_Header.m_NumRawData; i += pJob->m_Step)
+	{
+		if(pDataFile->m_ppDataPtrs[i])
+			pReader->ReadData(i, pDataFile->m_ppDataPtrs[i]);
+	}
+}
 
-			// clean up the temporary buffers
-			mem_free(pTemp);
+void CDataFileReader::LoadAllData()
+{
+	if(!m_pDataFile)
+		return;
+
+#if defined(CONF_ARCH_ENDIAN_BIG)
+	// the swap mode is only known on first access
+	return;
+#else
+	// allocate on this thread, the workers only fill the buffers
+	char **ppNewData = (char **)mem_alloc_tagged(m_pDataFile->m_Header.m_NumRawData*sizeof(char *), 1, MEMTAG_MAP);
+	int NumNew = 0;
+	for(int i = 0; i < m_pDataFile->m_Header.m_NumRawData; i++)
+	{
+		if(m_pDataFile->m_ppDataPtrs[i])
+		{
+			ppNewData[i] = 0;
+			continue;
 		}
-		else
+		ppNewData[i] = (char *)mem_alloc_tagged(GetUncompressedDataSize(i), 1, MEMTAG_MAP);
+		NumNew++;
+	}
+
+	// work on a private pointer table so the threads only see the new buffers
+	char **ppOldData = m_pDataFile->m_ppDataPtrs;
+	m_pDataFile->m_ppDataPtrs = ppNewData;
+
+	int NumThreads = min(NumNew, (int)MAX_LOAD_THREADS);
+	if(m_pDataFile->m_Header.m_Version != 4)
+		NumThreads = min(NumThreads, 1); // plain copies do not benefit from threads
+	if(NumThreads > 1)
+	{
+		CDatafileLoadJob aJobs[MAX_LOAD_THREADS];
+		void *apThreads[MAX_LOAD_THREADS];
+		for(int i = 0; i < NumThreads; i++)
 		{
-			// load the data
-			dbg_msg("datafile", "loading data index=%d size=%d", Index, DataSize);
-			m_pDataFile->m_ppDataPtrs[Index] = (char *)mem_alloc(DataSize, 1);
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset+m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, m_pDataFile->m_ppDataPtrs[Index], DataSize);
+			aJobs[i].m_pReader = this;
+			aJobs[i].m_First = i;
+			aJobs[i].m_Step = NumThreads;
+			apThreads[i] = thread_init(LoadDataThread, &aJobs[i]);
 		}
+		for(int i = 0; i < NumThreads; i++)
+			thread_wait(apThreads[i]);
+	}
+	else if(NumThreads == 1)
+	{
+		CDatafileLoadJob Job;
+		Job.m_pReader = this;
+		Job.m_First = 0;
+		Job.m_Step = 1;
+		LoadDataThread(&Job);
+	}
 
-#if defined(CONF_ARCH_ENDIAN_BIG)
-		if(Swap && SwapSize)
-			swap_endian(m_pDataFile->m_ppDataPtrs[Index], sizeof(int), SwapSize/sizeof(int));
-#endif
+	for(int i = 0; i < m_pDataFile->m_Header.m_NumRawData; i++)
+	{
+		if(ppNewData[i])
+			ppOldData[i] = ppNewData[i];
 	}
+	m_pDataFile->m_ppDataPtrs = ppOldData;
+	mem_free(ppNewData);
 
-	return m_pDataFile->m_ppDataPtrs[Index];
+	if(DEBUG)
+		dbg_msg("datafile", "loaded %d data items using %d threads", NumNew, NumThreads);
+#endif
 }
 
 void *CDataFileReader::GetData(int Index)
@@ -410,7 +577,7 @@ bool CDataFileReader::Close()
 	for(i = 0; i < m_pDataFile->m_Header.m_NumRawData; i++)
 		mem_free(m_pDataFile->m_ppDataPtrs[i]);
 
-	io_close(m_pDataFile->m_File);
+	ReleaseMapping(m_pDataFile->m_pMapping);
 	mem_free(m_pDataFile);
 	m_pDataFile = 0;
 	return true;
@@ -419,7 +586,13 @@ bool CDataFileReader::Close()
 unsigned CDataFileReader::Crc()
 {
 	if(!m_pDataFile) return 0xFFFFFFFF;
-	return m_pDataFile->m_Crc;
+	return m_pDataFile->m_pMapping->m_Crc;
+}
+
+unsigned CDataFileReader::Size()
+{
+	if(!m_pDataFile) return 0;
+	return m_pDataFile->m_pMapping->m_FileSize;
 }
 
 
@@ -4,10 +4,19 @@
 #define ENGINE_SHARED_DATAFILE_H
 
 // raw datafile access
+// the file content is memory mapped once and shared between readers of the same file
 class CDataFileReader
 {
+	enum
+	{
+		MAX_LOAD_THREADS=4,
+	};
+
 	struct CDatafile *m_pDataFile;
 	void *GetDataImpl(int Index, int Swap);
+	int GetUncompressedDataSize(int Index);
+	int ReadData(int Index, char *pDest);
+	static void LoadDataThread(void *pUser);
 public:
 	CDataFileReader() : m_pDataFile(0) {}
 	~CDataFileReader() { Close(); }
@@ -23,6 +32,7 @@ public:
 	void *GetDataSwapped(int Index); // makes sure that the data is 32bit LE ints when saved
 	int GetDataSize(int Index);
 	void UnloadData(int Index);
+	void LoadAllData(); // decompresses every data item in parallel
 	void *GetItem(int Index, int *pType, int *pID);
 	int GetItemSize(int Index);
 	void GetType(int Type, int *pStart, int *pNum);
@@ -32,6 +42,7 @@ public:
 	void Unload();
 
 	unsigned Crc();
+	unsigned Size();
 };
 
 // write access
@@ -100,6 +100,9 @@ public:
 		// open logfile if needed
 		if(g_Config.m_Logfile[0])
 			dbg_logger_file(g_Config.m_Logfile);
+
+		if(g_Config.m_LogAsync)
+			dbg_logger_async_start(g_Config.m_LogRateLimit);
 	}
 
 	void HostLookup(CHostLookup *pLookup, const char *pHostname, int Nettype)
@@ -9,6 +9,9 @@ CJobPool::CJobPool()
 	m_Lock = lock_create();
 	m_pFirstJob = 0;
 	m_pLastJob = 0;
+#if !defined(CONF_PLATFORM_MACOSX)
+	semaphore_init(&m_NumJobs);
+#endif
 }
 
 void CJobPool::WorkerThread(void *pUser)
@@ -19,6 +22,10 @@ void CJobPool::WorkerThread(void *pUser)
 	{
 		CJob *pJob = 0;
 
+#if !defined(CONF_PLATFORM_MACOSX)
+		semaphore_wait(&pPool->m_NumJobs);
+#endif
+
 		// fetch job from queue
 		lock_wait(pPool->m_Lock);
 		if(pPool->m_pFirstJob)
@@ -70,6 +77,9 @@ int CJobPool::Add(CJob *pJob, JOBFUNC pfnFunc, void *pData)
 		m_pFirstJob = pJob;
 
 	lock_release(m_Lock);
+#if !defined(CONF_PLATFORM_MACOSX)
+	semaphore_signal(&m_NumJobs);
+#endif
 	return 0;
 }
 
@@ -2,6 +2,9 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef ENGINE_SHARED_JOBS_H
 #define ENGINE_SHARED_JOBS_H
+
+#include <base/system.h>
+
 typedef int (*JOBFUNC)(void *pData);
 
 class CJobPool;
@@ -42,6 +45,9 @@ class CJobPool
 	LOCK m_Lock;
 	CJob *m_pFirstJob;
 	CJob *m_pLastJob;
+#if !defined(CONF_PLATFORM_MACOSX)
+	SEMAPHORE m_NumJobs; // the workers sleep on it until a job is added
+#endif
 
 	static void WorkerThread(void *pUser);
 
@@ -30,7 +30,10 @@ public:
 		IStorage *pStorage = Kernel()->RequestInterface<IStorage>();
 		if(!pStorage)
 			return false;
-		return m_DataFile.Open(pStorage, pMapName, IStorage::TYPE_ALL);
+		if(!m_DataFile.Open(pStorage, pMapName, IStorage::TYPE_ALL))
+			return false;
+		m_DataFile.LoadAllData();
+		return true;
 	}
 
 	virtual bool IsLoaded()
@@ -0,0 +1,354 @@
+#include <base/math.h>
+#include <base/system.h>
+
+#include "metrics.h"
+
+static void FormatValue(char *pBuf, int BufSize, double Value)
+{
+	if(Value == (double)(int64)Value && absolute(Value) < 1e15)
+		str_format(pBuf, BufSize, "%lld", (long long)Value);
+	else
+		str_format(pBuf, BufSize, "%.9g", Value);
+}
+
+CMetrics::CMetrics()
+{
+	m_NumSeries = 0;
+	m_pfnWriteLine = 0;
+	m_pWriteUser = 0;
+	m_aLastName[0] = 0;
+}
+
+int CMetrics::FindOrAdd(int Type, const char *pName, const char *pHelp, const char *pLabels)
+{
+	for(int i = 0; i < m_NumSeries; i++)
+	{
+		if(str_comp(m_aSeries[i].m_aName, pName) == 0 && str_comp(m_aSeries[i].m_aLabels, pLabels) == 0)
+			return m_aSeries[i].m_Type == Type ? i : -1;
+	}
+
+	if(m_NumSeries == MAX_SERIES)
+	{
+		dbg_msg("metrics", "no room left for '%s'", pName);
+		return -1;
+	}
+
+	CSeries *pSeries = &m_aSeries[m_NumSeries];
+	mem_zero(pSeries, sizeof(*pSeries));
+	str_copy(pSeries->m_aName, pName, sizeof(pSeries->m_aName));
+	str_copy(pSeries->m_aHelp, pHelp, sizeof(pSeries->m_aHelp));
+	str_copy(pSeries->m_aLabels, pLabels, sizeof(pSeries->m_aLabels));
+	pSeries->m_Type = Type;
+	return m_NumSeries++;
+}
+
+int CMetrics::Counter(const char *pName, const char *pHelp, const char *pLabels)
+{
+	return FindOrAdd(TYPE_COUNTER, pName, pHelp, pLabels);
+}
+
+int CMetrics::Gauge(const char *pName, const char *pHelp, const char *pLabels)
+{
+	return FindOrAdd(TYPE_GAUGE, pName, pHelp, pLabels);
+}
+
+int CMetrics::Histogram(const char *pName, const char *pHelp, const double *pBounds, int NumBounds, const char *pLabels)
+{
+	int Series = FindOrAdd(TYPE_HISTOGRAM, pName, pHelp, pLabels);
+	if(Series < 0)
+		return Series;
+
+	CSeries *pSeries = &m_aSeries[Series];
+	pSeries->m_NumBounds = min(NumBounds, (int)MAX_BOUNDS);
+	for(int i = 0; i < pSeries->m_NumBounds; i++)
+		pSeries->m_aBounds[i] = pBounds[i];
+	return Series;
+}
+
+void CMetrics::Add(int Series, double Value)
+{
+	if(Series >= 0)
+		m_aSeries[Series].m_Value += Value;
+}
+
+void CMetrics::Set(int Series, double Value)
+{
+	if(Series >= 0)
+		m_aSeries[Series].m_Value = Value;
+}
+
+void CMetrics::Observe(int Series, double Value)
+{
+	if(Series < 0)
+		return;
+
+	CSeries *pSeries = &m_aSeries[Series];
+	int Bucket = 0;
+	while(Bucket < pSeries->m_NumBounds && Value > pSeries->m_aBounds[Bucket])
+		Bucket++;
+	pSeries->m_aBucketCounts[Bucket]++;
+	pSeries->m_Count++;
+	pSeries->m_Value += Value;
+}
+
+void CMetrics::WriteHeader(int Type, const char *pName, const char *pHelp)
+{
+	// all the series of a metric follow the same header
+	if(str_comp(m_aLastName, pName) == 0)
+		return;
+	str_copy(m_aLastName, pName, sizeof(m_aLastName));
+
+	static const char *s_apTypes[] = {"counter", "gauge", "histogram"};
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "# HELP %s %s", pName, pHelp);
+	m_pfnWriteLine(aBuf, m_pWriteUser);
+	str_format(aBuf, sizeof(aBuf), "# TYPE %s %s", pName, s_apTypes[Type]);
+	m_pfnWriteLine(aBuf, m_pWriteUser);
+}
+
+void CMetrics::WriteValue(const char *pName, const char *pSuffix, const char *pLabels, const char *pExtraLabel, double Value)
+{
+	char aValue[64];
+	FormatValue(aValue, sizeof(aValue), Value);
+
+	char aBuf[256];
+	if(pLabels[0] && pExtraLabel[0])
+		str_format(aBuf, sizeof(aBuf), "%s%s{%s,%s} %s", pName, pSuffix, pLabels, pExtraLabel, aValue);
+	else if(pLabels[0] || pExtraLabel[0])
+		str_format(aBuf, sizeof(aBuf), "%s%s{%s} %s", pName, pSuffix, pLabels[0] ? pLabels : pExtraLabel, aValue);
+	else
+		str_format(aBuf, sizeof(aBuf), "%s%s %s", pName, pSuffix, aValue);
+	m_pfnWriteLine(aBuf, m_pWriteUser);
+}
+
+void CMetrics::WriteSeries(const CSeries *pSeries)
+{
+	WriteHeader(pSeries->m_Type, pSeries->m_aName, pSeries->m_aHelp);
+
+	if(pSeries->m_Type != TYPE_HISTOGRAM)
+	{
+		WriteValue(pSeries->m_aName, "", pSeries->m_aLabels, "", pSeries->m_Value);
+		return;
+	}
+
+	int64 Count = 0;
+	char aLabel[64];
+	for(int i = 0; i < pSeries->m_NumBounds; i++)
+	{
+		Count += pSeries->m_aBucketCounts[i];
+		str_format(aLabel, sizeof(aLabel), "le=\"%g\"", pSeries->m_aBounds[i]);
+		WriteValue(pSeries->m_aName, "_bucket", pSeries->m_aLabels, aLabel, (double)Count);
+	}
+	WriteValue(pSeries->m_aName, "_bucket", pSeries->m_aLabels, "le=\"+Inf\"", (double)pSeries->m_Count);
+	WriteValue(pSeries->m_aName, "_sum", pSeries->m_aLabels, "", pSeries->m_Value);
+	WriteValue(pSeries->m_aName, "_count", pSeries->m_aLabels, "", (double)pSeries->m_Count);
+}
+
+void CMetrics::BeginWrite(FWriteLine pfnWriteLine, void *pUser)
+{
+	m_pfnWriteLine = pfnWriteLine;
+	m_pWriteUser = pUser;
+	m_aLastName[0] = 0;
+
+	// group the series by name in the order the names were first registered
+	for(int i = 0; i < m_NumSeries; i++)
+	{
+		bool Written = false;
+		for(int j = 0; j < i && !Written; j++)
+			Written = str_comp(m_aSeries[i].m_aName, m_aSeries[j].m_aName) == 0;
+		if(Written)
+			continue;
+
+		for(int j = i; j < m_NumSeries; j++)
+		{
+			if(str_comp(m_aSeries[i].m_aName, m_aSeries[j].m_aName) == 0)
+				WriteSeries(&m_aSeries[j]);
+		}
+	}
+}
+
+void CMetrics::WriteCounter(const char *pName, const char *pHelp, const char *pLabels, double Value)
+{
+	WriteHeader(TYPE_COUNTER, pName, pHelp);
+	WriteValue(pName, "", pLabels, "", Value);
+}
+
+void CMetrics::WriteGauge(const char *pName, const char *pHelp, const char *pLabels, double Value)
+{
+	WriteHeader(TYPE_GAUGE, pName, pHelp);
+	WriteValue(pName, "", pLabels, "", Value);
+}
+
+void CMetrics::EndWrite()
+{
+	m_pfnWriteLine = 0;
+	m_pWriteUser = 0;
+}
+
+
+CMetricsHttp::CMetricsHttp()
+{
+	m_Open = false;
+	m_pfnRender = 0;
+	m_pRenderUser = 0;
+	m_ResponseSize = 0;
+	m_Truncated = false;
+	for(int i = 0; i < MAX_CONNECTIONS; i++)
+	{
+		m_aConnections[i].m_Used = false;
+		m_aConnections[i].m_pSendData = 0;
+	}
+}
+
+bool CMetricsHttp::Open(NETADDR BindAddr, FRender pfnRender, void *pUser)
+{
+	m_Socket = net_tcp_create(BindAddr);
+	if(!m_Socket.type)
+		return false;
+	if(net_tcp_listen(m_Socket, MAX_CONNECTIONS))
+	{
+		net_tcp_close(m_Socket);
+		return false;
+	}
+	net_set_non_blocking(m_Socket);
+
+	m_pfnRender = pfnRender;
+	m_pRenderUser = pUser;
+	m_Open = true;
+	return true;
+}
+
+void CMetricsHttp::AppendLine(const char *pLine, void *pUser)
+{
+	CMetricsHttp *pSelf = (CMetricsHttp *)pUser;
+	int Length = str_length(pLine);
+	if(pSelf->m_ResponseSize + Length + 1 >= MAX_RESPONSE_SIZE)
+	{
+		pSelf->m_Truncated = true;
+		return;
+	}
+	mem_copy(pSelf->m_aResponse + pSelf->m_ResponseSize, pLine, Length);
+	pSelf->m_ResponseSize += Length;
+	pSelf->m_aResponse[pSelf->m_ResponseSize++] = '\n';
+}
+
+void CMetricsHttp::Respond(CConnection *pConnection)
+{
+	m_ResponseSize = 0;
+	m_Truncated = false;
+	m_pfnRender(AppendLine, this, m_pRenderUser);
+	if(m_Truncated)
+		dbg_msg("metrics", "response truncated to %d bytes", m_ResponseSize);
+
+	// the socket stays non-blocking, the rest goes out on the next updates
+	char aHeader[256];
+	str_format(aHeader, sizeof(aHeader), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %d\r\nConnection: close\r\n\r\n", m_ResponseSize);
+	int HeaderSize = str_length(aHeader);
+	pConnection->m_SendSize = HeaderSize + m_ResponseSize;
+	pConnection->m_pSendData = (char *)mem_alloc_tagged(pConnection->m_SendSize, 1, MEMTAG_NETWORK);
+	mem_copy(pConnection->m_pSendData, aHeader, HeaderSize);
+	mem_copy(pConnection->m_pSendData + HeaderSize, m_aResponse, m_ResponseSize);
+	pConnection->m_SendOffset = 0;
+	pConnection->m_SendDeadline = time_get() + SEND_TIMEOUT*time_freq();
+	Flush(pConnection);
+}
+
+void CMetricsHttp::Flush(CConnection *pConnection)
+{
+	// as much as the socket takes, a scraper that stops reading is dropped at the deadline
+	while(pConnection->m_SendOffset < pConnection->m_SendSize)
+	{
+		int Bytes = net_tcp_send(pConnection->m_Socket, pConnection->m_pSendData + pConnection->m_SendOffset, pConnection->m_SendSize - pConnection->m_SendOffset);
+		if(Bytes <= 0)
+		{
+			if(Bytes < 0 && net_would_block() && time_get() < pConnection->m_SendDeadline)
+				return;
+			break;
+		}
+		pConnection->m_SendOffset += Bytes;
+	}
+	Close(pConnection);
+}
+
+void CMetricsHttp::Close(CConnection *pConnection)
+{
+	net_tcp_close(pConnection->m_Socket);
+	if(pConnection->m_pSendData)
+	{
+		mem_free(pConnection->m_pSendData);
+		pConnection->m_pSendData = 0;
+	}
+	pConnection->m_Used = false;
+}
+
+void CMetricsHttp::Update()
+{
+	if(!m_Open)
+		return;
+
+	NETSOCKET Socket;
+	NETADDR Addr;
+	while(net_tcp_accept(m_Socket, &Socket, &Addr) > 0)
+	{
+		CConnection *pConnection = 0;
+		for(int i = 0; i < MAX_CONNECTIONS && !pConnection; i++)
+		{
+			if(!m_aConnections[i].m_Used)
+				pConnection = &m_aConnections[i];
+		}
+		if(!pConnection)
+		{
+			net_tcp_close(Socket);
+			continue;
+		}
+
+		net_set_non_blocking(Socket);
+		pConnection->m_Used = true;
+		pConnection->m_Socket = Socket;
+		pConnection->m_ConnectTime = time_get();
+		pConnection->m_RequestSize = 0;
+		pConnection->m_pSendData = 0;
+	}
+
+	for(int i = 0; i < MAX_CONNECTIONS; i++)
+	{
+		CConnection *pConnection = &m_aConnections[i];
+		if(!pConnection->m_Used)
+			continue;
+
+		if(pConnection->m_pSendData)
+		{
+			Flush(pConnection);
+			continue;
+		}
+
+		// whatever is asked, the answer is the same once the request headers are complete
+		int Space = sizeof(pConnection->m_aRequest) - 1 - pConnection->m_RequestSize;
+		int Bytes = Space > 0 ? net_tcp_recv(pConnection->m_Socket, pConnection->m_aRequest + pConnection->m_RequestSize, Space) : 0;
+		if(Bytes > 0)
+		{
+			pConnection->m_RequestSize += Bytes;
+			pConnection->m_aRequest[pConnection->m_RequestSize] = 0;
+			if(str_find(pConnection->m_aRequest, "\r\n\r\n") || str_find(pConnection->m_aRequest, "\n\n") || Space == Bytes)
+				Respond(pConnection);
+		}
+		else if((Bytes < 0 && !net_would_block()) || (Bytes == 0 && Space > 0))
+			Close(pConnection);
+		else if(time_get() > pConnection->m_ConnectTime + REQUEST_TIMEOUT*time_freq())
+			Close(pConnection);
+	}
+}
+
+void CMetricsHttp::Shutdown()
+{
+	if(!m_Open)
+		return;
+
+	for(int i = 0; i < MAX_CONNECTIONS; i++)
+	{
+		if(m_aConnections[i].m_Used)
+			Close(&m_aConnections[i]);
+	}
+	net_tcp_close(m_Socket);
+	m_Open = false;
+}
@@ -0,0 +1,126 @@
+#ifndef ENGINE_SHARED_METRICS_H
+#define ENGINE_SHARED_METRICS_H
+
+#include <base/system.h>
+
+// counters, gauges and histograms written in the prometheus text format
+// series are registered once and updated by index, values that are cheaper to read
+// when asked for are written directly by the collectors with WriteCounter/WriteGauge
+class CMetrics
+{
+public:
+	enum
+	{
+		TYPE_COUNTER=0,
+		TYPE_GAUGE,
+		TYPE_HISTOGRAM,
+
+		MAX_SERIES=128,
+		MAX_BOUNDS=12,
+	};
+
+	typedef void (*FWriteLine)(const char *pLine, void *pUser);
+
+private:
+	class CSeries
+	{
+	public:
+		char m_aName[64];
+		char m_aHelp[128];
+		char m_aLabels[64]; // without the braces, for example client="3"
+		int m_Type;
+		double m_Value;
+		int m_NumBounds;
+		double m_aBounds[MAX_BOUNDS];
+		int64 m_aBucketCounts[MAX_BOUNDS+1]; // not cumulative, the last one is +Inf
+		int64 m_Count;
+	};
+
+	CSeries m_aSeries[MAX_SERIES];
+	int m_NumSeries;
+
+	FWriteLine m_pfnWriteLine;
+	void *m_pWriteUser;
+	char m_aLastName[64];
+
+	int FindOrAdd(int Type, const char *pName, const char *pHelp, const char *pLabels);
+	void WriteHeader(int Type, const char *pName, const char *pHelp);
+	void WriteValue(const char *pName, const char *pSuffix, const char *pLabels, const char *pExtraLabel, double Value);
+	void WriteSeries(const CSeries *pSeries);
+
+public:
+	CMetrics();
+
+	// find or register a series, returns -1 if there is no room left
+	int Counter(const char *pName, const char *pHelp, const char *pLabels = "");
+	int Gauge(const char *pName, const char *pHelp, const char *pLabels = "");
+	int Histogram(const char *pName, const char *pHelp, const double *pBounds, int NumBounds, const char *pLabels = "");
+
+	void Add(int Series, double Value);
+	void Set(int Series, double Value);
+	void Observe(int Series, double Value);
+
+	// writes the registered series, the collectors may add theirs until EndWrite
+	void BeginWrite(FWriteLine pfnWriteLine, void *pUser);
+	void WriteCounter(const char *pName, const char *pHelp, const char *pLabels, double Value);
+	void WriteGauge(const char *pName, const char *pHelp, const char *pLabels, double Value);
+	void EndWrite();
+};
+
+// answers every http request on a local port with the text given by the render callback
+class CMetricsHttp
+{
+public:
+	typedef void (*FRender)(CMetrics::FWriteLine pfnWriteLine, void *pLineUser, void *pUser);
+
+private:
+	enum
+	{
+		MAX_CONNECTIONS=4,
+		REQUEST_TIMEOUT=2, // seconds
+		SEND_TIMEOUT=5, // seconds
+		MAX_RESPONSE_SIZE=64*1024,
+	};
+
+	class CConnection
+	{
+	public:
+		bool m_Used;
+		NETSOCKET m_Socket;
+		int64 m_ConnectTime;
+		char m_aRequest[512];
+		int m_RequestSize;
+
+		// the response while it is sent, a part on every update
+		char *m_pSendData;
+		int m_SendSize;
+		int m_SendOffset;
+		int64 m_SendDeadline;
+	};
+
+	NETSOCKET m_Socket;
+	bool m_Open;
+	CConnection m_aConnections[MAX_CONNECTIONS];
+
+	FRender m_pfnRender;
+	void *m_pRenderUser;
+
+	char m_aResponse[MAX_RESPONSE_SIZE];
+	int m_ResponseSize;
+	bool m_Truncated;
+
+	static void AppendLine(const char *pLine, void *pUser);
+	void Respond(CConnection *pConnection);
+	void Flush(CConnection *pConnection);
+	void Close(CConnection *pConnection);
+
+public:
+	CMetricsHttp();
+
+	bool Open(NETADDR BindAddr, FRender pfnRender, void *pUser);
+	void Update();
+	void Shutdown();
+	bool IsOpen() const { return m_Open; }
+};
+
+#endif
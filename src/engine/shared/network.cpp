@@ -5,6 +5,7 @@
 
 #include "config.h"
 #include "network.h"
+#include "network_io.h"
 #include "huffman.h"
 
 void CNetRecvUnpacker::Clear()
@@ -88,6 +89,14 @@ int CNetRecvUnpacker::FetchChunk(CNetChunk *pChunk)
 }
 static const unsigned char NET_HEADER_EXTENDED[] = {'x', 'e'};
 // packs the data tight and sends it
+void CNetBase::SendDatagram(NETSOCKET Socket, NETADDR *pAddr, const void *pData, int DataSize)
+{
+	if(ms_pIOThread && ms_pIOThread->Owns(Socket))
+		ms_pIOThread->Send(pAddr, pData, DataSize);
+	else
+		net_udp_send(Socket, pAddr, pData, DataSize);
+}
+
 void CNetBase::SendPacketConnless(NETSOCKET Socket, NETADDR *pAddr, const void *pData, int DataSize, bool Extended, unsigned char aExtra[4])
 {
 	unsigned char aBuffer[NET_MAX_PACKETSIZE];
@@ -103,7 +112,7 @@ void CNetBase::SendPacketConnless(NETSOCKET Socket, NETADDR *pAddr, const void *
 		mem_copy(aBuffer + sizeof(NET_HEADER_EXTENDED), aExtra, 4);
 	}
 	mem_copy(aBuffer + DATA_OFFSET, pData, DataSize);
-	net_udp_send(Socket, pAddr, aBuffer, DataSize + DATA_OFFSET);
+	SendDatagram(Socket, pAddr, aBuffer, DataSize + DATA_OFFSET);
 }
 
 void CNetBase::SendPacket(NETSOCKET Socket, NETADDR *pAddr, CNetPacketConstruct *pPacket, SECURITY_TOKEN SecurityToken)
@@ -154,7 +163,7 @@ void CNetBase::SendPacket(NETSOCKET Socket, NETADDR *pAddr, CNetPacketConstruct
 		aBuffer[0] = ((pPacket->m_Flags<<4)&0xf0)|((pPacket->m_Ack>>8)&0xf);
 		aBuffer[1] = pPacket->m_Ack&0xff;
 		aBuffer[2] = pPacket->m_NumChunks;
-		net_udp_send(Socket, pAddr, aBuffer, FinalSize);
+		SendDatagram(Socket, pAddr, aBuffer, FinalSize);
 
 		// log raw socket data
 		if(ms_DataLogSent)
@@ -308,6 +317,7 @@ int CNetBase::IsSeqInBackroom(int Seq, int Ack)
 IOHANDLE CNetBase::ms_DataLogSent = 0;
 IOHANDLE CNetBase::ms_DataLogRecv = 0;
 CHuffman CNetBase::ms_Huffman;
+CNetIOThread *CNetBase::ms_pIOThread = 0;
 
 
 void CNetBase::OpenLog(IOHANDLE DataLogSent, IOHANDLE DataLogRecv)
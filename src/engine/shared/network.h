@@ -32,6 +32,7 @@ CURRENT:
 enum
 {
 	NETFLAG_ALLOWSTATELESS=1,
+	NETFLAG_IOTHREAD=2,
 	NETSENDFLAG_VITAL=1,
 	NETSENDFLAG_CONNLESS=2,
 	NETSENDFLAG_FLUSH=4,
@@ -188,6 +189,7 @@ private:
 	int64 m_LastUpdateTime;
 	int64 m_LastRecvTime;
 	int64 m_LastSendTime;
+	unsigned m_NumResends;
 
 	char m_ErrorString[256];
 
@@ -240,6 +242,7 @@ public:
 	int SecurityToken() const { return m_SecurityToken; }
 	
 	int AckSequence() const { return m_Ack; }
+	unsigned NumResends() const { return m_NumResends; }
 	
 	// anti spoof
 	void DirectInit(NETADDR &Addr, SECURITY_TOKEN SecurityToken);
@@ -328,6 +331,9 @@ class CNetServer
 	int64 m_aDistSpamConns[NET_CONNLIMIT_DDOS];
 	
 	CNetRecvUnpacker m_RecvUnpacker;
+	class CNetIOThread *m_pIOThread;
+
+	bool FetchPacket(NETADDR *pAddr);
 
 	struct CCaptcha
 	{
@@ -365,11 +371,17 @@ public:
 
 	// status requests
 	const NETADDR *ClientAddr(int ClientID) const { return m_aSlots[ClientID].m_Connection.PeerAddress(); }
+	unsigned ClientResends(int ClientID) const { return m_aSlots[ClientID].m_Connection.NumResends(); }
 	bool HasSecurityToken(int ClientID) const { return m_aSlots[ClientID].m_Connection.SecurityToken() != NET_SECURITY_TOKEN_UNSUPPORTED; }
 	NETSOCKET Socket() const { return m_Socket; }
 	class CNetBan *NetBan() const { return m_pNetBan; }
 	int NetType() const { return m_Socket.type; }
 	int MaxClients() const { return m_MaxClients; }
+	class CNetIOThread *IOThread() const { return m_pIOThread; }
+	// the waiter is woken by incoming data
+	void SetWaiter(WAITER *pWaiter);
+	// sends what the game thread queued for the network thread
+	void FlushIOThread();
 
 	//
 	void SetMaxClientsPerIP(int Max);
@@ -460,6 +472,7 @@ class CNetBase
 	static IOHANDLE ms_DataLogSent;
 	static IOHANDLE ms_DataLogRecv;
 	static CHuffman ms_Huffman;
+	static class CNetIOThread *ms_pIOThread;
 public:
 	static void OpenLog(IOHANDLE DataLogSent, IOHANDLE DataLogRecv);
 	static void CloseLog();
@@ -467,6 +480,9 @@ public:
 	static int Compress(const void *pData, int DataSize, void *pOutput, int OutputSize);
 	static int Decompress(const void *pData, int DataSize, void *pOutput, int OutputSize);
 
+	// the datagrams of the socket owned by the io thread are queued for it
+	static void SetIOThread(class CNetIOThread *pIOThread) { ms_pIOThread = pIOThread; }
+	static void SendDatagram(NETSOCKET Socket, NETADDR *pAddr, const void *pData, int DataSize);
 	static void SendControlMsg(NETSOCKET Socket, NETADDR *pAddr, int Ack, int ControlMsg, const void *pExtra, int ExtraSize, SECURITY_TOKEN SecurityToken);
 	static void SendPacketConnless(NETSOCKET Socket, NETADDR *pAddr, const void *pData, int DataSize, bool Extended, unsigned char aExtra[4]);
 	static void SendPacket(NETSOCKET Socket, NETADDR *pAddr, CNetPacketConstruct *pPacket, SECURITY_TOKEN SecurityToken);
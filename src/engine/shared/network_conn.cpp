@@ -20,6 +20,7 @@ void CNetConnection::Reset(bool Rejoin)
 	m_Ack = 0;
 	m_PeerAck = 0;
 	m_RemoteClosed = 0;
+	m_NumResends = 0;
 
 	if (!Rejoin)
 	{
@@ -185,6 +186,7 @@ void CNetConnection::ResendChunk(CNetChunkResend *pResend)
 {
 	QueueChunkEx(pResend->m_Flags|NET_CHUNKFLAG_RESEND, pResend->m_DataSize, pResend->m_pData, pResend->m_Sequence);
 	pResend->m_LastSendTime = time_get();
+	m_NumResends++;
 }
 
 void CNetConnection::Resend()
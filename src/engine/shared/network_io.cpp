@@ -0,0 +1,156 @@
+#include <base/system.h>
+
+#include "network_io.h"
+
+bool CNetIOThread::Start(NETSOCKET Socket)
+{
+	m_Socket = Socket;
+	m_Stop = false;
+	m_RecvQueue.Reset();
+	m_SendQueue.Reset();
+	m_SendProducer = 0;
+	m_NumSendBypassed = 0;
+	m_NumRecvStalled = 0;
+	m_pRecvWaiter = 0;
+
+	m_pWaiter = waiter_create();
+	if(!m_pWaiter || waiter_add_socket(m_pWaiter, m_Socket) != 0)
+	{
+		if(m_pWaiter)
+			waiter_destroy(m_pWaiter);
+		m_pWaiter = 0;
+		return false;
+	}
+
+	m_pThread = thread_init(ThreadFunc, this);
+	if(!m_pThread)
+	{
+		waiter_destroy(m_pWaiter);
+		m_pWaiter = 0;
+	}
+	return m_pThread != 0;
+}
+
+void CNetIOThread::Stop()
+{
+	if(!m_pThread)
+		return;
+
+	m_Stop = true;
+	waiter_wake(m_pWaiter);
+	thread_wait(m_pThread);
+	m_pThread = 0;
+	FlushSendQueue();
+	waiter_destroy(m_pWaiter);
+	m_pWaiter = 0;
+}
+
+bool CNetIOThread::Owns(NETSOCKET Socket) const
+{
+	return m_pThread && Socket.type == m_Socket.type && Socket.ipv4sock == m_Socket.ipv4sock && Socket.ipv6sock == m_Socket.ipv6sock;
+}
+
+bool CNetIOThread::FlushSendQueue()
+{
+	bool Sent = false;
+	while(CSendSlot *pSlot = m_SendQueue.Front())
+	{
+		net_udp_send(m_Socket, &pSlot->m_Addr, pSlot->m_aData, pSlot->m_Size);
+		m_SendQueue.Pop();
+		Sent = true;
+	}
+	return Sent;
+}
+
+bool CNetIOThread::FillRecvQueue()
+{
+	bool Received = false;
+	while(1)
+	{
+		// leave the datagrams in the socket buffer until the game thread caught up
+		CRecvSlot *pSlot = m_RecvQueue.Reserve();
+		if(!pSlot)
+		{
+			atomic_inc(&m_NumRecvStalled);
+			break;
+		}
+
+		int Bytes = net_udp_recv(m_Socket, &pSlot->m_Addr, m_aRecvBuffer, NET_MAX_PACKETSIZE);
+		if(Bytes <= 0)
+			break;
+
+		Received = true;
+		if(CNetBase::UnpackPacket(m_aRecvBuffer, Bytes, &pSlot->m_Packet) == 0)
+			m_RecvQueue.Commit();
+	}
+	return Received;
+}
+
+void CNetIOThread::ThreadFunc(void *pUser)
+{
+	CNetIOThread *pSelf = (CNetIOThread *)pUser;
+
+	while(!pSelf->m_Stop)
+	{
+		bool Busy = pSelf->FlushSendQueue();
+		if(pSelf->FillRecvQueue())
+		{
+			Busy = true;
+			if(pSelf->m_pRecvWaiter)
+				waiter_wake(pSelf->m_pRecvWaiter);
+		}
+
+		// sleep until a datagram arrives or the game thread flushes, a full receive queue has no wake up
+		if(!Busy)
+		{
+			if(pSelf->m_RecvQueue.Reserve())
+				waiter_wait_until(pSelf->m_pWaiter, -1);
+			else
+				thread_sleep(WAIT_TIME);
+		}
+	}
+}
+
+bool CNetIOThread::Recv(NETADDR *pAddr, CNetPacketConstruct *pPacket)
+{
+	CRecvSlot *pSlot = m_RecvQueue.Front();
+	if(!pSlot)
+		return false;
+
+	*pAddr = pSlot->m_Addr;
+	mem_copy(pPacket, &pSlot->m_Packet, sizeof(*pPacket));
+	m_RecvQueue.Pop();
+	return true;
+}
+
+void CNetIOThread::Send(const NETADDR *pAddr, const void *pData, int Size)
+{
+	// the game thread is the only regular producer, other threads and a full queue use the socket directly
+	CSendSlot *pSlot = 0;
+	if(atomic_compswap(&m_SendProducer, 0, 1) == 0)
+	{
+		pSlot = m_SendQueue.Reserve();
+		if(pSlot)
+		{
+			pSlot->m_Addr = *pAddr;
+			pSlot->m_Size = Size;
+			mem_copy(pSlot->m_aData, pData, Size);
+			m_SendQueue.Commit();
+		}
+		sync_barrier();
+		m_SendProducer = 0;
+	}
+
+	if(!pSlot)
+	{
+		atomic_inc(&m_NumSendBypassed);
+		NETADDR Addr = *pAddr;
+		net_udp_send(m_Socket, &Addr, pData, Size);
+	}
+}
+
+void CNetIOThread::Flush()
+{
+	if(m_SendQueue.Size())
+		waiter_wake(m_pWaiter);
+}
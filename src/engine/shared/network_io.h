@@ -0,0 +1,94 @@
+#ifndef ENGINE_SHARED_NETWORK_IO_H
+#define ENGINE_SHARED_NETWORK_IO_H
+
+#include <base/tl/threading.h>
+
+#include "network.h"
+
+// ring for one producer and one consumer thread, the slots are filled and read in place
+template<class T, int SIZE>
+class CNetRing
+{
+	T m_aSlots[SIZE];
+	volatile unsigned m_Head; // next slot to read, written by the consumer
+	volatile unsigned m_Tail; // next slot to fill, written by the producer
+
+public:
+	void Reset() { m_Head = 0; m_Tail = 0; }
+
+	// producer side
+	T *Reserve() { return m_Tail-m_Head == (unsigned)SIZE ? 0 : &m_aSlots[m_Tail%SIZE]; }
+	void Commit() { sync_barrier(); m_Tail = m_Tail+1; }
+
+	// consumer side
+	T *Front() { if(m_Head == m_Tail) return 0; sync_barrier(); return &m_aSlots[m_Head%SIZE]; }
+	void Pop() { sync_barrier(); m_Head = m_Head+1; }
+
+	int Size() const { return m_Tail-m_Head; }
+};
+
+// owns the reads and the final writes of a udp socket on a thread of its own
+// received datagrams are unpacked there, everything with state stays on the game thread
+class CNetIOThread
+{
+	enum
+	{
+		RECV_QUEUE_SIZE=512,
+		SEND_QUEUE_SIZE=1024,
+		WAIT_TIME=1, // ms, while the receive queue is full
+	};
+
+	struct CRecvSlot
+	{
+		NETADDR m_Addr;
+		CNetPacketConstruct m_Packet;
+	};
+
+	struct CSendSlot
+	{
+		NETADDR m_Addr;
+		int m_Size;
+		unsigned char m_aData[NET_MAX_PACKETSIZE];
+	};
+
+	NETSOCKET m_Socket;
+	void *m_pThread;
+	volatile bool m_Stop;
+	WAITER *m_pWaiter; // socket and send wake ups of the network thread
+	WAITER *m_pRecvWaiter; // woken for the game thread
+
+	CNetRing<CRecvSlot, RECV_QUEUE_SIZE> m_RecvQueue;
+	CNetRing<CSendSlot, SEND_QUEUE_SIZE> m_SendQueue;
+	volatile unsigned m_SendProducer; // taken by the thread that fills the send queue
+
+	unsigned char m_aRecvBuffer[NET_MAX_PACKETSIZE];
+
+	// sent directly because the send queue was full or busy, received late because the receive queue was full
+	volatile unsigned m_NumSendBypassed;
+	volatile unsigned m_NumRecvStalled;
+
+	static void ThreadFunc(void *pUser);
+	bool FlushSendQueue();
+	bool FillRecvQueue();
+
+public:
+	bool Start(NETSOCKET Socket);
+	// sends what is queued before returning
+	void Stop();
+	bool IsRunning() const { return m_pThread != 0; }
+	bool Owns(NETSOCKET Socket) const;
+
+	// game thread
+	void SetRecvWaiter(WAITER *pWaiter) { m_pRecvWaiter = pWaiter; }
+	bool Recv(NETADDR *pAddr, CNetPacketConstruct *pPacket);
+	void Send(const NETADDR *pAddr, const void *pData, int Size);
+	// wakes the network thread for the datagrams queued since the last call
+	void Flush();
+
+	unsigned NumSendBypassed() const { return m_NumSendBypassed; }
+	unsigned NumRecvStalled() const { return m_NumRecvStalled; }
+	int RecvQueueSize() const { return m_RecvQueue.Size(); }
+	int SendQueueSize() const { return m_SendQueue.Size(); }
+};
+
+#endif
@@ -8,6 +8,7 @@
 
 #include "netban.h"
 #include "network.h"
+#include "network_io.h"
 #include "protocol.h"
 
 
@@ -37,6 +38,19 @@ bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int Ma
 	for(int i = 0; i < NET_MAX_CLIENTS; i++)
 		m_aSlots[i].m_Connection.Init(m_Socket, true);
 
+	if(Flags&NETFLAG_IOTHREAD)
+	{
+		m_pIOThread = new CNetIOThread();
+		if(m_pIOThread->Start(m_Socket))
+			CNetBase::SetIOThread(m_pIOThread);
+		else
+		{
+			dbg_msg("net_server", "failed to start the network thread, staying single threaded");
+			delete m_pIOThread;
+			m_pIOThread = 0;
+		}
+	}
+
 	return true;
 }
 
@@ -59,10 +73,49 @@ int CNetServer::SetCallbacks(NETFUNC_NEWCLIENT pfnNewClient, NETFUNC_CLIENTREJOI
 
 int CNetServer::Close()
 {
-	// TODO: implement me
+	if(m_pIOThread)
+	{
+		CNetBase::SetIOThread(0);
+		m_pIOThread->Stop();
+		delete m_pIOThread;
+		m_pIOThread = 0;
+	}
 	return 0;
 }
 
+void CNetServer::SetWaiter(WAITER *pWaiter)
+{
+	if(m_pIOThread)
+		m_pIOThread->SetRecvWaiter(pWaiter);
+	else
+		waiter_add_socket(pWaiter, m_Socket);
+}
+
+void CNetServer::FlushIOThread()
+{
+	if(m_pIOThread)
+		m_pIOThread->Flush();
+}
+
+bool CNetServer::FetchPacket(NETADDR *pAddr)
+{
+	// the network thread hands over packets that are unpacked already
+	if(m_pIOThread)
+		return m_pIOThread->Recv(pAddr, &m_RecvUnpacker.m_Data);
+
+	while(1)
+	{
+		int Bytes = net_udp_recv(m_Socket, pAddr, m_RecvUnpacker.m_aBuffer, NET_MAX_PACKETSIZE);
+
+		// no more packets for now
+		if(Bytes <= 0)
+			return false;
+
+		if(CNetBase::UnpackPacket(m_RecvUnpacker.m_aBuffer, Bytes, &m_RecvUnpacker.m_Data) == 0)
+			return true;
+	}
+}
+
 int CNetServer::Drop(int ClientID, int Type, const char *pReason)
 {
 	// TODO: insert lots of checks here
@@ -416,10 +469,7 @@ int CNetServer::Recv(CNetChunk *pChunk)
 			return 1;
 
 		// TODO: empty the recvinfo
-		int Bytes = net_udp_recv(m_Socket, &Addr, m_RecvUnpacker.m_aBuffer, NET_MAX_PACKETSIZE);
-
-		// no more packets for now
-		if(Bytes <= 0)
+		if(!FetchPacket(&Addr))
 			break;
 				
 		// check if we just should drop the packet
@@ -431,69 +481,66 @@ int CNetServer::Recv(CNetChunk *pChunk)
 			continue;
 		} */
 				
-		if(CNetBase::UnpackPacket(m_RecvUnpacker.m_aBuffer, Bytes, &m_RecvUnpacker.m_Data) == 0)
+		if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS)
 		{
-			if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS)
+			//refuse server info for banned clients (vanilla behavior)
+			if(NetBan() && NetBan()->IsBanned(&Addr, aBuf, sizeof(aBuf)))
+				continue;
+
+			pChunk->m_Flags = NETSENDFLAG_CONNLESS;
+			pChunk->m_ClientID = -1;
+			pChunk->m_Address = Addr;
+			pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
+			pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
+			if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_EXTENDED)
 			{
-				//refuse server info for banned clients (vanilla behavior)
-				if(NetBan() && NetBan()->IsBanned(&Addr, aBuf, sizeof(aBuf)))
-					continue;
+				pChunk->m_Flags |= NETSENDFLAG_EXTENDED;
+				mem_copy(pChunk->m_aExtraData, m_RecvUnpacker.m_Data.m_aExtraData, sizeof(pChunk->m_aExtraData));
+			}
+			return 1;
+		}
+		else
+		{
+			// drop invalid ctrl packets
+			if (m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONTROL &&
+					m_RecvUnpacker.m_Data.m_DataSize == 0)
+				continue;
+
+			// normal packet, find matching slot
+			int Slot = GetClientSlot(Addr);
+			
+			if (Slot != -1)
+			{
+				// found
+
+				// control
+				if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONTROL)
+					OnConnCtrlMsg(Addr, Slot, m_RecvUnpacker.m_Data.m_aChunkData[0], m_RecvUnpacker.m_Data);
 
-				pChunk->m_Flags = NETSENDFLAG_CONNLESS;
-				pChunk->m_ClientID = -1;
-				pChunk->m_Address = Addr;
-				pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
-				pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
-				if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_EXTENDED)
+				if(m_aSlots[Slot].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr))
 				{
-					pChunk->m_Flags |= NETSENDFLAG_EXTENDED;
-					mem_copy(pChunk->m_aExtraData, m_RecvUnpacker.m_Data.m_aExtraData, sizeof(pChunk->m_aExtraData));
+					if(m_RecvUnpacker.m_Data.m_DataSize)
+						m_RecvUnpacker.Start(&Addr, &m_aSlots[Slot].m_Connection, Slot);
 				}
-				return 1;
 			}
 			else
 			{
-				// drop invalid ctrl packets
-				if (m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONTROL &&
-						m_RecvUnpacker.m_Data.m_DataSize == 0)
-					continue;
+				// not found, client that wants to connect
 
-				// normal packet, find matching slot
-				int Slot = GetClientSlot(Addr);
-				
-				if (Slot != -1)
+				//refuse connect for banned clients
+				if(NetBan() && NetBan()->IsBanned(&Addr, aBuf, sizeof(aBuf)))
 				{
-					// found
-
-					// control
-					if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONTROL)
-						OnConnCtrlMsg(Addr, Slot, m_RecvUnpacker.m_Data.m_aChunkData[0], m_RecvUnpacker.m_Data);
-
-					if(m_aSlots[Slot].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr))
-					{
-						if(m_RecvUnpacker.m_Data.m_DataSize)
-							m_RecvUnpacker.Start(&Addr, &m_aSlots[Slot].m_Connection, Slot);
-					}
+					// banned, reply with a message
+					CNetBase::SendControlMsg(m_Socket, &Addr, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf)+1, NET_SECURITY_TOKEN_UNSUPPORTED);
+					continue;
 				}
+
+				if(IsDDNetControlMsg(&m_RecvUnpacker.m_Data))
+					// got ddnet control msg
+					OnTokenCtrlMsg(Addr, m_RecvUnpacker.m_Data.m_aChunkData[0], m_RecvUnpacker.m_Data);
 				else
-				{
-					// not found, client that wants to connect
-
-					//refuse connect for banned clients
-					if(NetBan() && NetBan()->IsBanned(&Addr, aBuf, sizeof(aBuf)))
-					{
-						// banned, reply with a message
-						CNetBase::SendControlMsg(m_Socket, &Addr, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf)+1, NET_SECURITY_TOKEN_UNSUPPORTED);
-						continue;
- 					}
-
-					if(IsDDNetControlMsg(&m_RecvUnpacker.m_Data))
-						// got ddnet control msg
-						OnTokenCtrlMsg(Addr, m_RecvUnpacker.m_Data.m_aChunkData[0], m_RecvUnpacker.m_Data);
-					else
-						// got connection-less ctrl or sys msg
-						OnPreConnMsg(Addr, m_RecvUnpacker.m_Data);
-				}
+					// got connection-less ctrl or sys msg
+					OnPreConnMsg(Addr, m_RecvUnpacker.m_Data);
 			}
 		}
 	}
@@ -33,36 +33,29 @@ void CPacker::AddString(const char *pStr, int Limit)
 	if(m_Error)
 		return;
 
-	//
-	if(Limit > 0)
+	if(m_pCurrent >= m_pEnd)
 	{
-		while(*pStr && Limit != 0)
-		{
-			*m_pCurrent++ = *pStr++;
-			Limit--;
-
-			if(m_pCurrent >= m_pEnd)
-			{
-				m_Error = 1;
-				break;
-			}
-		}
-		*m_pCurrent++ = 0;
+		m_Error = 1;
+		return;
 	}
-	else
-	{
-		while(*pStr)
-		{
-			*m_pCurrent++ = *pStr++;
 
-			if(m_pCurrent >= m_pEnd)
-			{
-				m_Error = 1;
-				break;
-			}
-		}
-		*m_pCurrent++ = 0;
+	// copy until the limit or the last byte, the terminator has to fit behind the string
+	unsigned char *pDst = m_pCurrent;
+	unsigned char *pEnd = m_pEnd-1;
+	bool Limited = Limit > 0 && Limit <= pEnd-pDst;
+	if(Limited)
+		pEnd = pDst+Limit;
+	while(pDst != pEnd && *pStr)
+		*pDst++ = *pStr++;
+
+	if(!Limited && *pStr)
+	{
+		m_Error = 1;
+		return;
 	}
+
+	*pDst++ = 0;
+	m_pCurrent = pDst;
 }
 
 void CPacker::AddRaw(const void *pData, int Size)
@@ -76,12 +69,8 @@ void CPacker::AddRaw(const void *pData, int Size)
 		return;
 	}
 
-	const unsigned char *pSrc = (const unsigned char *)pData;
-	while(Size)
-	{
-		*m_pCurrent++ = *pSrc++;
-		Size--;
-	}
+	mem_copy(m_pCurrent, pData, Size);
+	m_pCurrent += Size;
 }
 
 
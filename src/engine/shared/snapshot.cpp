@@ -1,8 +1,14 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/detect.h>
+
 #include "snapshot.h"
 #include "compression.h"
 
+#if defined(CONF_ARCH_AMD64)
+#include <emmintrin.h>
+#endif
+
 // CSnapshot
 
 CSnapshotItem *CSnapshot::GetItem(int Index)
@@ -57,64 +63,93 @@ void CSnapshot::DebugDump()
 }
 
 
-// CSnapshotDelta
+// CSnapshotIndex
 
-struct CItemList
+int CSnapshotIndex::Size(int NumItems)
 {
-	int m_Num;
-	int m_aKeys[64];
-	int m_aIndex[64];
-};
+	int NumSlots = MIN_SLOTS;
+	while(NumSlots < NumItems*2)
+		NumSlots <<= 1;
+	return sizeof(CSnapshotIndex) + NumSlots*2*sizeof(int) + NumItems*sizeof(unsigned);
+}
 
-enum
+static unsigned HashKey(int Key, int Shift)
 {
-	HASHLIST_SIZE = 256,
-};
+	return ((unsigned)Key*0x9e3779b1u)>>Shift;
+}
 
-static void GenerateHash(CItemList *pHashlist, CSnapshot *pSnapshot)
+void CSnapshotIndex::Build(CSnapshot *pSnap)
 {
-	for(int i = 0; i < HASHLIST_SIZE; i++)
-		pHashlist[i].m_Num = 0;
+	m_NumItems = pSnap->NumItems();
+	m_NumSlots = MIN_SLOTS;
+	m_Shift = 28;
+	while(m_NumSlots < m_NumItems*2)
+	{
+		m_NumSlots <<= 1;
+		m_Shift--;
+	}
+
+	int *pKeys = Keys();
+	int *pIndices = Indices();
+	unsigned *pChecksums = Checksums();
+	for(int i = 0; i < m_NumSlots; i++)
+		pIndices[i] = -1;
 
-	for(int i = 0; i < pSnapshot->NumItems(); i++)
+	for(int i = 0; i < m_NumItems; i++)
 	{
-		int Key = pSnapshot->GetItem(i)->Key();
-		int HashID = ((Key>>12)&0xf0) | (Key&0xf);
-		if(pHashlist[HashID].m_Num != 64)
+		CSnapshotItem *pItem = pSnap->GetItem(i);
+		int Key = pItem->Key();
+
+		// the first item wins on duplicate keys, like a linear search would
+		unsigned Slot = HashKey(Key, m_Shift);
+		while(pIndices[Slot] != -1 && pKeys[Slot] != Key)
+			Slot = (Slot+1)&(m_NumSlots-1);
+		if(pIndices[Slot] == -1)
 		{
-			pHashlist[HashID].m_aIndex[pHashlist[HashID].m_Num] = i;
-			pHashlist[HashID].m_aKeys[pHashlist[HashID].m_Num] = Key;
-			pHashlist[HashID].m_Num++;
+			pKeys[Slot] = Key;
+			pIndices[Slot] = i;
 		}
+
+		// only a filter, equal checksums still need the bytes compared
+		int Size = pSnap->GetItemSize(i)/4;
+		const int *pData = pItem->Data();
+		unsigned Checksum = Size;
+		for(int b = 0; b < Size; b++)
+			Checksum = ((Checksum<<7)|(Checksum>>25))^(unsigned)pData[b];
+		pChecksums[i] = Checksum;
 	}
 }
 
-static int GetItemIndexHashed(int Key, const CItemList *pHashlist)
+int CSnapshotIndex::Find(int Key) const
 {
-		int HashID = ((Key>>12)&0xf0) | (Key&0xf);
-		for(int i = 0; i < pHashlist[HashID].m_Num; i++)
-		{
-			if(pHashlist[HashID].m_aKeys[i] == Key)
-				return pHashlist[HashID].m_aIndex[i];
+	const int *pKeys = Keys();
+	const int *pIndices = Indices();
+	unsigned Slot = HashKey(Key, m_Shift);
+	while(pIndices[Slot] != -1)
+	{
+		if(pKeys[Slot] == Key)
+			return pIndices[Slot];
+		Slot = (Slot+1)&(m_NumSlots-1);
 	}
-
 	return -1;
 }
 
-static int DiffItem(int *pPast, int *pCurrent, int *pOut, int Size)
+
+// CSnapshotDelta
+
+static void DiffItem(const int *pPast, const int *pCurrent, int *pOut, int Size)
 {
-	int Needed = 0;
-	while(Size)
+	int i = 0;
+#if defined(CONF_ARCH_AMD64)
+	for(; i+4 <= Size; i += 4)
 	{
-		*pOut = *pCurrent-*pPast;
-		Needed |= *pOut;
-		pOut++;
-		pPast++;
-		pCurrent++;
-		Size--;
+		__m128i Past = _mm_loadu_si128((const __m128i *)(pPast+i));
+		__m128i Current = _mm_loadu_si128((const __m128i *)(pCurrent+i));
+		_mm_storeu_si128((__m128i *)(pOut+i), _mm_sub_epi32(Current, Past));
 	}
-
-	return Needed;
+#endif
+	for(; i < Size; i++)
+		pOut[i] = pCurrent[i]-pPast[i];
 }
 
 void CSnapshotDelta::UndiffItem(int *pPast, int *pDiff, int *pOut, int Size)
@@ -158,8 +193,12 @@ CSnapshotDelta::CData *CSnapshotDelta::EmptyDelta()
 	return &m_Empty;
 }
 
-// TODO: OPT: this should be made much faster
 int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData)
+{
+	return CreateDelta(pFrom, 0, pTo, 0, pDstData);
+}
+
+int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, const CSnapshotIndex *pFromIndex, CSnapshot *pTo, const CSnapshotIndex *pToIndex, void *pDstData)
 {
 	CData *pDelta = (CData *)pDstData;
 	int *pData = (int *)pDelta->m_pData;
@@ -167,21 +206,29 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 	CSnapshotItem *pFromItem;
 	CSnapshotItem *pCurItem;
 	CSnapshotItem *pPastItem;
-	int Count = 0;
-	int SizeCount = 0;
 
 	pDelta->m_NumDeletedItems = 0;
 	pDelta->m_NumUpdateItems = 0;
 	pDelta->m_NumTempItems = 0;
 
-	CItemList Hashlist[HASHLIST_SIZE];
-	GenerateHash(Hashlist, pTo);
+	if(!pFromIndex)
+	{
+		dbg_assert(CSnapshotIndex::Size(pFrom->NumItems()) <= (int)sizeof(m_aFromIndexData), "too many items");
+		((CSnapshotIndex *)m_aFromIndexData)->Build(pFrom);
+		pFromIndex = (CSnapshotIndex *)m_aFromIndexData;
+	}
+	if(!pToIndex)
+	{
+		dbg_assert(CSnapshotIndex::Size(pTo->NumItems()) <= (int)sizeof(m_aToIndexData), "too many items");
+		((CSnapshotIndex *)m_aToIndexData)->Build(pTo);
+		pToIndex = (CSnapshotIndex *)m_aToIndexData;
+	}
 
 	// pack deleted stuff
 	for(i = 0; i < pFrom->NumItems(); i++)
 	{
 		pFromItem = pFrom->GetItem(i);
-		if(GetItemIndexHashed(pFromItem->Key(), Hashlist) == -1)
+		if(pToIndex->Find(pFromItem->Key()) == -1)
 		{
 			// deleted
 			pDelta->m_NumDeletedItems++;
@@ -190,7 +237,6 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 		}
 	}
 
-	GenerateHash(Hashlist, pFrom);
 	int aPastIndecies[1024];
 
 	// fetch previous indices
@@ -198,15 +244,15 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 	const int NumItems = pTo->NumItems();
 	for(i = 0; i < NumItems; i++)
 	{
-		pCurItem = pTo->GetItem(i); // O(1) .. O(n)
-		aPastIndecies[i] = GetItemIndexHashed(pCurItem->Key(), Hashlist); // O(n) .. O(n^n)
+		pCurItem = pTo->GetItem(i);
+		aPastIndecies[i] = pFromIndex->Find(pCurItem->Key());
 	}
 
 	for(i = 0; i < NumItems; i++)
 	{
 		// do delta
-		ItemSize = pTo->GetItemSize(i); // O(1) .. O(n)
-		pCurItem = pTo->GetItem(i); // O(1) .. O(n)
+		ItemSize = pTo->GetItemSize(i);
+		pCurItem = pTo->GetItem(i);
 		PastIndex = aPastIndecies[i];
 
 		if(PastIndex != -1)
@@ -218,8 +264,16 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 			if(m_aItemSizes[pCurItem->Type()])
 				pItemDataDst = pData+2;
 
-			if(DiffItem((int*)pPastItem->Data(), (int*)pCurItem->Data(), pItemDataDst, ItemSize/4))
+			// most items did not change, the checksums tell the changed ones apart without touching their bytes
+			bool Changed;
+			if(pFrom->GetItemSize(PastIndex) == ItemSize && pFromIndex->Checksum(PastIndex) != pToIndex->Checksum(i))
+				Changed = true;
+			else
+				Changed = mem_comp(pPastItem->Data(), pCurItem->Data(), ItemSize) != 0;
+
+			if(Changed)
 			{
+				DiffItem(pPastItem->Data(), pCurItem->Data(), pItemDataDst, ItemSize/4);
 
 				*pData++ = pCurItem->Type();
 				*pData++ = pCurItem->ID();
@@ -237,10 +291,8 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 				*pData++ = ItemSize/4;
 
 			mem_copy(pData, pCurItem->Data(), ItemSize);
-			SizeCount += ItemSize;
 			pData += ItemSize/4;
 			pDelta->m_NumUpdateItems++;
-			Count++;
 		}
 	}
 
@@ -428,13 +480,14 @@ void CSnapshotStorage::PurgeUntil(int Tick)
 
 void CSnapshotStorage::Add(int Tick, int64 Tagtime, int DataSize, void *pData, int CreateAlt)
 {
-	// allocate memory for holder + snapshot_data
-	int TotalSize = sizeof(CHolder)+DataSize;
+	// allocate memory for holder + snapshot_data + index
+	int IndexSize = CSnapshotIndex::Size(((CSnapshot *)pData)->NumItems());
+	int TotalSize = sizeof(CHolder)+DataSize+IndexSize;
 
 	if(CreateAlt)
 		TotalSize += DataSize;
 
-	CHolder *pHolder = (CHolder *)mem_alloc(TotalSize, 1);
+	CHolder *pHolder = (CHolder *)mem_alloc_tagged(TotalSize, 1, MEMTAG_SNAPSHOT);
 
 	// set data
 	pHolder->m_Tick = Tick;
@@ -451,6 +504,8 @@ void CSnapshotStorage::Add(int Tick, int64 Tagtime, int DataSize, void *pData, i
 	else
 		pHolder->m_pAltSnap = 0;
 
+	pHolder->m_pIndex = (CSnapshotIndex*)(((char *)pHolder->m_pSnap) + (CreateAlt ? DataSize*2 : DataSize));
+	pHolder->m_pIndex->Build(pHolder->m_pSnap);
 
 	// link
 	pHolder->m_pNext = 0;
@@ -462,9 +517,10 @@ void CSnapshotStorage::Add(int Tick, int64 Tagtime, int DataSize, void *pData, i
 	m_pLast = pHolder;
 }
 
-int CSnapshotStorage::Get(int Tick, int64 *pTagtime, CSnapshot **ppData, CSnapshot **ppAltData)
+int CSnapshotStorage::Get(int Tick, int64 *pTagtime, CSnapshot **ppData, CSnapshot **ppAltData, const CSnapshotIndex **ppIndex)
 {
-	CHolder *pHolder = m_pFirst;
+	// the acked snapshots are almost always among the latest ones
+	CHolder *pHolder = m_pLast;
 
 	while(pHolder)
 	{
@@ -476,10 +532,12 @@ int CSnapshotStorage::Get(int Tick, int64 *pTagtime, CSnapshot **ppData, CSnapsh
 				*ppData = pHolder->m_pSnap;
 			if(ppAltData)
 				*ppAltData = pHolder->m_pAltSnap;
+			if(ppIndex)
+				*ppIndex = pHolder->m_pIndex;
 			return pHolder->m_SnapSize;
 		}
 
-		pHolder = pHolder->m_pNext;
+		pHolder = pHolder->m_pPrev;
 	}
 
 	return -1;
@@ -45,6 +45,35 @@ public:
 };
 
 
+// CSnapshotIndex
+
+// key lookup and item checksums of a snapshot, built once and kept next to it in the storage
+class CSnapshotIndex
+{
+	int m_NumSlots; // power of two, at least twice the number of items
+	int m_Shift;
+	int m_NumItems;
+
+	int *Keys() const { return (int *)(this+1); }
+	int *Indices() const { return Keys()+m_NumSlots; } // -1 for an empty slot
+	unsigned *Checksums() const { return (unsigned *)(Indices()+m_NumSlots); }
+
+public:
+	enum
+	{
+		MIN_SLOTS=16,
+		MAX_SIZE=(3+2*2048+1024)*4,
+	};
+
+	// bytes needed for the index of a snapshot with that many items
+	static int Size(int NumItems);
+	void Build(CSnapshot *pSnap);
+
+	int Find(int Key) const;
+	unsigned Checksum(int Index) const { return Checksums()[Index]; }
+};
+
+
 // CSnapshotDelta
 
 class CSnapshotDelta
@@ -66,6 +95,8 @@ private:
 	int m_aSnapshotDataUpdates[0xffff];
 	int m_SnapshotCurrent;
 	CData m_Empty;
+	int m_aFromIndexData[CSnapshotIndex::MAX_SIZE/4];
+	int m_aToIndexData[CSnapshotIndex::MAX_SIZE/4];
 
 	void UndiffItem(int *pPast, int *pDiff, int *pOut, int Size);
 
@@ -75,7 +106,9 @@ public:
 	int GetDataUpdates(int Index) { return m_aSnapshotDataUpdates[Index]; }
 	void SetStaticsize(int ItemType, int Size);
 	CData *EmptyDelta();
+	// the indices are built on the fly when not given
 	int CreateDelta(class CSnapshot *pFrom, class CSnapshot *pTo, void *pData);
+	int CreateDelta(class CSnapshot *pFrom, const CSnapshotIndex *pFromIndex, class CSnapshot *pTo, const CSnapshotIndex *pToIndex, void *pData);
 	int UnpackDelta(class CSnapshot *pFrom, class CSnapshot *pTo, void *pData, int DataSize);
 };
 
@@ -97,6 +130,7 @@ public:
 		int m_SnapSize;
 		CSnapshot *m_pSnap;
 		CSnapshot *m_pAltSnap;
+		CSnapshotIndex *m_pIndex;
 	};
 
 
@@ -107,7 +141,7 @@ public:
 	void PurgeAll();
 	void PurgeUntil(int Tick);
 	void Add(int Tick, int64 Tagtime, int DataSize, void *pData, int CreateAlt);
-	int Get(int Tick, int64 *Tagtime, CSnapshot **pData, CSnapshot **ppAltData);
+	int Get(int Tick, int64 *Tagtime, CSnapshot **pData, CSnapshot **ppAltData, const CSnapshotIndex **ppIndex = 0);
 };
 
 class CSnapshotBuilder
@@ -14,23 +14,32 @@
 #include <game/gamecore.h>
 #include <game/animation.h>
 
+#if defined(CONF_ARCH_AMD64)
+#include <emmintrin.h>
+#endif
+
 CCollision::CCollision()
 {
-	m_pPhysicsTiles = 0;
+	m_pTiles = 0;
+	m_pTileOrigin = 0;
+	m_TileStride = 0;
 	m_PhysicsWidth = 0;
 	m_PhysicsHeight = 0;
 	
 	m_pLayers = 0;
 	
 	m_Time = 0.0;
+	
+	m_FloodFill.Init(this);
 }
 
 CCollision::~CCollision()
 {
-	if(m_pPhysicsTiles)
-		delete[] m_pPhysicsTiles;
+	if(m_pTiles)
+		delete[] m_pTiles;
 	
-	m_pPhysicsTiles = 0;
+	m_pTiles = 0;
+	m_pTileOrigin = 0;
 }
 
 void CCollision::Init(class CLayers *pLayers)
@@ -40,33 +49,72 @@ void CCollision::Init(class CLayers *pLayers)
 	m_PhysicsWidth = m_pLayers->PhysicsLayer()->m_Width;
 	m_PhysicsHeight = m_pLayers->PhysicsLayer()->m_Height;
 	CTile* pPhysicsTiles = static_cast<CTile *>(m_pLayers->Map()->GetData(m_pLayers->PhysicsLayer()->m_Data));
-	if(m_pPhysicsTiles)
-		delete[] m_pPhysicsTiles;
-	m_pPhysicsTiles = new int[m_PhysicsWidth*m_PhysicsHeight];
-
-	for(int i = 0; i < m_PhysicsWidth*m_PhysicsHeight; i++)
+	if(m_pTiles)
+		delete[] m_pTiles;
+	m_TileStride = m_PhysicsWidth+TILE_BORDER*2;
+	m_pTiles = new unsigned char[m_TileStride*(m_PhysicsHeight+TILE_BORDER*2)];
+	m_pTileOrigin = m_pTiles + TILE_BORDER*m_TileStride + TILE_BORDER;
+
+	// the border gets the flags of the nearest map tile, the same a clamped lookup would find
+	for(int y = -TILE_BORDER; y < m_PhysicsHeight+TILE_BORDER; y++)
 	{
-		switch(pPhysicsTiles[i].m_Index)
+		int Ny = clamp(y, 0, m_PhysicsHeight-1);
+		for(int x = -TILE_BORDER; x < m_PhysicsWidth+TILE_BORDER; x++)
 		{
-		case TILE_PHYSICS_SOLID:
-			m_pPhysicsTiles[i] = COLFLAG_SOLID;
-			break;
-		case TILE_PHYSICS_NOHOOK:
-			m_pPhysicsTiles[i] = COLFLAG_SOLID|COLFLAG_NOHOOK;
-			break;
-		default:
-			m_pPhysicsTiles[i] = 0x0;
-			break;
+			int Nx = clamp(x, 0, m_PhysicsWidth-1);
+			unsigned char Flags;
+			switch(pPhysicsTiles[Ny*m_PhysicsWidth+Nx].m_Index)
+			{
+			case TILE_PHYSICS_SOLID:
+				Flags = COLFLAG_SOLID;
+				break;
+			case TILE_PHYSICS_NOHOOK:
+				Flags = COLFLAG_SOLID|COLFLAG_NOHOOK;
+				break;
+			default:
+				Flags = 0x0;
+				break;
+			}
+			m_pTileOrigin[y*m_TileStride+x] = Flags;
 		}
 	}
 }
 
 int CCollision::GetTile(int x, int y)
 {
-	int Nx = clamp(x/32, 0, m_PhysicsWidth-1);
-	int Ny = clamp(y/32, 0, m_PhysicsHeight-1);
+	int Nx = x/32;
+	int Ny = y/32;
+	if(!InsideBorder(Nx, Ny))
+	{
+		Nx = clamp(Nx, 0, m_PhysicsWidth-1);
+		Ny = clamp(Ny, 0, m_PhysicsHeight-1);
+	}
 
-	return m_pPhysicsTiles[Ny*m_PhysicsWidth+Nx];
+	return m_pTileOrigin[Ny*m_TileStride+Nx];
+}
+
+bool CCollision::IsSolidArea(int Tx0, int Ty0, int Tx1, int Ty1) const
+{
+	for(int y = Ty0; y <= Ty1; y++)
+	{
+		const unsigned char *pRow = m_pTileOrigin + y*m_TileStride;
+		int x = Tx0;
+#if defined(CONF_ARCH_AMD64)
+		const __m128i Solid = _mm_set1_epi8(COLFLAG_SOLID);
+		for(; x+16 <= Tx1+1; x += 16)
+		{
+			__m128i Flags = _mm_and_si128(_mm_loadu_si128((const __m128i *)(pRow+x)), Solid);
+			if(_mm_movemask_epi8(_mm_cmpeq_epi8(Flags, _mm_setzero_si128())) != 0xffff)
+				return true;
+		}
+#endif
+		for(; x <= Tx1; x++)
+		{
+			if(pRow[x]&COLFLAG_SOLID)
+				return true;
+		}
+	}
+	return false;
 }
 
 bool CCollision::IsTileSolid(int x, int y)
@@ -141,9 +189,32 @@ void CCollision::MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, i
 	}
 }
 
+// same result as round(), halves away from zero, without the library call
+static inline int RoundPixel(float f)
+{
+	int i = (int)f;
+	float Rest = f - (float)i;
+	return i + (Rest >= 0.5f) - (Rest <= -0.5f);
+}
+
 bool CCollision::TestBox(vec2 Pos, vec2 Size)
 {
 	Size *= 0.5f;
+	int Left = RoundPixel(Pos.x-Size.x);
+	int Right = RoundPixel(Pos.x+Size.x);
+	int Top = RoundPixel(Pos.y-Size.y);
+	int Bottom = RoundPixel(Pos.y+Size.y);
+
+	// the four corners straight from the grid when they are inside the border
+	int Tx0 = Left/32, Tx1 = Right/32;
+	int Ty0 = Top/32, Ty1 = Bottom/32;
+	if(InsideBorder(Tx0, Ty0) && InsideBorder(Tx1, Ty1))
+	{
+		const unsigned char *pRow0 = m_pTileOrigin + Ty0*m_TileStride;
+		const unsigned char *pRow1 = m_pTileOrigin + Ty1*m_TileStride;
+		return (pRow0[Tx0]|pRow0[Tx1]|pRow1[Tx0]|pRow1[Tx1])&COLFLAG_SOLID;
+	}
+
 	if(CheckPoint(Pos.x-Size.x, Pos.y-Size.y))
 		return true;
 	if(CheckPoint(Pos.x+Size.x, Pos.y-Size.y))
@@ -166,6 +237,26 @@ void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elas
 
 	if(Distance > 0.00001f)
 	{
+		// nothing solid around the whole move means that every test below would fail,
+		// the steps are still taken to end up on the same position. the margin covers
+		// the rounding of the corners and the drift of the float steps
+		bool Free = false;
+		if(Max < MAX_FREE_MOVE_STEPS)
+		{
+			float HalfW = absolute(Size.x)*0.5f + 2.0f;
+			float HalfH = absolute(Size.y)*0.5f + 2.0f;
+			float Left = min(Pos.x, Pos.x+Vel.x) - HalfW;
+			float Right = max(Pos.x, Pos.x+Vel.x) + HalfW;
+			float Top = min(Pos.y, Pos.y+Vel.y) - HalfH;
+			float Bottom = max(Pos.y, Pos.y+Vel.y) + HalfH;
+			if(Left > -TILE_BORDER*32 && Right < (m_PhysicsWidth+TILE_BORDER)*32 && Top > -TILE_BORDER*32 && Bottom < (m_PhysicsHeight+TILE_BORDER)*32)
+			{
+				int Tx0 = (int)Left/32, Tx1 = (int)Right/32;
+				int Ty0 = (int)Top/32, Ty1 = (int)Bottom/32;
+				Free = InsideBorder(Tx0, Ty0) && InsideBorder(Tx1, Ty1) && !IsSolidArea(Tx0, Ty0, Tx1, Ty1);
+			}
+		}
+
 		//vec2 old_pos = pos;
 		float Fraction = 1.0f/(float)(Max+1);
 		for(int i = 0; i <= Max; i++)
@@ -176,7 +267,7 @@ void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elas
 
 			vec2 NewPos = Pos + Vel*Fraction; // TODO: this row is not nice
 
-			if(TestBox(vec2(NewPos.x, NewPos.y), Size))
+			if(!Free && TestBox(vec2(NewPos.x, NewPos.y), Size))
 			{
 				int Hits = 0;
 
@@ -388,68 +479,15 @@ bool CCollision::AreConnected(vec2 Pos1, vec2 Pos2, float Radius)
 		return false;
 	
 	int TileRadius = std::ceil(Radius/32.0f);
-	int CenterX = TileRadius;
-	int CenterY = TileRadius;
 	int Width = 2*TileRadius+1;
-	int Height = 2*TileRadius+1;
-	char* pMap = new char[Width*Height];
-	for(int j=0; j<Height; j++)
-	{
-		for(int i=0; i<Width; i++)
-		{
-			if(CheckPoint(Pos1.x + 32.0f*(i-CenterX), Pos1.y + 32.0f*(j-CenterY)))
-				pMap[j*Width+i] = 0x0; //This tile can be checked
-			else
-				pMap[j*Width+i] = 0x1;
-		}
-	}
-	
-	pMap[CenterY*Width+CenterX] = 0x2; //This tile is checked
-	
-	int Pos2X = clamp(CenterX + (int)round((Pos2.x - Pos1.x)/32.0f), 0, Width-1);
-	int Pos2Y = clamp(CenterY + (int)round((Pos2.y - Pos1.y)/32.0f), 0, Height-1);
+	int Pos2X = clamp(TileRadius + (int)round((Pos2.x - Pos1.x)/32.0f), 0, Width-1);
+	int Pos2Y = clamp(TileRadius + (int)round((Pos2.y - Pos1.y)/32.0f), 0, Width-1);
 	
-	bool Changes = true;
-	while(Changes)
-	{
-		Changes = false;
-		for(int j=0; j<Height; j++)
-		{
-			for(int i=0; i<Width; i++)
-			{
-				if(pMap[j*Width+i]&0x1 && !(pMap[j*Width+i]&0x2))
-				{
-					if(i>0 && (pMap[j*Width+(i-1)]&0x2))
-					{
-						pMap[j*Width+i] = 0x2;
-						Changes = true;
-					}
-					if(j>0 && (pMap[(j-1)*Width+i]&0x2))
-					{
-						pMap[j*Width+i] = 0x2;
-						Changes = true;
-					}
-					if(i<Width-1 && (pMap[j*Width+(i+1)]&0x2))
-					{
-						pMap[j*Width+i] = 0x2;
-						Changes = true;
-					}
-					if(j<Height-1 && (pMap[(j+1)*Width+i]&0x2))
-					{
-						pMap[j*Width+i] = 0x2;
-						Changes = true;
-					}
-				}
-			}
-		}
-		
-		if(pMap[Pos2Y*Width+Pos2X]&0x2)
-		{
-			delete[] pMap;
-			return true;
-		}
-	}	
+	//Walk through the free tiles around Pos1
+	CFloodFill::CGrid *pGrid = m_FloodFill.AllocGrid(Pos1, TileRadius, 0);
+	m_FloodFill.Seed(pGrid, pGrid->Center(), 0);
+	bool Connected = m_FloodFill.Reach(pGrid, Pos2Y*Width+Pos2X);
+	m_FloodFill.FreeGrid(pGrid);
 	
-	delete[] pMap;
-	return false;
+	return Connected;
 }
@@ -5,6 +5,7 @@
 
 #include <base/vmath.h>
 #include <base/tl/array.h>
+#include <game/floodfill.h>
 #include <map>
 #include <vector>
 
@@ -20,7 +21,16 @@ enum DD_TILE_TELE
 
 class CCollision
 {
-	int *m_pPhysicsTiles;
+	enum
+	{
+		TILE_BORDER=16, // tiles copied around the map, lookups within them need no clamping
+		MAX_FREE_MOVE_STEPS=64, // MoveBox steps that may skip the tests when nothing solid is around
+	};
+
+	// one byte of flags per physics tile, the border repeats the outermost tiles
+	unsigned char *m_pTiles;
+	unsigned char *m_pTileOrigin; // tile 0,0 inside m_pTiles
+	int m_TileStride;
 	int m_PhysicsWidth;
 	int m_PhysicsHeight;
 	
@@ -30,8 +40,13 @@ class CCollision
 	
 	array< array<int> > m_Zones;
 
+	CFloodFill m_FloodFill;
+
 	bool IsTileSolid(int x, int y);
 	int GetTile(int x, int y);
+	bool InsideBorder(int Tx, int Ty) const { return Tx >= -TILE_BORDER && Tx < m_PhysicsWidth+TILE_BORDER && Ty >= -TILE_BORDER && Ty < m_PhysicsHeight+TILE_BORDER; }
+	// tile coordinates inclusive, all of them inside the border
+	bool IsSolidArea(int Tx0, int Ty0, int Tx1, int Ty1) const;
 	int GetZoneTile(int x, int y);
 
 public:
@@ -70,6 +85,7 @@ public:
 	bool CheckPhysicsFlag(vec2 Pos, int Flag);
 	
 	bool AreConnected(vec2 Pos1, vec2 Pos2, float Radius);
+	CFloodFill *FloodFill() { return &m_FloodFill; }
 /* INFECTION MODIFICATION END *****************************************/
 };
 
@@ -0,0 +1,171 @@
+#include <base/system.h>
+#include <base/math.h>
+
+#include <game/collision.h>
+
+#include "floodfill.h"
+
+CFloodFill::CFloodFill()
+{
+	m_pCollision = 0;
+	m_pFirstFree = 0;
+}
+
+CFloodFill::~CFloodFill()
+{
+	while(m_pFirstFree)
+	{
+		CGrid *pGrid = m_pFirstFree;
+		m_pFirstFree = pGrid->m_pNextFree;
+		delete[] pGrid->m_pCells;
+		delete[] pGrid->m_pData;
+		delete[] pGrid->m_pQueue;
+		delete pGrid;
+	}
+
+	for(int i = 0; i < m_apDiscs.size(); i++)
+		delete[] m_apDiscs[i];
+}
+
+// half width of each row of a disc, row y contains the cells with |x| <= Disc[|y|]
+const int *CFloodFill::Disc(int Radius)
+{
+	while(m_apDiscs.size() <= Radius)
+		m_apDiscs.add(0);
+
+	if(!m_apDiscs[Radius])
+	{
+		int *pDisc = new int[Radius+1];
+		for(int y = 0; y <= Radius; y++)
+		{
+			int x = Radius;
+			while(x*x+y*y > Radius*Radius)
+				x--;
+			pDisc[y] = x;
+		}
+		m_apDiscs[Radius] = pDisc;
+	}
+	return m_apDiscs[Radius];
+}
+
+CFloodFill::CGrid *CFloodFill::AllocGrid(vec2 Center, int Radius, int Flags)
+{
+	Radius = max(Radius, 0);
+	int Length = 2*Radius+1;
+	int Size = Length*Length;
+
+	CGrid **ppPrev = &m_pFirstFree;
+	CGrid *pGrid = m_pFirstFree;
+	while(pGrid && pGrid->m_Capacity < Size)
+	{
+		ppPrev = &pGrid->m_pNextFree;
+		pGrid = pGrid->m_pNextFree;
+	}
+
+	if(pGrid)
+		*ppPrev = pGrid->m_pNextFree;
+	else
+	{
+		pGrid = new CGrid;
+		pGrid->m_Capacity = Size;
+		pGrid->m_pCells = new int[Size];
+		pGrid->m_pData = new vec2[Size];
+		pGrid->m_pQueue = new int[Size];
+	}
+
+	pGrid->m_pNextFree = 0;
+	pGrid->m_pDisc = Flags&FLAG_DISC ? Disc(Radius) : 0;
+	pGrid->m_Center = Center;
+	pGrid->m_Radius = Radius;
+	pGrid->m_Length = Length;
+	pGrid->m_Flags = Flags;
+	pGrid->m_QueueStart = 0;
+	pGrid->m_QueueEnd = 0;
+	for(int i = 0; i < Size; i++)
+		pGrid->m_pCells[i] = CELL_UNKNOWN;
+	mem_zero(pGrid->m_pData, Size*sizeof(vec2));
+
+	return pGrid;
+}
+
+void CFloodFill::FreeGrid(CGrid *pGrid)
+{
+	pGrid->m_pNextFree = m_pFirstFree;
+	m_pFirstFree = pGrid;
+}
+
+int CFloodFill::Probe(const CGrid *pGrid, int Cell) const
+{
+	int x = Cell%pGrid->m_Length - pGrid->m_Radius;
+	int y = Cell/pGrid->m_Length - pGrid->m_Radius;
+
+	if(pGrid->m_pDisc && absolute(x) > pGrid->m_pDisc[absolute(y)])
+		return CELL_BLOCKED;
+	if(pGrid->m_Flags&FLAG_NOCLIP)
+		return CELL_FREE;
+
+	return m_pCollision->CheckPoint(pGrid->m_Center + vec2(32.0f*x, 32.0f*y)) ? CELL_BLOCKED : CELL_FREE;
+}
+
+void CFloodFill::Visit(CGrid *pGrid, int Cell, int Tick)
+{
+	if(pGrid->m_pCells[Cell] == CELL_UNKNOWN)
+		pGrid->m_pCells[Cell] = Probe(pGrid, Cell);
+
+	if(pGrid->m_pCells[Cell] == CELL_FREE)
+		Seed(pGrid, Cell, Tick);
+}
+
+void CFloodFill::Seed(CGrid *pGrid, int Cell, int Tick)
+{
+	pGrid->m_pCells[Cell] = Tick;
+	pGrid->m_pQueue[pGrid->m_QueueEnd++] = Cell;
+}
+
+int CFloodFill::Grow(CGrid *pGrid, int Tick)
+{
+	int Length = pGrid->m_Length;
+	int First = pGrid->m_QueueEnd;
+
+	// the queue is ordered by tick, only the cells reached before Tick can spread
+	while(pGrid->m_QueueStart < First && pGrid->m_pCells[pGrid->m_pQueue[pGrid->m_QueueStart]] < Tick)
+	{
+		int Cell = pGrid->m_pQueue[pGrid->m_QueueStart++];
+		int x = Cell%Length;
+		int y = Cell/Length;
+
+		if(x > 0)
+			Visit(pGrid, Cell-1, Tick);
+		if(x < Length-1)
+			Visit(pGrid, Cell+1, Tick);
+		if(y > 0)
+			Visit(pGrid, Cell-Length, Tick);
+		if(y < Length-1)
+			Visit(pGrid, Cell+Length, Tick);
+	}
+
+	return First;
+}
+
+bool CFloodFill::Reach(CGrid *pGrid, int Target)
+{
+	int Length = pGrid->m_Length;
+
+	while(pGrid->m_pCells[Target] < 0 && pGrid->m_QueueStart < pGrid->m_QueueEnd)
+	{
+		int Cell = pGrid->m_pQueue[pGrid->m_QueueStart++];
+		int x = Cell%Length;
+		int y = Cell/Length;
+
+		if(x > 0)
+			Visit(pGrid, Cell-1, 0);
+		if(x < Length-1)
+			Visit(pGrid, Cell+1, 0);
+		if(y > 0)
+			Visit(pGrid, Cell-Length, 0);
+		if(y < Length-1)
+			Visit(pGrid, Cell+Length, 0);
+	}
+
+	return pGrid->m_pCells[Target] >= 0;
+}
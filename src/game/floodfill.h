@@ -0,0 +1,72 @@
+#ifndef GAME_FLOODFILL_H
+#define GAME_FLOODFILL_H
+
+#include <base/vmath.h>
+#include <base/tl/array.h>
+
+// breadth first flood fill over the tiles of a square window centered on a tile
+// grids are pooled and tiles are only probed when the fill reaches them
+class CFloodFill
+{
+public:
+	enum
+	{
+		CELL_UNKNOWN=-3, // not probed yet
+		CELL_BLOCKED=-2,
+		CELL_FREE=-1,
+
+		FLAG_DISC=1, // only the cells within the radius of the center can be reached
+		FLAG_NOCLIP=2, // ignore the tiles of the map
+	};
+
+	class CGrid
+	{
+		friend class CFloodFill;
+
+		int m_Capacity;
+		CGrid *m_pNextFree;
+		const int *m_pDisc;
+
+	public:
+		vec2 m_Center; // world position of the center cell
+		int m_Radius;
+		int m_Length;
+		int m_Flags;
+
+		int *m_pCells; // CELL_* or the tick the cell was reached
+		vec2 *m_pData; // user data, zeroed when the grid is allocated
+		int *m_pQueue; // reached cells, in the order they were reached
+		int m_QueueStart;
+		int m_QueueEnd;
+
+		int Center() const { return m_Radius*m_Length+m_Radius; }
+		int Size() const { return m_Length*m_Length; }
+	};
+
+private:
+	class CCollision *m_pCollision;
+	CGrid *m_pFirstFree;
+	array<int *> m_apDiscs;
+
+	const int *Disc(int Radius);
+	int Probe(const CGrid *pGrid, int Cell) const;
+	void Visit(CGrid *pGrid, int Cell, int Tick);
+
+public:
+	CFloodFill();
+	~CFloodFill();
+
+	void Init(class CCollision *pCollision) { m_pCollision = pCollision; }
+
+	CGrid *AllocGrid(vec2 Center, int Radius, int Flags);
+	void FreeGrid(CGrid *pGrid);
+
+	void Seed(CGrid *pGrid, int Cell, int Tick);
+	// reaches every cell next to a cell reached before Tick, the new cells are reached at Tick
+	// returns the position in the queue of the first new cell
+	int Grow(CGrid *pGrid, int Tick);
+	// fills the whole grid, stops as soon as Target is reached
+	bool Reach(CGrid *pGrid, int Target);
+};
+
+#endif
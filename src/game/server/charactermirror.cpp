@@ -0,0 +1,148 @@
+#include <base/detect.h>
+#include <base/math.h>
+
+#include "charactermirror.h"
+
+#if defined(CONF_ARCH_AMD64)
+#include <emmintrin.h>
+#endif
+
+CCharacterMirror::CCharacterMirror()
+{
+	Clear();
+}
+
+void CCharacterMirror::Clear()
+{
+	m_Num = 0;
+	m_HumanMask = 0;
+	m_ZombieMask = 0;
+
+	// the vector loops read whole groups of slots, the unused ones are out of reach
+	for(int i = 0; i < MAX_CHARACTERS; i++)
+	{
+		m_aX[i] = 1e30f;
+		m_aY[i] = 1e30f;
+		m_aRadius[i] = 0.0f;
+		m_apCharacters[i] = 0;
+	}
+}
+
+void CCharacterMirror::Add(CCharacter *pCharacter, vec2 Pos, float ProximityRadius, bool Zombie)
+{
+	dbg_assert(m_Num < MAX_CHARACTERS, "too many characters in the world");
+	m_aX[m_Num] = Pos.x;
+	m_aY[m_Num] = Pos.y;
+	m_aRadius[m_Num] = ProximityRadius;
+	m_apCharacters[m_Num] = pCharacter;
+	if(Zombie)
+		m_ZombieMask |= 1LL<<m_Num;
+	else
+		m_HumanMask |= 1LL<<m_Num;
+	m_Num++;
+}
+
+int CCharacterMirror::FirstSlot(int64 Mask)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll((unsigned long long)Mask);
+#else
+	int Slot = 0;
+	while(!(Mask&1))
+	{
+		Mask = (unsigned long long)Mask>>1;
+		Slot++;
+	}
+	return Slot;
+#endif
+}
+
+int64 CCharacterMirror::FlagMask(int Flags) const
+{
+	int64 Mask = 0;
+	if(Flags&FLAG_HUMAN)
+		Mask |= m_HumanMask;
+	if(Flags&FLAG_ZOMBIE)
+		Mask |= m_ZombieMask;
+	return Mask;
+}
+
+int64 CCharacterMirror::WithinRadius(vec2 Pos, float Radius, bool AddProximity, int Flags) const
+{
+	int64 Mask = 0;
+	int i = 0;
+
+#if defined(CONF_ARCH_AMD64)
+	const __m128 PosX = _mm_set1_ps(Pos.x);
+	const __m128 PosY = _mm_set1_ps(Pos.y);
+	const __m128 Limit = _mm_set1_ps(Radius);
+	const __m128 Proximity = AddProximity ? _mm_castsi128_ps(_mm_set1_epi32(-1)) : _mm_setzero_ps();
+	for(; i < m_Num; i += 4)
+	{
+		__m128 DiffX = _mm_sub_ps(_mm_loadu_ps(m_aX+i), PosX);
+		__m128 DiffY = _mm_sub_ps(_mm_loadu_ps(m_aY+i), PosY);
+		__m128 Length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(DiffX, DiffX), _mm_mul_ps(DiffY, DiffY)));
+		__m128 Radii = _mm_add_ps(_mm_and_ps(_mm_loadu_ps(m_aRadius+i), Proximity), Limit);
+		Mask |= (int64)_mm_movemask_ps(_mm_cmplt_ps(Length, Radii))<<i;
+	}
+#endif
+
+	for(; i < m_Num; i++)
+	{
+		float Length = distance(vec2(m_aX[i], m_aY[i]), Pos);
+		if(Length < (AddProximity ? m_aRadius[i]+Radius : Radius))
+			Mask |= 1LL<<i;
+	}
+
+	return Mask&FlagMask(Flags);
+}
+
+int64 CCharacterMirror::WithinSegment(vec2 Pos0, vec2 Pos1, float Radius, bool AddProximity, int Flags) const
+{
+	// closest_point_on_line finds nothing on an empty segment
+	float SegmentLength = length(Pos0-Pos1);
+	if(!(SegmentLength > 0.0f))
+		return 0;
+	vec2 Dir = normalize(Pos1-Pos0);
+	vec2 Segment = Pos1-Pos0;
+
+	int64 Mask = 0;
+	int i = 0;
+
+#if defined(CONF_ARCH_AMD64)
+	const __m128 StartX = _mm_set1_ps(Pos0.x);
+	const __m128 StartY = _mm_set1_ps(Pos0.y);
+	const __m128 DirX = _mm_set1_ps(Dir.x);
+	const __m128 DirY = _mm_set1_ps(Dir.y);
+	const __m128 SegmentX = _mm_set1_ps(Segment.x);
+	const __m128 SegmentY = _mm_set1_ps(Segment.y);
+	const __m128 SegmentLength4 = _mm_set1_ps(SegmentLength);
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 One = _mm_set1_ps(1.0f);
+	const __m128 Limit = _mm_set1_ps(Radius);
+	const __m128 Proximity = AddProximity ? _mm_castsi128_ps(_mm_set1_epi32(-1)) : _mm_setzero_ps();
+	for(; i < m_Num; i += 4)
+	{
+		__m128 X = _mm_loadu_ps(m_aX+i);
+		__m128 Y = _mm_loadu_ps(m_aY+i);
+		__m128 T = _mm_div_ps(_mm_add_ps(_mm_mul_ps(DirX, _mm_sub_ps(X, StartX)), _mm_mul_ps(DirY, _mm_sub_ps(Y, StartY))), SegmentLength4);
+		T = _mm_min_ps(_mm_max_ps(T, Zero), One);
+		__m128 DiffX = _mm_sub_ps(X, _mm_add_ps(StartX, _mm_mul_ps(SegmentX, T)));
+		__m128 DiffY = _mm_sub_ps(Y, _mm_add_ps(StartY, _mm_mul_ps(SegmentY, T)));
+		__m128 Length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(DiffX, DiffX), _mm_mul_ps(DiffY, DiffY)));
+		__m128 Radii = _mm_add_ps(_mm_and_ps(_mm_loadu_ps(m_aRadius+i), Proximity), Limit);
+		Mask |= (int64)_mm_movemask_ps(_mm_cmplt_ps(Length, Radii))<<i;
+	}
+#endif
+
+	for(; i < m_Num; i++)
+	{
+		vec2 CharPos(m_aX[i], m_aY[i]);
+		float T = clamp(dot(Dir, CharPos-Pos0)/SegmentLength, 0.0f, 1.0f);
+		float Length = distance(CharPos, Pos0 + Segment*T);
+		if(Length < (AddProximity ? m_aRadius[i]+Radius : Radius))
+			Mask |= 1LL<<i;
+	}
+
+	return Mask&FlagMask(Flags);
+}
@@ -0,0 +1,54 @@
+#ifndef GAME_SERVER_CHARACTERMIRROR_H
+#define GAME_SERVER_CHARACTERMIRROR_H
+
+#include <base/system.h>
+#include <base/vmath.h>
+#include <engine/shared/protocol.h>
+
+class CCharacter;
+
+// struct of arrays copy of the characters of the world for proximity queries
+// slots follow the order of the character list, queries return a mask of slots
+class CCharacterMirror
+{
+public:
+	enum
+	{
+		FLAG_HUMAN=1,
+		FLAG_ZOMBIE=2,
+		FLAG_ALL=FLAG_HUMAN|FLAG_ZOMBIE,
+
+		MAX_CHARACTERS=MAX_CLIENTS, // one bit per slot in an int64
+	};
+
+private:
+	float m_aX[MAX_CHARACTERS];
+	float m_aY[MAX_CHARACTERS];
+	float m_aRadius[MAX_CHARACTERS];
+	CCharacter *m_apCharacters[MAX_CHARACTERS];
+	int m_Num;
+
+	int64 m_HumanMask;
+	int64 m_ZombieMask;
+
+	int64 FlagMask(int Flags) const;
+
+public:
+	CCharacterMirror();
+
+	void Clear();
+	void Add(CCharacter *pCharacter, vec2 Pos, float ProximityRadius, bool Zombie);
+
+	int Num() const { return m_Num; }
+	CCharacter *GetCharacter(int Slot) const { return m_apCharacters[Slot]; }
+	// character of the lowest slot in a non empty mask
+	CCharacter *First(int64 Mask) const { return m_apCharacters[FirstSlot(Mask)]; }
+	static int FirstSlot(int64 Mask);
+
+	// characters closer than Radius to Pos, plus their proximity radius if AddProximity is set
+	int64 WithinRadius(vec2 Pos, float Radius, bool AddProximity, int Flags) const;
+	// characters closer than Radius to the segment from Pos0 to Pos1, same rules as closest_point_on_line
+	int64 WithinSegment(vec2 Pos0, vec2 Pos1, float Radius, bool AddProximity, int Flags) const;
+};
+
+#endif
@@ -7,7 +7,7 @@
 #include "biologist-laser.h"
 
 CBiologistMine::CBiologistMine(CGameWorld *pGameWorld, vec2 Pos, vec2 EndPos, int Owner)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_BIOLOGIST_MINE)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_BIOLOGIST_MINE, Owner)
 {
 	m_Pos = Pos;
 	m_EndPos = EndPos;
@@ -90,18 +90,14 @@ void CBiologistMine::Tick()
 	
 	
 	// Find other players
-	for(CCharacter *p = (CCharacter*) GameWorld()->FindFirst(CGameWorld::ENTTYPE_CHARACTER); p; p = (CCharacter *)p->TypeNext())
+	const CCharacterMirror *pCharacters = GameWorld()->Characters();
+	for(int64 Mask = pCharacters->WithinSegment(m_Pos, m_EndPos, 0.0f, true, CCharacterMirror::FLAG_ZOMBIE); Mask; Mask &= Mask-1)
 	{
-		if(p->IsHuman()) continue;
+		CCharacter *p = pCharacters->First(Mask);
 		if(p->GetClass() == PLAYERCLASS_UNDEAD && p->IsFrozen()) continue;
 		if(p->GetClass() == PLAYERCLASS_VOODOO && p->m_VoodooAboutToDie) continue;
 
-		vec2 IntersectPos = closest_point_on_line(m_Pos, m_EndPos, p->m_Pos);
-		float Len = distance(p->m_Pos, IntersectPos);
-		if(Len < p->m_ProximityRadius)
-		{
-			Explode();
-			break;
-		}
+		Explode();
+		break;
 	}
 }
@@ -766,10 +766,9 @@ void CCharacter::FireWeapon()
 		/* INFECTION MODIFICATION START ***************************************/
 		if (GetClass() == PLAYERCLASS_ENGINEER)
 		{
-			for (CEngineerWall *pWall = (CEngineerWall *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_ENGINEER_WALL); pWall; pWall = (CEngineerWall *)pWall->TypeNext())
+			for (CEngineerWall *pWall = (CEngineerWall *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_ENGINEER_WALL); pWall; pWall = (CEngineerWall *)pWall->OwnerNext())
 			{
-				if (pWall->m_Owner == m_pPlayer->GetCID())
-					GameServer()->m_World.DestroyEntity(pWall);
+				GameServer()->m_World.DestroyEntity(pWall);
 			}
 
 			if (m_FirstShot)
@@ -803,10 +802,9 @@ void CCharacter::FireWeapon()
 		else if (GetClass() == PLAYERCLASS_LOOPER)
 		{
 			// Potential variable name conflicts with engineers wall (for example *pWall is used twice for both Looper and Engineer)
-			for (CLooperWall *pWall = (CLooperWall *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_LOOPER_WALL); pWall; pWall = (CLooperWall *)pWall->TypeNext())
+			for (CLooperWall *pWall = (CLooperWall *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_LOOPER_WALL); pWall; pWall = (CLooperWall *)pWall->OwnerNext())
 			{
-				if (pWall->m_Owner == m_pPlayer->GetCID())
-					GameServer()->m_World.DestroyEntity(pWall);
+				GameServer()->m_World.DestroyEntity(pWall);
 			}
 
 			if (m_FirstShot)
@@ -840,14 +838,11 @@ void CCharacter::FireWeapon()
 		else if (GetClass() == PLAYERCLASS_SOLDIER)
 		{
 			bool BombFound = false;
-			for (CSoldierBomb *pBomb = (CSoldierBomb *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_SOLDIER_BOMB); pBomb; pBomb = (CSoldierBomb *)pBomb->TypeNext())
+			for (CSoldierBomb *pBomb = (CSoldierBomb *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_SOLDIER_BOMB); pBomb; pBomb = (CSoldierBomb *)pBomb->OwnerNext())
 			{
-				if (pBomb->m_Owner == m_pPlayer->GetCID())
-				{
-					BombFound = pBomb->Explode();
-					if (!BombFound)
-						GameServer()->m_World.DestroyEntity(pBomb);
-				}
+				BombFound = pBomb->Explode();
+				if (!BombFound)
+					GameServer()->m_World.DestroyEntity(pBomb);
 			}
 
 			if (!BombFound)
@@ -876,13 +871,10 @@ void CCharacter::FireWeapon()
 		else if (GetClass() == PLAYERCLASS_MERCENARY && g_Config.m_InfMercLove && !GameServer()->m_FunRound)
 		{
 			CMercenaryBomb *pCurrentBomb = NULL;
-			for (CMercenaryBomb *pBomb = (CMercenaryBomb *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_MERCENARY_BOMB); pBomb; pBomb = (CMercenaryBomb *)pBomb->TypeNext())
+			for (CMercenaryBomb *pBomb = (CMercenaryBomb *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_MERCENARY_BOMB); pBomb; pBomb = (CMercenaryBomb *)pBomb->OwnerNext())
 			{
-				if (pBomb->m_Owner == m_pPlayer->GetCID())
-				{
-					pCurrentBomb = pBomb;
-					break;
-				}
+				pCurrentBomb = pBomb;
+				break;
 			}
 
 			if (pCurrentBomb)
@@ -956,12 +948,9 @@ void CCharacter::FireWeapon()
 		{
 			if (m_HasDefenceCircle)
 			{
-				for (CDefenceCircle *pMine = (CDefenceCircle *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_DEFENCE_CIRCLE); pMine; pMine = (CDefenceCircle *)pMine->TypeNext())
+				for (CDefenceCircle *pMine = (CDefenceCircle *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_DEFENCE_CIRCLE); pMine; pMine = (CDefenceCircle *)pMine->OwnerNext())
 				{
-					if (pMine->GetOwner() == m_pPlayer->GetCID())
-					{
-						GameServer()->m_World.DestroyEntity(pMine);
-					}
+					GameServer()->m_World.DestroyEntity(pMine);
 				}
 			}
 
@@ -1049,10 +1038,9 @@ void CCharacter::FireWeapon()
 			if (GetClass() == PLAYERCLASS_FREEZER && m_HasFreezeMine)
 			{
 				CFreezeMine *pOldMine = 0;
-				for (CFreezeMine *pMine = (CFreezeMine *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_FREEZE_MINE); pMine; pMine = (CFreezeMine *)pMine->TypeNext())
+				for (CFreezeMine *pMine = (CFreezeMine *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_FREEZE_MINE); pMine; pMine = (CFreezeMine *)pMine->OwnerNext())
 				{
-					if (pMine->GetOwner() == m_pPlayer->GetCID())
-						pOldMine = pMine;
+					pOldMine = pMine;
 				}
 				if (pOldMine)
 					GameServer()->m_World.DestroyEntity(pOldMine);
@@ -1493,10 +1481,8 @@ void CCharacter::FireWeapon()
 		{
 			// Find bomb
 			bool BombFound = false;
-			for (CScatterGrenade *pGrenade = (CScatterGrenade *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_SCATTER_GRENADE); pGrenade; pGrenade = (CScatterGrenade *)pGrenade->TypeNext())
+			for (CScatterGrenade *pGrenade = (CScatterGrenade *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_SCATTER_GRENADE); pGrenade; pGrenade = (CScatterGrenade *)pGrenade->OwnerNext())
 			{
-				if (pGrenade->m_Owner != m_pPlayer->GetCID())
-					continue;
 				pGrenade->Explode();
 				BombFound = true;
 			}
@@ -1521,10 +1507,8 @@ void CCharacter::FireWeapon()
 		{
 			// Find bomb
 			bool BombFound = false;
-			for (CMedicGrenade *pGrenade = (CMedicGrenade *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_MEDIC_GRENADE); pGrenade; pGrenade = (CMedicGrenade *)pGrenade->TypeNext())
+			for (CMedicGrenade *pGrenade = (CMedicGrenade *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_MEDIC_GRENADE); pGrenade; pGrenade = (CMedicGrenade *)pGrenade->OwnerNext())
 			{
-				if (pGrenade->m_Owner != m_pPlayer->GetCID())
-					continue;
 				pGrenade->Explode();
 				BombFound = true;
 			}
@@ -1694,10 +1678,8 @@ void CCharacter::FireWeapon()
 	{
 		if (GetClass() == PLAYERCLASS_BIOLOGIST)
 		{
-			for (CBiologistMine *pMine = (CBiologistMine *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_BIOLOGIST_MINE); pMine; pMine = (CBiologistMine *)pMine->TypeNext())
+			for (CBiologistMine *pMine = (CBiologistMine *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_BIOLOGIST_MINE); pMine; pMine = (CBiologistMine *)pMine->OwnerNext())
 			{
-				if (pMine->m_Owner != m_pPlayer->GetCID())
-					continue;
 				GameServer()->m_World.DestroyEntity(pMine);
 			}
 
@@ -3034,13 +3016,10 @@ void CCharacter::Tick()
 	if (GetClass() == PLAYERCLASS_ENGINEER)
 	{
 		CEngineerWall *pCurrentWall = NULL;
-		for (CEngineerWall *pWall = (CEngineerWall *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_ENGINEER_WALL); pWall; pWall = (CEngineerWall *)pWall->TypeNext())
+		for (CEngineerWall *pWall = (CEngineerWall *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_ENGINEER_WALL); pWall; pWall = (CEngineerWall *)pWall->OwnerNext())
 		{
-			if (pWall->m_Owner == m_pPlayer->GetCID())
-			{
-				pCurrentWall = pWall;
-				break;
-			}
+			pCurrentWall = pWall;
+			break;
 		}
 
 		if (pCurrentWall)
@@ -3056,13 +3035,10 @@ void CCharacter::Tick()
 	{
 		// Potential variable name conflict with engineerwall with pCurrentWall
 		CLooperWall *pCurrentWall = NULL;
-		for (CLooperWall *pWall = (CLooperWall *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_LOOPER_WALL); pWall; pWall = (CLooperWall *)pWall->TypeNext())
+		for (CLooperWall *pWall = (CLooperWall *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_LOOPER_WALL); pWall; pWall = (CLooperWall *)pWall->OwnerNext())
 		{
-			if (pWall->m_Owner == m_pPlayer->GetCID())
-			{
-				pCurrentWall = pWall;
-				break;
-			}
+			pCurrentWall = pWall;
+			break;
 		}
 
 		if (pCurrentWall)
@@ -3078,13 +3054,10 @@ void CCharacter::Tick()
 	{
 		CPoliceShield *pCurrentShield = NULL;
 
-		for (CPoliceShield *pShield = (CPoliceShield *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_POLICE_SHIELD); pShield; pShield = (CPoliceShield *)pShield->TypeNext())
+		for (CPoliceShield *pShield = (CPoliceShield *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_POLICE_SHIELD); pShield; pShield = (CPoliceShield *)pShield->OwnerNext())
 		{
-			if (pShield->m_Owner == m_pPlayer->GetCID())
-			{
-				pCurrentShield = pShield;
-				break;
-			}
+			pCurrentShield = pShield;
+			break;
 		}
 		if (GetInfWeaponID(m_ActiveWeapon) != INFWEAPON_POLICE_HAMMER)
 		{
@@ -3115,10 +3088,9 @@ void CCharacter::Tick()
 	else if (GetClass() == PLAYERCLASS_SOLDIER)
 	{
 		int NumBombs = 0;
-		for (CSoldierBomb *pBomb = (CSoldierBomb *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_SOLDIER_BOMB); pBomb; pBomb = (CSoldierBomb *)pBomb->TypeNext())
+		for (CSoldierBomb *pBomb = (CSoldierBomb *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_SOLDIER_BOMB); pBomb; pBomb = (CSoldierBomb *)pBomb->OwnerNext())
 		{
-			if (pBomb->m_Owner == m_pPlayer->GetCID())
-				NumBombs += pBomb->GetNbBombs();
+			NumBombs += pBomb->GetNbBombs();
 		}
 
 		if (NumBombs)
@@ -3131,21 +3103,13 @@ void CCharacter::Tick()
 	}
 	else if (GetClass() == PLAYERCLASS_SCIENTIST)
 	{
-		int NumMines = 0;
-		for (CScientistMine *pMine = (CScientistMine *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_SCIENTIST_MINE); pMine; pMine = (CScientistMine *)pMine->TypeNext())
-		{
-			if (pMine->m_Owner == m_pPlayer->GetCID())
-				NumMines++;
-		}
+		int NumMines = GameWorld()->CountOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_SCIENTIST_MINE);
 
 		CWhiteHole *pCurrentWhiteHole = NULL;
-		for (CWhiteHole *pWhiteHole = (CWhiteHole *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_WHITE_HOLE); pWhiteHole; pWhiteHole = (CWhiteHole *)pWhiteHole->TypeNext())
+		for (CWhiteHole *pWhiteHole = (CWhiteHole *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_WHITE_HOLE); pWhiteHole; pWhiteHole = (CWhiteHole *)pWhiteHole->OwnerNext())
 		{
-			if (pWhiteHole->m_Owner == m_pPlayer->GetCID())
-			{
-				pCurrentWhiteHole = pWhiteHole;
-				break;
-			}
+			pCurrentWhiteHole = pWhiteHole;
+			break;
 		}
 
 		// Reset superweapon kill counter, two seconds after whiteHole explosion
@@ -3192,12 +3156,7 @@ void CCharacter::Tick()
 	}
 	else if (GetClass() == PLAYERCLASS_BIOLOGIST)
 	{
-		int NumMines = 0;
-		for (CBiologistMine *pMine = (CBiologistMine *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_BIOLOGIST_MINE); pMine; pMine = (CBiologistMine *)pMine->TypeNext())
-		{
-			if (pMine->m_Owner == m_pPlayer->GetCID())
-				NumMines++;
-		}
+		int NumMines = GameWorld()->CountOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_BIOLOGIST_MINE);
 
 		if (NumMines > 0)
 		{
@@ -3218,13 +3177,10 @@ void CCharacter::Tick()
 	else if (GetClass() == PLAYERCLASS_REVIVER)
 	{
 		CHealBoom *pCurrentHealBoom = NULL;
-		for (CHealBoom *pHealBoom = (CHealBoom *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_HEAL_BOOM); pHealBoom; pHealBoom = (CHealBoom *)pHealBoom->TypeNext())
+		for (CHealBoom *pHealBoom = (CHealBoom *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_HEAL_BOOM); pHealBoom; pHealBoom = (CHealBoom *)pHealBoom->OwnerNext())
 		{
-			if (pHealBoom->m_Owner == m_pPlayer->GetCID())
-			{
-				pCurrentHealBoom = pHealBoom;
-				break;
-			}
+			pCurrentHealBoom = pHealBoom;
+			break;
 		}
 
 		// Reset superweapon kill counter, two seconds after whiteHole explosion
@@ -3290,13 +3246,10 @@ void CCharacter::Tick()
 	else if (GetClass() == PLAYERCLASS_MERCENARY)
 	{
 		CMercenaryBomb *pCurrentBomb = NULL;
-		for (CMercenaryBomb *pBomb = (CMercenaryBomb *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_MERCENARY_BOMB); pBomb; pBomb = (CMercenaryBomb *)pBomb->TypeNext())
+		for (CMercenaryBomb *pBomb = (CMercenaryBomb *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_MERCENARY_BOMB); pBomb; pBomb = (CMercenaryBomb *)pBomb->OwnerNext())
 		{
-			if (pBomb->m_Owner == m_pPlayer->GetCID())
-			{
-				pCurrentBomb = pBomb;
-				break;
-			}
+			pCurrentBomb = pBomb;
+			break;
 		}
 
 		if (pCurrentBomb)
@@ -3346,13 +3299,10 @@ void CCharacter::Tick()
 	else if(GetClass() == PLAYERCLASS_PHYSICIST)
 	{
 		CElasticHole *pCurrentElasticHole = NULL;
-		for (CElasticHole *pElasticHole = (CElasticHole *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_ELASTIC_HOLE); pElasticHole; pElasticHole = (CElasticHole *)pElasticHole->TypeNext())
+		for (CElasticHole *pElasticHole = (CElasticHole *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_ELASTIC_HOLE); pElasticHole; pElasticHole = (CElasticHole *)pElasticHole->OwnerNext())
 		{
-			if (pElasticHole->m_Owner == m_pPlayer->GetCID())
-			{
-				pCurrentElasticHole = pElasticHole;
-				break;
-			}
+			pCurrentElasticHole = pElasticHole;
+			break;
 		}
 
 		// Reset superweapon kill counter, two seconds after whiteHole explosion
@@ -3571,6 +3521,7 @@ void CCharacter::Die(int Killer, int Weapon)
 
 			m_Pos = m_JokerFlagPos;
 			m_Core.m_Pos = m_JokerFlagPos;
+			GameServer()->m_World.InvalidateCharacters();
 			m_Core.m_Vel = m_JokerDirection * 1.5f;
 
 			m_JokerFlagPos = vec2(0.f, 0.f);
@@ -4167,13 +4118,10 @@ void CCharacter::Snap(int SnappingClient)
 		if (pClient && pClient->IsHuman() && GetClass() == PLAYERCLASS_ENGINEER && !m_FirstShot)
 		{
 			CEngineerWall *pCurrentWall = NULL;
-			for (CEngineerWall *pWall = (CEngineerWall *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_ENGINEER_WALL); pWall; pWall = (CEngineerWall *)pWall->TypeNext())
+			for (CEngineerWall *pWall = (CEngineerWall *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_ENGINEER_WALL); pWall; pWall = (CEngineerWall *)pWall->OwnerNext())
 			{
-				if (pWall->m_Owner == m_pPlayer->GetCID())
-				{
-					pCurrentWall = pWall;
-					break;
-				}
+				pCurrentWall = pWall;
+				break;
 			}
 
 			if (!pCurrentWall)
@@ -4192,13 +4140,10 @@ void CCharacter::Snap(int SnappingClient)
 		if (pClient && pClient->IsHuman() && GetClass() == PLAYERCLASS_LOOPER && !m_FirstShot)
 		{
 			CLooperWall *pCurrentWall = NULL;
-			for (CLooperWall *pWall = (CLooperWall *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_LOOPER_WALL); pWall; pWall = (CLooperWall *)pWall->TypeNext())
+			for (CLooperWall *pWall = (CLooperWall *)GameWorld()->FindFirstOwned(m_pPlayer->GetCID(), CGameWorld::ENTTYPE_LOOPER_WALL); pWall; pWall = (CLooperWall *)pWall->OwnerNext())
 			{
-				if (pWall->m_Owner == m_pPlayer->GetCID())
-				{
-					pCurrentWall = pWall;
-					break;
-				}
+				pCurrentWall = pWall;
+				break;
 			}
 
 			if (!pCurrentWall)
@@ -5071,180 +5016,7 @@ void CCharacter::DestroyChildEntities()
 	m_NinjaStrengthBuff = 0;
 	m_NinjaAmmoBuff = 0;
 
-	for (CProjectile *pProjectile = (CProjectile *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_PROJECTILE); pProjectile; pProjectile = (CProjectile *)pProjectile->TypeNext())
-	{
-		if (pProjectile->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pProjectile);
-	}
-	for (CPoliceShield *pShield = (CPoliceShield *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_POLICE_SHIELD); pShield; pShield = (CPoliceShield *)pShield->TypeNext())
-	{
-		if (pShield->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pShield);
-	}
-	for (CEngineerWall *pWall = (CEngineerWall *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_ENGINEER_WALL); pWall; pWall = (CEngineerWall *)pWall->TypeNext())
-	{
-		if (pWall->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pWall);
-	}
-	for (CLooperWall *pWall = (CLooperWall *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_LOOPER_WALL); pWall; pWall = (CLooperWall *)pWall->TypeNext())
-	{
-		if (pWall->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pWall);
-	}
-	for (CSoldierBomb *pBomb = (CSoldierBomb *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_SOLDIER_BOMB); pBomb; pBomb = (CSoldierBomb *)pBomb->TypeNext())
-	{
-		if (pBomb->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pBomb);
-	}
-	for (CScatterGrenade *pGrenade = (CScatterGrenade *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_SCATTER_GRENADE); pGrenade; pGrenade = (CScatterGrenade *)pGrenade->TypeNext())
-	{
-		if (pGrenade->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pGrenade);
-	}
-	for (CMedicGrenade *pGrenade = (CMedicGrenade *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_MEDIC_GRENADE); pGrenade; pGrenade = (CMedicGrenade *)pGrenade->TypeNext())
-	{
-		if (pGrenade->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pGrenade);
-	}
-	for (COccultistGrenade *pGrenade = (COccultistGrenade *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_OCCULTIST_GRENADE); pGrenade; pGrenade = (COccultistGrenade *)pGrenade->TypeNext())
-	{
-		if (pGrenade->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pGrenade);
-	}
-	for (CElasticGrenade *pGrenade = (CElasticGrenade *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_ELASTIC_GRENADE); pGrenade; pGrenade = (CElasticGrenade *)pGrenade->TypeNext())
-	{
-		if (pGrenade->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pGrenade);
-	}
-	for (CReviverGrenade *pGrenade = (CReviverGrenade *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_REVIVER_GRENADE); pGrenade; pGrenade = (CReviverGrenade *)pGrenade->TypeNext())
-	{
-		if (pGrenade->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pGrenade);
-	}
-	for (CHealBoom *pHB = (CHealBoom *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_HEAL_BOOM); pHB; pHB = (CHealBoom *)pHB->TypeNext())
-	{
-		if (pHB->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pHB);
-	}
-	for (CMercenaryBomb *pBomb = (CMercenaryBomb *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_MERCENARY_BOMB); pBomb; pBomb = (CMercenaryBomb *)pBomb->TypeNext())
-	{
-		if (pBomb->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pBomb);
-	}
-	for (CScientistMine *pMine = (CScientistMine *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_SCIENTIST_MINE); pMine; pMine = (CScientistMine *)pMine->TypeNext())
-	{
-		if (pMine->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pMine);
-	}
-	for (CDefenceCircle *pCircle = (CDefenceCircle *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_DEFENCE_CIRCLE); pCircle; pCircle = (CDefenceCircle *)pCircle->TypeNext())
-	{
-		if (pCircle->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pCircle);
-	}
-	for (CBiologistMine *pMine = (CBiologistMine *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_BIOLOGIST_MINE); pMine; pMine = (CBiologistMine *)pMine->TypeNext())
-	{
-		if (pMine->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pMine);
-	}
-	for (CSlugSlime *pSlime = (CSlugSlime *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_SLUG_SLIME); pSlime; pSlime = (CSlugSlime *)pSlime->TypeNext())
-	{
-		if (pSlime->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pSlime);
-	}
-	for (CSlimeEntity *pSlime = (CSlimeEntity *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_SLIME_ENTITY); pSlime; pSlime = (CSlimeEntity *)pSlime->TypeNext())
-	{
-		if (pSlime->m_Owner != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pSlime);
-	}
-	for (CGrowingExplosion *pGrowiExpl = (CGrowingExplosion *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_GROWINGEXPLOSION); pGrowiExpl; pGrowiExpl = (CGrowingExplosion *)pGrowiExpl->TypeNext())
-	{
-		if (pGrowiExpl->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pGrowiExpl);
-	}
-	for (CWhiteHole *pWhiteHole = (CWhiteHole *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_WHITE_HOLE); pWhiteHole; pWhiteHole = (CWhiteHole *)pWhiteHole->TypeNext())
-	{
-		if (pWhiteHole->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pWhiteHole);
-	}
-	for (CElasticHole *pElasticHole = (CElasticHole *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_ELASTIC_HOLE); pElasticHole; pElasticHole = (CElasticHole *)pElasticHole->TypeNext())
-	{
-		if (pElasticHole->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pElasticHole);
-	}
-	for (CElasticEntity *pElasticEntity = (CElasticEntity *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_ELASTIC_ENTITY); pElasticEntity; pElasticEntity = (CElasticEntity *)pElasticEntity->TypeNext())
-	{
-		if (pElasticEntity->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pElasticEntity);
-	}
-	for (CSuperWeaponIndicator *pIndicator = (CSuperWeaponIndicator *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_SUPERWEAPON_INDICATOR); pIndicator; pIndicator = (CSuperWeaponIndicator *)pIndicator->TypeNext())
-	{
-		if (pIndicator->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pIndicator);
-	}
-	for (CTurret *pTurret = (CTurret *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_TURRET); pTurret; pTurret = (CTurret *)pTurret->TypeNext())
-	{
-		if (pTurret->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pTurret);
-	}
-	for (CPlasma *pPlasma = (CPlasma *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_PLASMA); pPlasma; pPlasma = (CPlasma *)pPlasma->TypeNext())
-	{
-		if (pPlasma->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pPlasma);
-	}
-	for (CPlasmaPlus *pPlasma = (CPlasmaPlus *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_PLASMA_PLUS); pPlasma; pPlasma = (CPlasmaPlus *)pPlasma->TypeNext())
-	{
-		if (pPlasma->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pPlasma);
-	}
-	for (CHeroFlag *pFlag = (CHeroFlag *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_HERO_FLAG); pFlag; pFlag = (CHeroFlag *)pFlag->TypeNext())
-	{
-		if (pFlag->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pFlag);
-	}
-	for (CFreezeMine *pMine = (CFreezeMine *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_FREEZE_MINE); pMine; pMine = (CFreezeMine *)pMine->TypeNext())
-	{
-		if (pMine->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pMine);
-	}
-	for(CSiegridHammer *pHammer = (CSiegridHammer *) GameWorld()->FindFirst(CGameWorld::ENTTYPE_SIEGRID_HAMMER); pHammer; pHammer = (CSiegridHammer *) pHammer->TypeNext())
-	{
-		if(pHammer->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pHammer);
-	}
-	for(CFlyingIon *pFlyingIon = (CFlyingIon *) GameWorld()->FindFirst(CGameWorld::ENTTYPE_FLYINGION); pFlyingIon; pFlyingIon = (CFlyingIon *) pFlyingIon->TypeNext())
-	{
-		if(pFlyingIon->GetOwner() != m_pPlayer->GetCID())
-			continue;
-		GameServer()->m_World.DestroyEntity(pFlyingIon);
-	}
+	GameWorld()->DestroyOwnedEntities(m_pPlayer->GetCID());
 
 	m_FirstShot = true;
 	m_HookMode = 0;
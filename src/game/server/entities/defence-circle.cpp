@@ -10,7 +10,7 @@
 #include "growingexplosion.h"
 
 CDefenceCircle::CDefenceCircle(CGameWorld *pGameWorld, vec2 Pos, int Owner)
-	: CEntity(pGameWorld, CGameWorld::ENTTYPE_DEFENCE_CIRCLE)
+	: CEntity(pGameWorld, CGameWorld::ENTTYPE_DEFENCE_CIRCLE, Owner)
 {
 	m_Pos = Pos;
 	GameWorld()->InsertEntity(this);
@@ -10,7 +10,7 @@
 #include "growingexplosion.h"
 
 CElasticEntity::CElasticEntity(CGameWorld *pGameWorld, vec2 CenterPos, vec2 Dir,int OwnerClientID)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_ELASTIC_ENTITY)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_ELASTIC_ENTITY, OwnerClientID)
 {
 	m_Pos = CenterPos;
 	m_ActualPos = CenterPos;
@@ -11,7 +11,7 @@
 #include "growingexplosion.h"
 
 CElasticGrenade::CElasticGrenade(CGameWorld *pGameWorld, int Owner, int Weapon, vec2 Pos, vec2 Dir)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_ELASTIC_GRENADE)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_ELASTIC_GRENADE, Owner)
 {
 	m_Pos = Pos;
 	m_ActualPos = Pos;
@@ -8,7 +8,7 @@
 #include "growingexplosion.h"
 
 CElasticHole::CElasticHole(CGameWorld *pGameWorld, vec2 CenterPos, int OwnerClientID, bool IsExplode, float MaxRadius)
-	: CEntity(pGameWorld, CGameWorld::ENTTYPE_ELASTIC_HOLE)
+	: CEntity(pGameWorld, CGameWorld::ENTTYPE_ELASTIC_HOLE, OwnerClientID)
 {
 	m_Pos = CenterPos;
 	GameWorld()->InsertEntity(this);
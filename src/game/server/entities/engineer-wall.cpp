@@ -12,7 +12,7 @@ const float g_BarrierMaxLength = 300.0;
 const float g_BarrierRadius = 0.0;
 
 CEngineerWall::CEngineerWall(CGameWorld *pGameWorld, vec2 Pos1, vec2 Pos2, int Owner)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_ENGINEER_WALL)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_ENGINEER_WALL, Owner)
 {
 	m_Pos = Pos1;
 	if(distance(Pos1, Pos2) > g_BarrierMaxLength)
@@ -53,54 +53,51 @@ void CEngineerWall::Tick()
 	else
 	{
 		// Find other players
-		for(CCharacter *p = (CCharacter*) GameWorld()->FindFirst(CGameWorld::ENTTYPE_CHARACTER); p; p = (CCharacter *)p->TypeNext())
+		const CCharacterMirror *pCharacters = GameWorld()->Characters();
+		for(int64 Mask = pCharacters->WithinSegment(m_Pos, m_Pos2, g_BarrierRadius, true, CCharacterMirror::FLAG_ZOMBIE); Mask; Mask &= Mask-1)
 		{
-			if(p->IsHuman()) continue;
+			CCharacter *p = pCharacters->First(Mask);
+			if(!p->IsAlive()) continue;
 
-			vec2 IntersectPos = closest_point_on_line(m_Pos, m_Pos2, p->m_Pos);
-			float Len = distance(p->m_Pos, IntersectPos);
-			if(Len < p->m_ProximityRadius+g_BarrierRadius)
+			if(p->GetPlayer())
 			{
-				if(p->GetPlayer())
+				for(CCharacter *pHook = (CCharacter*) GameWorld()->FindFirst(CGameWorld::ENTTYPE_CHARACTER); pHook; pHook = (CCharacter *)pHook->TypeNext())
 				{
-					for(CCharacter *pHook = (CCharacter*) GameWorld()->FindFirst(CGameWorld::ENTTYPE_CHARACTER); pHook; pHook = (CCharacter *)pHook->TypeNext())
+					
+					//skip classes that can't die.
+					if(p->GetClass() == PLAYERCLASS_UNDEAD && p->IsFrozen()) continue;
+					if(p->GetClass() == PLAYERCLASS_VOODOO && p->m_VoodooAboutToDie) continue;
+					
+					if(
+						pHook->GetPlayer() &&
+						pHook->IsHuman() &&
+						pHook->m_Core.m_HookedPlayer == p->GetPlayer()->GetCID() &&
+						pHook->GetPlayer()->GetCID() != m_Owner && //The engineer will get the point when the infected dies
+						p->m_LastFreezer != pHook->GetPlayer()->GetCID() //The ninja will get the point when the infected dies
+					)
 					{
-						
-						//skip classes that can't die.
-						if(p->GetClass() == PLAYERCLASS_UNDEAD && p->IsFrozen()) continue;
-						if(p->GetClass() == PLAYERCLASS_VOODOO && p->m_VoodooAboutToDie) continue;
-						
-						if(
-							pHook->GetPlayer() &&
-							pHook->IsHuman() &&
-							pHook->m_Core.m_HookedPlayer == p->GetPlayer()->GetCID() &&
-							pHook->GetPlayer()->GetCID() != m_Owner && //The engineer will get the point when the infected dies
-							p->m_LastFreezer != pHook->GetPlayer()->GetCID() //The ninja will get the point when the infected dies
-						)
-						{
-							int ClientID = pHook->GetPlayer()->GetCID();
-							Server()->RoundStatistics()->OnScoreEvent(ClientID, SCOREEVENT_HELP_HOOK_BARRIER, pHook->GetClass(), Server()->ClientName(ClientID), GameServer()->Console());
-							GameServer()->SendScoreSound(pHook->GetPlayer()->GetCID());
-						}
+						int ClientID = pHook->GetPlayer()->GetCID();
+						Server()->RoundStatistics()->OnScoreEvent(ClientID, SCOREEVENT_HELP_HOOK_BARRIER, pHook->GetClass(), Server()->ClientName(ClientID), GameServer()->Console());
+						GameServer()->SendScoreSound(pHook->GetPlayer()->GetCID());
 					}
+				}
+				
+				if(p->GetClass() != PLAYERCLASS_UNDEAD && p->GetClass() != PLAYERCLASS_VOODOO)
+				{
+					int LifeSpanReducer = ((Server()->TickSpeed()*g_Config.m_InfBarrierTimeReduce)/100);
+					m_WallFlashTicks = 10;
 					
-					if(p->GetClass() != PLAYERCLASS_UNDEAD && p->GetClass() != PLAYERCLASS_VOODOO)
+					if(p->GetClass() == PLAYERCLASS_GHOUL)
 					{
-						int LifeSpanReducer = ((Server()->TickSpeed()*g_Config.m_InfBarrierTimeReduce)/100);
-						m_WallFlashTicks = 10;
-						
-						if(p->GetClass() == PLAYERCLASS_GHOUL)
-						{
-							float Factor = p->GetPlayer()->GetGhoulPercent();
-							LifeSpanReducer += Server()->TickSpeed() * 5.0f * Factor;
-						}
-						
-						m_LifeSpan -= LifeSpanReducer;
+						float Factor = p->GetPlayer()->GetGhoulPercent();
+						LifeSpanReducer += Server()->TickSpeed() * 5.0f * Factor;
 					}
+					
+					m_LifeSpan -= LifeSpanReducer;
 				}
-				
-				p->Die(m_Owner, WEAPON_HAMMER);
 			}
+			
+			p->Die(m_Owner, WEAPON_HAMMER);
 		}
 	}
 }
@@ -4,7 +4,7 @@
 #include "flyingion.h"
 
 CFlyingIon::CFlyingIon(CGameWorld *pGameWorld, vec2 Pos, vec2 Vel, int Owner, int Radius)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_FLYINGION)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_FLYINGION, Owner)
 {
 	m_Pos = Pos;
     m_Radius = Radius;
@@ -5,7 +5,7 @@
 #include <game/server/gamecontext.h>
 
 CFreezeMine::CFreezeMine(CGameWorld *pGameWorld, vec2 Pos, int Owner, float Radius)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_FREEZE_MINE)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_FREEZE_MINE, Owner)
 {
     m_Pos = Pos;
 	m_ActualPos = Pos;
@@ -6,16 +6,11 @@
 #include <game/server/gamecontext.h>
 
 CGrowingExplosion::CGrowingExplosion(CGameWorld *pGameWorld, vec2 Pos, vec2 Dir, int Owner, int Radius, int ExplosionEffect, bool NoClip)
-		: CEntity(pGameWorld, CGameWorld::ENTTYPE_GROWINGEXPLOSION),
-		m_pGrowingMap(NULL),
-		m_pGrowingMapVec(NULL)
+		: CEntity(pGameWorld, CGameWorld::ENTTYPE_GROWINGEXPLOSION, Owner),
+		m_pGrowingMap(NULL)
 {
 	m_MaxGrowing = Radius;
 	m_GrowingMap_Length = (2*m_MaxGrowing+1);
-	m_GrowingMap_Size = (m_GrowingMap_Length*m_GrowingMap_Length);
-	
-	m_pGrowingMap = new int[m_GrowingMap_Size];
-	m_pGrowingMapVec = new vec2[m_GrowingMap_Size];
 	
 	m_Pos = Pos;
 	m_StartTick = Server()->Tick();
@@ -47,25 +42,9 @@ CGrowingExplosion::CGrowingExplosion(CGameWorld *pGameWorld, vec2 Pos, vec2 Dir,
 	m_SeedX = static_cast<int>(round(m_SeedPos.x))/32;
 	m_SeedY = static_cast<int>(round(m_SeedPos.y))/32;
 	
-	for(int j=0; j<m_GrowingMap_Length; j++)
-	{
-		for(int i=0; i<m_GrowingMap_Length; i++)
-		{
-			vec2 Tile = m_SeedPos + vec2(32.0f*(i-m_MaxGrowing), 32.0f*(j-m_MaxGrowing));
-			if((!m_NoClip && GameServer()->Collision()->CheckPoint(Tile)) || distance(Tile, m_SeedPos) > m_MaxGrowing*32.0f)
-			{
-				m_pGrowingMap[j*m_GrowingMap_Length+i] = -2;
-			}
-			else
-			{
-				m_pGrowingMap[j*m_GrowingMap_Length+i] = -1;
-			}
-			
-			m_pGrowingMapVec[j*m_GrowingMap_Length+i] = vec2(0.0f, 0.0f);
-		}
-	}
-	
-	m_pGrowingMap[m_MaxGrowing*m_GrowingMap_Length+m_MaxGrowing] = Server()->Tick();
+	//The tiles are only checked when the explosion reaches them
+	m_pGrowingMap = FloodFill()->AllocGrid(m_SeedPos, m_MaxGrowing, CFloodFill::FLAG_DISC|(m_NoClip ? CFloodFill::FLAG_NOCLIP : 0));
+	FloodFill()->Seed(m_pGrowingMap, m_pGrowingMap->Center(), Server()->Tick());
 	
 	switch(m_ExplosionEffect)
 	{
@@ -87,7 +66,7 @@ CGrowingExplosion::CGrowingExplosion(CGameWorld *pGameWorld, vec2 Pos, vec2 Dir,
 				//~ GameServer()->CreateHammerHit(m_SeedPos);
 					
 				vec2 EndPoint = m_SeedPos + vec2(-16.0f + random_float()*32.0f, -16.0f + random_float()*32.0f);
-				m_pGrowingMapVec[m_MaxGrowing*m_GrowingMap_Length+m_MaxGrowing] = EndPoint;
+				m_pGrowingMap->m_pData[m_pGrowingMap->Center()] = EndPoint;
 			}					
 			break;
 	}
@@ -97,15 +76,14 @@ CGrowingExplosion::~CGrowingExplosion()
 {
 	if(m_pGrowingMap)
 	{
-		delete[] m_pGrowingMap;
+		FloodFill()->FreeGrid(m_pGrowingMap);
 		m_pGrowingMap = NULL;
 	}
-		
-	if(m_pGrowingMapVec)
-	{
-		delete[] m_pGrowingMapVec;
-		m_pGrowingMapVec = NULL;
-	}
+}
+
+CFloodFill *CGrowingExplosion::FloodFill()
+{
+	return GameServer()->Collision()->FloodFill();
 }
 
 void CGrowingExplosion::Reset()
@@ -130,108 +108,104 @@ void CGrowingExplosion::Tick()
 		return;
 	}
 	
-	bool NewTile = false;
+	//Only the tiles reached during this tick are visited
+	int FirstNewTile = FloodFill()->Grow(m_pGrowingMap, tick);
+	bool NewTile = FirstNewTile < m_pGrowingMap->m_QueueEnd;
+	const int *pCells = m_pGrowingMap->m_pCells;
+	vec2 *pCellVecs = m_pGrowingMap->m_pData;
 	
-	for(int j=0; j<m_GrowingMap_Length; j++)
+	for(int q = FirstNewTile; q < m_pGrowingMap->m_QueueEnd; q++)
 	{
-		for(int i=0; i<m_GrowingMap_Length; i++)
+		int i = m_pGrowingMap->m_pQueue[q]%m_GrowingMap_Length;
+		int j = m_pGrowingMap->m_pQueue[q]/m_GrowingMap_Length;
+		
+		bool FromLeft = (i > 0 && pCells[j*m_GrowingMap_Length+i-1] < tick && pCells[j*m_GrowingMap_Length+i-1] >= 0);
+		bool FromRight = (i < m_GrowingMap_Length-1 && pCells[j*m_GrowingMap_Length+i+1] < tick && pCells[j*m_GrowingMap_Length+i+1] >= 0);
+		bool FromTop = (j > 0 && pCells[(j-1)*m_GrowingMap_Length+i] < tick && pCells[(j-1)*m_GrowingMap_Length+i] >= 0);
+		bool FromBottom = (j < m_GrowingMap_Length-1 && pCells[(j+1)*m_GrowingMap_Length+i] < tick && pCells[(j+1)*m_GrowingMap_Length+i] >= 0);
+		
+		vec2 TileCenter = m_SeedPos + vec2(32.0f*(i-m_MaxGrowing) - 16.0f + random_float()*32.0f, 32.0f*(j-m_MaxGrowing) - 16.0f + random_float()*32.0f);
+		switch(m_ExplosionEffect)
 		{
-			if(m_pGrowingMap[j*m_GrowingMap_Length+i] == -1)
-			{
-				bool FromLeft = (i > 0 && m_pGrowingMap[j*m_GrowingMap_Length+i-1] < tick && m_pGrowingMap[j*m_GrowingMap_Length+i-1] >= 0);
-				bool FromRight = (i < m_GrowingMap_Length-1 && m_pGrowingMap[j*m_GrowingMap_Length+i+1] < tick && m_pGrowingMap[j*m_GrowingMap_Length+i+1] >= 0);
-				bool FromTop = (j > 0 && m_pGrowingMap[(j-1)*m_GrowingMap_Length+i] < tick && m_pGrowingMap[(j-1)*m_GrowingMap_Length+i] >= 0);
-				bool FromBottom = (j < m_GrowingMap_Length-1 && m_pGrowingMap[(j+1)*m_GrowingMap_Length+i] < tick && m_pGrowingMap[(j+1)*m_GrowingMap_Length+i] >= 0);
-				
-				if(FromLeft || FromRight || FromTop || FromBottom)
+			case GROWINGEXPLOSIONEFFECT_FREEZE_INFECTED:
+			case GROWINGEXPLOSIONEFFECT_FREEZE_HUMAN:
+				if(random_prob(0.05f))
 				{
-					m_pGrowingMap[j*m_GrowingMap_Length+i] = tick;
-					NewTile = true;
-					vec2 TileCenter = m_SeedPos + vec2(32.0f*(i-m_MaxGrowing) - 16.0f + random_float()*32.0f, 32.0f*(j-m_MaxGrowing) - 16.0f + random_float()*32.0f);
-					switch(m_ExplosionEffect)
+					GameServer()->CreateHammerHit(TileCenter);
+				}
+				break;
+			case GROWINGEXPLOSIONEFFECT_POISON_INFECTED:
+				if(random_prob(0.05f))
+				{
+					GameServer()->CreateDeath(TileCenter, m_Owner);
+				}
+				break;
+			case GROWINGEXPLOSIONEFFECT_HEAL_HUMANS:
+				if(random_prob(0.05f))
+				{
+					GameServer()->CreateDeath(TileCenter, m_Owner);
+				}
+				break;
+			case GROWINGEXPLOSIONEFFECT_LOVE_INFECTED:
+				if(random_prob(0.2f))
+				{
+					GameServer()->CreateLoveEvent(TileCenter);
+				}
+				break;
+			case GROWINGEXPLOSIONEFFECT_BOOM_INFECTED:
+				if (random_prob(0.2f))
+				{
+					GameServer()->CreateExplosion(TileCenter, m_Owner, WEAPON_HAMMER, false, TAKEDAMAGEMODE_NOINFECTION);
+				}
+				break;
+			case GROWINGEXPLOSIONEFFECT_MERC_INFECTED:
+				if (random_prob(0.2f))
+				{
+					GameServer()->CreateExplosion(TileCenter, m_Owner, WEAPON_HAMMER, false, TAKEDAMAGEMODE_SELFHARM);
+				}
+				break;
+			case GROWINGEXPLOSIONEFFECT_ELECTRIC_INFECTED:
+				{
+					vec2 EndPoint = m_SeedPos + vec2(32.0f*(i-m_MaxGrowing) - 16.0f + random_float()*32.0f, 32.0f*(j-m_MaxGrowing) - 16.0f + random_float()*32.0f);
+					pCellVecs[j*m_GrowingMap_Length+i] = EndPoint;
+					
+					int NumPossibleStartPoint = 0;
+					vec2 PossibleStartPoint[4];
+					
+					if(FromLeft)
 					{
-						case GROWINGEXPLOSIONEFFECT_FREEZE_INFECTED:
-						case GROWINGEXPLOSIONEFFECT_FREEZE_HUMAN:
-							if(random_prob(0.05f))
-							{
-								GameServer()->CreateHammerHit(TileCenter);
-							}
-							break;
-						case GROWINGEXPLOSIONEFFECT_POISON_INFECTED:
-							if(random_prob(0.05f))
-							{
-								GameServer()->CreateDeath(TileCenter, m_Owner);
-							}
-							break;
-						case GROWINGEXPLOSIONEFFECT_HEAL_HUMANS:
-							if(random_prob(0.05f))
-							{
-								GameServer()->CreateDeath(TileCenter, m_Owner);
-							}
-							break;
-						case GROWINGEXPLOSIONEFFECT_LOVE_INFECTED:
-							if(random_prob(0.2f))
-							{
-								GameServer()->CreateLoveEvent(TileCenter);
-							}
-							break;
-						case GROWINGEXPLOSIONEFFECT_BOOM_INFECTED:
-							if (random_prob(0.2f))
-							{
-								GameServer()->CreateExplosion(TileCenter, m_Owner, WEAPON_HAMMER, false, TAKEDAMAGEMODE_NOINFECTION);
-							}
-							break;
-						case GROWINGEXPLOSIONEFFECT_MERC_INFECTED:
-							if (random_prob(0.2f))
-							{
-								GameServer()->CreateExplosion(TileCenter, m_Owner, WEAPON_HAMMER, false, TAKEDAMAGEMODE_SELFHARM);
-							}
-							break;
-						case GROWINGEXPLOSIONEFFECT_ELECTRIC_INFECTED:
-							{
-								vec2 EndPoint = m_SeedPos + vec2(32.0f*(i-m_MaxGrowing) - 16.0f + random_float()*32.0f, 32.0f*(j-m_MaxGrowing) - 16.0f + random_float()*32.0f);
-								m_pGrowingMapVec[j*m_GrowingMap_Length+i] = EndPoint;
-								
-								int NumPossibleStartPoint = 0;
-								vec2 PossibleStartPoint[4];
-								
-								if(FromLeft)
-								{
-									PossibleStartPoint[NumPossibleStartPoint] = m_pGrowingMapVec[j*m_GrowingMap_Length+i-1];
-									NumPossibleStartPoint++;
-								}
-								if(FromRight)
-								{
-									PossibleStartPoint[NumPossibleStartPoint] = m_pGrowingMapVec[j*m_GrowingMap_Length+i+1];
-									NumPossibleStartPoint++;
-								}
-								if(FromTop)
-								{
-									PossibleStartPoint[NumPossibleStartPoint] = m_pGrowingMapVec[(j-1)*m_GrowingMap_Length+i];
-									NumPossibleStartPoint++;
-								}
-								if(FromBottom)
-								{
-									PossibleStartPoint[NumPossibleStartPoint] = m_pGrowingMapVec[(j+1)*m_GrowingMap_Length+i];
-									NumPossibleStartPoint++;
-								}
-								
-								if(NumPossibleStartPoint > 0)
-								{
-									int randNb = random_int(0, NumPossibleStartPoint-1);
-									vec2 StartPoint = PossibleStartPoint[randNb];
-									GameServer()->CreateLaserDotEvent(StartPoint, EndPoint, Server()->TickSpeed()/6);
-								}
-								
-								if(random_prob(0.05f))
-								{
-									GameServer()->CreateSound(EndPoint, SOUND_RIFLE_BOUNCE);
-								}
-							}
-							break;
+						PossibleStartPoint[NumPossibleStartPoint] = pCellVecs[j*m_GrowingMap_Length+i-1];
+						NumPossibleStartPoint++;
+					}
+					if(FromRight)
+					{
+						PossibleStartPoint[NumPossibleStartPoint] = pCellVecs[j*m_GrowingMap_Length+i+1];
+						NumPossibleStartPoint++;
+					}
+					if(FromTop)
+					{
+						PossibleStartPoint[NumPossibleStartPoint] = pCellVecs[(j-1)*m_GrowingMap_Length+i];
+						NumPossibleStartPoint++;
+					}
+					if(FromBottom)
+					{
+						PossibleStartPoint[NumPossibleStartPoint] = pCellVecs[(j+1)*m_GrowingMap_Length+i];
+						NumPossibleStartPoint++;
+					}
+					
+					if(NumPossibleStartPoint > 0)
+					{
+						int randNb = random_int(0, NumPossibleStartPoint-1);
+						vec2 StartPoint = PossibleStartPoint[randNb];
+						GameServer()->CreateLaserDotEvent(StartPoint, EndPoint, Server()->TickSpeed()/6);
+					}
+					
+					if(random_prob(0.05f))
+					{
+						GameServer()->CreateSound(EndPoint, SOUND_RIFLE_BOUNCE);
 					}
 				}
-			}
+				break;
 		}
 	}
 	
@@ -262,9 +236,9 @@ void CGrowingExplosion::Tick()
 		
 		int k = tileY*m_GrowingMap_Length+tileX;
 
-		if((m_pGrowingMap[k] >= 0) && p->IsHuman())
+		if((pCells[k] >= 0) && p->IsHuman())
 		{
-			if(tick - m_pGrowingMap[k] < Server()->TickSpeed()/4)
+			if(tick - pCells[k] < Server()->TickSpeed()/4)
 			{
 				switch(m_ExplosionEffect)
 				{
@@ -285,9 +259,9 @@ void CGrowingExplosion::Tick()
 		if(p->IsHuman())
 			continue;
 
-		if(m_pGrowingMap[k] >= 0)
+		if(pCells[k] >= 0)
 		{
-			if(tick - m_pGrowingMap[k] < Server()->TickSpeed()/4)
+			if(tick - pCells[k] < Server()->TickSpeed()/4)
 			{
 				switch(m_ExplosionEffect)
 				{
@@ -344,9 +318,9 @@ void CGrowingExplosion::Tick()
 				continue;
 				
 			int k = tileY*m_GrowingMap_Length+tileX;
-			if(m_pGrowingMap[k] >= 0)
+			if(pCells[k] >= 0)
 			{
-				if(tick - m_pGrowingMap[k] < Server()->TickSpeed()/4)
+				if(tick - pCells[k] < Server()->TickSpeed()/4)
 				{
 					e->Reset();
 				}
@@ -2,6 +2,7 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
 #include <engine/shared/config.h>
+#include <game/floodfill.h>
 #include <game/server/entity.h>
 
 #ifndef GAME_SERVER_ENTITIES_GROWINGEXP_H
@@ -32,17 +33,17 @@ public:
 	int GetOwner() const;
 
 private:
+	CFloodFill *FloodFill();
+
 	int m_MaxGrowing;
 	int m_GrowingMap_Length;
-	int m_GrowingMap_Size;
 	
 	int m_Owner;
 	vec2 m_SeedPos;
 	int m_SeedX;
 	int m_SeedY;
 	int m_StartTick;
-	int* m_pGrowingMap;
-	vec2* m_pGrowingMapVec;
+	CFloodFill::CGrid *m_pGrowingMap; // tick at which each tile was reached, electric end points as data
 	int m_ExplosionEffect;
 	bool m_Hit[MAX_CLIENTS];
 
@@ -9,7 +9,7 @@
 #include <engine/server/roundstatistics.h>
 
 CHealBoom::CHealBoom(CGameWorld *pGameWorld, vec2 CenterPos, int OwnerClientID)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_HEAL_BOOM)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_HEAL_BOOM, OwnerClientID)
 {
 	m_Pos = CenterPos;
 	GameWorld()->InsertEntity(this);
@@ -6,14 +6,16 @@
 #include "hero-flag.h"
 
 CHeroFlag::CHeroFlag(CGameWorld *pGameWorld, int ClientID)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_HERO_FLAG)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_HERO_FLAG, ClientID)
 {
 	m_ProximityRadius = ms_PhysSize;
 	m_OwnerID = ClientID;
 	m_CoolDownTick = 0;
+	int FirstID = Server()->SnapNewIDRange(CHeroFlag::SHIELD_COUNT, m_ID);
+	m_IDRange = FirstID >= 0;
 	for(int i=0; i<CHeroFlag::SHIELD_COUNT; i++)
 	{
-		m_IDs[i] = Server()->SnapNewID();
+		m_IDs[i] = m_IDRange ? FirstID+i : Server()->SnapNewID();
 	}
 	FindPosition();
 	GameWorld()->InsertEntity(this);
@@ -21,9 +23,12 @@ CHeroFlag::CHeroFlag(CGameWorld *pGameWorld, int ClientID)
 
 CHeroFlag::~CHeroFlag()
 {
-	for(int i=0; i<CHeroFlag::SHIELD_COUNT; i++)
+	if(m_IDRange)
+		Server()->SnapFreeIDRange(m_IDs[0], CHeroFlag::SHIELD_COUNT);
+	else
 	{
-		Server()->SnapFreeID(m_IDs[i]);
+		for(int i=0; i<CHeroFlag::SHIELD_COUNT; i++)
+			Server()->SnapFreeID(m_IDs[i]);
 	}
 }
 
@@ -19,6 +19,7 @@ private:
 	int m_CoolDownTick;
 	int m_OwnerID;
 	int m_IDs[SHIELD_COUNT];
+	bool m_IDRange; // false if the ids were taken one by one
 
 public:
 	static const int ms_PhysSize = 14;
@@ -8,7 +8,7 @@
 #include "looper-wall.h"
 
 CLooperWall::CLooperWall(CGameWorld *pGameWorld, vec2 Pos1, vec2 Pos2, int Owner)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_LOOPER_WALL)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_LOOPER_WALL, Owner)
 {
 	m_Pos = Pos1;
 	if(distance(Pos1, Pos2) > g_BarrierMaxLength)
@@ -71,35 +71,31 @@ void CLooperWall::Tick()
 	else
 	{
 		// Find other players
-		for(CCharacter *p = (CCharacter*) GameWorld()->FindFirst(CGameWorld::ENTTYPE_CHARACTER); p; p = (CCharacter *)p->TypeNext())
+		const CCharacterMirror *pCharacters = GameWorld()->Characters();
+		for(int64 Mask = pCharacters->WithinSegment(m_Pos, m_Pos2, g_BarrierRadius, true, CCharacterMirror::FLAG_ZOMBIE); Mask; Mask &= Mask-1)
 		{
-			if(p->IsHuman()) continue;
+			CCharacter *p = pCharacters->First(Mask);
 
-			vec2 IntersectPos = closest_point_on_line(m_Pos, m_Pos2, p->m_Pos);
-			float Len = distance(p->m_Pos, IntersectPos);
-			if(Len < p->m_ProximityRadius+g_BarrierRadius)
+			if(p->GetPlayer())
 			{
-				if(p->GetPlayer())
+				int LifeSpanReducer = ((Server()->TickSpeed()*g_Config.m_InfLooperBarrierTimeReduce)/100);
+				if(!p->IsInSlowMotion()) 
 				{
-					int LifeSpanReducer = ((Server()->TickSpeed()*g_Config.m_InfLooperBarrierTimeReduce)/100);
-					if(!p->IsInSlowMotion()) 
+					if(p->GetClass() == PLAYERCLASS_GHOUL)
 					{
-						if(p->GetClass() == PLAYERCLASS_GHOUL)
-						{
-							float Factor = p->GetPlayer()->GetGhoulPercent();
-							LifeSpanReducer += Server()->TickSpeed() * 5.0f * Factor;
-						}
-							
-						m_LifeSpan -= LifeSpanReducer;
+						float Factor = p->GetPlayer()->GetGhoulPercent();
+						LifeSpanReducer += Server()->TickSpeed() * 5.0f * Factor;
 					}
+						
+					m_LifeSpan -= LifeSpanReducer;
 				}
+			}
 
-				//Slow-Motion modification here
-				if (!p->IsInSlowMotion())
-				{
-					p->SlowMotionEffect(g_Config.m_InfSlowMotionWallDuration);
-					GameServer()->SendEmoticon(p->GetPlayer()->GetCID(), EMOTICON_EXCLAMATION);			  
-				}
+			//Slow-Motion modification here
+			if (!p->IsInSlowMotion())
+			{
+				p->SlowMotionEffect(g_Config.m_InfSlowMotionWallDuration);
+				GameServer()->SendEmoticon(p->GetPlayer()->GetCID(), EMOTICON_EXCLAMATION);			  
 			}
 		}
 	}
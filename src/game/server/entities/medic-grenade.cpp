@@ -7,7 +7,7 @@
 #include "medic-grenade.h"
 
 CMedicGrenade::CMedicGrenade(CGameWorld *pGameWorld, int Owner, vec2 Pos, vec2 Dir)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_MEDIC_GRENADE)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_MEDIC_GRENADE, Owner)
 {
 	m_Pos = Pos;
 	m_ActualPos = Pos;
@@ -7,7 +7,7 @@
 #include "scatter-grenade.h"
 
 CMercenaryBomb::CMercenaryBomb(CGameWorld *pGameWorld, vec2 Pos, int Owner)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_MERCENARY_BOMB)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_MERCENARY_BOMB, Owner)
 {
 	m_Pos = Pos;
 	GameWorld()->InsertEntity(this);
@@ -50,25 +50,20 @@ void CMercenaryBomb::Tick()
 	
 	// Find other players
 	bool MustExplode = false;
-	for(CCharacter *p = (CCharacter*) GameWorld()->FindFirst(CGameWorld::ENTTYPE_CHARACTER); p; p = (CCharacter *)p->TypeNext())
+	const CCharacterMirror *pCharacters = GameWorld()->Characters();
+	for(int64 Mask = pCharacters->WithinRadius(m_Pos, 80.0f, true, CCharacterMirror::FLAG_ZOMBIE); Mask; Mask &= Mask-1)
 	{
-		if(p->IsHuman()) continue;
+		CCharacter *p = pCharacters->First(Mask);
 		if(p->GetClass() == PLAYERCLASS_UNDEAD && p->IsFrozen()) continue;
 		if(p->GetClass() == PLAYERCLASS_VOODOO && p->m_VoodooAboutToDie) continue;
 
-		float Len = distance(p->m_Pos, m_Pos);
-		if(Len < p->m_ProximityRadius+80.0f)
-		{
-			MustExplode = true;
-			break;
-		}
+		MustExplode = true;
+		break;
 	}
 	if( m_Damage < g_Config.m_InfMercBombs )
 	{
-		for(CScatterGrenade *p = (CScatterGrenade*) GameWorld()->FindFirst(CGameWorld::ENTTYPE_SCATTER_GRENADE); p; p = (CScatterGrenade *)p->TypeNext())
+		for(CScatterGrenade *p = (CScatterGrenade*) GameWorld()->FindFirstOwned(m_Owner, CGameWorld::ENTTYPE_SCATTER_GRENADE); p; p = (CScatterGrenade *)p->OwnerNext())
 		{
-			if(p->m_Owner != m_Owner)continue;
-
 			float Len = distance(p->m_ActualPos, m_Pos);
 			if(Len < 80.0f)
 			{
@@ -9,7 +9,7 @@
 
 
 COccultistGrenade::COccultistGrenade(CGameWorld *pGameWorld, int Owner, vec2 Pos, vec2 Dir)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_OCCULTIST_GRENADE)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_OCCULTIST_GRENADE, Owner)
 {
 	m_Pos = Pos;
 	m_Owner = Owner;
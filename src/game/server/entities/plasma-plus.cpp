@@ -7,7 +7,7 @@
 #include "plasma-plus.h"
 
 CPlasmaPlus::CPlasmaPlus(CGameWorld *pGameWorld, vec2 Pos, int Owner, vec2 Direction, bool Freeze, bool Explosive)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_PLASMA_PLUS)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_PLASMA_PLUS, Owner)
 {
 	m_Owner = Owner;
 	m_Pos = Pos;
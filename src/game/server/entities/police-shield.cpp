@@ -7,7 +7,7 @@
 #include <engine/shared/config.h>
 
 CPoliceShield::CPoliceShield(CGameWorld *pGameWorld, int Owner)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_POLICE_SHIELD)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_POLICE_SHIELD, Owner)
 {
 	m_Owner = Owner;
 	m_ExplodeTick = 0;
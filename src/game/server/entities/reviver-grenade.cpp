@@ -9,7 +9,7 @@
 #include "reviver-grenade.h"
 
 CReviverGrenade::CReviverGrenade(CGameWorld *pGameWorld, int Owner, vec2 Pos, vec2 Dir)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_REVIVER_GRENADE)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_REVIVER_GRENADE, Owner)
 {
 	m_Pos = Pos;
 	m_ActualPos = Pos;
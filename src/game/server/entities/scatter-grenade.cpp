@@ -9,7 +9,7 @@
 #include "scatter-grenade.h"
 
 CScatterGrenade::CScatterGrenade(CGameWorld *pGameWorld, int Owner, vec2 Pos, vec2 Dir)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_SCATTER_GRENADE)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_SCATTER_GRENADE, Owner)
 {
 	m_Pos = Pos;
 	m_ActualPos = Pos;
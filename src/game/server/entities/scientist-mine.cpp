@@ -8,7 +8,7 @@
 #include "growingexplosion.h"
 
 CScientistMine::CScientistMine(CGameWorld *pGameWorld, vec2 Pos, int Owner)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_SCIENTIST_MINE)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_SCIENTIST_MINE, Owner)
 {
 	m_Pos = Pos;
 	GameWorld()->InsertEntity(this);
@@ -119,23 +119,20 @@ void CScientistMine::Tick()
 	// Find other players
 	bool MustExplode = false;
 	int DetonatedBy;
-	for(CCharacter *p = (CCharacter*) GameWorld()->FindFirst(CGameWorld::ENTTYPE_CHARACTER); p; p = (CCharacter *)p->TypeNext())
+	const CCharacterMirror *pCharacters = GameWorld()->Characters();
+	for(int64 Mask = pCharacters->WithinRadius(m_Pos, g_Config.m_InfMineRadius, true, CCharacterMirror::FLAG_ZOMBIE); Mask; Mask &= Mask-1)
 	{
-		if(p->IsHuman()) continue;
+		CCharacter *p = pCharacters->First(Mask);
 		if(p->GetClass() == PLAYERCLASS_UNDEAD && p->IsFrozen()) continue;
 		if(p->GetClass() == PLAYERCLASS_VOODOO && p->m_VoodooAboutToDie) continue;
 
-		float Len = distance(p->m_Pos, m_Pos);
-		if(Len < p->m_ProximityRadius+g_Config.m_InfMineRadius)
-		{
-			MustExplode = true;
-			CPlayer *pDetonatedBy = p->GetPlayer();
-			if (pDetonatedBy)
-				DetonatedBy = pDetonatedBy->GetCID();
-			else
-				DetonatedBy = m_Owner;
-			break;
-		}
+		MustExplode = true;
+		CPlayer *pDetonatedBy = p->GetPlayer();
+		if (pDetonatedBy)
+			DetonatedBy = pDetonatedBy->GetCID();
+		else
+			DetonatedBy = m_Owner;
+		break;
 	}
 	
 	if(MustExplode)
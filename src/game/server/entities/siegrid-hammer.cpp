@@ -9,7 +9,7 @@
 const float dt = 0.01f;
 
 CSiegridHammer::CSiegridHammer(CGameWorld *pGameWorld, int Owner, vec2 Pos)
-    : CEntity(pGameWorld, CGameWorld::ENTTYPE_SIEGRID_HAMMER)
+    : CEntity(pGameWorld, CGameWorld::ENTTYPE_SIEGRID_HAMMER, Owner)
 {
     m_Owner = Owner;
     m_Anchor = Pos;
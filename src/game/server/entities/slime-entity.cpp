@@ -10,7 +10,7 @@
 #include "growingexplosion.h"
 
 CSlimeEntity::CSlimeEntity(CGameWorld *pGameWorld, int Owner, vec2 Pos, vec2 Dir)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_SLIME_ENTITY)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_SLIME_ENTITY, Owner)
 {
 	m_Pos = Pos;
 	m_ActualPos = Pos;
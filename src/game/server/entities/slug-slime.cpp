@@ -6,7 +6,7 @@
 #include "slug-slime.h"
 
 CSlugSlime::CSlugSlime(CGameWorld *pGameWorld, vec2 Pos, int Owner)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_SLUG_SLIME)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_SLUG_SLIME, Owner)
 {
 	m_Pos = Pos;
 	m_Owner = Owner;
@@ -6,7 +6,7 @@
 #include "projectile.h"
 
 CSoldierBomb::CSoldierBomb(CGameWorld *pGameWorld, vec2 Pos, int Owner)
-	: CEntity(pGameWorld, CGameWorld::ENTTYPE_SOLDIER_BOMB)
+	: CEntity(pGameWorld, CGameWorld::ENTTYPE_SOLDIER_BOMB, Owner)
 {
 	m_Pos = Pos;
 	GameWorld()->InsertEntity(this);
@@ -38,9 +38,9 @@ void CSoldierBomb::Tick()
 {
 	if (m_nbBomb < m_nbMaxBomb)
 	{
-		for (CProjectile *p = (CProjectile *)GameWorld()->FindFirst(CGameWorld::ENTTYPE_PROJECTILE); p; p = (CProjectile *)p->TypeNext())
+		for (CProjectile *p = (CProjectile *)GameWorld()->FindFirstOwned(m_Owner, CGameWorld::ENTTYPE_PROJECTILE); p; p = (CProjectile *)p->OwnerNext())
 		{
-			if (p->GetOwner() != m_Owner || p->GetType() != WEAPON_GRENADE)
+			if (p->GetType() != WEAPON_GRENADE)
 				continue;
 
 			float Len = distance(p->m_ActualPos, m_Pos);
@@ -5,7 +5,7 @@
 #include "superweapon-indicator.h"
 
 CSuperWeaponIndicator::CSuperWeaponIndicator(CGameWorld *pGameWorld, vec2 Pos, int Owner)
-	: CEntity(pGameWorld, CGameWorld::ENTTYPE_SUPERWEAPON_INDICATOR)
+	: CEntity(pGameWorld, CGameWorld::ENTTYPE_SUPERWEAPON_INDICATOR, Owner)
 {
 	m_Pos = Pos;
 	GameWorld()->InsertEntity(this);
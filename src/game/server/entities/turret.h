@@ -37,6 +37,7 @@ private:
 	bool m_foundTarget;
 	
 	array<int> m_IDs;
+	bool m_IDRange; // false if the ids were taken one by one
 
 	int m_LifeSpan;
 
@@ -1,13 +1,18 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.				*/
+#include <base/detect.h>
 #include <game/server/gamecontext.h>
 #include <engine/shared/config.h>
 
+#if defined(CONF_ARCH_AMD64)
+#include <emmintrin.h>
+#endif
+
 #include "white-hole.h"
 #include "growingexplosion.h"
 
 CWhiteHole::CWhiteHole(CGameWorld *pGameWorld, vec2 CenterPos, int OwnerClientID)
-: CEntity(pGameWorld, CGameWorld::ENTTYPE_WHITE_HOLE)
+: CEntity(pGameWorld, CGameWorld::ENTTYPE_WHITE_HOLE, OwnerClientID)
 {
 	m_Pos = CenterPos;
 	GameWorld()->InsertEntity(this);
@@ -19,12 +24,23 @@ CWhiteHole::CWhiteHole(CGameWorld *pGameWorld, vec2 CenterPos, int OwnerClientID
 	m_PlayerPullStrength = g_Config.m_InfWhiteHolePullStrength/10.0f;
 
 	m_NumParticles = g_Config.m_InfWhiteHoleNumParticles;
-	m_IDs = new int[m_NumParticles];
-	m_ParticlePos = new vec2[m_NumParticles];
-	m_ParticleVec = new vec2[m_NumParticles];
-	for(int i=0; i<m_NumParticles; i++)
+	m_NumParticleSlots = (m_NumParticles+PARTICLE_BLOCK-1)/PARTICLE_BLOCK*PARTICLE_BLOCK;
+	m_FirstParticleID = Server()->SnapNewIDRange(m_NumParticles, m_ID);
+
+	// mem_alloc does not align, so take 15 more bytes and align the first array by hand
+	m_pParticleData = mem_alloc(4*m_NumParticleSlots*sizeof(float)+15, 16);
+	m_pParticleX = (float *)(((size_t)m_pParticleData+15)&~(size_t)15);
+	m_pParticleY = m_pParticleX + m_NumParticleSlots;
+	m_pParticleVelX = m_pParticleY + m_NumParticleSlots;
+	m_pParticleVelY = m_pParticleVelX + m_NumParticleSlots;
+
+	// the padding particles stay out of the map and never move
+	for(int i=m_NumParticles; i<m_NumParticleSlots; i++)
 	{
-		m_IDs[i] = Server()->SnapNewID();
+		m_pParticleX[i] = -99999.0f;
+		m_pParticleY[i] = -99999.0f;
+		m_pParticleVelX[i] = 0.0f;
+		m_pParticleVelY[i] = 0.0f;
 	}
 	
 	StartVisualEffect();
@@ -32,13 +48,9 @@ CWhiteHole::CWhiteHole(CGameWorld *pGameWorld, vec2 CenterPos, int OwnerClientID
 
 CWhiteHole::~CWhiteHole()
 {
-	for(int i=0; i<m_NumParticles; i++)
-	{
-		Server()->SnapFreeID(m_IDs[i]);
-	}
-	delete[] m_IDs;
-	delete[] m_ParticlePos;
-	delete[] m_ParticleVec;
+	if(m_FirstParticleID >= 0)
+		Server()->SnapFreeIDRange(m_FirstParticleID, m_NumParticles);
+	mem_free(m_pParticleData);
 }
 
 void CWhiteHole::Reset()
@@ -62,8 +74,10 @@ void CWhiteHole::StartVisualEffect()
 		RandomAngle = 2.0f * pi * random_float();
 		VecX = cos(RandomAngle);
 		VecY = sin(RandomAngle);
-		m_ParticlePos[i] = m_Pos + vec2(RandomRadius * VecX, RandomRadius * VecY);
-		m_ParticleVec[i] = vec2(-VecX, -VecY);
+		m_pParticleX[i] = m_Pos.x + RandomRadius * VecX;
+		m_pParticleY[i] = m_Pos.y + RandomRadius * VecY;
+		m_pParticleVelX[i] = -VecX;
+		m_pParticleVelY[i] = -VecY;
 	}
 	// find out how long it takes for a particle to reach the mid
 	RandomRadius = random_float()*(Radius-4.0f);
@@ -90,7 +104,7 @@ void CWhiteHole::StartVisualEffect()
 // Draw ParticleEffect
 void CWhiteHole::Snap(int SnappingClient)
 {
-	if(IsDontSnapEntity(SnappingClient))
+	if(IsDontSnapEntity(SnappingClient) || m_FirstParticleID < 0)
 		return;
 	// Draw AntiPing white hole effect
 	if (Server()->GetClientAntiPing(SnappingClient)) {	
@@ -102,7 +116,7 @@ void CWhiteHole::Snap(int SnappingClient)
 			vec2 PartPosStart = m_Pos + vec2(Radius * cos(AngleStep*i), Radius * sin(AngleStep*i));
 			vec2 PartPosEnd = m_Pos + vec2(Radius * cos(AngleStep*(i+1)), Radius * sin(AngleStep*(i+1)));
 		
-			CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(Server()->SnapNewItem(NETOBJTYPE_LASER, m_IDs[i], sizeof(CNetObj_Laser)));
+			CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(Server()->SnapNewItem(NETOBJTYPE_LASER, m_FirstParticleID+i, sizeof(CNetObj_Laser)));
 			if(!pObj)
 				return;
 
@@ -116,15 +130,29 @@ void CWhiteHole::Snap(int SnappingClient)
 	}
 
 	// Draw full particle effect - if anti ping is not set to true
-	for(int i=0; i<m_NumParticles; i++)
+	// far away clients get an even subset of the particles, they can hardly tell them apart anyway
+	int Stride = 1;
+	if(SnappingClient >= 0)
+	{
+		float Distance = distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, m_Pos);
+		if(Distance > (float)LOD_FAR_DISTANCE)
+			Stride = 4;
+		else if(Distance > (float)LOD_NEAR_DISTANCE)
+			Stride = 2;
+	}
+
+	float RadiusSquared = (float)m_Radius*m_Radius;
+	for(int i=0; i<m_NumParticles; i+=Stride)
 	{
-		if (!isDieing && distance(m_ParticlePos[i], m_Pos) > m_Radius) continue; // start animation
+		float DiffX = m_pParticleX[i] - m_Pos.x;
+		float DiffY = m_pParticleY[i] - m_Pos.y;
+		if (!isDieing && DiffX*DiffX+DiffY*DiffY > RadiusSquared) continue; // start animation
 
-		CNetObj_Projectile *pObj = static_cast<CNetObj_Projectile *>(Server()->SnapNewItem(NETOBJTYPE_PROJECTILE, m_IDs[i], sizeof(CNetObj_Projectile)));
+		CNetObj_Projectile *pObj = static_cast<CNetObj_Projectile *>(Server()->SnapNewItem(NETOBJTYPE_PROJECTILE, m_FirstParticleID+i, sizeof(CNetObj_Projectile)));
 		if(pObj)
 		{
-			pObj->m_X = (int)m_ParticlePos[i].x;
-			pObj->m_Y = (int)m_ParticlePos[i].y;
+			pObj->m_X = (int)m_pParticleX[i];
+			pObj->m_Y = (int)m_pParticleY[i];
 			pObj->m_VelX = 0;
 			pObj->m_VelY = 0;
 			pObj->m_StartTick = Server()->Tick();
@@ -133,34 +161,86 @@ void CWhiteHole::Snap(int SnappingClient)
 	}
 }
 
-void CWhiteHole::MoveParticles()
+void CWhiteHole::RespawnParticle(int i)
 {
+	if (m_LifeSpan < m_ParticleStopTickTime)
+	{
+		// make particles disappear
+		m_pParticleX[i] = -99999.0f;
+		m_pParticleY[i] = -99999.0f;
+		m_pParticleVelX[i] = 0.0f;
+		m_pParticleVelY[i] = 0.0f;
+		return;
+	}
 	float Radius = g_Config.m_InfWhiteHoleRadius;
-	float RandomAngle, Speed;
-	float VecX, VecY;
-	vec2 VecMid;
-	for(int i=0; i<m_NumParticles; i++)
+	float RandomAngle = 2.0f * pi * random_float();
+	float VecX = cos(RandomAngle);
+	float VecY = sin(RandomAngle);
+	m_pParticleX[i] = m_Pos.x + Radius * VecX;
+	m_pParticleY[i] = m_Pos.y + Radius * VecY;
+	m_pParticleVelX[i] = -VecX;
+	m_pParticleVelY[i] = -VecY;
+}
+
+// moves every particle toward the center, particles that passed it are respawned on the border
+void CWhiteHole::MoveParticles()
+{
+	float InvRadius = 1.0f/g_Config.m_InfWhiteHoleRadius;
+	int i = 0;
+
+#if defined(CONF_ARCH_AMD64)
+	const __m128 CenterX = _mm_set1_ps(m_Pos.x);
+	const __m128 CenterY = _mm_set1_ps(m_Pos.y);
+	const __m128 InvRadius4 = _mm_set1_ps(InvRadius);
+	const __m128 StartSpeed = _mm_set1_ps(m_ParticleStartSpeed);
+	const __m128 Acceleration = _mm_set1_ps(m_ParticleAcceleration);
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 One = _mm_set1_ps(1.0f);
+	const __m128 OneAndHalf = _mm_set1_ps(1.5f);
+	for(; i<m_NumParticleSlots; i+=PARTICLE_BLOCK)
 	{
-		VecMid = m_Pos - m_ParticlePos[i];
-		Speed = m_ParticleStartSpeed * clamp(1.0f-length(VecMid)/Radius+0.5f, 0.0f, 1.0f);
-		m_ParticlePos[i] += vec2(m_ParticleVec[i].x*Speed, m_ParticleVec[i].y*Speed); 
-		if (dot(VecMid, m_ParticleVec[i]) <= 0)
+		__m128 PosX = _mm_load_ps(m_pParticleX+i);
+		__m128 PosY = _mm_load_ps(m_pParticleY+i);
+		__m128 VelX = _mm_load_ps(m_pParticleVelX+i);
+		__m128 VelY = _mm_load_ps(m_pParticleVelY+i);
+
+		__m128 MidX = _mm_sub_ps(CenterX, PosX);
+		__m128 MidY = _mm_sub_ps(CenterY, PosY);
+		__m128 Length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(MidX, MidX), _mm_mul_ps(MidY, MidY)));
+		__m128 Speed = _mm_sub_ps(OneAndHalf, _mm_mul_ps(Length, InvRadius4));
+		Speed = _mm_mul_ps(StartSpeed, _mm_min_ps(_mm_max_ps(Speed, Zero), One));
+		_mm_store_ps(m_pParticleX+i, _mm_add_ps(PosX, _mm_mul_ps(VelX, Speed)));
+		_mm_store_ps(m_pParticleY+i, _mm_add_ps(PosY, _mm_mul_ps(VelY, Speed)));
+
+		// the particles that passed the center keep their velocity, they are respawned below
+		__m128 Passed = _mm_cmple_ps(_mm_add_ps(_mm_mul_ps(MidX, VelX), _mm_mul_ps(MidY, VelY)), Zero);
+		__m128 Factor = _mm_or_ps(_mm_and_ps(Passed, One), _mm_andnot_ps(Passed, Acceleration));
+		_mm_store_ps(m_pParticleVelX+i, _mm_mul_ps(VelX, Factor));
+		_mm_store_ps(m_pParticleVelY+i, _mm_mul_ps(VelY, Factor));
+
+		int PassedMask = _mm_movemask_ps(Passed);
+		for(int j=0; PassedMask; j++, PassedMask >>= 1)
 		{
-			if (m_LifeSpan < m_ParticleStopTickTime)
-			{
-				// make particles disappear
-				m_ParticlePos[i] = vec2(-99999.0f, -99999.0f);
-				m_ParticleVec[i] = vec2(0.0f, 0.0f);
-				continue;
-			}
-			RandomAngle = 2.0f * pi * random_float();
-			VecX = cos(RandomAngle);
-			VecY = sin(RandomAngle);
-			m_ParticlePos[i] = m_Pos + vec2(Radius * VecX, Radius * VecY);
-			m_ParticleVec[i] = vec2(-VecX, -VecY);
+			if((PassedMask&1) && i+j < m_NumParticles)
+				RespawnParticle(i+j);
+		}
+	}
+#endif
+
+	for(; i<m_NumParticles; i++)
+	{
+		float MidX = m_Pos.x - m_pParticleX[i];
+		float MidY = m_Pos.y - m_pParticleY[i];
+		float Speed = m_ParticleStartSpeed * clamp(1.5f-sqrtf(MidX*MidX+MidY*MidY)*InvRadius, 0.0f, 1.0f);
+		m_pParticleX[i] += m_pParticleVelX[i]*Speed;
+		m_pParticleY[i] += m_pParticleVelY[i]*Speed;
+		if (MidX*m_pParticleVelX[i] + MidY*m_pParticleVelY[i] <= 0)
+		{
+			RespawnParticle(i);
 			continue;
 		}
-		m_ParticleVec[i] *= m_ParticleAcceleration; 
+		m_pParticleVelX[i] *= m_ParticleAcceleration;
+		m_pParticleVelY[i] *= m_ParticleAcceleration;
 	}
 }
 
@@ -168,19 +248,17 @@ void CWhiteHole::MovePlayers()
 {
 	vec2 Dir;
 	float Distance, Intensity;
-	// Find a player to pull
-	for(CCharacter *pPlayer = (CCharacter*) GameWorld()->FindFirst(CGameWorld::ENTTYPE_CHARACTER); pPlayer; pPlayer = (CCharacter *)pPlayer->TypeNext())
+	// Find a player to pull, humans are only sucked in if the config var is set
+	int Flags = g_Config.m_InfWhiteHoleAffectsHumans ? CCharacterMirror::FLAG_ALL : CCharacterMirror::FLAG_ZOMBIE;
+	const CCharacterMirror *pCharacters = GameWorld()->Characters();
+	for(int64 Mask = pCharacters->WithinRadius(m_Pos, m_Radius, false, Flags); Mask; Mask &= Mask-1)
 	{
-		if(!g_Config.m_InfWhiteHoleAffectsHumans && pPlayer->IsHuman()) continue; // stops humans from being sucked in, if config var is set
-		
+		CCharacter *pPlayer = pCharacters->First(Mask);
 		Dir = m_Pos - pPlayer->m_Pos;
 		Distance = length(Dir);
-		if(Distance < m_Radius)
-		{
-			Intensity = clamp(1.0f-Distance/m_Radius+0.5f, 0.0f, 1.0f)*m_PlayerPullStrength;
-			pPlayer->m_Core.m_Vel += normalize(Dir)*Intensity;
-			pPlayer->m_Core.m_Vel *= m_PlayerDrag;
-		}
+		Intensity = clamp(1.0f-Distance/m_Radius+0.5f, 0.0f, 1.0f)*m_PlayerPullStrength;
+		pPlayer->m_Core.m_Vel += normalize(Dir)*Intensity;
+		pPlayer->m_Core.m_Vel *= m_PlayerDrag;
 	}
 }
 
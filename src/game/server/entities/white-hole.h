@@ -9,7 +9,15 @@ class CWhiteHole : public CEntity
 {
 	
 private:
+	enum
+	{
+		PARTICLE_BLOCK=4, // particles are moved 4 at a time, the arrays are padded to a multiple of it
+		LOD_NEAR_DISTANCE=600, // clients closer than this to the center see every particle
+		LOD_FAR_DISTANCE=900, // clients farther than this see a quarter of them, half in between
+	};
+
 	void StartVisualEffect();
+	void RespawnParticle(int i);
 	void MoveParticles();
 	void MovePlayers();
 
@@ -36,9 +44,14 @@ private:
 	int m_ParticleStopTickTime; // when X time is left stop creating particles - close animation
 
 	int m_NumParticles; // will be set with a config var
-	int *m_IDs;
-	vec2 *m_ParticlePos;
-	vec2 *m_ParticleVec;
+	int m_NumParticleSlots; // m_NumParticles rounded up to PARTICLE_BLOCK
+	int m_FirstParticleID; // one snap id per particle, -1 if no range was free and the particles are not drawn
+	// particle state as 16 byte aligned arrays of m_NumParticleSlots floats, all in m_pParticleData
+	void *m_pParticleData;
+	float *m_pParticleX;
+	float *m_pParticleY;
+	float *m_pParticleVelX;
+	float *m_pParticleVelY;
 
 	bool isDieing;
 	
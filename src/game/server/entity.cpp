@@ -9,7 +9,7 @@
 //////////////////////////////////////////////////
 // Entity
 //////////////////////////////////////////////////
-CEntity::CEntity(CGameWorld *pGameWorld, int ObjType)
+CEntity::CEntity(CGameWorld *pGameWorld, int ObjType, int Owner)
 {
 	m_pGameWorld = pGameWorld;
 
@@ -30,6 +30,10 @@ CEntity::CEntity(CGameWorld *pGameWorld, int ObjType)
 
 	m_pPrevTypeEntity = 0;
 	m_pNextTypeEntity = 0;
+
+	m_OwnerLink = Owner >= 0 && Owner < MAX_CLIENTS ? Owner : -1;
+	m_pPrevOwnerEntity = 0;
+	m_pNextOwnerEntity = 0;
 }
 
 CEntity::~CEntity()
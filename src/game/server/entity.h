@@ -11,7 +11,7 @@
 	public: \
 	void *operator new(size_t Size) \
 	{ \
-		void *p = mem_alloc(Size, 1); \
+		void *p = mem_alloc_tagged(Size, 1, MEMTAG_ENTITY); \
 		/*dbg_msg("", "++ %p %d", p, size);*/ \
 		mem_zero(p, Size); \
 		return p; \
@@ -62,6 +62,11 @@ class CEntity
 	CEntity *m_pPrevTypeEntity;
 	CEntity *m_pNextTypeEntity;
 
+	// entities created by a player, destroyed with its character
+	int m_OwnerLink;
+	CEntity *m_pPrevOwnerEntity;
+	CEntity *m_pNextOwnerEntity;
+
 	class CGameWorld *m_pGameWorld;
 protected:
 	bool m_MarkedForDestroy;
@@ -69,7 +74,7 @@ protected:
 	//array<int> m_IDs;
 	int m_ObjType;
 public:
-	CEntity(CGameWorld *pGameWorld, int Objtype);
+	CEntity(CGameWorld *pGameWorld, int Objtype, int Owner = -1);
 	virtual ~CEntity();
 
 	class CGameWorld *GameWorld() { return m_pGameWorld; }
@@ -79,6 +84,7 @@ public:
 
 	CEntity *TypeNext() { return m_pNextTypeEntity; }
 	CEntity *TypePrev() { return m_pPrevTypeEntity; }
+	CEntity *OwnerNext() { return m_pNextOwnerEntity; }
 
 	/*
 		Function: destroy
@@ -9,6 +9,10 @@
 CEventHandler::CEventHandler()
 {
 	m_pGameServer = 0;
+	m_NumCreated = 0;
+	m_NumDropped = 0;
+	m_NumCoalesced = 0;
+	m_PeakEvents = 0;
 	Clear();
 }
 
@@ -19,10 +23,15 @@ void CEventHandler::SetGameServer(CGameContext *pGameServer)
 
 void *CEventHandler::Create(int Type, int Size, int64_t Mask)
 {
-	if(m_NumEvents == MAX_EVENTS)
-		return 0;
-	if(m_CurrentOffset+Size >= MAX_DATASIZE)
+	// the previous event is filled by now
+	Index();
+
+	m_NumCreated++;
+	if(m_NumEvents == MAX_EVENTS || m_CurrentOffset+Size >= MAX_DATASIZE)
+	{
+		m_NumDropped++;
 		return 0;
+	}
 
 	void *p = &m_aData[m_CurrentOffset];
 	m_aOffsets[m_NumEvents] = m_CurrentOffset;
@@ -34,24 +43,90 @@ void *CEventHandler::Create(int Type, int Size, int64_t Mask)
 	return p;
 }
 
+void CEventHandler::Index()
+{
+	while(m_NumIndexed < m_NumEvents)
+	{
+		int i = m_NumIndexed;
+		CNetEvent_Common *pEvent = (CNetEvent_Common *)&m_aData[m_aOffsets[i]];
+		m_aCellX[i] = (int)floor(pEvent->m_X/(float)CELL_SIZE);
+		m_aCellY[i] = (int)floor(pEvent->m_Y/(float)CELL_SIZE);
+		int Bucket = CEventHandler::Bucket(m_aCellX[i], m_aCellY[i]);
+
+		// drop the event if the same one already happens on this tile
+		int Dup = m_aBuckets[Bucket];
+		for(; Dup != -1; Dup = m_aNext[Dup])
+		{
+			CNetEvent_Common *pOther = (CNetEvent_Common *)&m_aData[m_aOffsets[Dup]];
+			if(m_aTypes[Dup] == m_aTypes[i] && m_aSizes[Dup] == m_aSizes[i] && m_aClientMasks[Dup] == m_aClientMasks[i] &&
+				pOther->m_X/32 == pEvent->m_X/32 && pOther->m_Y/32 == pEvent->m_Y/32 &&
+				mem_comp(pOther+1, pEvent+1, m_aSizes[i]-sizeof(CNetEvent_Common)) == 0)
+				break;
+		}
+
+		if(Dup != -1)
+		{
+			// only the last event can be removed, the others are already indexed
+			m_CurrentOffset -= m_aSizes[i];
+			m_NumEvents--;
+			m_NumCoalesced++;
+			continue;
+		}
+
+		m_aNext[i] = m_aBuckets[Bucket];
+		m_aBuckets[Bucket] = i;
+		m_NumIndexed++;
+	}
+}
+
 void CEventHandler::Clear()
 {
+	if(m_NumEvents > m_PeakEvents)
+		m_PeakEvents = m_NumEvents;
+
 	m_NumEvents = 0;
+	m_NumIndexed = 0;
 	m_CurrentOffset = 0;
+	for(int i = 0; i < NUM_BUCKETS; i++)
+		m_aBuckets[i] = -1;
+}
+
+void CEventHandler::SnapEvent(int Index)
+{
+	void *d = GameServer()->Server()->SnapNewItem(m_aTypes[Index], Index, m_aSizes[Index]);
+	if(d)
+		mem_copy(d, &m_aData[m_aOffsets[Index]], m_aSizes[Index]);
 }
 
 void CEventHandler::Snap(int SnappingClient)
 {
-	for(int i = 0; i < m_NumEvents; i++)
+	Index();
+
+	if(SnappingClient == -1)
+	{
+		for(int i = 0; i < m_NumEvents; i++)
+			SnapEvent(i);
+		return;
+	}
+
+	// only visit the cells in view, several cells can share a bucket
+	vec2 ViewPos = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos;
+	int MinX = (int)floor((ViewPos.x-SNAP_DISTANCE)/CELL_SIZE);
+	int MaxX = (int)floor((ViewPos.x+SNAP_DISTANCE)/CELL_SIZE);
+	int MinY = (int)floor((ViewPos.y-SNAP_DISTANCE)/CELL_SIZE);
+	int MaxY = (int)floor((ViewPos.y+SNAP_DISTANCE)/CELL_SIZE);
+	for(int y = MinY; y <= MaxY; y++)
 	{
-		if(SnappingClient == -1 || CmaskIsSet(m_aClientMasks[i], SnappingClient))
+		for(int x = MinX; x <= MaxX; x++)
 		{
-			CNetEvent_Common *ev = (CNetEvent_Common *)&m_aData[m_aOffsets[i]];
-			if(SnappingClient == -1 || distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, vec2(ev->m_X, ev->m_Y)) < 1500.0f)
+			for(int i = m_aBuckets[Bucket(x, y)]; i != -1; i = m_aNext[i])
 			{
-				void *d = GameServer()->Server()->SnapNewItem(m_aTypes[i], i, m_aSizes[i]);
-				if(d)
-					mem_copy(d, &m_aData[m_aOffsets[i]], m_aSizes[i]);
+				if(m_aCellX[i] != x || m_aCellY[i] != y || !CmaskIsSet(m_aClientMasks[i], SnappingClient))
+					continue;
+
+				CNetEvent_Common *ev = (CNetEvent_Common *)&m_aData[m_aOffsets[i]];
+				if(distance(ViewPos, vec2(ev->m_X, ev->m_Y)) < SNAP_DISTANCE)
+					SnapEvent(i);
 			}
 		}
 	}
@@ -11,22 +11,42 @@ typedef unsigned __int64 uint64_t;
 #else
 #include <stdint.h>
 #endif
+
+#include <base/math.h>
 //
 class CEventHandler
 {
 	static const int MAX_EVENTS = 512;
 	static const int MAX_DATASIZE = 512*64;
+	static const int SNAP_DISTANCE = 1500;
+	static const int CELL_SIZE = 1024; // events are bucketed by screen sized cells of the world
+	static const int NUM_BUCKETS = 256;
 
 	int m_aTypes[MAX_EVENTS]; // TODO: remove some of these arrays
 	int m_aOffsets[MAX_EVENTS];
 	int m_aSizes[MAX_EVENTS];
 	int64_t m_aClientMasks[MAX_EVENTS];
+	int m_aCellX[MAX_EVENTS];
+	int m_aCellY[MAX_EVENTS];
+	int m_aNext[MAX_EVENTS]; // next event of the same bucket
 	char m_aData[MAX_DATASIZE];
 
+	int m_aBuckets[NUM_BUCKETS];
+
 	class CGameContext *m_pGameServer;
 
 	int m_CurrentOffset;
 	int m_NumEvents;
+	int m_NumIndexed; // events up to this one are bucketed, the last one may still be written by its creator
+
+	int64_t m_NumCreated;
+	int64_t m_NumDropped;
+	int64_t m_NumCoalesced;
+	int m_PeakEvents;
+
+	static int Bucket(int CellX, int CellY) { return cell_hash(CellX, CellY)&(NUM_BUCKETS-1); }
+	void Index();
+	void SnapEvent(int Index);
 public:
 	CGameContext *GameServer() const { return m_pGameServer; }
 	void SetGameServer(CGameContext *pGameServer);
@@ -35,6 +55,11 @@ public:
 	void *Create(int Type, int Size, int64_t Mask = -1LL);
 	void Clear();
 	void Snap(int SnappingClient);
+
+	int64_t NumCreated() const { return m_NumCreated; }
+	int64_t NumDropped() const { return m_NumDropped; }
+	int64_t NumCoalesced() const { return m_NumCoalesced; }
+	int PeakEvents() const { return m_PeakEvents; }
 };
 
 #endif
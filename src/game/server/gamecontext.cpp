@@ -7,6 +7,7 @@
 #include <engine/console.h>
 #include <engine/storage.h>
 #include <engine/server/roundstatistics.h>
+#include <engine/shared/metrics.h>
 #include "gamecontext.h"
 #include <game/version.h>
 #include <game/collision.h>
@@ -88,10 +89,6 @@ void CGameContext::Construct(int Resetting)
 	#if defined(MEASURE_TICKS)
 		m_pMeasure = new CMeasureTicks(10,"GameServerTick");
 	#endif
-	
-	#ifdef CONF_GEOLOCATION
-	geolocation = new Geolocation("GeoLite2-Country.mmdb");
-	#endif
 }
 
 CGameContext::CGameContext(int Resetting)
@@ -106,20 +103,12 @@ CGameContext::CGameContext()
 
 CGameContext::~CGameContext()
 {
-	for(int i = 0; i < m_LaserDots.size(); i++)
-		Server()->SnapFreeID(m_LaserDots[i].m_SnapID);
-	for(int i = 0; i < m_HammerDots.size(); i++)
-		Server()->SnapFreeID(m_HammerDots[i].m_SnapID);
+	m_TransientVisuals.Clear();
 	
 	for(int i = 0; i < MAX_CLIENTS; i++)
 		delete m_apPlayers[i];
 	if(!m_Resetting)
 		delete m_pVoteOptionHeap;
-	
-	#ifdef CONF_GEOLOCATION
-	delete geolocation;
-	geolocation = nullptr;
-	#endif
 }
 
 void CGameContext::Clear()
@@ -360,33 +349,17 @@ void CGameContext::CreateHammerHit(vec2 Pos)
 
 void CGameContext::CreateLaserDotEvent(vec2 Pos0, vec2 Pos1, int LifeSpan)
 {
-	CGameContext::LaserDotState State;
-	State.m_Pos0 = Pos0;
-	State.m_Pos1 = Pos1;
-	State.m_LifeSpan = LifeSpan;
-	State.m_SnapID = Server()->SnapNewID();
-	
-	m_LaserDots.add(State);
+	m_TransientVisuals.Create(CTransientVisuals::VISUAL_LASER, Pos0, Pos1, LifeSpan);
 }
 
 void CGameContext::CreateHammerDotEvent(vec2 Pos, int LifeSpan)
 {
-	CGameContext::HammerDotState State;
-	State.m_Pos = Pos;
-	State.m_LifeSpan = LifeSpan;
-	State.m_SnapID = Server()->SnapNewID();
-	
-	m_HammerDots.add(State);
+	m_TransientVisuals.Create(CTransientVisuals::VISUAL_HAMMER, Pos, Pos, LifeSpan);
 }
 
 void CGameContext::CreateLoveEvent(vec2 Pos)
 {
-	CGameContext::LoveDotState State;
-	State.m_Pos = Pos;
-	State.m_LifeSpan = Server()->TickSpeed();
-	State.m_SnapID = Server()->SnapNewID();
-	
-	m_LoveDots.add(State);
+	m_TransientVisuals.Create(CTransientVisuals::VISUAL_LOVE, Pos, Pos, Server()->TickSpeed());
 }
 
 void CGameContext::CreateExplosion(vec2 Pos, int Owner, int Weapon, bool NoDamage, int TakeDamageMode, float DamageFactor)
@@ -1021,6 +994,10 @@ void CGameContext::OnTick()
 	#if defined(MEASURE_TICKS)
 		m_pMeasure->Begin(); // when the tick starts	
 	#endif
+
+#ifdef CONF_SQL
+	Sql()->Tick();
+#endif
 	
 	if(!(Server()->Tick() % 150))
 	{
@@ -1271,47 +1248,7 @@ void CGameContext::OnTick()
 	
 /* INFECTION MODIFICATION START ***************************************/
 	//Clean old dots
-	int DotIter;
-	
-	DotIter = 0;
-	while(DotIter < m_LaserDots.size())
-	{
-		m_LaserDots[DotIter].m_LifeSpan--;
-		if(m_LaserDots[DotIter].m_LifeSpan <= 0)
-		{
-			Server()->SnapFreeID(m_LaserDots[DotIter].m_SnapID);
-			m_LaserDots.remove_index(DotIter);
-		}
-		else
-			DotIter++;
-	}
-	
-	DotIter = 0;
-	while(DotIter < m_HammerDots.size())
-	{
-		m_HammerDots[DotIter].m_LifeSpan--;
-		if(m_HammerDots[DotIter].m_LifeSpan <= 0)
-		{
-			Server()->SnapFreeID(m_HammerDots[DotIter].m_SnapID);
-			m_HammerDots.remove_index(DotIter);
-		}
-		else
-			DotIter++;
-	}
-	
-	DotIter = 0;
-	while(DotIter < m_LoveDots.size())
-	{
-		m_LoveDots[DotIter].m_LifeSpan--;
-		m_LoveDots[DotIter].m_Pos.y -= 5.0f;
-		if(m_LoveDots[DotIter].m_LifeSpan <= 0)
-		{
-			Server()->SnapFreeID(m_LoveDots[DotIter].m_SnapID);
-			m_LoveDots.remove_index(DotIter);
-		}
-		else
-			DotIter++;
-	}
+	m_TransientVisuals.Tick();
 /* INFECTION MODIFICATION END *****************************************/
 
 	// update voting
@@ -1704,6 +1641,13 @@ void CGameContext::OnCallVote(void *pRawMsg, int ClientID)
 								SendChatTarget(ClientID, aBufVoteMap);
 								return;
 							}
+							if (!Server()->MapExists(MapName))
+							{
+								char aBufVoteMap[128];
+								str_format(aBufVoteMap, sizeof(aBufVoteMap), "Map %s is not available on this server", MapName);
+								SendChatTarget(ClientID, aBufVoteMap);
+								return;
+							}
 						}
 
 						int RoundCount = m_pController->GetRoundCount();
@@ -2117,11 +2061,7 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 
 			// IP geolocation start
 			#ifdef CONF_GEOLOCATION
-			std::string ip = Server()->GetClientIP(ClientID);
-			int ISOCode = geolocation->get_country_iso_numeric_code(ip);
-			if(ISOCode == -1)
-				dbg_msg("geo", "This ip was not found in database: %s", ip.c_str());
-			Server()->SetClientCountry(ClientID, ISOCode);
+			Server()->SetClientCountry(ClientID, Server()->ClientGeolocationCountry(ClientID));
 			#endif
 			// IP geolocation end
 
@@ -2488,6 +2428,23 @@ bool CGameContext::ConTuneDump(IConsole::IResult *pResult, void *pUserData)
 	return true;
 }
 
+bool CGameContext::ConEventStats(IConsole::IResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "created=%lld coalesced=%lld dropped=%lld peak=%d",
+		(long long)pSelf->m_Events.NumCreated(), (long long)pSelf->m_Events.NumCoalesced(),
+		(long long)pSelf->m_Events.NumDropped(), pSelf->m_Events.PeakEvents());
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "events", aBuf);
+	str_format(aBuf, sizeof(aBuf), "visuals=%d created=%lld dropped=%lld peak=%d",
+		pSelf->m_TransientVisuals.Num(),
+		(long long)pSelf->m_TransientVisuals.NumCreated(), (long long)pSelf->m_TransientVisuals.NumDropped(),
+		pSelf->m_TransientVisuals.PeakVisuals());
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "events", aBuf);
+	
+	return true;
+}
+
 bool CGameContext::ConPause(IConsole::IResult *pResult, void *pUserData)
 {
 	CGameContext *pSelf = (CGameContext *)pUserData;
@@ -3402,6 +3359,13 @@ bool CGameContext::ConTop5(IConsole::IResult *pResult, void *pUserData)
 	return true;
 }
 
+bool CGameContext::ConRank(IConsole::IResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *) pUserData;
+	pSelf->Sql()->ShowRank(pResult->GetClientID());
+	return true;
+}
+
 void CGameContext::LogoutAccount(int ClientID)
 {
 	CPlayer *pP = m_apPlayers[ClientID];
@@ -4304,6 +4268,7 @@ void CGameContext::Teleport(CCharacter *pChr, vec2 Pos)
 	pChr->SetPos(Pos);
 	pChr->SetVel(vec2(0, 0));
 	pChr->m_Pos = Pos;
+	m_World.InvalidateCharacters();
 }
 
 bool CGameContext::ConWitch(IConsole::IResult *pResult, void *pUserData)
@@ -4388,6 +4353,7 @@ void CGameContext::OnConsoleInit()
 	Console()->Register("tune", "s<param> i<value>", CFGFLAG_SERVER, ConTuneParam, this, "Tune variable to value");
 	Console()->Register("tune_reset", "", CFGFLAG_SERVER, ConTuneReset, this, "Reset tuning");
 	Console()->Register("tune_dump", "", CFGFLAG_SERVER, ConTuneDump, this, "Dump tuning");
+	Console()->Register("event_stats", "", CFGFLAG_SERVER, ConEventStats, this, "Show how many events and transient visuals were created, coalesced and dropped on this map");
 	Console()->Register("status", "", CFGFLAG_SERVER, ConStatus, this, "List players");
 	
 	Console()->Register("pause", "", CFGFLAG_SERVER, ConPause, this, "Pause/unpause game");
@@ -4417,6 +4383,7 @@ void CGameContext::OnConsoleInit()
 	Console()->Register("login", "?s?s", CFGFLAG_CHAT|CFGFLAG_USER, ConLogin, this, "Login to an account");
 	Console()->Register("logout", "", CFGFLAG_CHAT|CFGFLAG_USER, ConLogout, this, "Logout");
 	Console()->Register("top5", "s<human|zombie>", CFGFLAG_CHAT|CFGFLAG_USER, ConTop5, this, "showTop5");
+	Console()->Register("rank", "", CFGFLAG_CHAT|CFGFLAG_USER, ConRank, this, "Show your rank");
 #endif
 	Console()->Register("help", "?s<page>", CFGFLAG_CHAT|CFGFLAG_USER, ConHelp, this, "Display help");
 	Console()->Register("customskin", "s<all|me|none>", CFGFLAG_CHAT|CFGFLAG_USER, ConCustomSkin, this, "Display information about the mod");
@@ -4437,6 +4404,7 @@ void CGameContext::OnInit(/*class IKernel *pKernel*/)
 	m_pConsole = Kernel()->RequestInterface<IConsole>();
 	m_World.SetGameServer(this);
 	m_Events.SetGameServer(this);
+	m_TransientVisuals.SetGameServer(this);
 	
 	for(int i=0; i<MAX_CLIENTS; i++)
 	{
@@ -4570,76 +4538,8 @@ void CGameContext::OnSnap(int ClientID)
 	}
 
 /* INFECTION MODIFICATION START ***************************************/
-	//Snap laser dots
-	for(int i=0; i < m_LaserDots.size(); i++)
-	{
-		if(ClientID >= 0)
-		{
-			vec2 CheckPos = (m_LaserDots[i].m_Pos0 + m_LaserDots[i].m_Pos1)*0.5f;
-			float dx = m_apPlayers[ClientID]->m_ViewPos.x-CheckPos.x;
-			float dy = m_apPlayers[ClientID]->m_ViewPos.y-CheckPos.y;
-			if(absolute(dx) > 1000.0f || absolute(dy) > 800.0f)
-				continue;
-			if(distance(m_apPlayers[ClientID]->m_ViewPos, CheckPos) > 1100.0f)
-				continue;
-		}
-		
-		CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(Server()->SnapNewItem(NETOBJTYPE_LASER, m_LaserDots[i].m_SnapID, sizeof(CNetObj_Laser)));
-		if(pObj)
-		{
-			pObj->m_X = (int)m_LaserDots[i].m_Pos1.x;
-			pObj->m_Y = (int)m_LaserDots[i].m_Pos1.y;
-			pObj->m_FromX = (int)m_LaserDots[i].m_Pos0.x;
-			pObj->m_FromY = (int)m_LaserDots[i].m_Pos0.y;
-			pObj->m_StartTick = Server()->Tick();
-		}
-	}
-	for(int i=0; i < m_HammerDots.size(); i++)
-	{
-		if(ClientID >= 0)
-		{
-			vec2 CheckPos = m_HammerDots[i].m_Pos;
-			float dx = m_apPlayers[ClientID]->m_ViewPos.x-CheckPos.x;
-			float dy = m_apPlayers[ClientID]->m_ViewPos.y-CheckPos.y;
-			if(absolute(dx) > 1000.0f || absolute(dy) > 800.0f)
-				continue;
-			if(distance(m_apPlayers[ClientID]->m_ViewPos, CheckPos) > 1100.0f)
-				continue;
-		}
-		
-		CNetObj_Projectile *pObj = static_cast<CNetObj_Projectile *>(Server()->SnapNewItem(NETOBJTYPE_PROJECTILE, m_HammerDots[i].m_SnapID, sizeof(CNetObj_Projectile)));
-		if(pObj)
-		{
-			pObj->m_X = (int)m_HammerDots[i].m_Pos.x;
-			pObj->m_Y = (int)m_HammerDots[i].m_Pos.y;
-			pObj->m_VelX = 0;
-			pObj->m_VelY = 0;
-			pObj->m_StartTick = Server()->Tick();
-			pObj->m_Type = WEAPON_HAMMER;
-		}
-	}
-	for(int i=0; i < m_LoveDots.size(); i++)
-	{
-		if(ClientID >= 0)
-		{
-			vec2 CheckPos = m_LoveDots[i].m_Pos;
-			float dx = m_apPlayers[ClientID]->m_ViewPos.x-CheckPos.x;
-			float dy = m_apPlayers[ClientID]->m_ViewPos.y-CheckPos.y;
-			if(absolute(dx) > 1000.0f || absolute(dy) > 800.0f)
-				continue;
-			if(distance(m_apPlayers[ClientID]->m_ViewPos, CheckPos) > 1100.0f)
-				continue;
-		}
-		
-		CNetObj_Pickup *pObj = static_cast<CNetObj_Pickup *>(Server()->SnapNewItem(NETOBJTYPE_PICKUP, m_LoveDots[i].m_SnapID, sizeof(CNetObj_Pickup)));
-		if(pObj)
-		{
-			pObj->m_X = (int)m_LoveDots[i].m_Pos.x;
-			pObj->m_Y = (int)m_LoveDots[i].m_Pos.y;
-			pObj->m_Type = POWERUP_HEALTH;
-			pObj->m_Subtype = 0;
-		}
-	}
+	//Snap laser, hammer and love dots
+	m_TransientVisuals.Snap(ClientID);
 /* INFECTION MODIFICATION END *****************************************/
 }
 
@@ -4683,11 +4583,7 @@ void CGameContext::OnRoundOver()
 				SendChatTarget_Localization(i, CHATCATEGORY_SCORE, 
 					_("You get {int:Score} in this round."), "Score", &HScore, NULL);
 			}
-			char aBuf[16];
-			str_format(aBuf, sizeof(aBuf), "\u002b%d", HScore);
-			char bBuf[16];
-			str_format(bBuf, sizeof(bBuf), "\u002b%d", ZScore);
-			Sql()->UpdateScore(pPlayer->GetCID(), aBuf, bBuf);
+			Sql()->UpdateScore(pPlayer->GetCID(), HScore, ZScore);
 		}
 	}
 #endif
@@ -4699,6 +4595,43 @@ void CGameContext::OnPostSnap()
 	m_Events.Clear();
 }
 
+void CGameContext::OnCollectMetrics(CMetrics *pMetrics)
+{
+	static const char *s_apEntityTypes[CGameWorld::NUM_ENTTYPES] = {
+		"projectile", "laser", "grenade", "growingexplosion", "flyingpoint", "character",
+		"engineer_wall", "soldier_bomb", "scientist_mine", "scientist_laser", "mercenary_bomb",
+		"scatter_grenade", "elastic_grenade", "physicist_gun", "medic_grenade", "occultist_grenade",
+		"hero_flag", "biologist_mine", "slug_slime", "bouncing_bullet", "looper_wall", "white_hole",
+		"superweapon_indicator", "laser_teleport", "turret", "plasma", "plasma_plus", "elastic_hole",
+		"elastic_entity", "slime_entity", "police_shield", "reviver_grenade", "heal_boom",
+		"defence_circle", "freeze_mine", "doctor_grenade", "doctor_funnel", "siegrid_hammer", "flyingion",
+	};
+
+	char aLabels[64];
+	for(int i = 0; i < CGameWorld::NUM_ENTTYPES; i++)
+	{
+		int Num = 0;
+		for(CEntity *pEnt = m_World.FindFirst(i); pEnt; pEnt = pEnt->TypeNext())
+			Num++;
+		str_format(aLabels, sizeof(aLabels), "type=\"%s\"", s_apEntityTypes[i]);
+		pMetrics->WriteGauge("infclass_entities", "Entities in the game world", aLabels, Num);
+	}
+
+	pMetrics->WriteGauge("infclass_humans", "Human players", "", GetHumanCount());
+	pMetrics->WriteGauge("infclass_zombies", "Infected players", "", GetZombieCount());
+
+	// the events and the visuals are counted again after each map change
+	pMetrics->WriteCounter("infclass_events_created_total", "Events created on this map", "", (double)m_Events.NumCreated());
+	pMetrics->WriteCounter("infclass_events_dropped_total", "Events dropped on this map because the buffer was full", "", (double)m_Events.NumDropped());
+	pMetrics->WriteCounter("infclass_events_coalesced_total", "Events merged into an identical one on this map", "", (double)m_Events.NumCoalesced());
+	pMetrics->WriteCounter("infclass_visuals_dropped_total", "Laser, hammer and love dots dropped on this map", "", (double)m_TransientVisuals.NumDropped());
+
+#ifdef CONF_SQL
+	pMetrics->WriteGauge("infclass_sql_queue_depth", "SQL requests waiting for the database", "", CSQL::QueueDepth());
+	pMetrics->WriteGauge("infclass_leaderboard_accounts", "Accounts in the in-memory leaderboard", "", CSQL::Leaderboard()->NumAccounts());
+#endif
+}
+
 bool CGameContext::IsClientReady(int ClientID)
 {
 	return m_apPlayers[ClientID] && m_apPlayers[ClientID]->m_IsReady ? true : false;
@@ -15,6 +15,7 @@
 #include <teeuniverses/components/localization.h>
 
 #include "eventhandler.h"
+#include "transientvisuals.h"
 #include "gamecontroller.h"
 #include "gameworld.h"
 #include "player.h"
@@ -27,10 +28,6 @@
 #endif
 
 
-#ifdef CONF_GEOLOCATION
-	#include <infclasscr/geolocation.h>
-#endif
-
 #ifdef _MSC_VER
 typedef __int32 int32_t;
 typedef unsigned __int32 uint32_t;
@@ -100,13 +97,10 @@ class CGameContext : public IGameServer
 	int m_TargetToKillCoolDown;
 	int m_HeroGiftCooldown;
 
-	#ifdef CONF_GEOLOCATION
-	Geolocation* geolocation;
-	#endif
-
 	static bool ConTuneParam(IConsole::IResult *pResult, void *pUserData);
 	static bool ConTuneReset(IConsole::IResult *pResult, void *pUserData);
 	static bool ConTuneDump(IConsole::IResult *pResult, void *pUserData);
+	static bool ConEventStats(IConsole::IResult *pResult, void *pUserData);
 	static bool ConPause(IConsole::IResult *pResult, void *pUserData);
 	static bool ConChangeMap(IConsole::IResult *pResult, void *pUserData);
 	static bool ConSkipMap(IConsole::IResult *pResult, void *pUserData);
@@ -256,6 +250,7 @@ public:
 	virtual void OnPreSnap();
 	virtual void OnSnap(int ClientID);
 	virtual void OnPostSnap();
+	virtual void OnCollectMetrics(class CMetrics *pMetrics);
 
 	virtual void OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID);
 
@@ -288,6 +283,7 @@ private:
 	static bool ConLogin(IConsole::IResult *pResult, void *pUserData);
 	static bool ConLogout(IConsole::IResult *pResult, void *pUserData);
 	static bool ConTop5(IConsole::IResult *pResult, void *pUserData);
+	static bool ConRank(IConsole::IResult *pResult, void *pUserData);
 #endif
 	static bool ConStatus(IConsole::IResult *pResult, void *pUserData);
 	static bool ConHelp(IConsole::IResult *pResult, void *pUserData);
@@ -359,30 +355,7 @@ private:
 	
 	CBroadcastState m_BroadcastStates[MAX_CLIENTS];
 	
-	struct LaserDotState
-	{
-		vec2 m_Pos0;
-		vec2 m_Pos1;
-		int m_LifeSpan;
-		int m_SnapID;
-	};
-	array<LaserDotState> m_LaserDots;
-	
-	struct HammerDotState
-	{
-		vec2 m_Pos;
-		int m_LifeSpan;
-		int m_SnapID;
-	};
-	array<HammerDotState> m_HammerDots;
-	
-	struct LoveDotState
-	{
-		vec2 m_Pos;
-		int m_LifeSpan;
-		int m_SnapID;
-	};
-	array<LoveDotState> m_LoveDots;
+	CTransientVisuals m_TransientVisuals;
 	
 	int m_aHitSoundState[MAX_CLIENTS]; //1 for hit, 2 for kill (no sounds must be sent)	
 
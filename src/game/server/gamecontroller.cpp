@@ -126,8 +126,6 @@ const char *IGameController::GetTeamName(int Team)
 	return "spectators";
 }
 
-static bool IsSeparator(char c) { return c == ';' || c == ' ' || c == ',' || c == '\t'; }
-
 int IGameController::GetRoundCount() {
 	return m_RoundCount;
 }
@@ -180,53 +178,19 @@ void IGameController::ChangeMap(const char *pToMap)
 	EndRound(WINNER_NONE);
 }
 
-void IGameController::GetWordFromList(char *pNextWord, const char *pList, int ListIndex)
-{
-	pList += ListIndex;
-	int i = 0;
-	while(*pList)
-	{
-		if (IsSeparator(*pList)) break;
-		pNextWord[i] = *pList;
-		pList++;
-		i++;
-	}
-	pNextWord[i] = 0;
-}
-
 void IGameController::GetMapRotationInfo(CMapRotationInfo *pMapRotationInfo)
 {
-	pMapRotationInfo->m_MapCount = 0;
+	pMapRotationInfo->m_MapCount = Server()->GetMapRotationSize();
+	// when the current map is not in the rotation, continue from the first one
+	pMapRotationInfo->m_CurrentMapNumber = pMapRotationInfo->m_MapCount-1;
 
-	if(!str_length(g_Config.m_SvMaprotation))
-		return;
-
-	const char *pNextMap = g_Config.m_SvMaprotation;
-	const char *pCurrentMap = g_Config.m_SvMap;
-	bool insideWord = false;
-	char aBuf[128];
-	int i = 0;
-	while(*pNextMap)
+	for(int i = 0; i < pMapRotationInfo->m_MapCount; i++)
 	{
-		if (IsSeparator(*pNextMap))
+		if(str_comp(Server()->GetMapRotationName(i), g_Config.m_SvMap) == 0)
 		{
-			if (insideWord)
-				insideWord = false;
+			pMapRotationInfo->m_CurrentMapNumber = i;
+			break;
 		}
-		else // current char is not a seperator
-		{
-			if (!insideWord)
-			{
-				insideWord = true;
-				pMapRotationInfo->m_MapNameIndices[pMapRotationInfo->m_MapCount] = i;
-				GetWordFromList(aBuf, g_Config.m_SvMaprotation, i);
-				if (str_comp(aBuf, pCurrentMap) == 0)
-					pMapRotationInfo->m_CurrentMapNumber = pMapRotationInfo->m_MapCount;
-				pMapRotationInfo->m_MapCount++;
-			}
-		}
-		pNextMap++;
-		i++;
 	}
 }
 
@@ -270,7 +234,7 @@ void IGameController::CycleMap(bool Forced)
 		for ( ; i<32; i++)
 		{
 			RandInt = random_int(0, pMapRotationInfo.m_MapCount-1);
-			GetWordFromList(aBuf, g_Config.m_SvMaprotation, pMapRotationInfo.m_MapNameIndices[RandInt]);
+			str_copy(aBuf, Server()->GetMapRotationName(RandInt), sizeof(aBuf));
 			int MinPlayers = Server()->GetMinPlayersForMap(aBuf);
 			int MaxPlayers = Server()->GetMaxPlayersForMap(aBuf);
 			if (RandInt != pMapRotationInfo.m_CurrentMapNumber && PlayerCount >= MinPlayers && PlayerCount <= MaxPlayers)
@@ -290,7 +254,7 @@ void IGameController::CycleMap(bool Forced)
 				if (i == pMapRotationInfo.m_CurrentMapNumber)
 					break;
 			}
-			GetWordFromList(aBuf, g_Config.m_SvMaprotation, pMapRotationInfo.m_MapNameIndices[i]);
+			str_copy(aBuf, Server()->GetMapRotationName(i), sizeof(aBuf));
 			int MinPlayers = Server()->GetMinPlayersForMap(aBuf);
 			int MaxPlayers = Server()->GetMaxPlayersForMap(aBuf);
 			if (PlayerCount >= MinPlayers && PlayerCount <= MaxPlayers)
@@ -305,7 +269,7 @@ void IGameController::CycleMap(bool Forced)
 		i++;
 		if (i >= pMapRotationInfo.m_MapCount)
 			i = 0;
-		GetWordFromList(aBuf, g_Config.m_SvMaprotation, pMapRotationInfo.m_MapNameIndices[i]);
+		str_copy(aBuf, Server()->GetMapRotationName(i), sizeof(aBuf));
 	}
 
 
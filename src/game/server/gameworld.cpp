@@ -18,8 +18,18 @@ CGameWorld::CGameWorld()
 
 	m_Paused = false;
 	m_ResetRequested = false;
+	m_CharacterMirrorValid = false;
+	m_InEntityTick = false;
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 		m_apFirstEntityTypes[i] = 0;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		for(int j = 0; j < NUM_ENTTYPES; j++)
+		{
+			m_aapFirstOwnedEntities[i][j] = 0;
+			m_aaNumOwnedEntities[i][j] = 0;
+		}
+	}
 }
 
 CGameWorld::~CGameWorld()
@@ -41,6 +51,39 @@ CEntity *CGameWorld::FindFirst(int Type)
 	return Type < 0 || Type >= NUM_ENTTYPES ? 0 : m_apFirstEntityTypes[Type];
 }
 
+CEntity *CGameWorld::FindFirstOwned(int ClientID, int Type)
+{
+	if(ClientID < 0 || ClientID >= MAX_CLIENTS || Type < 0 || Type >= NUM_ENTTYPES)
+		return 0;
+	return m_aapFirstOwnedEntities[ClientID][Type];
+}
+
+int CGameWorld::CountOwned(int ClientID, int Type)
+{
+	if(ClientID < 0 || ClientID >= MAX_CLIENTS || Type < 0 || Type >= NUM_ENTTYPES)
+		return 0;
+	return m_aaNumOwnedEntities[ClientID][Type];
+}
+
+void CGameWorld::DestroyOwnedEntities(int ClientID)
+{
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+		for(CEntity *pEnt = FindFirstOwned(ClientID, i); pEnt; pEnt = pEnt->m_pNextOwnerEntity)
+			DestroyEntity(pEnt);
+}
+
+const CCharacterMirror *CGameWorld::Characters()
+{
+	if(!m_CharacterMirrorValid)
+	{
+		m_CharacterMirror.Clear();
+		for(CCharacter *p = (CCharacter *)m_apFirstEntityTypes[ENTTYPE_CHARACTER]; p; p = (CCharacter *)p->TypeNext())
+			m_CharacterMirror.Add(p, p->m_Pos, p->m_ProximityRadius, p->IsZombie());
+		m_CharacterMirrorValid = m_InEntityTick;
+	}
+	return &m_CharacterMirror;
+}
+
 int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max, int Type)
 {
 	if(Type < 0 || Type >= NUM_ENTTYPES)
@@ -75,6 +118,20 @@ void CGameWorld::InsertEntity(CEntity *pEnt)
 	pEnt->m_pNextTypeEntity = m_apFirstEntityTypes[pEnt->m_ObjType];
 	pEnt->m_pPrevTypeEntity = 0x0;
 	m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+
+	if(pEnt->m_ObjType == ENTTYPE_CHARACTER)
+		m_CharacterMirrorValid = false;
+
+	if(pEnt->m_OwnerLink >= 0)
+	{
+		CEntity **ppFirst = &m_aapFirstOwnedEntities[pEnt->m_OwnerLink][pEnt->m_ObjType];
+		if(*ppFirst)
+			(*ppFirst)->m_pPrevOwnerEntity = pEnt;
+		pEnt->m_pNextOwnerEntity = *ppFirst;
+		pEnt->m_pPrevOwnerEntity = 0x0;
+		*ppFirst = pEnt;
+		m_aaNumOwnedEntities[pEnt->m_OwnerLink][pEnt->m_ObjType]++;
+	}
 }
 
 void CGameWorld::DestroyEntity(CEntity *pEnt)
@@ -102,6 +159,22 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 
 	pEnt->m_pNextTypeEntity = 0;
 	pEnt->m_pPrevTypeEntity = 0;
+
+	if(pEnt->m_OwnerLink >= 0)
+	{
+		if(pEnt->m_pPrevOwnerEntity)
+			pEnt->m_pPrevOwnerEntity->m_pNextOwnerEntity = pEnt->m_pNextOwnerEntity;
+		else
+			m_aapFirstOwnedEntities[pEnt->m_OwnerLink][pEnt->m_ObjType] = pEnt->m_pNextOwnerEntity;
+		if(pEnt->m_pNextOwnerEntity)
+			pEnt->m_pNextOwnerEntity->m_pPrevOwnerEntity = pEnt->m_pPrevOwnerEntity;
+		pEnt->m_pNextOwnerEntity = 0;
+		pEnt->m_pPrevOwnerEntity = 0;
+		m_aaNumOwnedEntities[pEnt->m_OwnerLink][pEnt->m_ObjType]--;
+	}
+
+	if(pEnt->m_ObjType == ENTTYPE_CHARACTER)
+		m_CharacterMirrorValid = false;
 }
 
 //
@@ -229,6 +302,8 @@ void CGameWorld::Tick()
 		if(GameServer()->m_pController->IsForceBalanced())
 			GameServer()->SendChat(-1, CGameContext::CHAT_ALL, "Teams have been balanced");
 		// update all objects
+		m_InEntityTick = true;
+		m_CharacterMirrorValid = false;
 		for(int i = 0; i < NUM_ENTTYPES; i++)
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 			{
@@ -236,6 +311,8 @@ void CGameWorld::Tick()
 				pEnt->Tick();
 				pEnt = m_pNextTraverseEntity;
 			}
+		m_InEntityTick = false;
+		m_CharacterMirrorValid = false;
 
 		for(int i = 0; i < NUM_ENTTYPES; i++)
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
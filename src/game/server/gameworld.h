@@ -5,6 +5,8 @@
 
 #include <game/gamecore.h>
 
+#include "charactermirror.h"
+
 class CEntity;
 class CCharacter;
 
@@ -68,10 +70,16 @@ private:
 
 	CEntity *m_pNextTraverseEntity;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
+	CEntity *m_aapFirstOwnedEntities[MAX_CLIENTS][NUM_ENTTYPES];
+	int m_aaNumOwnedEntities[MAX_CLIENTS][NUM_ENTTYPES];
 
 	class CGameContext *m_pGameServer;
 	class IServer *m_pServer;
 
+	CCharacterMirror m_CharacterMirror;
+	bool m_CharacterMirrorValid;
+	bool m_InEntityTick; // character positions only change in TickDefered
+
 	void UpdatePlayerMaps();
 
 public:
@@ -89,6 +97,38 @@ public:
 
 	CEntity *FindFirst(int Type);
 
+	/*
+		Function: characters
+			Returns the characters of the world as arrays for proximity
+			queries. While the entities tick the copy is kept until a
+			character is added, removed or changes class, at any other
+			time it is rebuilt by every call.
+	*/
+	const CCharacterMirror *Characters();
+	void InvalidateCharacters() { m_CharacterMirrorValid = false; }
+
+	/*
+		Function: find_first_owned
+			Returns the first entity of a type that was created with
+			ClientID as owner, the next ones are found with OwnerNext().
+			Only the entities destroyed with their owner's character
+			pass their owner to CEntity.
+	*/
+	CEntity *FindFirstOwned(int ClientID, int Type);
+
+	/*
+		Function: count_owned
+			Number of entities of a type in the world created by ClientID,
+			including the ones marked for destruction.
+	*/
+	int CountOwned(int ClientID, int Type);
+
+	/*
+		Function: destroy_owned
+			Marks every entity created by ClientID for destruction.
+	*/
+	void DestroyOwnedEntities(int ClientID);
+
 	/*
 		Function: find_entities
 			Finds entities close to a position and returns them in a list.
@@ -9,6 +9,7 @@ MACRO_CONFIG_STR(SvSqlIp, sv_sql_ip, 256, "127.0.0.1", CFGFLAG_SERVER, "SQL Data
 MACRO_CONFIG_INT(SvSqlPort, sv_sql_port, 3306, 0, 65535, CFGFLAG_SERVER, "SQL Database port")
 MACRO_CONFIG_STR(SvSqlDatabase, sv_sql_database, 256, "", CFGFLAG_SERVER, "SQL Database name")
 MACRO_CONFIG_STR(SvSqlPrefix, sv_sql_prefix, 16, "tw", CFGFLAG_SERVER, "SQL Database table prefix")
+MACRO_CONFIG_INT(SvSqlLeaderboardRefresh, sv_sql_leaderboard_refresh, 300, 10, 86400, CFGFLAG_SERVER, "Seconds between two full reads of the scores for the top5 and rank commands")
 #endif
 
 MACRO_CONFIG_INT(InfMinPlayers, inf_min_players, 2, 0, 64, CFGFLAG_SERVER, "Minimum number of players to start the round")
@@ -16,7 +17,7 @@ MACRO_CONFIG_INT(InfChallenge, inf_challenge, 0, 0, 1, CFGFLAG_SERVER, "Enable c
 MACRO_CONFIG_INT(InfAccusationThreshold, inf_accusation_threshold, 4, 0, 8, CFGFLAG_SERVER, "Number of accusations needed to start a banvote")
 MACRO_CONFIG_INT(InfLeaverBanTime, inf_leaver_ban_time, 5, 0, 180, CFGFLAG_SERVER, "How long an infected gets banned (in minutes), when leaving and leaving causes a human to get infected")
 MACRO_CONFIG_INT(InfFastDownload, inf_fast_download, 1, 0, 1, CFGFLAG_SERVER, "Enables fast download of maps")
-MACRO_CONFIG_INT(InfMapWindow, inf_map_window, 15, 0, 100, CFGFLAG_SERVER, "Map downloading send-ahead window")
+MACRO_CONFIG_INT(InfMapWindow, inf_map_window, 15, 1, 24, CFGFLAG_SERVER, "Initial map downloading send-ahead window, adapted per client afterwards")
 MACRO_CONFIG_INT(InfShowScoreTime, inf_show_score_time, 2, 0, 12, CFGFLAG_SERVER, "Number of seconds the score will be shown at the end of a round")
 MACRO_CONFIG_INT(InfMaprotationRandom, inf_maprotation_random, 1, 0, 1, CFGFLAG_SERVER, "When enabled, next map in rotation will be chosen randomly")
 MACRO_CONFIG_INT(InfMinRoundsForMapVote, inf_min_rounds_map_vote, 0, 0, 100, CFGFLAG_SERVER, "Minimum number of rounds before a new map can be voted")
@@ -846,6 +846,7 @@ void CPlayer::SetClass(int newClass)
 	m_GhoulLevelTick = 0;
 	
 	m_Class = newClass;
+	GameServer()->m_World.InvalidateCharacters();
 	
 	if(m_Class < END_HUMANCLASS)
 		HookProtection(true);
@@ -0,0 +1,189 @@
+#include "transientvisuals.h"
+#include "gamecontext.h"
+
+CTransientVisuals::CTransientVisuals()
+{
+	m_pGameServer = 0;
+	m_NumVisuals = 0;
+	m_IndexTick = -1;
+	m_NumCreated = 0;
+	m_NumDropped = 0;
+	m_PeakVisuals = 0;
+}
+
+bool CTransientVisuals::Create(int Type, vec2 Pos0, vec2 Pos1, int LifeSpan)
+{
+	m_NumCreated++;
+
+	// the server holds freed ids back for a while, so the clients never mistake a visual for the one that had its id before
+	int SnapID = m_NumVisuals < MAX_VISUALS ? GameServer()->Server()->SnapNewID() : -1;
+	if(SnapID < 0)
+	{
+		m_NumDropped++;
+		return false;
+	}
+
+	int i = m_NumVisuals++;
+	m_aTypes[i] = Type;
+	m_aPos0[i] = Pos0;
+	m_aPos1[i] = Pos1;
+	m_aLifeSpans[i] = LifeSpan;
+	m_aSnapIDs[i] = SnapID;
+	m_IndexTick = -1;
+
+	if(m_NumVisuals > m_PeakVisuals)
+		m_PeakVisuals = m_NumVisuals;
+	return true;
+}
+
+void CTransientVisuals::Clear()
+{
+	if(!m_pGameServer || !m_pGameServer->Server())
+		return;
+
+	for(int i = 0; i < m_NumVisuals; i++)
+		GameServer()->Server()->SnapFreeID(m_aSnapIDs[i]);
+
+	m_NumVisuals = 0;
+	m_IndexTick = -1;
+}
+
+void CTransientVisuals::Tick()
+{
+	int i = 0;
+	while(i < m_NumVisuals)
+	{
+		m_aLifeSpans[i]--;
+		if(m_aTypes[i] == VISUAL_LOVE)
+			m_aPos0[i].y -= 5.0f;
+
+		if(m_aLifeSpans[i] > 0)
+		{
+			i++;
+			continue;
+		}
+
+		// the order of the visuals does not matter, fill the hole with the last one
+		GameServer()->Server()->SnapFreeID(m_aSnapIDs[i]);
+		int Last = --m_NumVisuals;
+		m_aTypes[i] = m_aTypes[Last];
+		m_aPos0[i] = m_aPos0[Last];
+		m_aPos1[i] = m_aPos1[Last];
+		m_aLifeSpans[i] = m_aLifeSpans[Last];
+		m_aSnapIDs[i] = m_aSnapIDs[Last];
+	}
+	m_IndexTick = -1;
+}
+
+vec2 CTransientVisuals::CheckPos(int Index) const
+{
+	if(m_aTypes[Index] == VISUAL_LASER)
+		return (m_aPos0[Index] + m_aPos1[Index])*0.5f;
+	return m_aPos0[Index];
+}
+
+void CTransientVisuals::Index()
+{
+	if(m_IndexTick == GameServer()->Server()->Tick())
+		return;
+
+	for(int i = 0; i < NUM_BUCKETS; i++)
+		m_aBuckets[i] = -1;
+
+	for(int i = 0; i < m_NumVisuals; i++)
+	{
+		vec2 Pos = CheckPos(i);
+		m_aCellX[i] = (int)floor(Pos.x/CELL_SIZE);
+		m_aCellY[i] = (int)floor(Pos.y/CELL_SIZE);
+		int Bucket = CTransientVisuals::Bucket(m_aCellX[i], m_aCellY[i]);
+		m_aNext[i] = m_aBuckets[Bucket];
+		m_aBuckets[Bucket] = i;
+	}
+
+	m_IndexTick = GameServer()->Server()->Tick();
+}
+
+void CTransientVisuals::SnapVisual(int Index)
+{
+	IServer *pServer = GameServer()->Server();
+	switch(m_aTypes[Index])
+	{
+		case VISUAL_LASER:
+		{
+			CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(pServer->SnapNewItem(NETOBJTYPE_LASER, m_aSnapIDs[Index], sizeof(CNetObj_Laser)));
+			if(pObj)
+			{
+				pObj->m_X = (int)m_aPos1[Index].x;
+				pObj->m_Y = (int)m_aPos1[Index].y;
+				pObj->m_FromX = (int)m_aPos0[Index].x;
+				pObj->m_FromY = (int)m_aPos0[Index].y;
+				pObj->m_StartTick = pServer->Tick();
+			}
+			break;
+		}
+		case VISUAL_HAMMER:
+		{
+			CNetObj_Projectile *pObj = static_cast<CNetObj_Projectile *>(pServer->SnapNewItem(NETOBJTYPE_PROJECTILE, m_aSnapIDs[Index], sizeof(CNetObj_Projectile)));
+			if(pObj)
+			{
+				pObj->m_X = (int)m_aPos0[Index].x;
+				pObj->m_Y = (int)m_aPos0[Index].y;
+				pObj->m_VelX = 0;
+				pObj->m_VelY = 0;
+				pObj->m_StartTick = pServer->Tick();
+				pObj->m_Type = WEAPON_HAMMER;
+			}
+			break;
+		}
+		case VISUAL_LOVE:
+		{
+			CNetObj_Pickup *pObj = static_cast<CNetObj_Pickup *>(pServer->SnapNewItem(NETOBJTYPE_PICKUP, m_aSnapIDs[Index], sizeof(CNetObj_Pickup)));
+			if(pObj)
+			{
+				pObj->m_X = (int)m_aPos0[Index].x;
+				pObj->m_Y = (int)m_aPos0[Index].y;
+				pObj->m_Type = POWERUP_HEALTH;
+				pObj->m_Subtype = 0;
+			}
+			break;
+		}
+	}
+}
+
+void CTransientVisuals::Snap(int SnappingClient)
+{
+	if(SnappingClient == -1)
+	{
+		for(int i = 0; i < m_NumVisuals; i++)
+			SnapVisual(i);
+		return;
+	}
+
+	Index();
+
+	// same area as CEntity::NetworkClipped, only the cells overlapping it are visited
+	vec2 ViewPos = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos;
+	int MinX = (int)floor((ViewPos.x-1000.0f)/CELL_SIZE);
+	int MaxX = (int)floor((ViewPos.x+1000.0f)/CELL_SIZE);
+	int MinY = (int)floor((ViewPos.y-800.0f)/CELL_SIZE);
+	int MaxY = (int)floor((ViewPos.y+800.0f)/CELL_SIZE);
+	for(int y = MinY; y <= MaxY; y++)
+	{
+		for(int x = MinX; x <= MaxX; x++)
+		{
+			for(int i = m_aBuckets[Bucket(x, y)]; i != -1; i = m_aNext[i])
+			{
+				if(m_aCellX[i] != x || m_aCellY[i] != y)
+					continue;
+
+				vec2 Pos = CheckPos(i);
+				if(absolute(ViewPos.x-Pos.x) > 1000.0f || absolute(ViewPos.y-Pos.y) > 800.0f)
+					continue;
+				if(distance(ViewPos, Pos) > 1100.0f)
+					continue;
+
+				SnapVisual(i);
+			}
+		}
+	}
+}
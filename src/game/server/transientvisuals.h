@@ -0,0 +1,68 @@
+#ifndef GAME_SERVER_TRANSIENTVISUALS_H
+#define GAME_SERVER_TRANSIENTVISUALS_H
+
+#include <base/math.h>
+#include <base/system.h>
+#include <base/vmath.h>
+
+// short lived snap objects that are not entities: laser dots, hammer dots and love dots
+// stored as parallel arrays, expired visuals are swapped with the last one and their snap ids go back to the server
+class CTransientVisuals
+{
+public:
+	enum
+	{
+		VISUAL_LASER=0, // laser from Pos0 to Pos1
+		VISUAL_HAMMER, // hammer projectile at Pos0
+		VISUAL_LOVE, // heart at Pos0, floats upwards
+		NUM_VISUALS,
+	};
+
+private:
+	static const int MAX_VISUALS = 2048;
+	static const int CELL_SIZE = 1024;
+	static const int NUM_BUCKETS = 256;
+
+	int m_aTypes[MAX_VISUALS];
+	vec2 m_aPos0[MAX_VISUALS];
+	vec2 m_aPos1[MAX_VISUALS];
+	int m_aLifeSpans[MAX_VISUALS];
+	int m_aSnapIDs[MAX_VISUALS];
+	int m_aCellX[MAX_VISUALS];
+	int m_aCellY[MAX_VISUALS];
+	int m_aNext[MAX_VISUALS]; // next visual of the same bucket
+	int m_NumVisuals;
+
+	int m_aBuckets[NUM_BUCKETS];
+	int m_IndexTick; // tick the buckets were built for, -1 if they are outdated
+
+	int64 m_NumCreated;
+	int64 m_NumDropped;
+	int m_PeakVisuals;
+
+	class CGameContext *m_pGameServer;
+
+	static int Bucket(int CellX, int CellY) { return cell_hash(CellX, CellY)&(NUM_BUCKETS-1); }
+	vec2 CheckPos(int Index) const;
+	void Index();
+	void SnapVisual(int Index);
+
+public:
+	CGameContext *GameServer() const { return m_pGameServer; }
+	void SetGameServer(CGameContext *pGameServer) { m_pGameServer = pGameServer; }
+
+	CTransientVisuals();
+
+	bool Create(int Type, vec2 Pos0, vec2 Pos1, int LifeSpan);
+	// gives every snap id back to the server
+	void Clear();
+	void Tick();
+	void Snap(int SnappingClient);
+
+	int Num() const { return m_NumVisuals; }
+	int64 NumCreated() const { return m_NumCreated; }
+	int64 NumDropped() const { return m_NumDropped; }
+	int PeakVisuals() const { return m_PeakVisuals; }
+};
+
+#endif
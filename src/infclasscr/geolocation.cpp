@@ -3,9 +3,23 @@
 #ifdef CONF_GEOLOCATION
 Geolocation::Geolocation(const char* path_to_mmdb) {
 	db = new GeoLite2PP::DB(path_to_mmdb);
+	shutdown = false;
+	first_request = 0;
+	num_requests = 0;
+	use_counter = 0;
+	mem_zero(results, sizeof(results));
+	mem_zero(cache, sizeof(cache));
+	worker = std::thread(&Geolocation::worker_thread, this);
 }
 
 Geolocation::~Geolocation() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shutdown = true;
+	}
+	cond.notify_one();
+	worker.join();
+
 	delete db;
 	db = nullptr;
 }
@@ -20,8 +34,116 @@ int Geolocation::get_country_iso_numeric_code(std::string& ip) {
 	}
 }
 
+NETADDR Geolocation::get_prefix(const NETADDR *addr) {
+	// countries are assigned to whole networks, /24 for ipv4 and /48 for ipv6 is fine grained enough
+	NETADDR prefix;
+	mem_zero(&prefix, sizeof(prefix));
+	prefix.type = addr->type;
+	mem_copy(prefix.ip, addr->ip, addr->type == NETTYPE_IPV4 ? 3 : 6);
+	return prefix;
+}
+
+bool Geolocation::cache_get(const NETADDR *prefix, int *code) {
+	for(int i = 0; i < CACHE_SIZE; i++) {
+		if(cache[i].used && net_addr_comp(&cache[i].prefix, prefix) == 0) {
+			cache[i].last_use = ++use_counter;
+			*code = cache[i].code;
+			return true;
+		}
+	}
+	return false;
+}
+
+void Geolocation::cache_set(const NETADDR *prefix, int code) {
+	// replace the least recently used entry
+	int oldest = 0;
+	for(int i = 0; i < CACHE_SIZE; i++) {
+		if(!cache[i].used) {
+			oldest = i;
+			break;
+		}
+		if(cache[i].last_use < cache[oldest].last_use)
+			oldest = i;
+	}
+	cache[oldest].used = true;
+	cache[oldest].prefix = *prefix;
+	cache[oldest].code = code;
+	cache[oldest].last_use = ++use_counter;
+}
+
+int Geolocation::lookup(const NETADDR *addr) {
+	NETADDR prefix = get_prefix(addr);
+	int code;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(cache_get(&prefix, &code))
+			return code;
+	}
+
+	char addr_str[NETADDR_MAXSTRSIZE];
+	net_addr_str(addr, addr_str, sizeof(addr_str), false);
+	std::string ip(addr_str);
+	code = get_country_iso_numeric_code(ip);
+	if(code == -1)
+		dbg_msg("geo", "This ip was not found in database: %s", addr_str);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	cache_set(&prefix, code);
+	return code;
+}
+
+void Geolocation::worker_thread() {
+	while(true) {
+		request_t req;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cond.wait(lock, [this] { return shutdown || num_requests > 0; });
+			if(shutdown)
+				return;
+			req = requests[first_request];
+			first_request = (first_request + 1) % MAX_REQUESTS;
+			num_requests--;
+		}
+
+		int code = lookup(&req.addr);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if(net_addr_comp(&results[req.slot].addr, &req.addr) == 0) {
+			results[req.slot].code = code;
+			results[req.slot].done = true;
+		}
+	}
+}
+
+void Geolocation::request(int slot, const NETADDR *addr) {
+	if(slot < 0 || slot >= MAX_SLOTS)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		results[slot].done = false;
+		results[slot].addr = *addr;
+		if(num_requests >= MAX_REQUESTS)
+			return; // get_result resolves it when needed
+		requests[(first_request + num_requests) % MAX_REQUESTS] = { slot, *addr };
+		num_requests++;
+	}
+	cond.notify_one();
+}
+
+int Geolocation::get_result(int slot, const NETADDR *addr) {
+	if(slot >= 0 && slot < MAX_SLOTS) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if(results[slot].done && net_addr_comp(&results[slot].addr, addr) == 0)
+			return results[slot].code;
+	}
+
+	// not resolved yet, do it now
+	return lookup(addr);
+}
+
 int Geolocation::get_iso_numeric_code(GeoLite2PP::MStr& m) {
-	std::map<std::string, int> iso_numeric = {
+	static const std::map<std::string, int> iso_numeric = {
 		{"AF", 4},
 		{"AX", 248},
 		{"AL", 8},
@@ -272,6 +394,7 @@ int Geolocation::get_iso_numeric_code(GeoLite2PP::MStr& m) {
 		{"ZM", 894},
 		{"ZW", 716}
 	};
-	return iso_numeric[m["country_iso_code"]];
+	std::map<std::string, int>::const_iterator it = iso_numeric.find(m["country_iso_code"]);
+	return it != iso_numeric.end() ? it->second : 0;
 }
 #endif
\ No newline at end of file
@@ -3,17 +3,69 @@
 
 #ifdef CONF_GEOLOCATION
 
+#include <base/system.h>
 #include <infclasscr/GeoLite2PP/GeoLite2PP.hpp>
 #include <iostream>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
+// Resolves countries on a worker thread so joining clients never wait for the database.
+// Results are cached by address prefix, the database itself is opened once per process.
 class Geolocation {
 private:
+    enum {
+        MAX_SLOTS = 128,
+        MAX_REQUESTS = 256,
+        CACHE_SIZE = 1024,
+    };
+
+    struct request_t {
+        int slot;
+        NETADDR addr;
+    };
+
+    struct result_t {
+        bool done;
+        NETADDR addr;
+        int code;
+    };
+
+    struct cache_entry_t {
+        bool used;
+        NETADDR prefix;
+        int code;
+        int64 last_use;
+    };
+
     GeoLite2PP::DB *db;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::thread worker;
+    bool shutdown;
+
+    request_t requests[MAX_REQUESTS];
+    int first_request;
+    int num_requests;
+    result_t results[MAX_SLOTS];
+    cache_entry_t cache[CACHE_SIZE];
+    int64 use_counter;
+
     int get_iso_numeric_code(GeoLite2PP::MStr& m);
+    int lookup(const NETADDR *addr);
+    static NETADDR get_prefix(const NETADDR *addr);
+    bool cache_get(const NETADDR *prefix, int *code);
+    void cache_set(const NETADDR *prefix, int code);
+    void worker_thread();
 public:
     Geolocation(const char* path_to_mmdb);
     ~Geolocation();
     int get_country_iso_numeric_code(std::string& ip);
+
+    // queues a lookup for a client slot, called when the connection is accepted
+    void request(int slot, const NETADDR *addr);
+    // returns the country of the client, resolving it now if the worker has not finished yet
+    int get_result(int slot, const NETADDR *addr);
 };
 #endif
 #endif
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include <base/math.h>
+#include <base/tl/threading.h>
+
+#include <algorithm>
+
+#include "leaderboard.h"
+
+CLeaderboard::CLeaderboard()
+{
+	m_pSource = 0;
+	m_pData = new CData;
+	m_Loaded = false;
+	m_Sequence = 0;
+	m_pFetchThread = 0;
+	m_pFetched = 0;
+	m_FetchedSequence = 0;
+	m_FetchDone = false;
+	m_NextFetch = 0;
+}
+
+CLeaderboard::~CLeaderboard()
+{
+	Shutdown();
+	delete m_pData;
+}
+
+bool CLeaderboard::Better(const CData *pData, int Team, int a, int b)
+{
+	const CLeaderboardAccount *pA = &pData->m_Accounts[a];
+	const CLeaderboardAccount *pB = &pData->m_Accounts[b];
+	if(pA->m_aScores[Team] != pB->m_aScores[Team])
+		return pA->m_aScores[Team] > pB->m_aScores[Team];
+	return pA->m_UserID < pB->m_UserID;
+}
+
+void CLeaderboard::Sort(CData *pData)
+{
+	int NumAccounts = pData->m_Accounts.size();
+	pData->m_Index.clear();
+	pData->m_Index.reserve(NumAccounts);
+	for(int i = 0; i < NumAccounts; i++)
+		pData->m_Index[pData->m_Accounts[i].m_UserID] = i;
+
+	for(int t = 0; t < NUM_TEAMS; t++)
+	{
+		std::vector<int> &Order = pData->m_aOrder[t];
+		Order.resize(NumAccounts);
+		for(int i = 0; i < NumAccounts; i++)
+			Order[i] = i;
+		std::sort(Order.begin(), Order.end(), [pData, t](int a, int b) { return Better(pData, t, a, b); });
+		for(int i = 0; i < NumAccounts; i++)
+			pData->m_Accounts[Order[i]].m_aPositions[t] = i;
+	}
+}
+
+void CLeaderboard::FetchThread(void *pUser)
+{
+	CLeaderboard *pSelf = (CLeaderboard *)pUser;
+
+	// the sorting is done here as well, the game thread only swaps the result in
+	CData *pData = new CData;
+	unsigned Sequence = 0;
+	if(pSelf->m_pSource->Fetch(pSelf, &pData->m_Accounts, &Sequence))
+		Sort(pData);
+	else
+	{
+		delete pData;
+		pData = 0;
+	}
+
+	pSelf->m_pFetched = pData;
+	pSelf->m_FetchedSequence = Sequence;
+	sync_barrier();
+	pSelf->m_FetchDone = true;
+}
+
+void CLeaderboard::Init(ILeaderboardSource *pSource)
+{
+	m_pSource = pSource;
+	m_NextFetch = 0;
+	Update(0);
+}
+
+void CLeaderboard::Shutdown()
+{
+	if(m_pFetchThread)
+	{
+		thread_wait(m_pFetchThread);
+		m_pFetchThread = 0;
+		delete m_pFetched;
+		m_pFetched = 0;
+	}
+	m_Journal.clear();
+}
+
+void CLeaderboard::FinishFetch()
+{
+	thread_wait(m_pFetchThread);
+	m_pFetchThread = 0;
+	sync_barrier();
+
+	if(m_pFetched)
+	{
+		// the updates the database had not seen yet when it was read
+		CData *pOld = m_pData;
+		m_pData = m_pFetched;
+		m_pFetched = 0;
+		for(unsigned i = 0; i < m_Journal.size(); i++)
+		{
+			const CJournalEntry *pEntry = &m_Journal[i];
+			if((int)(pEntry->m_Sequence - m_FetchedSequence) > 0)
+				Apply(pEntry->m_UserID, pEntry->m_aName, pEntry->m_Team, pEntry->m_Score);
+		}
+		delete pOld;
+
+		if(!m_Loaded)
+			dbg_msg("leaderboard", "loaded %d accounts", NumAccounts());
+		m_Loaded = true;
+	}
+	else
+		dbg_msg("leaderboard", "couldn't read the scores");
+	m_Journal.clear();
+}
+
+void CLeaderboard::Update(int Interval)
+{
+	if(!m_pSource)
+		return;
+
+	int64 Now = time_get();
+	if(m_pFetchThread)
+	{
+		if(!m_FetchDone)
+			return;
+		FinishFetch();
+		// retry soon while there is nothing to answer with
+		m_NextFetch = Now + time_freq()*(m_Loaded ? Interval : min(Interval, 10));
+	}
+
+	if(Now >= m_NextFetch)
+	{
+		m_FetchDone = false;
+		m_pFetched = 0;
+		m_pFetchThread = thread_init(FetchThread, this);
+		if(!m_pFetchThread)
+			m_NextFetch = Now + time_freq()*Interval;
+	}
+}
+
+void CLeaderboard::Move(CData *pData, int Team, int Account)
+{
+	// the accounts between the old and the new place shift by one
+	std::vector<int> &Order = pData->m_aOrder[Team];
+	int Pos = pData->m_Accounts[Account].m_aPositions[Team];
+	while(Pos > 0 && Better(pData, Team, Account, Order[Pos-1]))
+	{
+		Order[Pos] = Order[Pos-1];
+		pData->m_Accounts[Order[Pos]].m_aPositions[Team] = Pos;
+		Pos--;
+	}
+	while(Pos < (int)Order.size()-1 && Better(pData, Team, Order[Pos+1], Account))
+	{
+		Order[Pos] = Order[Pos+1];
+		pData->m_Accounts[Order[Pos]].m_aPositions[Team] = Pos;
+		Pos++;
+	}
+	Order[Pos] = Account;
+	pData->m_Accounts[Account].m_aPositions[Team] = Pos;
+}
+
+void CLeaderboard::Apply(int UserID, const char *pName, int Team, int Score)
+{
+	CData *pData = m_pData;
+	int Account;
+	bool New = false;
+	std::unordered_map<int, int>::iterator Found = pData->m_Index.find(UserID);
+	if(Found == pData->m_Index.end())
+	{
+		// an account that was created after the last fetch, starts at the end of both orders
+		CLeaderboardAccount NewAccount;
+		mem_zero(&NewAccount, sizeof(NewAccount));
+		NewAccount.m_UserID = UserID;
+		Account = pData->m_Accounts.size();
+		for(int t = 0; t < NUM_TEAMS; t++)
+		{
+			NewAccount.m_aPositions[t] = Account;
+			pData->m_aOrder[t].push_back(Account);
+		}
+		pData->m_Accounts.push_back(NewAccount);
+		pData->m_Index[UserID] = Account;
+		New = true;
+	}
+	else
+		Account = Found->second;
+
+	CLeaderboardAccount *pAccount = &pData->m_Accounts[Account];
+	if(pName && pName[0])
+		str_copy(pAccount->m_aName, pName, sizeof(pAccount->m_aName));
+
+	for(int t = 0; t < NUM_TEAMS; t++)
+	{
+		if(t == Team)
+			pAccount->m_aScores[t] += Score;
+		else if(!New)
+			continue;
+		Move(pData, t, Account);
+	}
+}
+
+void CLeaderboard::AddScore(int UserID, const char *pName, int Team, int Score)
+{
+	// the database update has to be queued before the sequence moves, see ILeaderboardSource::Fetch
+	sync_barrier();
+	m_Sequence = m_Sequence+1;
+	sync_barrier();
+
+	if(m_pFetchThread)
+	{
+		CJournalEntry Entry;
+		Entry.m_Sequence = m_Sequence;
+		Entry.m_UserID = UserID;
+		str_copy(Entry.m_aName, pName ? pName : "", sizeof(Entry.m_aName));
+		Entry.m_Team = Team;
+		Entry.m_Score = Score;
+		m_Journal.push_back(Entry);
+	}
+
+	Apply(UserID, pName, Team, Score);
+}
+
+int CLeaderboard::GetTop(int Team, const CLeaderboardAccount **apAccounts, int Num) const
+{
+	if(Team < 0 || Team >= NUM_TEAMS)
+		return 0;
+
+	const std::vector<int> &Order = m_pData->m_aOrder[Team];
+	Num = min(Num, (int)Order.size());
+	for(int i = 0; i < Num; i++)
+		apAccounts[i] = &m_pData->m_Accounts[Order[i]];
+	return Num;
+}
+
+int CLeaderboard::GetRank(int Team, int UserID) const
+{
+	const CLeaderboardAccount *pAccount = GetAccount(UserID);
+	if(!pAccount || Team < 0 || Team >= NUM_TEAMS)
+		return 0;
+	return pAccount->m_aPositions[Team]+1;
+}
+
+const CLeaderboardAccount *CLeaderboard::GetAccount(int UserID) const
+{
+	std::unordered_map<int, int>::const_iterator Found = m_pData->m_Index.find(UserID);
+	return Found == m_pData->m_Index.end() ? 0 : &m_pData->m_Accounts[Found->second];
+}
@@ -0,0 +1,104 @@
+#ifndef INFCLASSCR_LEADERBOARD_H
+#define INFCLASSCR_LEADERBOARD_H
+
+#include <base/system.h>
+
+#include <unordered_map>
+#include <vector>
+
+struct CLeaderboardAccount
+{
+	int m_UserID;
+	char m_aName[32];
+	int m_aScores[2]; // human, zombie
+	int m_aPositions[2]; // in the order of each team, set by the leaderboard
+};
+
+class CLeaderboard;
+
+// where the scores come from, Fetch runs on the reconciliation thread
+class ILeaderboardSource
+{
+public:
+	virtual ~ILeaderboardSource() {}
+
+	// reads every account, *pSequence has to be a value of pBoard->Sequence() read at a point
+	// where the result has all the score updates up to it and none of the later ones
+	virtual bool Fetch(const CLeaderboard *pBoard, std::vector<CLeaderboardAccount> *pAccounts, unsigned *pSequence) = 0;
+};
+
+// account scores of both teams kept sorted in memory so top and rank queries never wait for the database
+// the game thread adds the score updates as they are sent to the database, and a full copy is read in
+// the background from time to time to pick up changes made elsewhere
+class CLeaderboard
+{
+public:
+	enum
+	{
+		TEAM_HUMAN=0,
+		TEAM_ZOMBIE,
+		NUM_TEAMS,
+	};
+
+private:
+	struct CData
+	{
+		std::vector<CLeaderboardAccount> m_Accounts;
+		std::unordered_map<int, int> m_Index; // user id to account
+		std::vector<int> m_aOrder[NUM_TEAMS]; // accounts, best first
+	};
+
+	// score updates made while a fetch is running, replayed on top of its result
+	struct CJournalEntry
+	{
+		unsigned m_Sequence;
+		int m_UserID;
+		char m_aName[32];
+		int m_Team;
+		int m_Score;
+	};
+
+	ILeaderboardSource *m_pSource;
+	CData *m_pData;
+	bool m_Loaded;
+	volatile unsigned m_Sequence;
+
+	void *m_pFetchThread;
+	CData *m_pFetched;
+	unsigned m_FetchedSequence;
+	volatile bool m_FetchDone;
+	int64 m_NextFetch;
+	std::vector<CJournalEntry> m_Journal;
+
+	static bool Better(const CData *pData, int Team, int a, int b);
+	static void Sort(CData *pData);
+	static void Move(CData *pData, int Team, int Account);
+	static void FetchThread(void *pUser);
+	void FinishFetch();
+	void Apply(int UserID, const char *pName, int Team, int Score);
+
+public:
+	CLeaderboard();
+	~CLeaderboard();
+
+	// starts loading the scores, nothing is answered until the first fetch finished
+	void Init(ILeaderboardSource *pSource);
+	void Shutdown();
+
+	// game thread, takes a finished fetch and starts the next one after Interval seconds
+	void Update(int Interval);
+	void AddScore(int UserID, const char *pName, int Team, int Score);
+
+	bool IsLoaded() const { return m_Loaded; }
+	bool IsFetching() const { return m_pFetchThread != 0; }
+	unsigned Sequence() const { return m_Sequence; }
+	int NumAccounts() const { return m_pData->m_Accounts.size(); }
+
+	// fills the best accounts of the team and returns how many there are
+	int GetTop(int Team, const CLeaderboardAccount **apAccounts, int Num) const;
+	// 1 for the best account, 0 if the account is not known
+	int GetRank(int Team, int UserID) const;
+	const CLeaderboardAccount *GetAccount(int UserID) const;
+};
+
+#endif
@@ -5,15 +5,102 @@
 #include <game/server/gamecontext.h>
 
 #include <engine/shared/config.h>
+#include <base/tl/threading.h>
 
 static LOCK SQLLock = 0;
+static volatile unsigned s_QueueDepth = 0;
 class CGameContext *m_pGameServer;
 CGameContext *GameServer() { return m_pGameServer; }
 
+// reads all the scores for the leaderboard with a connection of its own
+class CSqlLeaderboardSource : public ILeaderboardSource
+{
+	enum
+	{
+		MAX_QUEUE_WAITS=50,
+		QUEUE_WAIT_TIME=100, // ms
+	};
+
+public:
+	virtual bool Fetch(const CLeaderboard *pBoard, std::vector<CLeaderboardAccount> *pAccounts, unsigned *pSequence)
+	{
+		sql::Connection *pConnection = 0;
+		bool Done = false;
+		bool Locked = false;
+		try
+		{
+			sql::ConnectOptionsMap connection_properties;
+			connection_properties["hostName"]      = sql::SQLString(g_Config.m_SvSqlIp);
+			connection_properties["port"]          = g_Config.m_SvSqlPort;
+			connection_properties["userName"]      = sql::SQLString(g_Config.m_SvSqlUser);
+			connection_properties["password"]      = sql::SQLString(g_Config.m_SvSqlPassword);
+			connection_properties["OPT_CONNECT_TIMEOUT"] = 10;
+			connection_properties["OPT_READ_TIMEOUT"] = 10;
+			pConnection = get_driver_instance()->connect(connection_properties);
+			pConnection->setSchema(g_Config.m_SvSqlDatabase);
+
+			char aBuf[256];
+			str_format(aBuf, sizeof(aBuf), "SELECT UserID, Username, HumanScore, ZombieScore FROM %s_Account;", g_Config.m_SvSqlPrefix);
+
+			// the score updates run under the same lock, once none of them is waiting
+			// the table has every update the leaderboard has seen so far
+			for(int i = 0; i < MAX_QUEUE_WAITS && !Done; i++)
+			{
+				lock_wait(SQLLock);
+				Locked = true;
+				*pSequence = pBoard->Sequence();
+				sync_barrier();
+				if(s_QueueDepth == 0)
+				{
+					sql::Statement *pStatement = pConnection->createStatement();
+					sql::ResultSet *pResults = pStatement->executeQuery(aBuf);
+					while(pResults->next())
+					{
+						CLeaderboardAccount Account;
+						mem_zero(&Account, sizeof(Account));
+						Account.m_UserID = pResults->getInt("UserID");
+						str_copy(Account.m_aName, pResults->getString("Username").c_str(), sizeof(Account.m_aName));
+						Account.m_aScores[CLeaderboard::TEAM_HUMAN] = pResults->getInt("HumanScore");
+						Account.m_aScores[CLeaderboard::TEAM_ZOMBIE] = pResults->getInt("ZombieScore");
+						pAccounts->push_back(Account);
+					}
+					delete pResults;
+					delete pStatement;
+					Done = true;
+				}
+				lock_unlock(SQLLock);
+				Locked = false;
+
+				if(!Done)
+					thread_sleep(QUEUE_WAIT_TIME);
+			}
+		}
+		catch (sql::SQLException &e)
+		{
+			dbg_msg("SQL", "ERROR: Could not read the leaderboard (%s)", e.what());
+			if(Locked)
+				lock_unlock(SQLLock);
+			pAccounts->clear();
+			Done = false;
+		}
+
+		delete pConnection;
+		return Done;
+	}
+};
+
+static CSqlLeaderboardSource s_LeaderboardSource;
+static CLeaderboard *s_pLeaderboard = 0;
+
 CSQL::CSQL(class CGameContext *pGameServer)
 {
 	if(SQLLock == 0)
 		SQLLock = lock_create();
+	if(s_pLeaderboard == 0)
+	{
+		s_pLeaderboard = new CLeaderboard;
+		s_pLeaderboard->Init(&s_LeaderboardSource);
+	}
 
 	m_pGameServer = pGameServer;
 		
@@ -26,6 +113,21 @@ CSQL::CSQL(class CGameContext *pGameServer)
 	port = g_Config.m_SvSqlPort;
 }
 
+int CSQL::QueueDepth()
+{
+	return s_QueueDepth;
+}
+
+CLeaderboard *CSQL::Leaderboard()
+{
+	return s_pLeaderboard;
+}
+
+void CSQL::Tick()
+{
+	s_pLeaderboard->Update(g_Config.m_SvSqlLeaderboardRefresh);
+}
+
 bool CSQL::connect()
 {
 	try 
@@ -116,6 +218,7 @@ void CSQL::create_tables()
 static void update_score_thread(void *user)
 {
 	lock_wait(SQLLock);
+	atomic_dec(&s_QueueDepth);
 	
 	CSqlData *Data = (CSqlData *)user;
 	
@@ -124,22 +227,17 @@ static void update_score_thread(void *user)
 	{
 		try
 		{
-			// check if Account exists
+			// check if Account exists, by the id that was stored when the score was queued
+			// the player may have left since, the leaderboard already counted the score
 			char buf[1024];
-			str_format(buf, sizeof(buf), "SELECT * FROM %s_Account WHERE Username='%s';", Data->m_SqlData->prefix, Data->name);
+			str_format(buf, sizeof(buf), "SELECT UserID FROM %s_Account WHERE UserID=%d;", Data->m_SqlData->prefix, Data->UserID[Data->m_ClientID]);
 			Data->m_SqlData->results = Data->m_SqlData->statement->executeQuery(buf);
 			if(Data->m_SqlData->results->next())
 			{
 				// update Account data
-				CPlayer *p = GameServer()->m_apPlayers[Data->m_ClientID];
-				if(!p)
-				{
-					lock_unlock(SQLLock);
-					return;
-				}
-				str_format(buf, sizeof(buf), "UPDATE %s_Account SET ZombieScore=ZombieScore%s WHERE UserID=%d;", Data->m_SqlData->prefix, Data->ZombieScore, Data->UserID[Data->m_ClientID]);
+				str_format(buf, sizeof(buf), "UPDATE %s_Account SET ZombieScore=ZombieScore+%d WHERE UserID=%d;", Data->m_SqlData->prefix, Data->ZombieScore, Data->UserID[Data->m_ClientID]);
 				Data->m_SqlData->statement->execute(buf);
-				str_format(buf, sizeof(buf), "UPDATE %s_Account SET HumanScore=HumanScore%s WHERE UserID=%d;", Data->m_SqlData->prefix, Data->HumanScore, Data->UserID[Data->m_ClientID]);
+				str_format(buf, sizeof(buf), "UPDATE %s_Account SET HumanScore=HumanScore+%d WHERE UserID=%d;", Data->m_SqlData->prefix, Data->HumanScore, Data->UserID[Data->m_ClientID]);
 				Data->m_SqlData->statement->execute(buf);
 			}
 			else
@@ -151,7 +249,7 @@ static void update_score_thread(void *user)
 		}
 		catch (sql::SQLException &e)
 		{
-			dbg_msg("SQL", "ERROR: Could not update Account (Why: %s) (ClientID: %d, UserID: %d)", e.what(), Data->m_ClientID, Data->UserID);
+			dbg_msg("SQL", "ERROR: Could not update Account (Why: %s) (ClientID: %d, UserID: %d)", e.what(), Data->m_ClientID, Data->UserID[Data->m_ClientID]);
 		}
 		
 		// disconnect from Database
@@ -163,24 +261,42 @@ static void update_score_thread(void *user)
 	lock_unlock(SQLLock);
 }
 
-void CSQL::UpdateScore(int m_ClientID, const char *hscore, const char *zscore)
+void CSQL::UpdateScore(int m_ClientID, int HumanScore, int ZombieScore)
 {
+	CPlayer *pPlayer = GameServer()->m_apPlayers[m_ClientID];
 	CSqlData *tmp = new CSqlData();
 	tmp->m_ClientID = m_ClientID;
-	tmp->UserID[m_ClientID] = GameServer()->m_apPlayers[m_ClientID]->m_AccData.m_UserID;
-	tmp->HumanScore = hscore;
-	tmp->ZombieScore = zscore;
+	tmp->UserID[m_ClientID] = pPlayer->m_AccData.m_UserID;
+	tmp->HumanScore = HumanScore;
+	tmp->ZombieScore = ZombieScore;
 	tmp->m_SqlData = this;
 	
+	// counted as queued before the sequence moves, and written only after it moved, otherwise
+	// a fetch could read the update from the table and still replay it from the journal
+	atomic_inc(&s_QueueDepth);
+	s_pLeaderboard->AddScore(pPlayer->m_AccData.m_UserID, pPlayer->m_AccData.m_Username, CLeaderboard::TEAM_HUMAN, HumanScore);
+	s_pLeaderboard->AddScore(pPlayer->m_AccData.m_UserID, pPlayer->m_AccData.m_Username, CLeaderboard::TEAM_ZOMBIE, ZombieScore);
+
 	void *UpdateScoreThread = thread_init(update_score_thread, tmp);
 #if defined(CONF_FAMILY_UNIX)
 	pthread_detach((pthread_t)UpdateScoreThread);
 #endif
 }
+
+int CSQL::GetScore(int m_ClientID, int Team)
+{
+	CPlayer *pPlayer = GameServer()->m_apPlayers[m_ClientID];
+	if(!pPlayer || !pPlayer->LoggedIn || Team < 0 || Team >= CLeaderboard::NUM_TEAMS)
+		return 0;
+
+	const CLeaderboardAccount *pAccount = s_pLeaderboard->GetAccount(pPlayer->m_AccData.m_UserID);
+	return pAccount ? pAccount->m_aScores[Team] : 0;
+}
 // show top5
 static void show_top5_thread(void *user)
 {
 	lock_wait(SQLLock);
+	atomic_dec(&s_QueueDepth);
 	
 	CSqlData *Data = (CSqlData *)user;
 
@@ -233,22 +349,83 @@ static void show_top5_thread(void *user)
 
 void CSQL::ShowTop5(int m_ClientID, const char *Team)
 {
+	// asked the database directly until the leaderboard is loaded
+	if(s_pLeaderboard->IsLoaded())
+	{
+		if(!GameServer()->m_apPlayers[m_ClientID] || !GameServer()->m_apPlayers[m_ClientID]->LoggedIn)
+		{
+			GameServer()->SendChatTarget_Localization(m_ClientID, CHATCATEGORY_DEFAULT, _("You must login to use it."), NULL);
+			return;
+		}
+
+		int BoardTeam = str_comp(Team, "Zombie") == 0 ? CLeaderboard::TEAM_ZOMBIE : CLeaderboard::TEAM_HUMAN;
+		const CLeaderboardAccount *apTop[5];
+		int NumTop = s_pLeaderboard->GetTop(BoardTeam, apTop, 5);
+
+		GameServer()->SendChatTarget_Localization(m_ClientID, CHATCATEGORY_DEFAULT, _("--------Top5 Players--------"), NULL);
+		for(int i = 0; i < NumTop; i++)
+		{
+			int Rank = i+1;
+			int TopScore = apTop[i]->m_aScores[BoardTeam];
+			GameServer()->SendChatTarget_Localization(m_ClientID, 
+			CHATCATEGORY_DEFAULT, _("{int:Rank}. {str:Name} :{int:Score} Score"),
+				"Rank", &Rank, 
+				"Name", apTop[i]->m_aName,
+				"Score", &TopScore,
+				  NULL);
+		}
+		return;
+	}
+
 	CSqlData *tmp = new CSqlData();
 	tmp->m_ClientID = m_ClientID;
 	tmp->UserID[m_ClientID] = GameServer()->m_apPlayers[m_ClientID]->m_AccData.m_UserID;
 	str_copy(tmp->team, Team, sizeof(tmp->team));
 	tmp->m_SqlData = this;
 	
+	atomic_inc(&s_QueueDepth);
 	void *ShowTop5Thread = thread_init(show_top5_thread, tmp);
 #if defined(CONF_FAMILY_UNIX)
 	pthread_detach((pthread_t)ShowTop5Thread);
 #endif
 }
 
+void CSQL::ShowRank(int m_ClientID)
+{
+	CPlayer *pPlayer = GameServer()->m_apPlayers[m_ClientID];
+	if(!pPlayer || !pPlayer->LoggedIn)
+	{
+		GameServer()->SendChatTarget_Localization(m_ClientID, CHATCATEGORY_DEFAULT, _("You must login to use it."), NULL);
+		return;
+	}
+	if(!s_pLeaderboard->IsLoaded())
+	{
+		GameServer()->SendChatTarget_Localization(m_ClientID, CHATCATEGORY_DEFAULT, _("The ranking is not loaded yet, please try again later."), NULL);
+		return;
+	}
+
+	int HumanRank = s_pLeaderboard->GetRank(CLeaderboard::TEAM_HUMAN, pPlayer->m_AccData.m_UserID);
+	int ZombieRank = s_pLeaderboard->GetRank(CLeaderboard::TEAM_ZOMBIE, pPlayer->m_AccData.m_UserID);
+	int HumanScore = GetScore(m_ClientID, CLeaderboard::TEAM_HUMAN);
+	int ZombieScore = GetScore(m_ClientID, CLeaderboard::TEAM_ZOMBIE);
+	int NumAccounts = s_pLeaderboard->NumAccounts();
+	if(!HumanRank || !ZombieRank)
+	{
+		GameServer()->SendChatTarget_Localization(m_ClientID, CHATCATEGORY_DEFAULT, _("You are not ranked yet."), NULL);
+		return;
+	}
+
+	GameServer()->SendChatTarget_Localization(m_ClientID, CHATCATEGORY_DEFAULT, _("Human rank: {int:Rank} of {int:Num} ({int:Score} Score)"),
+		"Rank", &HumanRank, "Num", &NumAccounts, "Score", &HumanScore, NULL);
+	GameServer()->SendChatTarget_Localization(m_ClientID, CHATCATEGORY_DEFAULT, _("Zombie rank: {int:Rank} of {int:Num} ({int:Score} Score)"),
+		"Rank", &ZombieRank, "Num", &NumAccounts, "Score", &ZombieScore, NULL);
+}
+
 // create Account
 static void create_account_thread(void *user)
 {
 	lock_wait(SQLLock);
+	atomic_dec(&s_QueueDepth);
 	
 	CSqlData *Data = (CSqlData *)user;
 	
@@ -311,6 +488,7 @@ void CSQL::create_account(const char* name, const char* pass, int m_ClientID)
 	tmp->m_ClientID = m_ClientID;
 	tmp->m_SqlData = this;
 	
+	atomic_inc(&s_QueueDepth);
 	void *register_thread = thread_init(create_account_thread, tmp);
 #if defined(CONF_FAMILY_UNIX)
 	pthread_detach((pthread_t)register_thread);
@@ -321,6 +499,7 @@ void CSQL::create_account(const char* name, const char* pass, int m_ClientID)
 static void change_password_thread(void *user)
 {
 	lock_wait(SQLLock);
+	atomic_dec(&s_QueueDepth);
 	
 	CSqlData *Data = (CSqlData *)user;
 	
@@ -389,6 +568,7 @@ void CSQL::change_password(int m_ClientID, const char* new_pass)
 	str_copy(tmp->pass, new_pass, sizeof(tmp->pass));
 	tmp->m_SqlData = this;
 	
+	atomic_inc(&s_QueueDepth);
 	void *change_pw_thread = thread_init(change_password_thread, tmp);
 #if defined(CONF_FAMILY_UNIX)
 	pthread_detach((pthread_t)change_pw_thread);
@@ -399,6 +579,7 @@ void CSQL::change_password(int m_ClientID, const char* new_pass)
 static void login_thread(void *user)
 {
 	lock_wait(SQLLock);
+	atomic_dec(&s_QueueDepth);
 	
 	CSqlData *Data = (CSqlData *)user;
 
@@ -455,7 +636,10 @@ static void login_thread(void *user)
 							}
 						}
 						// login should be the last thing
-						GameServer()->m_apPlayers[Data->m_ClientID]->LoggedIn = true;
+						CPlayer *pPlayer = GameServer()->m_apPlayers[Data->m_ClientID];
+						pPlayer->m_AccData.m_UserID = Data->m_SqlData->results->getInt("UserID");
+						str_copy(pPlayer->m_AccData.m_Username, Data->name, sizeof(pPlayer->m_AccData.m_Username));
+						pPlayer->LoggedIn = true;
 						dbg_msg("SQL", "Account '%s' logged in sucessfully", Data->name);
 						
 						GameServer()->SendChatTarget_Localization(Data->m_ClientID, CHATCATEGORY_DEFAULT, _("You are now logged in."));}
@@ -503,6 +687,7 @@ void CSQL::login(const char* name, const char* pass, int m_ClientID)
 	tmp->m_ClientID = m_ClientID;
 	tmp->m_SqlData = this;
 	
+	atomic_inc(&s_QueueDepth);
 	void *login_account_thread = thread_init(login_thread, tmp);
 #if defined(CONF_FAMILY_UNIX)
 	pthread_detach((pthread_t)login_account_thread);
@@ -512,6 +697,7 @@ void CSQL::login(const char* name, const char* pass, int m_ClientID)
 static void SyncThread(void *user)
 {
 	lock_wait(SQLLock);
+	atomic_dec(&s_QueueDepth);
 	
 	CSqlData *Data = (CSqlData *)user;
 
@@ -559,6 +745,7 @@ static void SyncThread(void *user)
 static void update_thread(void *user)
 {
 	lock_wait(SQLLock);
+	atomic_dec(&s_QueueDepth);
 	
 	CSqlData *Data = (CSqlData *)user;
 
@@ -627,6 +814,7 @@ void CSQL::update(int m_ClientID)
 
 	tmp->m_SqlData = this;
 	
+	atomic_inc(&s_QueueDepth);
 	void *update_account_thread = thread_init(update_thread, tmp);
 #if defined(CONF_FAMILY_UNIX)
 	pthread_detach((pthread_t)update_account_thread);
@@ -703,6 +891,7 @@ void CSQL::SyncAccountData(int ClientID)
 	tmp->UserID[ClientID] = GameServer()->m_apPlayers[ClientID]->m_AccData.m_UserID;
 	tmp->m_SqlData = this;
 	
+	atomic_inc(&s_QueueDepth);
 	void *Sync_Thread = thread_init(SyncThread, tmp);
 #if defined(CONF_FAMILY_UNIX)
 	pthread_detach((pthread_t)Sync_Thread);
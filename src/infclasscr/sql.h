@@ -2,6 +2,7 @@
 /* SQL Class by Sushi */
 
 #include <engine/shared/protocol.h>
+#include <infclasscr/leaderboard.h>
 
 #include <mysql_connection.h>
 	
@@ -42,9 +43,17 @@ public:
 	void update_all();
 	void SyncAccountData(int ClientID);
 
-	void UpdateScore(int m_ClientID, const char *hscore, const char *zscore);
-	int GetScore(int m_ClientID);
+	// requests started but still waiting for the database
+	static int QueueDepth();
+
+	void UpdateScore(int m_ClientID, int HumanScore, int ZombieScore);
+	int GetScore(int m_ClientID, int Team);
 	void ShowTop5(int m_ClientID, const char *Team);
+	void ShowRank(int m_ClientID);
+
+	// the scores of all accounts, shared by the game contexts of every map
+	static CLeaderboard *Leaderboard();
+	void Tick();
 
 /*	static void update_score_thread(void *user);
 	static void change_password_thread(void *user);
@@ -60,8 +69,8 @@ struct CSqlData
 	char name[32];
 	char pass[32];
 	char team[8];
-	const char* HumanScore;
-	const char* ZombieScore;
+	int HumanScore;
+	int ZombieScore;
 	int m_ClientID;
 };
 
@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
 
 #include <engine/config.h>
@@ -17,9 +18,87 @@
 enum {
 	MTU = 1400,
 	MAX_SERVERS_PER_PACKET=75,
-	MAX_PACKETS=16,
+	MAX_PACKETS=64,
 	MAX_SERVERS=MAX_SERVERS_PER_PACKET*MAX_PACKETS,
-	EXPIRE_TIME = 90
+	EXPIRE_TIME = 90,
+	ADDR_INDEX_SIZE=16*1024, // power of two, keeps the index less than a third full
+};
+
+// finds table entries by address, the same address may be added for several entries
+class CAddrIndex
+{
+	NETADDR m_aAddr[ADDR_INDEX_SIZE];
+	int m_aEntry[ADDR_INDEX_SIZE]; // -1 for an empty slot
+
+	static unsigned Hash(const NETADDR *pAddr)
+	{
+		const unsigned char *pData = (const unsigned char *)pAddr;
+		unsigned Hash = 2166136261u;
+		for(unsigned i = 0; i < sizeof(NETADDR); i++)
+			Hash = (Hash^pData[i])*16777619u;
+		return Hash&(ADDR_INDEX_SIZE-1);
+	}
+
+	int FindSlot(const NETADDR *pAddr, int Entry) const
+	{
+		for(unsigned Slot = Hash(pAddr); m_aEntry[Slot] != -1; Slot = (Slot+1)&(ADDR_INDEX_SIZE-1))
+		{
+			if((Entry == -1 || m_aEntry[Slot] == Entry) && net_addr_comp(&m_aAddr[Slot], pAddr) == 0)
+				return Slot;
+		}
+		return -1;
+	}
+
+public:
+	void Clear()
+	{
+		for(int i = 0; i < ADDR_INDEX_SIZE; i++)
+			m_aEntry[i] = -1;
+	}
+
+	int Find(const NETADDR *pAddr) const
+	{
+		int Slot = FindSlot(pAddr, -1);
+		return Slot == -1 ? -1 : m_aEntry[Slot];
+	}
+
+	void Add(const NETADDR *pAddr, int Entry)
+	{
+		unsigned Slot = Hash(pAddr);
+		while(m_aEntry[Slot] != -1)
+			Slot = (Slot+1)&(ADDR_INDEX_SIZE-1);
+		m_aAddr[Slot] = *pAddr;
+		m_aEntry[Slot] = Entry;
+	}
+
+	// the entry moved to another place in its table
+	void Move(const NETADDR *pAddr, int Entry, int NewEntry)
+	{
+		int Slot = FindSlot(pAddr, Entry);
+		if(Slot != -1)
+			m_aEntry[Slot] = NewEntry;
+	}
+
+	void Remove(const NETADDR *pAddr, int Entry)
+	{
+		int Slot = FindSlot(pAddr, Entry);
+		if(Slot == -1)
+			return;
+
+		// shift the following entries back so that no lookup stops early at the hole
+		unsigned Hole = Slot;
+		for(unsigned Next = (Hole+1)&(ADDR_INDEX_SIZE-1); m_aEntry[Next] != -1; Next = (Next+1)&(ADDR_INDEX_SIZE-1))
+		{
+			unsigned Home = Hash(&m_aAddr[Next]);
+			if(((Next-Home)&(ADDR_INDEX_SIZE-1)) >= ((Next-Hole)&(ADDR_INDEX_SIZE-1)))
+			{
+				m_aAddr[Hole] = m_aAddr[Next];
+				m_aEntry[Hole] = m_aEntry[Next];
+				Hole = Next;
+			}
+		}
+		m_aEntry[Hole] = -1;
+	}
 };
 
 struct CCheckServer
@@ -33,16 +112,20 @@ struct CCheckServer
 
 static CCheckServer m_aCheckServers[MAX_SERVERS];
 static int m_NumCheckServers = 0;
+static CAddrIndex m_CheckServerIndex; // by address
+static CAddrIndex m_CheckServerAltIndex; // by alternative address
 
 struct CServerEntry
 {
 	enum ServerType m_Type;
 	NETADDR m_Address;
 	int64 m_Expire;
+	int m_ListSlot; // place in the list packets of its type
 };
 
 static CServerEntry m_aServers[MAX_SERVERS];
 static int m_NumServers = 0;
+static CAddrIndex m_ServerIndex;
 
 struct CPacketData
 {
@@ -69,6 +152,12 @@ struct CPacketDataLegacy
 CPacketDataLegacy m_aPacketsLegacy[MAX_PACKETS];
 static int m_NumPacketsLegacy = 0;
 
+// the servers in the list packets, by slot
+static int m_aListedServers[MAX_SERVERS];
+static int m_NumListed = 0;
+static int m_aListedServersLegacy[MAX_SERVERS];
+static int m_NumListedLegacy = 0;
+
 
 struct CCountPacketData
 {
@@ -88,84 +177,108 @@ static CNetClient m_NetOp; // main
 
 IConsole *m_pConsole;
 
-void BuildPackets()
+void InitPackets()
 {
-	CServerEntry *pCurrent = &m_aServers[0];
-	int ServersLeft = m_NumServers;
-	m_NumPackets = 0;
-	m_NumPacketsLegacy = 0;
-	int PacketIndex = 0;
-	int PacketIndexLegacy = 0;
-	while(ServersLeft-- && (m_NumPackets + m_NumPacketsLegacy) < MAX_PACKETS)
+	for(int i = 0; i < MAX_PACKETS; i++)
 	{
-		if(pCurrent->m_Type == SERVERTYPE_NORMAL)
-		{
-			if(PacketIndex % MAX_SERVERS_PER_PACKET == 0)
-			{
-				PacketIndex = 0;
-				m_NumPackets++;
-			}
-
-			// copy header
-			mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aHeader, SERVERBROWSE_LIST, sizeof(SERVERBROWSE_LIST));
-
-			// copy server addresses
-			if(pCurrent->m_Address.type == NETTYPE_IPV6)
-			{
-				mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp, pCurrent->m_Address.ip,
-					sizeof(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp));
-			}
-			else
-			{
-				static char IPV4Mapping[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF };
-
-				mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp, IPV4Mapping, sizeof(IPV4Mapping));
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[12] = pCurrent->m_Address.ip[0];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[13] = pCurrent->m_Address.ip[1];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[14] = pCurrent->m_Address.ip[2];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[15] = pCurrent->m_Address.ip[3];
-			}
+		mem_copy(m_aPackets[i].m_Data.m_aHeader, SERVERBROWSE_LIST, sizeof(SERVERBROWSE_LIST));
+		mem_copy(m_aPacketsLegacy[i].m_Data.m_aHeader, SERVERBROWSE_LIST_LEGACY, sizeof(SERVERBROWSE_LIST_LEGACY));
+	}
+}
 
-			m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aPort[0] = (pCurrent->m_Address.port>>8)&0xff;
-			m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aPort[1] = pCurrent->m_Address.port&0xff;
+// the list packets are kept up to date while servers come and go, a slot keeps its server until it is removed
+void WriteListSlot(int Slot)
+{
+	CServerEntry *pCurrent = &m_aServers[m_aListedServers[Slot]];
+	CMastersrvAddr *pAddr = &m_aPackets[Slot/MAX_SERVERS_PER_PACKET].m_Data.m_aServers[Slot%MAX_SERVERS_PER_PACKET];
 
-			PacketIndex++;
+	// copy server addresses
+	if(pCurrent->m_Address.type == NETTYPE_IPV6)
+	{
+		mem_copy(pAddr->m_aIp, pCurrent->m_Address.ip, sizeof(pAddr->m_aIp));
+	}
+	else
+	{
+		static const unsigned char IPV4Mapping[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF };
 
-			m_aPackets[m_NumPackets-1].m_Size = sizeof(SERVERBROWSE_LIST) + sizeof(CMastersrvAddr)*PacketIndex;
+		mem_copy(pAddr->m_aIp, IPV4Mapping, sizeof(IPV4Mapping));
+		pAddr->m_aIp[12] = pCurrent->m_Address.ip[0];
+		pAddr->m_aIp[13] = pCurrent->m_Address.ip[1];
+		pAddr->m_aIp[14] = pCurrent->m_Address.ip[2];
+		pAddr->m_aIp[15] = pCurrent->m_Address.ip[3];
+	}
 
-			pCurrent++;
-		}
-		else if(pCurrent->m_Type == SERVERTYPE_LEGACY)
-		{
-			if(PacketIndexLegacy % MAX_SERVERS_PER_PACKET == 0)
-			{
-				PacketIndexLegacy = 0;
-				m_NumPacketsLegacy++;
-			}
+	pAddr->m_aPort[0] = (pCurrent->m_Address.port>>8)&0xff;
+	pAddr->m_aPort[1] = pCurrent->m_Address.port&0xff;
+}
 
-			// copy header
-			mem_copy(m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aHeader, SERVERBROWSE_LIST_LEGACY, sizeof(SERVERBROWSE_LIST_LEGACY));
+void WriteListSlotLegacy(int Slot)
+{
+	CServerEntry *pCurrent = &m_aServers[m_aListedServersLegacy[Slot]];
+	CMastersrvAddrLegacy *pAddr = &m_aPacketsLegacy[Slot/MAX_SERVERS_PER_PACKET].m_Data.m_aServers[Slot%MAX_SERVERS_PER_PACKET];
+
+	// copy server addresses
+	mem_copy(pAddr->m_aIp, pCurrent->m_Address.ip, sizeof(pAddr->m_aIp));
+	// 0.5 has the port in little endian on the network
+	pAddr->m_aPort[0] = pCurrent->m_Address.port&0xff;
+	pAddr->m_aPort[1] = (pCurrent->m_Address.port>>8)&0xff;
+}
 
-			// copy server addresses
-			mem_copy(m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aServers[PacketIndexLegacy].m_aIp, pCurrent->m_Address.ip,
-				sizeof(m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aServers[PacketIndexLegacy].m_aIp));
-			// 0.5 has the port in little endian on the network
-			m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aServers[PacketIndexLegacy].m_aPort[0] = pCurrent->m_Address.port&0xff;
-			m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aServers[PacketIndexLegacy].m_aPort[1] = (pCurrent->m_Address.port>>8)&0xff;
+void UpdatePacketSizes()
+{
+	m_NumPackets = (m_NumListed+MAX_SERVERS_PER_PACKET-1)/MAX_SERVERS_PER_PACKET;
+	for(int i = 0; i < m_NumPackets; i++)
+		m_aPackets[i].m_Size = sizeof(SERVERBROWSE_LIST) + sizeof(CMastersrvAddr)*min(m_NumListed-i*MAX_SERVERS_PER_PACKET, (int)MAX_SERVERS_PER_PACKET);
 
-			PacketIndexLegacy++;
+	m_NumPacketsLegacy = (m_NumListedLegacy+MAX_SERVERS_PER_PACKET-1)/MAX_SERVERS_PER_PACKET;
+	for(int i = 0; i < m_NumPacketsLegacy; i++)
+		m_aPacketsLegacy[i].m_Size = sizeof(SERVERBROWSE_LIST_LEGACY) + sizeof(CMastersrvAddrLegacy)*min(m_NumListedLegacy-i*MAX_SERVERS_PER_PACKET, (int)MAX_SERVERS_PER_PACKET);
+}
 
-			m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Size = sizeof(SERVERBROWSE_LIST_LEGACY) + sizeof(CMastersrvAddrLegacy)*PacketIndexLegacy;
+void ListServer(int ServerIndex)
+{
+	CServerEntry *pServer = &m_aServers[ServerIndex];
+	if(pServer->m_Type == SERVERTYPE_NORMAL)
+	{
+		pServer->m_ListSlot = m_NumListed++;
+		m_aListedServers[pServer->m_ListSlot] = ServerIndex;
+		WriteListSlot(pServer->m_ListSlot);
+	}
+	else
+	{
+		pServer->m_ListSlot = m_NumListedLegacy++;
+		m_aListedServersLegacy[pServer->m_ListSlot] = ServerIndex;
+		WriteListSlotLegacy(pServer->m_ListSlot);
+	}
+	UpdatePacketSizes();
+}
 
-			pCurrent++;
+void UnlistServer(int ServerIndex)
+{
+	// the last server of the list takes over the slot
+	CServerEntry *pServer = &m_aServers[ServerIndex];
+	int Slot = pServer->m_ListSlot;
+	if(pServer->m_Type == SERVERTYPE_NORMAL)
+	{
+		int Last = m_aListedServers[--m_NumListed];
+		if(Last != ServerIndex)
+		{
+			m_aListedServers[Slot] = Last;
+			m_aServers[Last].m_ListSlot = Slot;
+			WriteListSlot(Slot);
 		}
-		else
+	}
+	else
+	{
+		int Last = m_aListedServersLegacy[--m_NumListedLegacy];
+		if(Last != ServerIndex)
 		{
-			*pCurrent = m_aServers[m_NumServers-1];
-			m_NumServers--;
-			dbg_msg("mastersrv", "error: server of invalid type, dropping it");
+			m_aListedServersLegacy[Slot] = Last;
+			m_aServers[Last].m_ListSlot = Slot;
+			WriteListSlotLegacy(Slot);
 		}
 	}
+	UpdatePacketSizes();
 }
 
 void SendOk(NETADDR *pAddr)
@@ -206,6 +319,17 @@ void SendCheck(NETADDR *pAddr)
 
 void AddCheckserver(NETADDR *pInfo, NETADDR *pAlt, ServerType Type)
 {
+	// a heartbeat during the check only updates it
+	int Index = m_CheckServerIndex.Find(pInfo);
+	if(Index != -1)
+	{
+		m_CheckServerAltIndex.Remove(&m_aCheckServers[Index].m_AltAddress, Index);
+		m_aCheckServers[Index].m_AltAddress = *pAlt;
+		m_aCheckServers[Index].m_Type = Type;
+		m_CheckServerAltIndex.Add(pAlt, Index);
+		return;
+	}
+
 	// add server
 	if(m_NumCheckServers == MAX_SERVERS)
 	{
@@ -223,22 +347,39 @@ void AddCheckserver(NETADDR *pInfo, NETADDR *pAlt, ServerType Type)
 	m_aCheckServers[m_NumCheckServers].m_TryCount = 0;
 	m_aCheckServers[m_NumCheckServers].m_TryTime = 0;
 	m_aCheckServers[m_NumCheckServers].m_Type = Type;
+	m_CheckServerIndex.Add(pInfo, m_NumCheckServers);
+	m_CheckServerAltIndex.Add(pAlt, m_NumCheckServers);
 	m_NumCheckServers++;
 }
 
+void RemoveCheckserver(int Index)
+{
+	CCheckServer *pCheck = &m_aCheckServers[Index];
+	m_CheckServerIndex.Remove(&pCheck->m_Address, Index);
+	m_CheckServerAltIndex.Remove(&pCheck->m_AltAddress, Index);
+
+	// the last one takes the place
+	int Last = m_NumCheckServers-1;
+	if(Index != Last)
+	{
+		*pCheck = m_aCheckServers[Last];
+		m_CheckServerIndex.Move(&pCheck->m_Address, Last, Index);
+		m_CheckServerAltIndex.Move(&pCheck->m_AltAddress, Last, Index);
+	}
+	m_NumCheckServers--;
+}
+
 void AddServer(NETADDR *pInfo, ServerType Type)
 {
 	// see if server already exists in list
-	for(int i = 0; i < m_NumServers; i++)
+	int Index = m_ServerIndex.Find(pInfo);
+	if(Index != -1)
 	{
-		if(net_addr_comp(&m_aServers[i].m_Address, pInfo) == 0)
-		{
-			char aAddrStr[NETADDR_MAXSTRSIZE];
-			net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
-			dbg_msg("mastersrv", "updated: %s", aAddrStr);
-			m_aServers[i].m_Expire = time_get()+time_freq()*EXPIRE_TIME;
-			return;
-		}
+		char aAddrStr[NETADDR_MAXSTRSIZE];
+		net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
+		dbg_msg("mastersrv", "updated: %s", aAddrStr);
+		m_aServers[Index].m_Expire = time_get()+time_freq()*EXPIRE_TIME;
+		return;
 	}
 
 	// add server
@@ -254,9 +395,31 @@ void AddServer(NETADDR *pInfo, ServerType Type)
 	m_aServers[m_NumServers].m_Address = *pInfo;
 	m_aServers[m_NumServers].m_Expire = time_get()+time_freq()*EXPIRE_TIME;
 	m_aServers[m_NumServers].m_Type = Type;
+	m_ServerIndex.Add(pInfo, m_NumServers);
+	ListServer(m_NumServers);
 	m_NumServers++;
 }
 
+void RemoveServer(int Index)
+{
+	CServerEntry *pServer = &m_aServers[Index];
+	UnlistServer(Index);
+	m_ServerIndex.Remove(&pServer->m_Address, Index);
+
+	// the last one takes the place
+	int Last = m_NumServers-1;
+	if(Index != Last)
+	{
+		*pServer = m_aServers[Last];
+		m_ServerIndex.Move(&pServer->m_Address, Last, Index);
+		if(pServer->m_Type == SERVERTYPE_NORMAL)
+			m_aListedServers[pServer->m_ListSlot] = Index;
+		else
+			m_aListedServersLegacy[pServer->m_ListSlot] = Index;
+	}
+	m_NumServers--;
+}
+
 void UpdateServers()
 {
 	int64 Now = time_get();
@@ -275,8 +438,7 @@ void UpdateServers()
 
 				// FAIL!!
 				SendError(&m_aCheckServers[i].m_Address);
-				m_aCheckServers[i] = m_aCheckServers[m_NumCheckServers-1];
-				m_NumCheckServers--;
+				RemoveCheckserver(i);
 				i--;
 			}
 			else
@@ -304,8 +466,7 @@ void PurgeServers()
 			char aAddrStr[NETADDR_MAXSTRSIZE];
 			net_addr_str(&m_aServers[i].m_Address, aAddrStr, sizeof(aAddrStr), true);
 			dbg_msg("mastersrv", "expired: %s", aAddrStr);
-			m_aServers[i] = m_aServers[m_NumServers-1];
-			m_NumServers--;
+			RemoveServer(i);
 		}
 		else
 			i++;
@@ -329,6 +490,10 @@ int main(int argc, const char **argv) // ignore_convention
 
 	mem_copy(m_CountData.m_Header, SERVERBROWSE_COUNT, sizeof(SERVERBROWSE_COUNT));
 	mem_copy(m_CountDataLegacy.m_Header, SERVERBROWSE_COUNT_LEGACY, sizeof(SERVERBROWSE_COUNT_LEGACY));
+	InitPackets();
+	m_CheckServerIndex.Clear();
+	m_CheckServerAltIndex.Clear();
+	m_ServerIndex.Clear();
 
 	IKernel *pKernel = IKernel::Create();
 	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, argc, argv);
@@ -497,16 +662,13 @@ int main(int argc, const char **argv) // ignore_convention
 			{
 				Type = SERVERTYPE_INVALID;
 				// remove it from checking
-				for(int i = 0; i < m_NumCheckServers; i++)
+				int Index = m_CheckServerIndex.Find(&Packet.m_Address);
+				if(Index == -1)
+					Index = m_CheckServerAltIndex.Find(&Packet.m_Address);
+				if(Index != -1)
 				{
-					if(net_addr_comp(&m_aCheckServers[i].m_Address, &Packet.m_Address) == 0 ||
-						net_addr_comp(&m_aCheckServers[i].m_AltAddress, &Packet.m_Address) == 0)
-					{
-						Type = m_aCheckServers[i].m_Type;
-						m_NumCheckServers--;
-						m_aCheckServers[i] = m_aCheckServers[m_NumCheckServers];
-						break;
-					}
+					Type = m_aCheckServers[Index].m_Type;
+					RemoveCheckserver(Index);
 				}
 
 				// drops servers that were not in the CheckServers list
@@ -531,7 +693,6 @@ int main(int argc, const char **argv) // ignore_convention
 
 			PurgeServers();
 			UpdateServers();
-			BuildPackets();
 		}
 
 		// be nice to the CPU
@@ -7,11 +7,47 @@
 #include <unicode/ubidi.h>
 /* END EDIT ***********************************************************/
 
+#include <stdint.h>
+
+enum
+{
+	CATALOG_VERSION=1,
+	MAX_INTERNED_KEYS=4096,
+};
+
+struct CCatalogHeader
+{
+	char m_aID[4];
+	int m_Version;
+	int m_NumEntries;
+	int m_NumBuckets;
+	int m_TableSize;
+	int m_StringsSize;
+};
+
+//Must match Hash() in scripts/compile_languages.py
+static unsigned CatalogHash(const char* pKey, unsigned Seed)
+{
+	unsigned Hash = 2166136261u ^ Seed;
+	for(; *pKey; pKey++)
+	{
+		Hash ^= (unsigned char)*pKey;
+		Hash *= 16777619u;
+	}
+	return Hash;
+}
+
+static const char* const s_apUnresolvedKey[1] = { NULL };
+
 /* LANGUAGE ***********************************************************/
 
 CLocalization::CLanguage::CLanguage() :
 	m_Loaded(false),
 	m_Direction(CLocalization::DIRECTION_LTR),
+	m_pCatalogData(NULL),
+	m_CatalogSize(0),
+	m_apCatalogVersions(NULL),
+	m_apCatalogKeys(NULL),
 	m_pPluralRules(NULL),
 	m_pNumberFormater(NULL),
 	m_pPercentFormater(NULL),
@@ -25,6 +61,10 @@ CLocalization::CLanguage::CLanguage() :
 CLocalization::CLanguage::CLanguage(const char* pName, const char* pFilename, const char* pParentFilename) :
 	m_Loaded(false),
 	m_Direction(CLocalization::DIRECTION_LTR),
+	m_pCatalogData(NULL),
+	m_CatalogSize(0),
+	m_apCatalogVersions(NULL),
+	m_apCatalogKeys(NULL),
 	m_pPluralRules(NULL),
 	m_pNumberFormater(NULL),
 	m_pPercentFormater(NULL)
@@ -93,6 +133,12 @@ CLocalization::CLanguage::~CLanguage()
 		++Iter;
 	}
 	
+	if(m_apCatalogVersions)
+		delete[] m_apCatalogVersions;
+	if(m_apCatalogKeys)
+		delete[] m_apCatalogKeys;
+	io_unmap(m_pCatalogData, m_CatalogSize);
+	
 	if(m_pNumberFormater)
 		unum_close(m_pNumberFormater);
 	
@@ -109,6 +155,95 @@ CLocalization::CLanguage::~CLanguage()
 /* BEGIN EDIT *********************************************************/
 bool CLocalization::CLanguage::Load(CLocalization* pLocalization, CStorage* pStorage)
 /* END EDIT ***********************************************************/
+{
+	if(!LoadCatalog(pStorage) && !LoadJson(pStorage))
+		return false;
+	
+	m_Loaded = true;
+	
+	return true;
+}
+
+bool CLocalization::CLanguage::LoadCatalog(CStorage* pStorage)
+{
+#if defined(CONF_ARCH_ENDIAN_BIG)
+	return false;
+#else
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "languages/%s.catalog", m_aFilename);
+	
+	IOHANDLE File = pStorage->OpenFile(aBuf, IOFLAG_READ, CStorage::TYPE_ALL);
+	if(!File)
+		return false;
+	
+	unsigned Size = 0;
+	const void* pData = io_map(File, &Size);
+	io_close(File);
+	if(!pData)
+		return false;
+	
+	//Validate the layout before trusting any offset
+	const CCatalogHeader* pHeader = (const CCatalogHeader*)pData;
+	bool Valid = Size >= sizeof(CCatalogHeader) && mem_comp(pHeader->m_aID, "TWLC", 4) == 0 && pHeader->m_Version == CATALOG_VERSION
+		&& pHeader->m_NumEntries >= 0 && pHeader->m_NumBuckets > 0 && pHeader->m_TableSize > 0 && pHeader->m_StringsSize > 0
+		&& pHeader->m_NumEntries < 0x100000 && pHeader->m_NumBuckets < 0x100000 && pHeader->m_TableSize < 0x100000;
+	unsigned TablesSize = 0;
+	if(Valid)
+	{
+		TablesSize = sizeof(CCatalogHeader) + sizeof(int)*(pHeader->m_NumBuckets + pHeader->m_TableSize + pHeader->m_NumEntries*(1+NUM_PLURALTYPES));
+		Valid = TablesSize <= Size && (unsigned)pHeader->m_StringsSize == Size - TablesSize && ((const char*)pData)[Size-1] == 0;
+	}
+	if(!Valid)
+	{
+		dbg_msg("Localization", "Invalid localization catalog %s", aBuf);
+		io_unmap(pData, Size);
+		return false;
+	}
+	
+	const int* pDisplacements = (const int*)(pHeader+1);
+	const int* pSlots = pDisplacements + pHeader->m_NumBuckets;
+	const int* pEntries = pSlots + pHeader->m_TableSize;
+	const char* pStrings = (const char*)pData + TablesSize;
+	
+	m_apCatalogKeys = new const char*[pHeader->m_NumEntries+1];
+	m_apCatalogVersions = new const char*[pHeader->m_NumEntries*NUM_PLURALTYPES+1];
+	for(int i=0; i<pHeader->m_NumEntries; i++)
+	{
+		const int* pEntry = pEntries + i*(1+NUM_PLURALTYPES);
+		for(int j=0; j<1+NUM_PLURALTYPES; j++)
+			Valid = Valid && pEntry[j] >= -1 && pEntry[j] < pHeader->m_StringsSize && (j > 0 || pEntry[j] >= 0);
+		if(!Valid)
+			break;
+		
+		m_apCatalogKeys[i] = pStrings + pEntry[0];
+		for(int j=0; j<NUM_PLURALTYPES; j++)
+			m_apCatalogVersions[i*NUM_PLURALTYPES+j] = pEntry[1+j] >= 0 ? pStrings + pEntry[1+j] : NULL;
+	}
+	for(int i=0; i<pHeader->m_TableSize; i++)
+		Valid = Valid && pSlots[i] >= -1 && pSlots[i] < pHeader->m_NumEntries;
+	if(!Valid)
+	{
+		dbg_msg("Localization", "Invalid localization catalog %s", aBuf);
+		delete[] m_apCatalogKeys;
+		delete[] m_apCatalogVersions;
+		m_apCatalogKeys = NULL;
+		m_apCatalogVersions = NULL;
+		io_unmap(pData, Size);
+		return false;
+	}
+	
+	m_pCatalogData = pData;
+	m_CatalogSize = Size;
+	m_CatalogNumBuckets = pHeader->m_NumBuckets;
+	m_CatalogTableSize = pHeader->m_TableSize;
+	m_pCatalogDisplacements = pDisplacements;
+	m_pCatalogSlots = pSlots;
+	
+	return true;
+#endif
+}
+
+bool CLocalization::CLanguage::LoadJson(CStorage* pStorage)
 {
 	// read file data into buffer
 	char aBuf[256];
@@ -164,7 +299,7 @@ bool CLocalization::CLanguage::Load(CLocalization* pLocalization, CStorage* pSto
 					
 					//Zero
 					pPlural = rStart[i]["zero"];
-					if(pPlural && pPlural[PLURALTYPE_ZERO])
+					if(pPlural && pPlural[0])
 					{
 						Length = str_length(pPlural)+1;
 						pEntry->m_apVersions[PLURALTYPE_ZERO] = new char[Length];
@@ -172,7 +307,7 @@ bool CLocalization::CLanguage::Load(CLocalization* pLocalization, CStorage* pSto
 					}
 					//One
 					pPlural = rStart[i]["one"];
-					if(pPlural && pPlural[PLURALTYPE_ONE])
+					if(pPlural && pPlural[0])
 					{
 						Length = str_length(pPlural)+1;
 						pEntry->m_apVersions[PLURALTYPE_ONE] = new char[Length];
@@ -180,7 +315,7 @@ bool CLocalization::CLanguage::Load(CLocalization* pLocalization, CStorage* pSto
 					}
 					//Two
 					pPlural = rStart[i]["two"];
-					if(pPlural && pPlural[PLURALTYPE_TWO])
+					if(pPlural && pPlural[0])
 					{
 						Length = str_length(pPlural)+1;
 						pEntry->m_apVersions[PLURALTYPE_TWO] = new char[Length];
@@ -188,7 +323,7 @@ bool CLocalization::CLanguage::Load(CLocalization* pLocalization, CStorage* pSto
 					}
 					//Few
 					pPlural = rStart[i]["few"];
-					if(pPlural && pPlural[PLURALTYPE_FEW])
+					if(pPlural && pPlural[0])
 					{
 						Length = str_length(pPlural)+1;
 						pEntry->m_apVersions[PLURALTYPE_FEW] = new char[Length];
@@ -196,7 +331,7 @@ bool CLocalization::CLanguage::Load(CLocalization* pLocalization, CStorage* pSto
 					}
 					//Many
 					pPlural = rStart[i]["many"];
-					if(pPlural && pPlural[PLURALTYPE_MANY])
+					if(pPlural && pPlural[0])
 					{
 						Length = str_length(pPlural)+1;
 						pEntry->m_apVersions[PLURALTYPE_MANY] = new char[Length];
@@ -204,7 +339,7 @@ bool CLocalization::CLanguage::Load(CLocalization* pLocalization, CStorage* pSto
 					}
 					//Other
 					pPlural = rStart[i]["other"];
-					if(pPlural && pPlural[PLURALTYPE_OTHER])
+					if(pPlural && pPlural[0])
 					{
 						Length = str_length(pPlural)+1;
 						pEntry->m_apVersions[PLURALTYPE_OTHER] = new char[Length];
@@ -219,24 +354,58 @@ bool CLocalization::CLanguage::Load(CLocalization* pLocalization, CStorage* pSto
 	json_value_free(pJsonData);
 	delete[] pFileData;
 	
-	m_Loaded = true;
-	
 	return true;
 }
 
-const char* CLocalization::CLanguage::Localize(const char* pText) const
-{	
-	const CEntry* pEntry = m_Translations.get(pText);
+const char* const* CLocalization::CLanguage::FindVersions(const char* pKey) const
+{
+	if(m_pCatalogData)
+	{
+		int Bucket = CatalogHash(pKey, 0)%m_CatalogNumBuckets;
+		int Slot = CatalogHash(pKey, m_pCatalogDisplacements[Bucket])%m_CatalogTableSize;
+		int Entry = m_pCatalogSlots[Slot];
+		if(Entry < 0 || str_comp(m_apCatalogKeys[Entry], pKey) != 0)
+			return NULL;
+		return &m_apCatalogVersions[Entry*NUM_PLURALTYPES];
+	}
+	
+	const CEntry* pEntry = m_Translations.get(pKey);
 	if(!pEntry)
 		return NULL;
+	return pEntry->m_apVersions;
+}
+
+const char* const* CLocalization::CLanguage::GetVersions(int KeyID, const char* pKey)
+{
+	if(KeyID < 0)
+		return FindVersions(pKey);
 	
-	return pEntry->m_apVersions[PLURALTYPE_NONE];
+	if(KeyID >= m_apKeyVersions.size())
+	{
+		int OldSize = m_apKeyVersions.size();
+		m_apKeyVersions.set_size(KeyID+1);
+		for(int i=OldSize; i<m_apKeyVersions.size(); i++)
+			m_apKeyVersions[i] = s_apUnresolvedKey;
+	}
+	
+	if(m_apKeyVersions[KeyID] == s_apUnresolvedKey)
+		m_apKeyVersions[KeyID] = FindVersions(pKey);
+	return m_apKeyVersions[KeyID];
 }
 
-const char* CLocalization::CLanguage::Localize_P(int Number, const char* pText) const
+const char* CLocalization::CLanguage::Localize(int KeyID, const char* pText)
+{	
+	const char* const* pVersions = GetVersions(KeyID, pText);
+	if(!pVersions)
+		return NULL;
+	
+	return pVersions[PLURALTYPE_NONE];
+}
+
+const char* CLocalization::CLanguage::Localize_P(int Number, int KeyID, const char* pText)
 {
-	const CEntry* pEntry = m_Translations.get(pText);
-	if(!pEntry)
+	const char* const* pVersions = GetVersions(KeyID, pText);
+	if(!pVersions)
 		return NULL;
 	
 	UChar aPluralKeyWord[6];
@@ -264,7 +433,7 @@ const char* CLocalization::CLanguage::Localize_P(int Number, const char* pText)
 			PluralCode = PLURALTYPE_ONE;
 	}
 	
-	return pEntry->m_apVersions[PluralCode];
+	return pVersions[PluralCode];
 }
 
 /* LOCALIZATION *******************************************************/
@@ -273,9 +442,12 @@ const char* CLocalization::CLanguage::Localize_P(int Number, const char* pText)
 CLocalization::CLocalization(class CStorage* pStorage) :
 	m_pStorage(pStorage),
 	m_pMainLanguage(NULL),
-	m_pUtf8Converter(NULL)
+	m_pUtf8Converter(NULL),
+	m_pKeyTable(NULL),
+	m_KeyTableSize(0),
+	m_NumKeyPointers(0)
 {
-	
+	m_Lock = lock_create();
 }
 /* END EDIT ***********************************************************/
 
@@ -286,6 +458,12 @@ CLocalization::~CLocalization()
 	
 	if(m_pUtf8Converter)
 		ucnv_close(m_pUtf8Converter);
+	
+	for(int i=0; i<m_apKeys.size(); i++)
+		delete[] m_apKeys[i];
+	if(m_pKeyTable)
+		delete[] m_pKeyTable;
+	lock_destroy(m_Lock);
 }
 
 /* BEGIN EDIT *********************************************************/
@@ -347,12 +525,11 @@ bool CLocalization::Init()
 			if((const char *)rStart[i]["direction"] && str_comp((const char *)rStart[i]["direction"], "rtl") == 0)
 				pLanguage->SetWritingDirection(DIRECTION_RTL);
 				
+			//Load every language now, not in the middle of a tick
+			pLanguage->Load(this, Storage());
+			
 			if(m_Cfg_MainLanguage == pLanguage->GetFilename())
-			{
-				pLanguage->Load(this, Storage());
-				
 				m_pMainLanguage = pLanguage;
-			}
 		}
 	}
 
@@ -404,7 +581,85 @@ bool CLocalization::PreUpdate()
 	return true;
 }
 
-const char* CLocalization::LocalizeWithDepth(const char* pLanguageCode, const char* pText, int Depth)
+int CLocalization::InternKey(const char* pText)
+{
+	unsigned Hash = (unsigned)(((uintptr_t)pText >> 2) * 2654435761u);
+	int Slot = -1;
+	if(m_pKeyTable)
+	{
+		for(int i = Hash&(m_KeyTableSize-1); m_pKeyTable[i].m_pText; i = (i+1)&(m_KeyTableSize-1))
+		{
+			if(m_pKeyTable[i].m_pText == pText)
+			{
+				//The same address can be reused for another text by non-literal keys
+				if(str_comp(m_apKeys[m_pKeyTable[i].m_ID], pText) == 0)
+					return m_pKeyTable[i].m_ID;
+				Slot = i;
+				break;
+			}
+		}
+	}
+	
+	//Slow path, find the key by its text
+	const int* pID = m_KeyIDs.get(pText);
+	int ID;
+	if(pID)
+		ID = *pID;
+	else
+	{
+		if(m_apKeys.size() >= MAX_INTERNED_KEYS)
+			return -1;
+		
+		ID = m_apKeys.size();
+		int Length = str_length(pText)+1;
+		char* pKey = new char[Length];
+		str_copy(pKey, pText, Length);
+		m_apKeys.add(pKey);
+		m_KeyIDs.set(pText, ID);
+	}
+	
+	if(Slot >= 0)
+	{
+		m_pKeyTable[Slot].m_ID = ID;
+		return ID;
+	}
+	
+	//Keep the table at most half full
+	if((m_NumKeyPointers+1)*2 > m_KeyTableSize)
+	{
+		int NewSize = m_KeyTableSize ? m_KeyTableSize*2 : 256;
+		if(NewSize > 4*MAX_INTERNED_KEYS)
+			return ID;
+		
+		CInternedKey* pNewTable = new CInternedKey[NewSize];
+		mem_zero(pNewTable, sizeof(CInternedKey)*NewSize);
+		for(int i=0; i<m_KeyTableSize; i++)
+		{
+			if(!m_pKeyTable[i].m_pText)
+				continue;
+			unsigned OldHash = (unsigned)(((uintptr_t)m_pKeyTable[i].m_pText >> 2) * 2654435761u);
+			int j = OldHash&(NewSize-1);
+			while(pNewTable[j].m_pText)
+				j = (j+1)&(NewSize-1);
+			pNewTable[j] = m_pKeyTable[i];
+		}
+		if(m_pKeyTable)
+			delete[] m_pKeyTable;
+		m_pKeyTable = pNewTable;
+		m_KeyTableSize = NewSize;
+	}
+	
+	int i = Hash&(m_KeyTableSize-1);
+	while(m_pKeyTable[i].m_pText)
+		i = (i+1)&(m_KeyTableSize-1);
+	m_pKeyTable[i].m_pText = pText;
+	m_pKeyTable[i].m_ID = ID;
+	m_NumKeyPointers++;
+	
+	return ID;
+}
+
+const char* CLocalization::LocalizeWithDepth(const char* pLanguageCode, int KeyID, const char* pText, int Depth)
 {
 	CLanguage* pLanguage = m_pMainLanguage;
 	if(pLanguageCode)
@@ -422,24 +677,25 @@ const char* CLocalization::LocalizeWithDepth(const char* pLanguageCode, const ch
 	if(!pLanguage)
 		return pText;
 	
-	if(!pLanguage->IsLoaded())
-		pLanguage->Load(this, Storage());
-	
-	const char* pResult = pLanguage->Localize(pText);
+	const char* pResult = pLanguage->Localize(KeyID, pText);
 	if(pResult)
 		return pResult;
 	else if(pLanguage->GetParentFilename()[0] && Depth < 4)
-		return LocalizeWithDepth(pLanguage->GetParentFilename(), pText, Depth+1);
+		return LocalizeWithDepth(pLanguage->GetParentFilename(), KeyID, pText, Depth+1);
 	else
 		return pText;
 }
 
 const char* CLocalization::Localize(const char* pLanguageCode, const char* pText)
 {
-	return LocalizeWithDepth(pLanguageCode, pText, 0);
+	//Called from the game thread and from the sql threads
+	lock_wait(m_Lock);
+	const char* pResult = LocalizeWithDepth(pLanguageCode, InternKey(pText), pText, 0);
+	lock_release(m_Lock);
+	return pResult;
 }
 
-const char* CLocalization::LocalizeWithDepth_P(const char* pLanguageCode, int Number, const char* pText, int Depth)
+const char* CLocalization::LocalizeWithDepth_P(const char* pLanguageCode, int Number, int KeyID, const char* pText, int Depth)
 {
 	CLanguage* pLanguage = m_pMainLanguage;
 	if(pLanguageCode)
@@ -457,21 +713,21 @@ const char* CLocalization::LocalizeWithDepth_P(const char* pLanguageCode, int Nu
 	if(!pLanguage)
 		return pText;
 	
-	if(!pLanguage->IsLoaded())
-		pLanguage->Load(this, Storage());
-	
-	const char* pResult = pLanguage->Localize_P(Number, pText);
+	const char* pResult = pLanguage->Localize_P(Number, KeyID, pText);
 	if(pResult)
 		return pResult;
 	else if(pLanguage->GetParentFilename()[0] && Depth < 4)
-		return LocalizeWithDepth_P(pLanguage->GetParentFilename(), Number, pText, Depth+1);
+		return LocalizeWithDepth_P(pLanguage->GetParentFilename(), Number, KeyID, pText, Depth+1);
 	else
 		return pText;
 }
 
 const char* CLocalization::Localize_P(const char* pLanguageCode, int Number, const char* pText)
 {
-	return LocalizeWithDepth_P(pLanguageCode, Number, pText, 0);
+	lock_wait(m_Lock);
+	const char* pResult = LocalizeWithDepth_P(pLanguageCode, Number, InternKey(pText), pText, 0);
+	lock_release(m_Lock);
+	return pResult;
 }
 
 void CLocalization::AppendNumber(dynamic_string& Buffer, int& BufferIter, CLanguage* pLanguage, int Number)
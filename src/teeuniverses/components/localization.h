@@ -83,6 +83,24 @@ public:
 		int m_Direction;
 		
 		hashtable< CEntry, 128 > m_Translations;
+		
+		//Binary catalog compiled by scripts/compile_languages.py, mapped in memory
+		const void* m_pCatalogData;
+		unsigned m_CatalogSize;
+		int m_CatalogNumBuckets;
+		int m_CatalogTableSize;
+		const int* m_pCatalogDisplacements;
+		const int* m_pCatalogSlots;
+		const char** m_apCatalogVersions;
+		const char** m_apCatalogKeys;
+		
+		//Translations by interned key id, resolved on first use
+		array<const char* const*> m_apKeyVersions;
+		
+		bool LoadCatalog(class CStorage* pStorage);
+		bool LoadJson(class CStorage* pStorage);
+		const char* const* FindVersions(const char* pKey) const;
+		const char* const* GetVersions(int KeyID, const char* pKey);
 	
 	public:
 		UPluralRules* m_pPluralRules;
@@ -102,8 +120,8 @@ public:
 		inline void SetWritingDirection(int Direction) { m_Direction = Direction; }
 		inline bool IsLoaded() const { return m_Loaded; }
 		bool Load(CLocalization* pLocalization, class CStorage* pStorage);
-		const char* Localize(const char* pKey) const;
-		const char* Localize_P(int Number, const char* pText) const;
+		const char* Localize(int KeyID, const char* pKey);
+		const char* Localize_P(int Number, int KeyID, const char* pText);
 	};
 	
 	enum
@@ -119,14 +137,29 @@ protected:
 	bool m_UpdateListeners;
 	
 	UConverter* m_pUtf8Converter;
+	
+	//Message keys are interned by address, so translations can be found without hashing the text
+	struct CInternedKey
+	{
+		const char* m_pText;
+		int m_ID;
+	};
+	CInternedKey* m_pKeyTable;
+	int m_KeyTableSize;
+	int m_NumKeyPointers;
+	array<char*> m_apKeys;
+	hashtable< int, 128 > m_KeyIDs;
+	LOCK m_Lock;
+	
+	int InternKey(const char* pText);
 
 public:
 	array<CLanguage*> m_pLanguages;
 	fixed_string128 m_Cfg_MainLanguage;
 
 protected:
-	const char* LocalizeWithDepth(const char* pLanguageCode, const char* pText, int Depth);
-	const char* LocalizeWithDepth_P(const char* pLanguageCode, int Number, const char* pText, int Depth);
+	const char* LocalizeWithDepth(const char* pLanguageCode, int KeyID, const char* pText, int Depth);
+	const char* LocalizeWithDepth_P(const char* pLanguageCode, int Number, int KeyID, const char* pText, int Depth);
 	
 	void AppendNumber(dynamic_string& Buffer, int& BufferIter, CLanguage* pLanguage, int Number);
 	void AppendPercent(dynamic_string& Buffer, int& BufferIter, CLanguage* pLanguage, double Number);
@@ -0,0 +1,134 @@
+#include <base/math.h>
+#include <base/system.h>
+#include <game/server/charactermirror.h>
+
+#include <gtest/gtest.h>
+
+#include "test.h"
+
+// the loops the entities used before the mirror
+static int64 ScalarWithinRadius(const vec2 *pPos, const float *pRadius, int Num, vec2 Pos, float Radius, bool AddProximity)
+{
+	int64 Mask = 0;
+	for(int i = 0; i < Num; i++)
+		if(distance(pPos[i], Pos) < (AddProximity ? pRadius[i]+Radius : Radius))
+			Mask |= 1LL<<i;
+	return Mask;
+}
+
+static int64 ScalarWithinSegment(const vec2 *pPos, const float *pRadius, int Num, vec2 Pos0, vec2 Pos1, float Radius, bool AddProximity)
+{
+	int64 Mask = 0;
+	if(!(length(Pos0-Pos1) > 0.0f))
+		return 0;
+	for(int i = 0; i < Num; i++)
+	{
+		vec2 IntersectPos = closest_point_on_line(Pos0, Pos1, pPos[i]);
+		if(distance(pPos[i], IntersectPos) < (AddProximity ? pRadius[i]+Radius : Radius))
+			Mask |= 1LL<<i;
+	}
+	return Mask;
+}
+
+class CharacterMirror : public ::testing::Test
+{
+protected:
+	CCharacterMirror m_Mirror;
+	vec2 m_aPos[CCharacterMirror::MAX_CHARACTERS];
+	float m_aRadius[CCharacterMirror::MAX_CHARACTERS];
+	bool m_aZombie[CCharacterMirror::MAX_CHARACTERS];
+	int m_Num;
+	CTestRandom m_Random;
+
+	CharacterMirror() : m_Num(0), m_Random(35) {}
+
+	vec2 RandomPos() { return vec2(m_Random.Float()*2000.0f, m_Random.Float()*2000.0f); }
+
+	void Fill(int Num)
+	{
+		m_Num = Num;
+		m_Mirror.Clear();
+		for(int i = 0; i < Num; i++)
+		{
+			m_aPos[i] = RandomPos();
+			m_aRadius[i] = 28.0f;
+			m_aZombie[i] = m_Random.Int(2);
+			m_Mirror.Add(0, m_aPos[i], m_aRadius[i], m_aZombie[i]);
+		}
+	}
+
+	int64 TeamMask(int Flags)
+	{
+		int64 Mask = 0;
+		for(int i = 0; i < m_Num; i++)
+			if(Flags&(m_aZombie[i] ? CCharacterMirror::FLAG_ZOMBIE : CCharacterMirror::FLAG_HUMAN))
+				Mask |= 1LL<<i;
+		return Mask;
+	}
+};
+
+TEST_F(CharacterMirror, WithinRadius)
+{
+	for(int Round = 0; Round < 2000; Round++)
+	{
+		Fill(m_Random.Int(CCharacterMirror::MAX_CHARACTERS+1));
+		vec2 Pos = RandomPos();
+		// a character right on the limit, the comparison has to be strict
+		if(m_Num && Round%4 == 0)
+			Pos = m_aPos[0] + vec2(0.0f, m_aRadius[0]+100.0f);
+		bool AddProximity = Round%2;
+		int Flags = 1+Round%3;
+		int64 Expected = ScalarWithinRadius(m_aPos, m_aRadius, m_Num, Pos, 100.0f, AddProximity)&TeamMask(Flags);
+		ASSERT_EQ(Expected, m_Mirror.WithinRadius(Pos, 100.0f, AddProximity, Flags)) << "round " << Round;
+	}
+}
+
+TEST_F(CharacterMirror, WithinSegment)
+{
+	for(int Round = 0; Round < 2000; Round++)
+	{
+		Fill(m_Random.Int(CCharacterMirror::MAX_CHARACTERS+1));
+		vec2 Pos0 = RandomPos();
+		vec2 Pos1 = Round%10 == 0 ? Pos0 : Pos0 + vec2(m_Random.Float()*400.0f-200.0f, m_Random.Float()*400.0f-200.0f);
+		bool AddProximity = Round%2;
+		int Flags = 1+Round%3;
+		int64 Expected = ScalarWithinSegment(m_aPos, m_aRadius, m_Num, Pos0, Pos1, 30.0f, AddProximity)&TeamMask(Flags);
+		ASSERT_EQ(Expected, m_Mirror.WithinSegment(Pos0, Pos1, 30.0f, AddProximity, Flags)) << "round " << Round;
+	}
+}
+
+// times a full server of queries, the results show up in the test output
+TEST_F(CharacterMirror, Benchmark)
+{
+	const int NumQueries = 200000;
+	Fill(CCharacterMirror::MAX_CHARACTERS);
+	vec2 aQueries[64];
+	for(int i = 0; i < 64; i++)
+		aQueries[i] = RandomPos();
+
+	int64 Sink = 0;
+	int64 Start = time_get();
+	for(int i = 0; i < NumQueries; i++)
+		Sink += ScalarWithinRadius(m_aPos, m_aRadius, m_Num, aQueries[i%64], 100.0f, true);
+	int64 Scalar = time_get()-Start;
+
+	Start = time_get();
+	for(int i = 0; i < NumQueries; i++)
+		Sink -= m_Mirror.WithinRadius(aQueries[i%64], 100.0f, true, CCharacterMirror::FLAG_ALL);
+	int64 Mirror = time_get()-Start;
+
+	Start = time_get();
+	for(int i = 0; i < NumQueries; i++)
+		Sink += ScalarWithinSegment(m_aPos, m_aRadius, m_Num, aQueries[i%64], aQueries[(i+1)%64], 30.0f, true);
+	int64 ScalarSegment = time_get()-Start;
+
+	Start = time_get();
+	for(int i = 0; i < NumQueries; i++)
+		Sink -= m_Mirror.WithinSegment(aQueries[i%64], aQueries[(i+1)%64], 30.0f, true, CCharacterMirror::FLAG_ALL);
+	int64 MirrorSegment = time_get()-Start;
+
+	EXPECT_EQ(Sink, 0);
+	printf("%d characters, ns per query: radius scalar %.1f mirror %.1f, segment scalar %.1f mirror %.1f\n", m_Num,
+		Scalar*1e9/time_freq()/NumQueries, Mirror*1e9/time_freq()/NumQueries,
+		ScalarSegment*1e9/time_freq()/NumQueries, MirrorSegment*1e9/time_freq()/NumQueries);
+}
@@ -0,0 +1,660 @@
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/shared/compression.h>
+#include <engine/shared/huffman.h>
+#include <engine/shared/packer.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "test.h"
+
+// the table of CNetBase, it is static to network.cpp
+static const unsigned gs_aFreqTable[256+1] = {
+	1<<30,4545,2657,431,1950,919,444,482,2244,617,838,542,715,1814,304,240,754,212,647,186,
+	283,131,146,166,543,164,167,136,179,859,363,113,157,154,204,108,137,180,202,176,
+	872,404,168,134,151,111,113,109,120,126,129,100,41,20,16,22,18,18,17,19,
+	16,37,13,21,362,166,99,78,95,88,81,70,83,284,91,187,77,68,52,68,
+	59,66,61,638,71,157,50,46,69,43,11,24,13,19,10,12,12,20,14,9,
+	20,20,10,10,15,15,12,12,7,19,15,14,13,18,35,19,17,14,8,5,
+	15,17,9,15,14,18,8,10,2173,134,157,68,188,60,170,60,194,62,175,71,
+	148,67,167,78,211,67,156,69,1674,90,174,53,147,89,181,51,174,63,163,80,
+	167,94,128,122,223,153,218,77,200,110,190,73,174,69,145,66,277,143,141,60,
+	136,53,180,57,142,57,158,61,166,112,152,92,26,22,21,28,20,26,30,21,
+	32,27,20,17,23,21,30,22,22,21,27,25,17,27,23,18,39,26,15,21,
+	12,18,18,27,20,18,15,19,11,17,33,12,18,15,19,18,16,26,17,18,
+	9,10,25,22,22,17,20,16,6,16,15,20,14,18,24,335,1517};
+
+// the varint packing of the baseline, a loop for every int
+static unsigned char *OldPackInt(unsigned char *pDst, int i)
+{
+	*pDst = (i>>25)&0x40;
+	i = i^(i>>31);
+	*pDst |= i&0x3F;
+	i >>= 6;
+	if(i)
+	{
+		*pDst |= 0x80;
+		while(1)
+		{
+			pDst++;
+			*pDst = i&0x7F;
+			i >>= 7;
+			*pDst |= (i!=0)<<7;
+			if(!i)
+				break;
+		}
+	}
+	pDst++;
+	return pDst;
+}
+
+static long OldVarCompress(const int *pSrc, int Size, unsigned char *pDst)
+{
+	unsigned char *pStart = pDst;
+	for(int i = 0; i < Size/4; i++)
+		pDst = OldPackInt(pDst, pSrc[i]);
+	return (long)(pDst-pStart);
+}
+
+// the huffman coder of the baseline, 32 bits of pending codes and one byte at a time
+class COldHuffman
+{
+	enum
+	{
+		HUFFMAN_EOF_SYMBOL = 256,
+		HUFFMAN_MAX_SYMBOLS=HUFFMAN_EOF_SYMBOL+1,
+		HUFFMAN_MAX_NODES=HUFFMAN_MAX_SYMBOLS*2-1,
+		HUFFMAN_LUTBITS = 10,
+		HUFFMAN_LUTSIZE = (1<<HUFFMAN_LUTBITS),
+		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE-1)
+	};
+
+	struct CNode
+	{
+		unsigned m_Bits;
+		unsigned m_NumBits;
+		unsigned short m_aLeafs[2];
+		unsigned char m_Symbol;
+	};
+
+	struct CConstructNode
+	{
+		unsigned short m_NodeId;
+		int m_Frequency;
+	};
+
+	CNode m_aNodes[HUFFMAN_MAX_NODES];
+	CNode *m_apDecodeLut[HUFFMAN_LUTSIZE];
+	CNode *m_pStartNode;
+	int m_NumNodes;
+
+	void Setbits_r(CNode *pNode, int Bits, unsigned Depth)
+	{
+		if(pNode->m_aLeafs[1] != 0xffff)
+			Setbits_r(&m_aNodes[pNode->m_aLeafs[1]], Bits|(1<<Depth), Depth+1);
+		if(pNode->m_aLeafs[0] != 0xffff)
+			Setbits_r(&m_aNodes[pNode->m_aLeafs[0]], Bits, Depth+1);
+
+		if(pNode->m_NumBits)
+		{
+			pNode->m_Bits = Bits;
+			pNode->m_NumBits = Depth;
+		}
+	}
+
+	static void BubbleSort(CConstructNode **ppList, int Size)
+	{
+		int Changed = 1;
+		while(Changed)
+		{
+			Changed = 0;
+			for(int i = 0; i < Size-1; i++)
+			{
+				if(ppList[i]->m_Frequency < ppList[i+1]->m_Frequency)
+				{
+					CConstructNode *pTemp = ppList[i];
+					ppList[i] = ppList[i+1];
+					ppList[i+1] = pTemp;
+					Changed = 1;
+				}
+			}
+			Size--;
+		}
+	}
+
+	void ConstructTree(const unsigned *pFrequencies)
+	{
+		CConstructNode aNodesLeftStorage[HUFFMAN_MAX_SYMBOLS];
+		CConstructNode *apNodesLeft[HUFFMAN_MAX_SYMBOLS];
+		int NumNodesLeft = HUFFMAN_MAX_SYMBOLS;
+
+		for(int i = 0; i < HUFFMAN_MAX_SYMBOLS; i++)
+		{
+			m_aNodes[i].m_NumBits = 0xFFFFFFFF;
+			m_aNodes[i].m_Symbol = i;
+			m_aNodes[i].m_aLeafs[0] = 0xffff;
+			m_aNodes[i].m_aLeafs[1] = 0xffff;
+			aNodesLeftStorage[i].m_Frequency = i == HUFFMAN_EOF_SYMBOL ? 1 : pFrequencies[i];
+			aNodesLeftStorage[i].m_NodeId = i;
+			apNodesLeft[i] = &aNodesLeftStorage[i];
+		}
+		m_NumNodes = HUFFMAN_MAX_SYMBOLS;
+
+		while(NumNodesLeft > 1)
+		{
+			BubbleSort(apNodesLeft, NumNodesLeft);
+			m_aNodes[m_NumNodes].m_NumBits = 0;
+			m_aNodes[m_NumNodes].m_aLeafs[0] = apNodesLeft[NumNodesLeft-1]->m_NodeId;
+			m_aNodes[m_NumNodes].m_aLeafs[1] = apNodesLeft[NumNodesLeft-2]->m_NodeId;
+			apNodesLeft[NumNodesLeft-2]->m_NodeId = m_NumNodes;
+			apNodesLeft[NumNodesLeft-2]->m_Frequency = apNodesLeft[NumNodesLeft-1]->m_Frequency + apNodesLeft[NumNodesLeft-2]->m_Frequency;
+			m_NumNodes++;
+			NumNodesLeft--;
+		}
+
+		m_pStartNode = &m_aNodes[m_NumNodes-1];
+		Setbits_r(m_pStartNode, 0, 0);
+	}
+
+public:
+	void Init(const unsigned *pFrequencies)
+	{
+		mem_zero(this, sizeof(*this));
+		ConstructTree(pFrequencies);
+
+		for(int i = 0; i < HUFFMAN_LUTSIZE; i++)
+		{
+			unsigned Bits = i;
+			int k;
+			CNode *pNode = m_pStartNode;
+			for(k = 0; k < HUFFMAN_LUTBITS; k++)
+			{
+				pNode = &m_aNodes[pNode->m_aLeafs[Bits&1]];
+				Bits >>= 1;
+				if(pNode->m_NumBits)
+				{
+					m_apDecodeLut[i] = pNode;
+					break;
+				}
+			}
+			if(k == HUFFMAN_LUTBITS)
+				m_apDecodeLut[i] = pNode;
+		}
+	}
+
+	int Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize)
+	{
+#define HUFFMAN_MACRO_LOADSYMBOL(Sym) \
+		Bits |= m_aNodes[Sym].m_Bits << Bitcount; \
+		Bitcount += m_aNodes[Sym].m_NumBits;
+
+#define HUFFMAN_MACRO_WRITE() \
+		while(Bitcount >= 8) \
+		{ \
+			*pDst++ = (unsigned char)(Bits&0xff); \
+			if(pDst == pDstEnd) \
+				return -1; \
+			Bits >>= 8; \
+			Bitcount -= 8; \
+		}
+
+		const unsigned char *pSrc = (const unsigned char *)pInput;
+		const unsigned char *pSrcEnd = pSrc + InputSize;
+		unsigned char *pDst = (unsigned char *)pOutput;
+		unsigned char *pDstEnd = pDst + OutputSize;
+		unsigned Bits = 0;
+		unsigned Bitcount = 0;
+
+		if(InputSize)
+		{
+			int Symbol = *pSrc++;
+			while(pSrc != pSrcEnd)
+			{
+				HUFFMAN_MACRO_LOADSYMBOL(Symbol)
+				Symbol = *pSrc++;
+				HUFFMAN_MACRO_WRITE()
+			}
+			HUFFMAN_MACRO_LOADSYMBOL(Symbol)
+			HUFFMAN_MACRO_WRITE()
+		}
+
+		HUFFMAN_MACRO_LOADSYMBOL(HUFFMAN_EOF_SYMBOL)
+		HUFFMAN_MACRO_WRITE()
+		*pDst++ = Bits;
+		return (int)(pDst - (const unsigned char *)pOutput);
+
+#undef HUFFMAN_MACRO_LOADSYMBOL
+#undef HUFFMAN_MACRO_WRITE
+	}
+
+	int Decompress(const void *pInput, int InputSize, void *pOutput, int OutputSize)
+	{
+		unsigned char *pDst = (unsigned char *)pOutput;
+		const unsigned char *pSrc = (const unsigned char *)pInput;
+		unsigned char *pDstEnd = pDst + OutputSize;
+		const unsigned char *pSrcEnd = pSrc + InputSize;
+		unsigned Bits = 0;
+		unsigned Bitcount = 0;
+		CNode *pEof = &m_aNodes[HUFFMAN_EOF_SYMBOL];
+
+		while(1)
+		{
+			CNode *pNode = 0;
+			if(Bitcount >= HUFFMAN_LUTBITS)
+				pNode = m_apDecodeLut[Bits&HUFFMAN_LUTMASK];
+
+			while(Bitcount < 24 && pSrc != pSrcEnd)
+			{
+				Bits |= (*pSrc++) << Bitcount;
+				Bitcount += 8;
+			}
+
+			if(!pNode)
+				pNode = m_apDecodeLut[Bits&HUFFMAN_LUTMASK];
+			if(!pNode)
+				return -1;
+
+			if(pNode->m_NumBits)
+			{
+				Bits >>= pNode->m_NumBits;
+				Bitcount -= pNode->m_NumBits;
+			}
+			else
+			{
+				Bits >>= HUFFMAN_LUTBITS;
+				Bitcount -= HUFFMAN_LUTBITS;
+				while(1)
+				{
+					pNode = &m_aNodes[pNode->m_aLeafs[Bits&1]];
+					Bitcount--;
+					Bits >>= 1;
+					if(pNode->m_NumBits)
+						break;
+					if(Bitcount == 0)
+						return -1;
+				}
+			}
+
+			if(pNode == pEof)
+				break;
+			if(pDst == pDstEnd)
+				return -1;
+			*pDst++ = pNode->m_Symbol;
+		}
+		return (int)(pDst - (const unsigned char *)pOutput);
+	}
+};
+
+// the packer of the baseline, byte loops that write the terminator even when the string did not fit
+class COldPacker
+{
+	enum
+	{
+		PACKER_BUFFER_SIZE=1024*2
+	};
+
+	// one spare byte for that terminator
+	unsigned char m_aBuffer[PACKER_BUFFER_SIZE+1];
+	unsigned char *m_pCurrent;
+	unsigned char *m_pEnd;
+	int m_Error;
+
+public:
+	void Reset()
+	{
+		m_Error = 0;
+		m_pCurrent = m_aBuffer;
+		m_pEnd = m_pCurrent + PACKER_BUFFER_SIZE;
+	}
+
+	void AddInt(int i)
+	{
+		if(m_Error)
+			return;
+		if(m_pEnd - m_pCurrent < 6)
+			m_Error = 1;
+		else
+			m_pCurrent = OldPackInt(m_pCurrent, i);
+	}
+
+	void AddString(const char *pStr, int Limit)
+	{
+		if(m_Error)
+			return;
+		if(Limit <= 0)
+			Limit = -1;
+		while(*pStr && Limit != 0)
+		{
+			*m_pCurrent++ = *pStr++;
+			Limit--;
+			if(m_pCurrent >= m_pEnd)
+			{
+				m_Error = 1;
+				break;
+			}
+		}
+		*m_pCurrent++ = 0;
+	}
+
+	void AddRaw(const void *pData, int Size)
+	{
+		if(m_Error)
+			return;
+		if(m_pCurrent+Size >= m_pEnd)
+		{
+			m_Error = 1;
+			return;
+		}
+		const unsigned char *pSrc = (const unsigned char *)pData;
+		while(Size)
+		{
+			*m_pCurrent++ = *pSrc++;
+			Size--;
+		}
+	}
+
+	int Size() const { return (int)(m_pCurrent-m_aBuffer); }
+	const unsigned char *Data() const { return m_aBuffer; }
+	bool Error() const { return m_Error; }
+};
+
+class Codec : public ::testing::Test
+{
+protected:
+	CHuffman m_Huffman;
+	COldHuffman m_OldHuffman;
+	CTestRandom m_Random;
+
+	Codec() : m_Random(47)
+	{
+		m_Huffman.Init(gs_aFreqTable);
+		m_OldHuffman.Init(gs_aFreqTable);
+	}
+
+	// shaped like snapshot deltas, mostly zeros and small values
+	int RandomInt()
+	{
+		int r = m_Random.Int(100);
+		if(r < 70)
+			return 0;
+		if(r < 90)
+			return m_Random.Int(127)-63;
+		if(r < 98)
+			return m_Random.Int(10001)-5000;
+		return (int)(m_Random.Next()<<8^m_Random.Next());
+	}
+
+	// the first and the last value of every varint length, and their negations
+	int EdgeInt()
+	{
+		static const int s_aEdges[] = {0, 1, 63, 64, 8191, 8192, 1048575, 1048576, 134217727, 134217728, 0x7fffffff};
+		int Value = s_aEdges[m_Random.Int(sizeof(s_aEdges)/sizeof(s_aEdges[0]))];
+		return m_Random.Int(2) ? Value : ~Value;
+	}
+
+	// the rarest symbols get the longest codes and fill the pending bits fastest
+	void RandomBytes(unsigned char *pData, int Size, int Kind)
+	{
+		static const unsigned char s_aRare[] = {90, 94, 95, 99, 102, 103, 108, 118, 119, 122, 126, 127, 228, 240, 241, 248};
+		for(int i = 0; i < Size; i++)
+		{
+			if(Kind == 0)
+				pData[i] = m_Random.Next();
+			else if(Kind == 1)
+				pData[i] = s_aRare[m_Random.Int(sizeof(s_aRare))];
+			else if(Kind == 2)
+				pData[i] = 0;
+			else
+				pData[i] = i;
+		}
+	}
+
+	void CheckVarInt(const std::vector<int> &aInts)
+	{
+		int Size = aInts.size()*4;
+		std::vector<unsigned char> aOld(aInts.size()*5+1), aNew(aInts.size()*5+1);
+		long OldSize = OldVarCompress(aInts.data(), Size, aOld.data());
+		long NewSize = CVariableInt::Compress(aInts.data(), Size, aNew.data());
+		ASSERT_EQ(OldSize, NewSize);
+		ASSERT_EQ(mem_comp(aOld.data(), aNew.data(), OldSize), 0);
+
+		std::vector<int> aOut(aInts.size()+1);
+		ASSERT_EQ(CVariableInt::Decompress(aNew.data(), NewSize, aOut.data()), Size);
+		ASSERT_EQ(mem_comp(aOut.data(), aInts.data(), Size), 0);
+	}
+
+	void CheckHuffman(const unsigned char *pData, int Size, int OutputSize)
+	{
+		std::vector<unsigned char> aOld(OutputSize+1, 0xaa), aNew(OutputSize+1, 0xaa);
+		int OldSize = m_OldHuffman.Compress(pData, Size, aOld.data(), OutputSize);
+		int NewSize = m_Huffman.Compress(pData, Size, aNew.data(), OutputSize);
+		ASSERT_EQ(OldSize, NewSize) << "input " << Size << " output " << OutputSize;
+		if(NewSize < 0)
+			return;
+		ASSERT_EQ(mem_comp(aOld.data(), aNew.data(), NewSize), 0) << "input " << Size << " output " << OutputSize;
+		ASSERT_EQ(aNew[OutputSize], 0xaa) << "input " << Size << " output " << OutputSize;
+
+		std::vector<unsigned char> aOut(Size+1);
+		ASSERT_EQ(m_Huffman.Decompress(aNew.data(), NewSize, aOut.data(), Size), Size);
+		ASSERT_EQ(mem_comp(aOut.data(), pData, Size), 0);
+		ASSERT_EQ(m_OldHuffman.Decompress(aNew.data(), NewSize, aOut.data(), Size), Size);
+		if(Size > 0)
+			ASSERT_EQ(m_Huffman.Decompress(aNew.data(), NewSize, aOut.data(), Size-1), -1);
+	}
+
+	void CheckDecoders(const unsigned char *pData, int Size, int OutputSize)
+	{
+		std::vector<unsigned char> aOld(OutputSize+1), aNew(OutputSize+1);
+		int OldSize = m_OldHuffman.Decompress(pData, Size, aOld.data(), OutputSize);
+		int NewSize = m_Huffman.Decompress(pData, Size, aNew.data(), OutputSize);
+		ASSERT_EQ(OldSize, NewSize) << "input " << Size << " output " << OutputSize;
+		if(NewSize > 0)
+			ASSERT_EQ(mem_comp(aOld.data(), aNew.data(), NewSize), 0);
+	}
+};
+
+TEST_F(Codec, VarIntMatchesBaseline)
+{
+	for(int Round = 0; Round < 2000; Round++)
+	{
+		std::vector<int> aInts(m_Random.Int(1200));
+		for(unsigned i = 0; i < aInts.size(); i++)
+			aInts[i] = Round%4 == 0 ? EdgeInt() : RandomInt();
+		CheckVarInt(aInts);
+		if(HasFatalFailure())
+			FAIL() << "round " << Round;
+	}
+}
+
+TEST_F(Codec, HuffmanMatchesBaseline)
+{
+	unsigned char aData[1400];
+	for(int Round = 0; Round < 5000; Round++)
+	{
+		int Size = Round < 8 ? Round : m_Random.Int(sizeof(aData)+1);
+		RandomBytes(aData, Size, Round%4);
+		// room to spare, an output size around the compressed size and the smallest ones
+		int OutputSize = 2048;
+		if(Round%3 == 1)
+			OutputSize = 1+m_Random.Int(Size*2+8);
+		else if(Round%3 == 2)
+			OutputSize = 1+m_Random.Int(4);
+		CheckHuffman(aData, Size, OutputSize);
+		if(HasFatalFailure())
+			FAIL() << "round " << Round;
+	}
+
+	// the new coder refuses to write into an empty buffer
+	unsigned char Byte = 0xaa;
+	EXPECT_EQ(m_Huffman.Compress(aData, 0, &Byte, 0), -1);
+	EXPECT_EQ(Byte, 0xaa);
+}
+
+TEST_F(Codec, HuffmanDecoderFuzz)
+{
+	unsigned char aData[1400];
+	unsigned char aStream[4096];
+	for(int Round = 0; Round < 10000; Round++)
+	{
+		int Size;
+		if(Round%2)
+		{
+			// a valid stream, truncated and with a flipped bit
+			int In = 1+m_Random.Int(sizeof(aData));
+			RandomBytes(aData, In, m_Random.Int(4));
+			int Compressed = m_Huffman.Compress(aData, In, aStream, sizeof(aStream));
+			ASSERT_GT(Compressed, 0);
+			Size = 1+m_Random.Int(Compressed);
+			aStream[m_Random.Int(Size)] ^= 1<<m_Random.Int(8);
+		}
+		else
+		{
+			Size = m_Random.Int(64);
+			for(int i = 0; i < Size; i++)
+				aStream[i] = m_Random.Next();
+		}
+		int OutputSize = m_Random.Int(3) ? 2048 : m_Random.Int(64);
+		CheckDecoders(aStream, Size, OutputSize);
+		if(HasFatalFailure())
+			FAIL() << "round " << Round;
+
+	}
+}
+
+TEST_F(Codec, PackerMatchesBaseline)
+{
+	char aString[300];
+	unsigned char aRaw[200];
+	for(int i = 0; i < (int)sizeof(aRaw); i++)
+		aRaw[i] = m_Random.Next();
+
+	for(int Round = 0; Round < 5000; Round++)
+	{
+		CPacker Packer;
+		COldPacker OldPacker;
+		Packer.Reset();
+		OldPacker.Reset();
+		int NumOps = 1+m_Random.Int(Round%10 ? 40 : 400);
+		for(int i = 0; i < NumOps; i++)
+		{
+			int Type = m_Random.Int(3);
+			if(Type == 0)
+			{
+				int Value = Round%4 ? RandomInt() : EdgeInt();
+				// a full packer breaks into the debugger on AddInt
+				if(!Packer.Error() && Packer.Size() >= 2040)
+					continue;
+				Packer.AddInt(Value);
+				OldPacker.AddInt(Value);
+			}
+			else if(Type == 1)
+			{
+				int Length = m_Random.Int(Round%5 ? 32 : 290);
+				for(int c = 0; c < Length; c++)
+					aString[c] = 'a'+m_Random.Int(26);
+				aString[Length] = 0;
+				int Limit = m_Random.Int(40)-10;
+				Packer.AddString(aString, Limit);
+				OldPacker.AddString(aString, Limit);
+			}
+			else
+			{
+				int Size = m_Random.Int(sizeof(aRaw));
+				Packer.AddRaw(aRaw, Size);
+				OldPacker.AddRaw(aRaw, Size);
+			}
+			ASSERT_EQ(OldPacker.Error(), Packer.Error()) << "round " << Round << " op " << i;
+			// the old packer overflowed on errors, the contents only count without one
+			if(Packer.Error())
+				break;
+			ASSERT_EQ(OldPacker.Size(), Packer.Size()) << "round " << Round << " op " << i;
+		}
+		if(!Packer.Error())
+			ASSERT_EQ(mem_comp(OldPacker.Data(), Packer.Data(), Packer.Size()), 0) << "round " << Round;
+	}
+}
+
+// times the old and the new paths over snapshot shaped data, the results show up in the test output
+TEST_F(Codec, Benchmark)
+{
+	const int NumRounds = 10000;
+	const int NumInts = 600;
+	std::vector<int> aInts(NumRounds*NumInts);
+	for(unsigned i = 0; i < aInts.size(); i++)
+		aInts[i] = RandomInt();
+	std::vector<unsigned char> aPacked(NumInts*5);
+	unsigned char aCompressed[2048];
+	unsigned char aOut[2048];
+
+	int64 Sink = 0;
+	int64 Start = time_get();
+	for(int r = 0; r < NumRounds; r++)
+		Sink += OldVarCompress(&aInts[r*NumInts], NumInts*4, aPacked.data());
+	int64 VarOld = time_get()-Start;
+	Start = time_get();
+	for(int r = 0; r < NumRounds; r++)
+		Sink -= CVariableInt::Compress(&aInts[r*NumInts], NumInts*4, aPacked.data());
+	int64 VarNew = time_get()-Start;
+
+	int PackedSize = min((int)CVariableInt::Compress(aInts.data(), NumInts*4, aPacked.data()), 1400);
+	Start = time_get();
+	for(int r = 0; r < NumRounds; r++)
+		Sink += m_OldHuffman.Compress(aPacked.data(), PackedSize, aCompressed, sizeof(aCompressed));
+	int64 CompressOld = time_get()-Start;
+	Start = time_get();
+	for(int r = 0; r < NumRounds; r++)
+		Sink -= m_Huffman.Compress(aPacked.data(), PackedSize, aCompressed, sizeof(aCompressed));
+	int64 CompressNew = time_get()-Start;
+
+	int CompressedSize = m_Huffman.Compress(aPacked.data(), PackedSize, aCompressed, sizeof(aCompressed));
+	Start = time_get();
+	for(int r = 0; r < NumRounds; r++)
+		Sink += m_OldHuffman.Decompress(aCompressed, CompressedSize, aOut, sizeof(aOut));
+	int64 DecompressOld = time_get()-Start;
+	Start = time_get();
+	for(int r = 0; r < NumRounds; r++)
+		Sink -= m_Huffman.Decompress(aCompressed, CompressedSize, aOut, sizeof(aOut));
+	int64 DecompressNew = time_get()-Start;
+
+	// AddInt is the same on both sides, the ints are timed with the varints above
+	const char *pName = "player_name";
+	const char *pChat = "a chat line that is a good deal longer than the name of a player";
+	Start = time_get();
+	for(int r = 0; r < NumRounds; r++)
+	{
+		COldPacker Packer;
+		Packer.Reset();
+		for(int i = 0; i < 20; i++)
+		{
+			Packer.AddString(pName, 16);
+			Packer.AddString(pChat, 128);
+			Packer.AddRaw(aPacked.data(), 8);
+		}
+		Sink += Packer.Size();
+	}
+	int64 PackerOld = time_get()-Start;
+	Start = time_get();
+	for(int r = 0; r < NumRounds; r++)
+	{
+		CPacker Packer;
+		Packer.Reset();
+		for(int i = 0; i < 20; i++)
+		{
+			Packer.AddString(pName, 16);
+			Packer.AddString(pChat, 128);
+			Packer.AddRaw(aPacked.data(), 8);
+		}
+		Sink -= Packer.Size();
+	}
+	int64 PackerNew = time_get()-Start;
+
+	EXPECT_EQ(Sink, 0);
+	double Freq = time_freq()/1e9;
+	printf("ns per byte: varint compress old %.2f new %.2f, huffman compress old %.2f new %.2f, huffman decompress old %.2f new %.2f\n",
+		VarOld/Freq/(NumRounds*NumInts*4.0), VarNew/Freq/(NumRounds*NumInts*4.0),
+		CompressOld/Freq/(NumRounds*(double)PackedSize), CompressNew/Freq/(NumRounds*(double)PackedSize),
+		DecompressOld/Freq/(NumRounds*(double)PackedSize), DecompressNew/Freq/(NumRounds*(double)PackedSize));
+	printf("ns per message of 20 names, chat lines and raw blocks: packer old %.1f new %.1f\n", PackerOld/Freq/NumRounds, PackerNew/Freq/NumRounds);
+}
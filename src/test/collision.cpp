@@ -0,0 +1,239 @@
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/storage.h>
+#include <game/collision.h>
+#include <game/layers.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+// the collision of the baseline, one int of flags per tile and a clamped lookup
+class COldCollision
+{
+	std::vector<int> m_aTiles;
+	int m_Width;
+	int m_Height;
+
+public:
+	void Init(CLayers *pLayers)
+	{
+		m_Width = pLayers->PhysicsLayer()->m_Width;
+		m_Height = pLayers->PhysicsLayer()->m_Height;
+		CTile *pTiles = static_cast<CTile *>(pLayers->Map()->GetData(pLayers->PhysicsLayer()->m_Data));
+		m_aTiles.resize(m_Width*m_Height);
+		for(int i = 0; i < m_Width*m_Height; i++)
+		{
+			if(pTiles[i].m_Index == TILE_PHYSICS_SOLID)
+				m_aTiles[i] = CCollision::COLFLAG_SOLID;
+			else if(pTiles[i].m_Index == TILE_PHYSICS_NOHOOK)
+				m_aTiles[i] = CCollision::COLFLAG_SOLID|CCollision::COLFLAG_NOHOOK;
+			else
+				m_aTiles[i] = 0;
+		}
+	}
+
+	int GetTile(int x, int y) { return m_aTiles[clamp(y/32, 0, m_Height-1)*m_Width+clamp(x/32, 0, m_Width-1)]; }
+	bool CheckPoint(float x, float y) { return GetTile(round(x), round(y))&CCollision::COLFLAG_SOLID; }
+	bool CheckPoint(vec2 Pos) { return CheckPoint(Pos.x, Pos.y); }
+	int GetCollisionAt(float x, float y) { return GetTile(round(x), round(y)); }
+	bool CheckPhysicsFlag(vec2 Pos, int Flag) { return GetTile(Pos.x, Pos.y)&Flag; }
+
+	int IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+	{
+		float Distance = distance(Pos0, Pos1);
+		int End(Distance+1);
+		vec2 Last = Pos0;
+		for(int i = 0; i < End; i++)
+		{
+			vec2 Pos = mix(Pos0, Pos1, i/Distance);
+			if(CheckPoint(Pos.x, Pos.y))
+			{
+				*pOutCollision = Pos;
+				*pOutBeforeCollision = Last;
+				return GetCollisionAt(Pos.x, Pos.y);
+			}
+			Last = Pos;
+		}
+		*pOutCollision = Pos1;
+		*pOutBeforeCollision = Pos1;
+		return 0;
+	}
+
+	void MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, int *pBounces)
+	{
+		*pBounces = 0;
+		vec2 Pos = *pInoutPos;
+		vec2 Vel = *pInoutVel;
+		if(CheckPoint(Pos + Vel))
+		{
+			int Affected = 0;
+			if(CheckPoint(Pos.x + Vel.x, Pos.y))
+			{
+				pInoutVel->x *= -Elasticity;
+				(*pBounces)++;
+				Affected++;
+			}
+			if(CheckPoint(Pos.x, Pos.y + Vel.y))
+			{
+				pInoutVel->y *= -Elasticity;
+				(*pBounces)++;
+				Affected++;
+			}
+			if(Affected == 0)
+			{
+				pInoutVel->x *= -Elasticity;
+				pInoutVel->y *= -Elasticity;
+			}
+		}
+		else
+			*pInoutPos = Pos + Vel;
+	}
+
+	bool TestBox(vec2 Pos, vec2 Size)
+	{
+		Size *= 0.5f;
+		return CheckPoint(Pos.x-Size.x, Pos.y-Size.y) || CheckPoint(Pos.x+Size.x, Pos.y-Size.y) ||
+			CheckPoint(Pos.x-Size.x, Pos.y+Size.y) || CheckPoint(Pos.x+Size.x, Pos.y+Size.y);
+	}
+
+	void MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity)
+	{
+		vec2 Pos = *pInoutPos;
+		vec2 Vel = *pInoutVel;
+		float Distance = length(Vel);
+		int Max = (int)Distance;
+		if(Distance > 0.00001f)
+		{
+			float Fraction = 1.0f/(float)(Max+1);
+			for(int i = 0; i <= Max; i++)
+			{
+				vec2 NewPos = Pos + Vel*Fraction;
+				if(TestBox(vec2(NewPos.x, NewPos.y), Size))
+				{
+					int Hits = 0;
+					if(TestBox(vec2(Pos.x, NewPos.y), Size))
+					{
+						NewPos.y = Pos.y;
+						Vel.y *= -Elasticity;
+						Hits++;
+					}
+					if(TestBox(vec2(NewPos.x, Pos.y), Size))
+					{
+						NewPos.x = Pos.x;
+						Vel.x *= -Elasticity;
+						Hits++;
+					}
+					if(Hits == 0)
+					{
+						NewPos.y = Pos.y;
+						Vel.y *= -Elasticity;
+						NewPos.x = Pos.x;
+						Vel.x *= -Elasticity;
+					}
+				}
+				Pos = NewPos;
+			}
+		}
+		*pInoutPos = Pos;
+		*pInoutVel = Vel;
+	}
+};
+
+static bool Same(vec2 a, vec2 b) { return mem_comp(&a, &b, sizeof(a)) == 0; }
+
+static int ListMapCallback(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	int Length = str_length(pName);
+	if(!IsDir && Length > 4 && str_comp(pName+Length-4, ".map") == 0)
+		((std::vector<std::string> *)pUser)->push_back(std::string("maps/")+pName);
+	return 0;
+}
+
+// positions, sizes and velocities inside and far outside of each bundled map, compared bit for bit
+TEST(Collision, BundledMapsMatchBaseline)
+{
+	const int NumSamples = 5000;
+	IStorage *pStorage = CreateTestStorage();
+	ASSERT_TRUE(pStorage);
+	IEngineMap *pMap = CreateEngineMap();
+	IKernel *pKernel = IKernel::Create();
+	pKernel->RegisterInterface(pStorage);
+	pKernel->RegisterInterface(static_cast<IEngineMap *>(pMap));
+	pKernel->RegisterInterface(static_cast<IMap *>(pMap));
+
+	std::vector<std::string> aMaps;
+	pStorage->ListDirectory(IStorage::TYPE_ALL, "maps", ListMapCallback, &aMaps);
+	ASSERT_GT(aMaps.size(), 0u);
+
+	CTestRandom Random(46);
+	int NumChecked = 0;
+	for(unsigned m = 0; m < aMaps.size(); m++)
+	{
+		const char *pMapName = aMaps[m].c_str();
+		ASSERT_TRUE(pMap->Load(pMapName)) << pMapName;
+		CLayers Layers;
+		Layers.Init(pMap);
+		if(!Layers.PhysicsLayer())
+		{
+			pMap->Unload();
+			continue;
+		}
+
+		CCollision *pNew = new CCollision;
+		COldCollision *pOld = new COldCollision;
+		pNew->Init(&Layers);
+		pOld->Init(&Layers);
+		float Width = pNew->GetWidth()*32.0f;
+		float Height = pNew->GetHeight()*32.0f;
+
+		for(int i = 0; i < NumSamples; i++)
+		{
+			vec2 Pos(Random.Float()*(Width+2400.0f)-1200.0f, Random.Float()*(Height+2400.0f)-1200.0f);
+			if(i%7 == 0)
+				Pos *= 40.0f;
+			vec2 Vel(Random.Float()*60.0f-30.0f, Random.Float()*60.0f-30.0f);
+			if(i%11 == 0)
+				Vel *= 5.0f;
+			vec2 Size = i%5 ? vec2(28.0f, 28.0f) : vec2(Random.Float()*200.0f-20.0f, Random.Float()*200.0f-20.0f);
+
+			ASSERT_EQ(pOld->TestBox(Pos, Size), pNew->TestBox(Pos, Size)) << pMapName << " sample " << i;
+			ASSERT_EQ(pOld->CheckPoint(Pos), pNew->CheckPoint(Pos)) << pMapName << " sample " << i;
+			ASSERT_EQ(pOld->GetCollisionAt(Pos.x, Pos.y), pNew->GetCollisionAt(Pos.x, Pos.y)) << pMapName << " sample " << i;
+			ASSERT_EQ(pOld->CheckPhysicsFlag(Pos, CCollision::COLFLAG_NOHOOK), pNew->CheckPhysicsFlag(Pos, CCollision::COLFLAG_NOHOOK)) << pMapName << " sample " << i;
+
+			vec2 OldPos = Pos, OldVel = Vel, NewPos = Pos, NewVel = Vel;
+			pOld->MoveBox(&OldPos, &OldVel, Size, 0.0f);
+			pNew->MoveBox(&NewPos, &NewVel, Size, 0.0f);
+			ASSERT_TRUE(Same(OldPos, NewPos) && Same(OldVel, NewVel)) << pMapName << " MoveBox sample " << i;
+
+			int OldBounces, NewBounces;
+			OldPos = NewPos = Pos;
+			OldVel = NewVel = Vel;
+			pOld->MovePoint(&OldPos, &OldVel, 0.5f, &OldBounces);
+			pNew->MovePoint(&NewPos, &NewVel, 0.5f, &NewBounces);
+			ASSERT_TRUE(Same(OldPos, NewPos) && Same(OldVel, NewVel) && OldBounces == NewBounces) << pMapName << " MovePoint sample " << i;
+
+			vec2 OldCollision, OldBefore, NewCollision, NewBefore;
+			int OldHit = pOld->IntersectLine(Pos, Pos+Vel*10.0f, &OldCollision, &OldBefore);
+			int NewHit = pNew->IntersectLine(Pos, Pos+Vel*10.0f, &NewCollision, &NewBefore);
+			ASSERT_TRUE(OldHit == NewHit && Same(OldCollision, NewCollision) && Same(OldBefore, NewBefore)) << pMapName << " IntersectLine sample " << i;
+		}
+
+		delete pOld;
+		delete pNew;
+		pMap->Unload();
+		NumChecked++;
+	}
+	EXPECT_GT(NumChecked, 0);
+	printf("%d maps checked with %d samples each\n", NumChecked, NumSamples);
+
+	delete pKernel;
+	delete pMap;
+	delete pStorage;
+}
@@ -0,0 +1,180 @@
+#include <base/math.h>
+#include <game/collision.h>
+#include <game/floodfill.h>
+#include <game/layers.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "test.h"
+
+// the AreConnected of the baseline, a full sweep over the window until nothing changes
+static bool OldAreConnected(CCollision *pCollision, vec2 Pos1, vec2 Pos2, float Radius)
+{
+	if(distance(Pos1, Pos2) > Radius)
+		return false;
+
+	int TileRadius = std::ceil(Radius/32.0f);
+	int Width = 2*TileRadius+1;
+	std::vector<char> Map(Width*Width);
+	for(int j = 0; j < Width; j++)
+		for(int i = 0; i < Width; i++)
+			Map[j*Width+i] = pCollision->CheckPoint(Pos1.x + 32.0f*(i-TileRadius), Pos1.y + 32.0f*(j-TileRadius)) ? 0x0 : 0x1;
+	Map[TileRadius*Width+TileRadius] = 0x2;
+
+	int Pos2X = clamp(TileRadius + (int)round((Pos2.x - Pos1.x)/32.0f), 0, Width-1);
+	int Pos2Y = clamp(TileRadius + (int)round((Pos2.y - Pos1.y)/32.0f), 0, Width-1);
+
+	bool Changes = true;
+	while(Changes)
+	{
+		Changes = false;
+		for(int j = 0; j < Width; j++)
+			for(int i = 0; i < Width; i++)
+			{
+				if(!(Map[j*Width+i]&0x1) || (Map[j*Width+i]&0x2))
+					continue;
+				if((i > 0 && (Map[j*Width+i-1]&0x2)) || (j > 0 && (Map[(j-1)*Width+i]&0x2)) ||
+					(i < Width-1 && (Map[j*Width+i+1]&0x2)) || (j < Width-1 && (Map[(j+1)*Width+i]&0x2)))
+				{
+					Map[j*Width+i] = 0x2;
+					Changes = true;
+				}
+			}
+		if(Map[Pos2Y*Width+Pos2X]&0x2)
+			return true;
+	}
+	return false;
+}
+
+// the reach ticks of the baseline CGrowingExplosion, -1 for the cells that are never reached
+static std::vector<int> OldGrow(CCollision *pCollision, vec2 Seed, int Radius, bool NoClip, int Ticks)
+{
+	int Length = 2*Radius+1;
+	std::vector<int> Map(Length*Length);
+	for(int j = 0; j < Length; j++)
+		for(int i = 0; i < Length; i++)
+		{
+			vec2 Tile = Seed + vec2(32.0f*(i-Radius), 32.0f*(j-Radius));
+			Map[j*Length+i] = (!NoClip && pCollision->CheckPoint(Tile)) || distance(Tile, Seed) > Radius*32.0f ? -2 : -1;
+		}
+	Map[Radius*Length+Radius] = 0;
+
+	for(int Tick = 1; Tick <= Ticks; Tick++)
+		for(int j = 0; j < Length; j++)
+			for(int i = 0; i < Length; i++)
+			{
+				if(Map[j*Length+i] != -1)
+					continue;
+				for(int n = 0; n < 4; n++)
+				{
+					int x = i + (n == 0 ? -1 : n == 1 ? 1 : 0);
+					int y = j + (n == 2 ? -1 : n == 3 ? 1 : 0);
+					if(x < 0 || x >= Length || y < 0 || y >= Length)
+						continue;
+					int Neighbour = Map[y*Length+x];
+					if(Neighbour >= 0 && Neighbour < Tick)
+					{
+						Map[j*Length+i] = Tick;
+						break;
+					}
+				}
+			}
+
+	for(unsigned i = 0; i < Map.size(); i++)
+		Map[i] = max(Map[i], -1);
+	return Map;
+}
+
+class FloodFill : public ::testing::Test
+{
+protected:
+	CTestMap m_Map;
+	CLayers m_Layers;
+	CCollision m_Collision;
+	CTestRandom m_Random;
+
+	FloodFill() : m_Map(64, 64), m_Random(1) {}
+
+	void Load()
+	{
+		m_Layers.Init(&m_Map);
+		m_Collision.Init(&m_Layers);
+	}
+
+	void Fill(int Density)
+	{
+		for(int y = 0; y < 64; y++)
+			for(int x = 0; x < 64; x++)
+				m_Map.SetTile(x, y, m_Random.Int(100) < Density ? TILE_PHYSICS_SOLID : TILE_PHYSICS_AIR);
+		Load();
+	}
+
+	vec2 TileCenter(int x, int y) { return vec2(32.0f*x+16.0f, 32.0f*y+16.0f); }
+};
+
+TEST_F(FloodFill, AreConnectedOpenAir)
+{
+	Load();
+	EXPECT_TRUE(m_Collision.AreConnected(TileCenter(10, 10), TileCenter(11, 10), 84.0f));
+	EXPECT_TRUE(m_Collision.AreConnected(TileCenter(10, 10), TileCenter(10, 10), 84.0f));
+	EXPECT_TRUE(m_Collision.AreConnected(TileCenter(10, 10), TileCenter(12, 11), 84.0f));
+	EXPECT_FALSE(m_Collision.AreConnected(TileCenter(10, 10), TileCenter(13, 10), 84.0f));
+}
+
+TEST_F(FloodFill, AreConnectedWall)
+{
+	for(int y = 0; y < 64; y++)
+		m_Map.SetTile(11, y, TILE_PHYSICS_SOLID);
+	Load();
+	EXPECT_FALSE(m_Collision.AreConnected(TileCenter(10, 10), TileCenter(12, 10), 84.0f));
+	EXPECT_FALSE(m_Collision.AreConnected(TileCenter(10, 10), TileCenter(11, 10), 84.0f));
+	EXPECT_TRUE(m_Collision.AreConnected(TileCenter(10, 10), TileCenter(10, 12), 84.0f));
+
+	// a gap in the wall within the window
+	m_Map.SetTile(11, 12, TILE_PHYSICS_AIR);
+	Load();
+	EXPECT_TRUE(m_Collision.AreConnected(TileCenter(10, 10), TileCenter(12, 10), 84.0f));
+}
+
+TEST_F(FloodFill, AreConnectedMatchesBaseline)
+{
+	for(int Map = 0; Map < 200; Map++)
+	{
+		Fill(m_Random.Int(60));
+		for(int i = 0; i < 50; i++)
+		{
+			vec2 Pos1 = vec2(m_Random.Float()*64*32, m_Random.Float()*64*32);
+			vec2 Pos2 = Pos1 + vec2(m_Random.Float()*300-150, m_Random.Float()*300-150);
+			float Radius = 10.0f + m_Random.Float()*200.0f;
+			ASSERT_EQ(OldAreConnected(&m_Collision, Pos1, Pos2, Radius), m_Collision.AreConnected(Pos1, Pos2, Radius))
+				<< "map " << Map << " from " << Pos1.x << "," << Pos1.y << " to " << Pos2.x << "," << Pos2.y << " radius " << Radius;
+		}
+	}
+}
+
+TEST_F(FloodFill, GrowMatchesBaseline)
+{
+	CFloodFill *pFloodFill = m_Collision.FloodFill();
+	for(int Map = 0; Map < 500; Map++)
+	{
+		Fill(m_Random.Int(60));
+		int Radius = m_Random.Int(16);
+		bool NoClip = m_Random.Int(5) == 0;
+		vec2 Seed = TileCenter(m_Random.Int(64), m_Random.Int(64));
+
+		std::vector<int> Old = OldGrow(&m_Collision, Seed, Radius, NoClip, Radius+2);
+
+		// the pooled grids are reused across the maps
+		CFloodFill::CGrid *pGrid = pFloodFill->AllocGrid(Seed, Radius, CFloodFill::FLAG_DISC|(NoClip ? CFloodFill::FLAG_NOCLIP : 0));
+		pFloodFill->Seed(pGrid, pGrid->Center(), 0);
+		for(int Tick = 1; Tick <= Radius+2; Tick++)
+			pFloodFill->Grow(pGrid, Tick);
+
+		ASSERT_EQ(pGrid->Size(), (int)Old.size());
+		for(int i = 0; i < pGrid->Size(); i++)
+			ASSERT_EQ(Old[i], max(pGrid->m_pCells[i], -1)) << "map " << Map << " cell " << i;
+		pFloodFill->FreeGrid(pGrid);
+	}
+}
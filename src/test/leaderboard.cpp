@@ -0,0 +1,299 @@
+#include <base/system.h>
+#include <base/tl/threading.h>
+#include <infclasscr/leaderboard.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "test.h"
+
+// a database with a writer thread, run like the score updates of CSQL
+class CMockSource : public ILeaderboardSource
+{
+	struct CUpdate
+	{
+		int m_UserID;
+		int m_Team;
+		int m_Score;
+	};
+
+	LOCK m_Lock;
+	volatile unsigned m_QueueDepth;
+	std::deque<CUpdate> m_Queue;
+	std::map<int, CLeaderboardAccount> m_Accounts;
+	void *m_pWriter;
+	volatile bool m_Stop;
+	CTestRandom m_WriterRandom;
+	CTestRandom m_FetchRandom;
+
+	static void WriterThread(void *pUser)
+	{
+		CMockSource *pSelf = (CMockSource *)pUser;
+		while(!pSelf->m_Stop)
+		{
+			pSelf->WriteOne();
+			if(pSelf->m_WriterRandom.Int(4) == 0)
+				thread_sleep(1);
+		}
+	}
+
+public:
+	volatile int m_NumFetches;
+	// every fetch waits for OpenGate and never fails
+	bool m_Gated;
+	semaphore m_FetchGate;
+
+	CMockSource() : m_QueueDepth(0), m_pWriter(0), m_Stop(false), m_WriterRandom(49), m_FetchRandom(50), m_NumFetches(0), m_Gated(false)
+	{
+		m_Lock = lock_create();
+	}
+
+	~CMockSource()
+	{
+		if(m_pWriter)
+			Stop();
+		lock_destroy(m_Lock);
+	}
+
+	CLeaderboardAccount *Account(int UserID)
+	{
+		CLeaderboardAccount *pAccount = &m_Accounts[UserID];
+		if(!pAccount->m_UserID)
+		{
+			pAccount->m_UserID = UserID;
+			str_format(pAccount->m_aName, sizeof(pAccount->m_aName), "player%d", UserID);
+		}
+		return pAccount;
+	}
+
+	void Start() { m_pWriter = thread_init(WriterThread, this); }
+	void OpenGate() { m_FetchGate.signal(); }
+
+	void Stop()
+	{
+		m_Stop = true;
+		thread_wait(m_pWriter);
+		m_pWriter = 0;
+	}
+
+	// the order of CSQL::UpdateScore: counted, added to the leaderboard, handed to the writer
+	void UpdateScore(CLeaderboard *pBoard, int UserID, int Team, int Score)
+	{
+		atomic_inc(&m_QueueDepth);
+		char aName[32];
+		str_format(aName, sizeof(aName), "player%d", UserID);
+		pBoard->AddScore(UserID, aName, Team, Score);
+
+		CUpdate Update = {UserID, Team, Score};
+		lock_wait(m_Lock);
+		m_Queue.push_back(Update);
+		lock_unlock(m_Lock);
+	}
+
+	// writes the oldest queued update, the writer thread does the same
+	void WriteOne()
+	{
+		lock_wait(m_Lock);
+		if(!m_Queue.empty())
+		{
+			CUpdate Update = m_Queue.front();
+			m_Queue.pop_front();
+			atomic_dec(&m_QueueDepth);
+			Account(Update.m_UserID)->m_aScores[Update.m_Team] += Update.m_Score;
+		}
+		lock_unlock(m_Lock);
+	}
+
+	void WaitForWriter()
+	{
+		while(m_QueueDepth)
+			thread_sleep(1);
+	}
+
+	// the accounts sorted by brute force, the writer has to be idle
+	std::vector<CLeaderboardAccount> Sorted(int Team)
+	{
+		std::vector<CLeaderboardAccount> aAccounts;
+		for(std::map<int, CLeaderboardAccount>::iterator i = m_Accounts.begin(); i != m_Accounts.end(); ++i)
+			aAccounts.push_back(i->second);
+		std::sort(aAccounts.begin(), aAccounts.end(), [Team](const CLeaderboardAccount &a, const CLeaderboardAccount &b)
+			{ return a.m_aScores[Team] != b.m_aScores[Team] ? a.m_aScores[Team] > b.m_aScores[Team] : a.m_UserID < b.m_UserID; });
+		return aAccounts;
+	}
+
+	virtual bool Fetch(const CLeaderboard *pBoard, std::vector<CLeaderboardAccount> *pAccounts, unsigned *pSequence)
+	{
+		if(m_Gated)
+			m_FetchGate.wait();
+
+		// like the sql source, read once no update is waiting
+		while(1)
+		{
+			lock_wait(m_Lock);
+			*pSequence = pBoard->Sequence();
+			sync_barrier();
+			if(m_QueueDepth == 0)
+			{
+				for(std::map<int, CLeaderboardAccount>::iterator i = m_Accounts.begin(); i != m_Accounts.end(); ++i)
+					pAccounts->push_back(i->second);
+				int Delay = m_Gated ? 0 : m_FetchRandom.Int(10);
+				bool Fail = !m_Gated && m_FetchRandom.Int(10) == 0;
+				lock_unlock(m_Lock);
+				m_NumFetches = m_NumFetches+1;
+				// a slow connection gives the game time to add more scores
+				thread_sleep(Delay);
+				if(Fail)
+					pAccounts->clear();
+				return !Fail;
+			}
+			lock_unlock(m_Lock);
+			thread_sleep(1);
+		}
+	}
+};
+
+TEST(Leaderboard, Ranks)
+{
+	CMockSource Source;
+	for(int i = 1; i <= 5; i++)
+		Source.Account(i)->m_aScores[CLeaderboard::TEAM_HUMAN] = i*10;
+	Source.Account(6)->m_aScores[CLeaderboard::TEAM_HUMAN] = 30;
+
+	CLeaderboard Board;
+	Board.Init(&Source);
+	while(!Board.IsLoaded())
+	{
+		Board.Update(0);
+		thread_sleep(1);
+	}
+	Board.Shutdown();
+
+	const CLeaderboardAccount *apTop[3];
+	ASSERT_EQ(Board.GetTop(CLeaderboard::TEAM_HUMAN, apTop, 3), 3);
+	EXPECT_EQ(apTop[0]->m_UserID, 5);
+	EXPECT_EQ(apTop[1]->m_UserID, 4);
+	EXPECT_EQ(apTop[2]->m_UserID, 3);
+	// equal scores go by the user id
+	EXPECT_EQ(Board.GetRank(CLeaderboard::TEAM_HUMAN, 6), 4);
+	EXPECT_EQ(Board.GetRank(CLeaderboard::TEAM_HUMAN, 7), 0);
+	EXPECT_EQ(Board.GetRank(CLeaderboard::TEAM_ZOMBIE, 1), 1);
+
+	// a new account and one that moves to the top
+	Board.AddScore(7, "player7", CLeaderboard::TEAM_ZOMBIE, 5);
+	Board.AddScore(1, "player1", CLeaderboard::TEAM_HUMAN, 100);
+	EXPECT_EQ(Board.GetRank(CLeaderboard::TEAM_ZOMBIE, 7), 1);
+	EXPECT_EQ(Board.GetRank(CLeaderboard::TEAM_HUMAN, 7), 7);
+	EXPECT_EQ(Board.GetRank(CLeaderboard::TEAM_HUMAN, 1), 1);
+	EXPECT_EQ(Board.GetRank(CLeaderboard::TEAM_HUMAN, 5), 2);
+	EXPECT_EQ(Board.GetAccount(1)->m_aScores[CLeaderboard::TEAM_HUMAN], 110);
+}
+
+// an update added while a fetch runs, once before the fetch reads and once after, is counted once
+TEST(Leaderboard, UpdateDuringFetch)
+{
+	CMockSource Source;
+	Source.Account(1)->m_aScores[CLeaderboard::TEAM_HUMAN] = 10;
+	Source.m_Gated = true;
+
+	CLeaderboard Board;
+	Board.Init(&Source);
+	Source.OpenGate();
+	while(!Board.IsLoaded())
+	{
+		Board.Update(0);
+		thread_sleep(1);
+	}
+	// the next fetch started right away and waits at the gate
+	ASSERT_TRUE(Board.IsFetching());
+
+	// queued before the fetch reads, the fetch has to wait for the write
+	Source.UpdateScore(&Board, 1, CLeaderboard::TEAM_HUMAN, 5);
+	Source.OpenGate();
+	thread_sleep(5);
+	EXPECT_EQ(Source.m_NumFetches, 1);
+	Source.WriteOne();
+	while(Source.m_NumFetches < 2)
+		thread_sleep(1);
+
+	// queued after the fetch read, only the journal has it
+	Source.UpdateScore(&Board, 1, CLeaderboard::TEAM_HUMAN, 7);
+	Source.WriteOne();
+	while(Board.IsFetching())
+	{
+		Board.Update(1000);
+		thread_sleep(1);
+	}
+
+	EXPECT_EQ(Board.GetAccount(1)->m_aScores[CLeaderboard::TEAM_HUMAN], 22);
+	EXPECT_EQ(Source.Account(1)->m_aScores[CLeaderboard::TEAM_HUMAN], 22);
+}
+
+// score updates race with the writer and the fetches, after the writer caught up the leaderboard
+// has to match the database exactly, an update that is both read and replayed counts twice
+TEST(Leaderboard, Reconciliation)
+{
+	const int NumAccounts = 2000;
+	CMockSource Source;
+	CTestRandom Random(48);
+	for(int i = 1; i <= NumAccounts; i++)
+	{
+		Source.Account(i)->m_aScores[CLeaderboard::TEAM_HUMAN] = Random.Int(1000);
+		Source.Account(i)->m_aScores[CLeaderboard::TEAM_ZOMBIE] = Random.Int(1000);
+	}
+	Source.Start();
+
+	CLeaderboard Board;
+	Board.Init(&Source);
+	while(!Board.IsLoaded())
+	{
+		Board.Update(0);
+		thread_sleep(1);
+	}
+
+	int NumChecks = 0;
+	for(int Tick = 0; Tick < 300; Tick++)
+	{
+		Board.Update(0);
+		// in bursts, the fetches only read while no update is queued
+		if(Random.Int(3) == 0)
+		{
+			for(int i = 0; i < 20; i++)
+				Source.UpdateScore(&Board, 1+Random.Int(NumAccounts+NumAccounts/10), Random.Int(CLeaderboard::NUM_TEAMS), Random.Int(10));
+		}
+		thread_sleep(1);
+
+		if(Tick%50 != 49)
+			continue;
+
+		Source.WaitForWriter();
+		for(int t = 0; t < CLeaderboard::NUM_TEAMS; t++)
+		{
+			std::vector<CLeaderboardAccount> aExpected = Source.Sorted(t);
+			ASSERT_EQ((int)aExpected.size(), Board.NumAccounts()) << "tick " << Tick;
+			const CLeaderboardAccount *apTop[5];
+			int NumTop = Board.GetTop(t, apTop, 5);
+			ASSERT_EQ(NumTop, 5);
+			for(int i = 0; i < NumTop; i++)
+				ASSERT_EQ(apTop[i]->m_UserID, aExpected[i].m_UserID) << "tick " << Tick << " team " << t;
+			for(unsigned i = 0; i < aExpected.size(); i++)
+			{
+				const CLeaderboardAccount *pAccount = Board.GetAccount(aExpected[i].m_UserID);
+				ASSERT_TRUE(pAccount);
+				ASSERT_EQ(pAccount->m_aScores[t], aExpected[i].m_aScores[t]) << "tick " << Tick << " account " << aExpected[i].m_UserID;
+				ASSERT_STREQ(pAccount->m_aName, aExpected[i].m_aName);
+				ASSERT_EQ(Board.GetRank(t, aExpected[i].m_UserID), (int)i+1) << "tick " << Tick;
+			}
+		}
+		NumChecks++;
+	}
+
+	// the fetch waits for the writer, so the writer stops last, as it does when a check fails
+	Board.Shutdown();
+	Source.Stop();
+	EXPECT_EQ(NumChecks, 6);
+	EXPECT_GT(Source.m_NumFetches, 1);
+}
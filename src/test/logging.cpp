@@ -0,0 +1,63 @@
+#include <base/system.h>
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+
+static volatile int s_QueuedBehind = 0;
+
+// fails on one line once another one is queued behind it, writes the others to stderr
+static void AssertingLogger(const char *pLine)
+{
+	if(str_find(pLine, "fails in the logger"))
+	{
+		while(!s_QueuedBehind)
+			thread_sleep(1);
+		dbg_assert(0, "logger assert");
+	}
+	fprintf(stderr, "%s\n", pLine);
+}
+
+// an assert that fires on the flusher thread can't wait for the flusher,
+// it has to write the rest of the queue itself and stop the process
+TEST(LoggingDeathTest, AssertOnFlusher)
+{
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+	EXPECT_DEATH(
+		{
+			dbg_logger(AssertingLogger);
+			dbg_logger_async_start(0);
+			dbg_msg("test", "this line fails in the logger");
+			dbg_msg("test", "queued behind the assert");
+			s_QueuedBehind = 1;
+			thread_sleep(5000);
+		}, "queued behind the assert");
+}
+
+static void StderrLogger(const char *pLine)
+{
+	fprintf(stderr, "%s\n", pLine);
+}
+
+// a system over the limit must not use up the budget of another one, not even one with the same hash
+TEST(LoggingDeathTest, RateLimitPerSystem)
+{
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+	char aInnocent[32];
+	for(int i = 0; ; i++)
+	{
+		str_format(aInnocent, sizeof(aInnocent), "system%d", i);
+		if((str_quickhash(aInnocent)&63) == (str_quickhash("flood")&63))
+			break;
+	}
+	EXPECT_EXIT(
+		{
+			dbg_logger(StderrLogger);
+			dbg_logger_async_start(100);
+			for(int i = 0; i < 200; i++)
+				dbg_msg("flood", "line %d", i);
+			dbg_msg(aInnocent, "innocent line");
+			dbg_logger_async_stop();
+			exit(0);
+		}, ::testing::ExitedWithCode(0), "innocent line");
+}
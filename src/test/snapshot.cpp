@@ -0,0 +1,313 @@
+#include <base/system.h>
+#include <engine/shared/snapshot.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "test.h"
+
+// the CreateDelta of the baseline, with its 256 hash lists of up to 64 keys
+struct COldItemList
+{
+	int m_Num;
+	int m_aKeys[64];
+	int m_aIndex[64];
+};
+
+static void OldGenerateHash(COldItemList *pHashlist, CSnapshot *pSnapshot)
+{
+	for(int i = 0; i < 256; i++)
+		pHashlist[i].m_Num = 0;
+
+	for(int i = 0; i < pSnapshot->NumItems(); i++)
+	{
+		int Key = pSnapshot->GetItem(i)->Key();
+		int HashID = ((Key>>12)&0xf0) | (Key&0xf);
+		if(pHashlist[HashID].m_Num != 64)
+		{
+			pHashlist[HashID].m_aIndex[pHashlist[HashID].m_Num] = i;
+			pHashlist[HashID].m_aKeys[pHashlist[HashID].m_Num] = Key;
+			pHashlist[HashID].m_Num++;
+		}
+	}
+}
+
+static int OldGetItemIndexHashed(int Key, const COldItemList *pHashlist)
+{
+	int HashID = ((Key>>12)&0xf0) | (Key&0xf);
+	for(int i = 0; i < pHashlist[HashID].m_Num; i++)
+	{
+		if(pHashlist[HashID].m_aKeys[i] == Key)
+			return pHashlist[HashID].m_aIndex[i];
+	}
+	return -1;
+}
+
+static int OldCreateDelta(const short *pItemSizes, CSnapshot *pFrom, CSnapshot *pTo, void *pDstData)
+{
+	CSnapshotDelta::CData *pDelta = (CSnapshotDelta::CData *)pDstData;
+	int *pData = (int *)pDelta->m_pData;
+
+	pDelta->m_NumDeletedItems = 0;
+	pDelta->m_NumUpdateItems = 0;
+	pDelta->m_NumTempItems = 0;
+
+	static COldItemList s_aHashlist[256];
+	OldGenerateHash(s_aHashlist, pTo);
+	for(int i = 0; i < pFrom->NumItems(); i++)
+	{
+		CSnapshotItem *pFromItem = pFrom->GetItem(i);
+		if(OldGetItemIndexHashed(pFromItem->Key(), s_aHashlist) == -1)
+		{
+			pDelta->m_NumDeletedItems++;
+			*pData++ = pFromItem->Key();
+		}
+	}
+
+	OldGenerateHash(s_aHashlist, pFrom);
+	int aPastIndecies[1024];
+	for(int i = 0; i < pTo->NumItems(); i++)
+		aPastIndecies[i] = OldGetItemIndexHashed(pTo->GetItem(i)->Key(), s_aHashlist);
+
+	for(int i = 0; i < pTo->NumItems(); i++)
+	{
+		int ItemSize = pTo->GetItemSize(i);
+		CSnapshotItem *pCurItem = pTo->GetItem(i);
+		int PastIndex = aPastIndecies[i];
+
+		if(PastIndex != -1)
+		{
+			int *pItemDataDst = pItemSizes[pCurItem->Type()] ? pData+2 : pData+3;
+			int *pPast = pFrom->GetItem(PastIndex)->Data();
+			int Needed = 0;
+			for(int b = 0; b < ItemSize/4; b++)
+			{
+				pItemDataDst[b] = pCurItem->Data()[b]-pPast[b];
+				Needed |= pItemDataDst[b];
+			}
+
+			if(Needed)
+			{
+				*pData++ = pCurItem->Type();
+				*pData++ = pCurItem->ID();
+				if(!pItemSizes[pCurItem->Type()])
+					*pData++ = ItemSize/4;
+				pData += ItemSize/4;
+				pDelta->m_NumUpdateItems++;
+			}
+		}
+		else
+		{
+			*pData++ = pCurItem->Type();
+			*pData++ = pCurItem->ID();
+			if(!pItemSizes[pCurItem->Type()])
+				*pData++ = ItemSize/4;
+			mem_copy(pData, pCurItem->Data(), ItemSize);
+			pData += ItemSize/4;
+			pDelta->m_NumUpdateItems++;
+		}
+	}
+
+	if(!pDelta->m_NumDeletedItems && !pDelta->m_NumUpdateItems && !pDelta->m_NumTempItems)
+		return 0;
+
+	return (int)((char*)pData-(char*)pDstData);
+}
+
+// a delta does not keep the item order, so the items are compared by key
+static bool SameItems(CSnapshot *pA, CSnapshot *pB)
+{
+	if(pA->NumItems() != pB->NumItems())
+		return false;
+	for(int i = 0; i < pA->NumItems(); i++)
+	{
+		int Index = pB->GetItemIndex(pA->GetItem(i)->Key());
+		if(Index < 0 || pB->GetItemSize(Index) != pA->GetItemSize(i) ||
+			mem_comp(pB->GetItem(Index)->Data(), pA->GetItem(i)->Data(), pA->GetItemSize(i)) != 0)
+			return false;
+	}
+	return true;
+}
+
+// a game world of characters, players, projectiles and pickups that move and come and go
+class CReplayWorld
+{
+	struct CEntity
+	{
+		int m_Type;
+		int m_ID;
+		int m_Size;
+		int m_aData[32];
+		bool m_Alive;
+	};
+
+	std::vector<CEntity> m_aEntities;
+	int m_FirstDynamic;
+	CTestRandom m_Random;
+
+	void AddEntities(int Num, int Type, int FirstID, int Size, bool Alive, int Range)
+	{
+		for(int i = 0; i < Num; i++)
+		{
+			CEntity Entity;
+			mem_zero(&Entity, sizeof(Entity));
+			Entity.m_Type = Type;
+			Entity.m_ID = FirstID+i;
+			Entity.m_Size = Size;
+			Entity.m_Alive = Alive;
+			for(int b = 0; b < Size; b++)
+				Entity.m_aData[b] = Range ? m_Random.Int(Range) : (int)m_Random.Next();
+			m_aEntities.push_back(Entity);
+		}
+	}
+
+public:
+	enum
+	{
+		TYPE_CHARACTER=9,
+		CHARACTER_SIZE=22,
+	};
+
+	CReplayWorld() : m_Random(45)
+	{
+		AddEntities(64, TYPE_CHARACTER, 0, CHARACTER_SIZE, true, 0);
+		AddEntities(64, 10, 0, 5, true, 4);
+		AddEntities(64, 11, 0, 6, true, 100);
+		AddEntities(150, 5, 100, 4, true, 0);
+		m_FirstDynamic = m_aEntities.size();
+		for(int i = 0; i < 500; i++)
+			AddEntities(1, 2+i%3, 300+i, 6+(i%3)*2, false, 0);
+	}
+
+	int Tick(int Tick, CSnapshotBuilder *pBuilder, void *pSnapData)
+	{
+		for(unsigned i = 0; i < m_aEntities.size(); i++)
+		{
+			CEntity *pEntity = &m_aEntities[i];
+			if((int)i >= m_FirstDynamic)
+			{
+				if(m_Random.Int(40) == 0)
+					pEntity->m_Alive = !pEntity->m_Alive;
+				if(pEntity->m_Alive)
+					pEntity->m_aData[0]++;
+			}
+			else if(pEntity->m_Type == TYPE_CHARACTER && m_Random.Int(3))
+			{
+				pEntity->m_aData[0] = Tick;
+				pEntity->m_aData[1] += m_Random.Int(7)-3;
+				pEntity->m_aData[2] += m_Random.Int(5)-2;
+			}
+			else if(pEntity->m_Type == 10 && m_Random.Int(50) == 0)
+				pEntity->m_aData[m_Random.Int(5)]++;
+		}
+
+		pBuilder->Init();
+		for(unsigned i = 0; i < m_aEntities.size(); i++)
+		{
+			const CEntity *pEntity = &m_aEntities[i];
+			if(pEntity->m_Alive)
+				mem_copy(pBuilder->NewItem(pEntity->m_Type, pEntity->m_ID, pEntity->m_Size*4), pEntity->m_aData, pEntity->m_Size*4);
+		}
+		return pBuilder->Finish(pSnapData);
+	}
+};
+
+// replays generated ticks and diffs each against a snapshot 1-3 ticks back, like a client that acks late
+TEST(Snapshot, DeltaReplay)
+{
+	const int NumTicks = 1500;
+	CSnapshotDelta *pDelta = new CSnapshotDelta;
+	CSnapshotBuilder *pBuilder = new CSnapshotBuilder;
+	CSnapshotStorage Storage;
+	CReplayWorld World;
+	short aItemSizes[64] = {0};
+	aItemSizes[CReplayWorld::TYPE_CHARACTER] = CReplayWorld::CHARACTER_SIZE*4;
+	pDelta->SetStaticsize(CReplayWorld::TYPE_CHARACTER, CReplayWorld::CHARACTER_SIZE*4);
+
+	std::vector<char> Empty(CSnapshot::MAX_SIZE), Current(CSnapshot::MAX_SIZE), Unpacked(CSnapshot::MAX_SIZE);
+	std::vector<char> OldDelta(CSnapshot::MAX_SIZE*2), NewDelta(CSnapshot::MAX_SIZE*2);
+	((CSnapshot *)&Empty[0])->Clear();
+	CSnapshot *pCurrent = (CSnapshot *)&Current[0];
+
+	Storage.Init();
+	int64 OldTime = 0, NewTime = 0, IndexedTime = 0, StoreTime = 0;
+	for(int Tick = 0; Tick < NumTicks; Tick++)
+	{
+		int Size = World.Tick(Tick, pBuilder, pCurrent);
+
+		CSnapshot *pFrom;
+		const CSnapshotIndex *pFromIndex;
+		if(Storage.Get(Tick-1-Tick%3, 0, &pFrom, 0, &pFromIndex) < 0)
+		{
+			pFrom = (CSnapshot *)&Empty[0];
+			pFromIndex = 0;
+		}
+		Storage.PurgeUntil(Tick-10);
+
+		int64 Start = time_get();
+		int OldSize = OldCreateDelta(aItemSizes, pFrom, pCurrent, &OldDelta[0]);
+		int64 Old = time_get();
+		int NewSize = pDelta->CreateDelta(pFrom, pCurrent, &NewDelta[0]);
+		int64 New = time_get();
+		ASSERT_EQ(OldSize, NewSize) << "tick " << Tick;
+		ASSERT_EQ(mem_comp(&OldDelta[0], &NewDelta[0], OldSize), 0) << "tick " << Tick;
+
+		Storage.Add(Tick, 0, Size, pCurrent, 0);
+		int64 Stored = time_get();
+		NewSize = pDelta->CreateDelta(pFrom, pFromIndex, pCurrent, Storage.m_pLast->m_pIndex, &NewDelta[0]);
+		int64 Indexed = time_get();
+		ASSERT_EQ(OldSize, NewSize) << "tick " << Tick;
+		ASSERT_EQ(mem_comp(&OldDelta[0], &NewDelta[0], OldSize), 0) << "tick " << Tick;
+
+		// the client side has to get the same snapshot back
+		if(NewSize)
+		{
+			ASSERT_GE(pDelta->UnpackDelta(pFrom, (CSnapshot *)&Unpacked[0], &NewDelta[0], NewSize), 0) << "tick " << Tick;
+			ASSERT_TRUE(SameItems((CSnapshot *)&Unpacked[0], pCurrent)) << "tick " << Tick;
+		}
+
+		OldTime += Old-Start;
+		NewTime += New-Old;
+		StoreTime += Stored-New;
+		IndexedTime += Indexed-Stored;
+	}
+	Storage.PurgeAll();
+
+	printf("%d ticks of %d items, us per delta: old %.2f new %.2f with stored indices %.2f (storing %.2f)\n",
+		NumTicks, pCurrent->NumItems(), OldTime*1e6/time_freq()/NumTicks, NewTime*1e6/time_freq()/NumTicks,
+		IndexedTime*1e6/time_freq()/NumTicks, StoreTime*1e6/time_freq()/NumTicks);
+
+	delete pBuilder;
+	delete pDelta;
+}
+
+// keys that share one of the old hash lists, more than the 64 it could hold
+TEST(Snapshot, DeltaCrowdedKeys)
+{
+	CSnapshotDelta *pDelta = new CSnapshotDelta;
+	CSnapshotBuilder *pBuilder = new CSnapshotBuilder;
+	std::vector<char> From(CSnapshot::MAX_SIZE), To(CSnapshot::MAX_SIZE), Unpacked(CSnapshot::MAX_SIZE), Delta(CSnapshot::MAX_SIZE*2);
+
+	for(int Pass = 0; Pass < 2; Pass++)
+	{
+		pBuilder->Init();
+		for(int i = 0; i < 200; i++)
+		{
+			int *pData = (int *)pBuilder->NewItem(4, i*16, 8);
+			pData[0] = i;
+			pData[1] = Pass && i%2 ? i*3 : i;
+		}
+		pBuilder->Finish(Pass ? &To[0] : &From[0]);
+	}
+
+	int Size = pDelta->CreateDelta((CSnapshot *)&From[0], (CSnapshot *)&To[0], &Delta[0]);
+	ASSERT_GT(Size, 0);
+	EXPECT_EQ(((CSnapshotDelta::CData *)&Delta[0])->m_NumDeletedItems, 0);
+	EXPECT_EQ(((CSnapshotDelta::CData *)&Delta[0])->m_NumUpdateItems, 100);
+	ASSERT_GT(pDelta->UnpackDelta((CSnapshot *)&From[0], (CSnapshot *)&Unpacked[0], &Delta[0], Size), 0);
+	EXPECT_TRUE(SameItems((CSnapshot *)&Unpacked[0], (CSnapshot *)&To[0]));
+
+	delete pBuilder;
+	delete pDelta;
+}
@@ -0,0 +1,67 @@
+#include <base/system.h>
+#include <engine/storage.h>
+#include <game/gamecore.h>
+
+#include <gtest/gtest.h>
+
+#include "test.h"
+
+static const char *s_pArgv0 = "testrunner";
+
+CTestMap::CTestMap(int Width, int Height)
+{
+	mem_zero(&m_Group, sizeof(m_Group));
+	m_Group.m_Version = CMapItemGroup::CURRENT_VERSION;
+	m_Group.m_ParallaxX = 100;
+	m_Group.m_ParallaxY = 100;
+	m_Group.m_StartLayer = 0;
+	m_Group.m_NumLayers = 1;
+	StrToInts(m_Group.m_aName, sizeof(m_Group.m_aName)/sizeof(int), "Game");
+
+	mem_zero(&m_Layer, sizeof(m_Layer));
+	m_Layer.m_Layer.m_Type = LAYERTYPE_TILES;
+	m_Layer.m_Width = Width;
+	m_Layer.m_Height = Height;
+	m_Layer.m_Flags = TILESLAYERFLAG_PHYSICS;
+	m_Layer.m_Image = -1;
+	m_Layer.m_Data = 0;
+	StrToInts(m_Layer.m_aName, sizeof(m_Layer.m_aName)/sizeof(int), "Game");
+
+	CTile Air;
+	mem_zero(&Air, sizeof(Air));
+	m_aTiles.assign(Width*Height, Air);
+}
+
+void *CTestMap::GetItem(int Index, int *pType, int *pID)
+{
+	if(Index == 0)
+		return &m_Group;
+	if(Index == 1)
+		return &m_Layer;
+	return 0;
+}
+
+void CTestMap::GetType(int Type, int *pStart, int *pNum)
+{
+	*pStart = 0;
+	*pNum = 0;
+	if(Type == MAPITEMTYPE_GROUP)
+		*pNum = 1;
+	else if(Type == MAPITEMTYPE_LAYER)
+	{
+		*pStart = 1;
+		*pNum = 1;
+	}
+}
+
+IStorage *CreateTestStorage()
+{
+	return CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, 1, &s_pArgv0);
+}
+
+int main(int argc, char **argv)
+{
+	s_pArgv0 = argv[0];
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
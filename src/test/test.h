@@ -0,0 +1,47 @@
+#ifndef TEST_TEST_H
+#define TEST_TEST_H
+
+#include <engine/map.h>
+#include <game/mapitems.h>
+
+#include <vector>
+
+// a map made of a single physics layer whose tiles are set by the test
+class CTestMap : public IMap
+{
+	CMapItemGroup m_Group;
+	CMapItemLayerTilemap m_Layer;
+	std::vector<CTile> m_aTiles;
+
+public:
+	CTestMap(int Width, int Height);
+
+	void SetTile(int x, int y, int Index) { m_aTiles[y*m_Layer.m_Width+x].m_Index = Index; }
+
+	virtual void *GetData(int Index) { return Index == 0 ? &m_aTiles[0] : 0; }
+	virtual int GetDataSize(int Index) { return Index == 0 ? m_aTiles.size()*sizeof(CTile) : 0; }
+	virtual void *GetDataSwapped(int Index) { return GetData(Index); }
+	virtual void UnloadData(int Index) {}
+	virtual void *GetItem(int Index, int *pType, int *pID);
+	virtual void GetType(int Type, int *pStart, int *pNum);
+	virtual void *FindItem(int Type, int ID) { return 0; }
+	virtual int NumItems() { return 2; }
+};
+
+// storage that finds the data directory the way the server does, without save paths
+class IStorage *CreateTestStorage();
+
+// deterministic random numbers, so a failing run can be repeated
+class CTestRandom
+{
+	unsigned m_Seed;
+
+public:
+	CTestRandom(unsigned Seed) : m_Seed(Seed) {}
+
+	unsigned Next() { m_Seed = m_Seed*1103515245+12345; return m_Seed>>8; }
+	int Int(int Num) { return Next()%Num; }
+	float Float() { return (Next()&0xffffff)/(float)0xffffff; }
+};
+
+#endif
@@ -1,6 +1,7 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <stdlib.h> //rand
+#include <base/math.h>
 #include <base/system.h>
 #include <engine/shared/config.h>
 #include <engine/shared/network.h>
@@ -27,6 +28,19 @@ int MaxPlayers = 0;
 char aInfoMsg[1024];
 int aInfoMsgSize;
 
+// load mode, many fake servers on consecutive ports to measure a master server
+int NumLoadServers = 0;
+int LoadBasePort = 18000;
+int ListRequestRate = 0; // per second
+
+struct CLoadServer
+{
+	NETSOCKET m_Socket;
+	int m_Port;
+	int64 m_NextHeartBeat;
+	bool m_Registered;
+};
+
 static void SendHeartBeats()
 {
 	static unsigned char aData[sizeof(SERVERBROWSE_HEARTBEAT) + 2];
@@ -108,6 +122,152 @@ static void SendFWCheckResponse(NETADDR *pAddr)
 	pNet->Send(&p);
 }
 
+static void SendHeartBeat(CLoadServer *pServer)
+{
+	unsigned char aData[sizeof(SERVERBROWSE_HEARTBEAT) + 2];
+	mem_copy(aData, SERVERBROWSE_HEARTBEAT, sizeof(SERVERBROWSE_HEARTBEAT));
+	aData[sizeof(SERVERBROWSE_HEARTBEAT)] = (pServer->m_Port>>8)&0xff;
+	aData[sizeof(SERVERBROWSE_HEARTBEAT)+1] = pServer->m_Port&0xff;
+
+	for(int i = 0; i < NumMasters; i++)
+		CNetBase::SendPacketConnless(pServer->m_Socket, &aMasterServers[i], aData, sizeof(aData), false, 0);
+}
+
+static bool IsConnless(const CNetPacketConstruct *pPacket, const unsigned char *pMsg, int MsgSize)
+{
+	return (pPacket->m_Flags&NET_PACKETFLAG_CONNLESS) && pPacket->m_DataSize >= MsgSize && mem_comp(pPacket->m_aChunkData, pMsg, MsgSize) == 0;
+}
+
+static int RunLoad()
+{
+	if(!NumMasters)
+	{
+		dbg_msg("fake_server", "load mode needs a master server, use -m");
+		return -1;
+	}
+
+	CLoadServer *pServers = new CLoadServer[NumLoadServers];
+	int64 Now = time_get();
+	for(int i = 0; i < NumLoadServers; i++)
+	{
+		NETADDR BindAddr = {NETTYPE_IPV4, {0}, 0};
+		BindAddr.port = LoadBasePort+i;
+		pServers[i].m_Socket = net_udp_create(BindAddr);
+		if(!pServers[i].m_Socket.type)
+		{
+			dbg_msg("fake_server", "couldn't open port %d", BindAddr.port);
+			for(int j = 0; j < i; j++)
+				net_udp_close(pServers[j].m_Socket);
+			delete[] pServers;
+			return -1;
+		}
+		pServers[i].m_Port = BindAddr.port;
+		// spread the first heartbeats over a second
+		pServers[i].m_NextHeartBeat = Now + time_freq()*i/NumLoadServers;
+		pServers[i].m_Registered = false;
+	}
+
+	NETADDR ListBindAddr = {NETTYPE_IPV4, {0}, 0};
+	NETSOCKET ListSocket = net_udp_create(ListBindAddr);
+
+	int NumRegistered = 0, NumFailed = 0;
+	int NumHeartBeats = 0, NumChecks = 0;
+	int NumListRequests = 0, NumListPackets = 0, NumListed = 0, LastListed = 0;
+	int64 ListRequestTime = 0, ListLatency = 0, MaxListLatency = 0;
+	int NumLatencies = 0;
+	bool WaitingForList = false;
+	int64 NextListRequest = Now, NextReport = Now + time_freq()*5, LastReport = Now;
+
+	unsigned char aBuffer[NET_MAX_PACKETSIZE];
+	CNetPacketConstruct Packet;
+	NETADDR Addr;
+
+	while(1)
+	{
+		Now = time_get();
+		for(int i = 0; i < NumLoadServers; i++)
+		{
+			CLoadServer *pServer = &pServers[i];
+			int Bytes;
+			while((Bytes = net_udp_recv(pServer->m_Socket, &Addr, aBuffer, sizeof(aBuffer))) > 0)
+			{
+				if(CNetBase::UnpackPacket(aBuffer, Bytes, &Packet) != 0)
+					continue;
+
+				if(IsConnless(&Packet, SERVERBROWSE_FWCHECK, sizeof(SERVERBROWSE_FWCHECK)))
+				{
+					CNetBase::SendPacketConnless(pServer->m_Socket, &Addr, SERVERBROWSE_FWRESPONSE, sizeof(SERVERBROWSE_FWRESPONSE), false, 0);
+					NumChecks++;
+				}
+				else if(IsConnless(&Packet, SERVERBROWSE_GETINFO, sizeof(SERVERBROWSE_GETINFO)))
+					CNetBase::SendPacketConnless(pServer->m_Socket, &Addr, aInfoMsg, aInfoMsgSize, false, 0);
+				else if(IsConnless(&Packet, SERVERBROWSE_FWOK, sizeof(SERVERBROWSE_FWOK)) && !pServer->m_Registered)
+				{
+					pServer->m_Registered = true;
+					NumRegistered++;
+				}
+				else if(IsConnless(&Packet, SERVERBROWSE_FWERROR, sizeof(SERVERBROWSE_FWERROR)))
+					NumFailed++;
+			}
+
+			if(pServer->m_NextHeartBeat < Now)
+			{
+				pServer->m_NextHeartBeat = Now+time_freq()*(15+(rand()%15));
+				SendHeartBeat(pServer);
+				NumHeartBeats++;
+			}
+		}
+
+		// ask for the list like the clients do and time the first answer
+		if(ListRequestRate && NextListRequest < Now)
+		{
+			NextListRequest += time_freq()/ListRequestRate;
+			CNetBase::SendPacketConnless(ListSocket, &aMasterServers[0], SERVERBROWSE_GETLIST, sizeof(SERVERBROWSE_GETLIST), false, 0);
+			NumListRequests++;
+			ListRequestTime = Now;
+			WaitingForList = true;
+			LastListed = NumListed;
+			NumListed = 0;
+		}
+
+		int Bytes;
+		while((Bytes = net_udp_recv(ListSocket, &Addr, aBuffer, sizeof(aBuffer))) > 0)
+		{
+			if(CNetBase::UnpackPacket(aBuffer, Bytes, &Packet) != 0 || !IsConnless(&Packet, SERVERBROWSE_LIST, sizeof(SERVERBROWSE_LIST)))
+				continue;
+
+			NumListPackets++;
+			NumListed += (Packet.m_DataSize-sizeof(SERVERBROWSE_LIST))/sizeof(CMastersrvAddr);
+			if(WaitingForList)
+			{
+				WaitingForList = false;
+				int64 Latency = time_get()-ListRequestTime;
+				ListLatency += Latency;
+				MaxListLatency = max(MaxListLatency, Latency);
+				NumLatencies++;
+			}
+		}
+
+		if(NextReport < Now)
+		{
+			double Seconds = (Now-LastReport)/(double)time_freq();
+			dbg_msg("fake_server", "%d/%d servers registered, %d failed, %.1f heartbeats/s, %.1f checks/s",
+				NumRegistered, NumLoadServers, NumFailed, NumHeartBeats/Seconds, NumChecks/Seconds);
+			if(ListRequestRate)
+				dbg_msg("fake_server", "%.1f list requests/s, %.1f list packets/s, %d servers listed, first answer after %.2fms on average, %.2fms at most",
+					NumListRequests/Seconds, NumListPackets/Seconds, max(NumListed, LastListed),
+					NumLatencies ? ListLatency*1000.0/time_freq()/NumLatencies : 0.0, MaxListLatency*1000.0/time_freq());
+
+			NumHeartBeats = NumChecks = NumListRequests = NumListPackets = NumLatencies = 0;
+			ListLatency = MaxListLatency = 0;
+			LastReport = Now;
+			NextReport = Now + time_freq()*5;
+		}
+
+		thread_sleep(1);
+	}
+}
+
 static int Run()
 {
 	int64 NextHeartBeat = 0;
@@ -150,20 +310,37 @@ static int Run()
 
 int main(int argc, char **argv)
 {
+	dbg_logger_stdout();
 	pNet = new CNetServer;
 
 	while(argc)
 	{
-		// ?
-		/*if(str_comp(*argv, "-m") == 0)
+		if(str_comp(*argv, "-m") == 0 && argc > 1)
+		{
+			argc--; argv++;
+			if(NumMasters < 16 && net_host_lookup(*argv, &aMasterServers[NumMasters], NETTYPE_IPV4) == 0)
+			{
+				if(!aMasterServers[NumMasters].port)
+					aMasterServers[NumMasters].port = MASTERSERVER_PORT;
+				NumMasters++;
+			}
+		}
+		else if(str_comp(*argv, "-l") == 0 && argc > 1)
+		{
+			argc--; argv++;
+			NumLoadServers = str_toint(*argv);
+		}
+		else if(str_comp(*argv, "-b") == 0 && argc > 1)
 		{
 			argc--; argv++;
-			net_host_lookup(*argv, &aMasterServers[NumMasters], NETTYPE_IPV4);
+			LoadBasePort = str_toint(*argv);
+		}
+		else if(str_comp(*argv, "-r") == 0 && argc > 1)
+		{
 			argc--; argv++;
-			aMasterServers[NumMasters].port = str_toint(*argv);
-			NumMasters++;
+			ListRequestRate = str_toint(*argv);
 		}
-		else */if(str_comp(*argv, "-p") == 0)
+		else if(str_comp(*argv, "-p") == 0)
 		{
 			argc--; argv++;
 			PlayerNames[NumPlayers++] = *argv;
@@ -205,7 +382,7 @@ int main(int argc, char **argv)
 	}
 
 	BuildInfoMsg();
-	int RunReturn = Run();
+	int RunReturn = NumLoadServers > 0 ? RunLoad() : Run();
 
 	delete pNet;
 	return RunReturn;